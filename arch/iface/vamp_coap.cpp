@@ -0,0 +1,457 @@
+/**
+ *
+ *
+ *
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "vamp_coap.h"
+
+#ifdef VAMP_COAP
+
+#include "../../vamp_gw.h"
+#include "../../lib/vamp_url.h"
+#include "../../lib/vamp_coap.h"
+
+#ifdef VAMP_DNS_CACHE
+#include "vamp_dns.h"
+#endif /* VAMP_DNS_CACHE */
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+/* Mensaje CON esperando su ACK */
+typedef struct {
+	uint8_t tries;							// Envíos hechos, 0 = slot libre
+	uint16_t msg_id;
+	uint32_t next_time;						// Próxima retransmisión (millis)
+	uint32_t timeout;						// Timeout actual, se duplica en cada envío
+	IPAddress ip;
+	uint16_t port;
+	uint16_t len;
+	uint8_t dgram[VAMP_COAP_DGRAM_MAX];		// Datagrama tal como se envió
+} vamp_coap_retx_t;
+
+static WiFiUDP coap_udp;
+static bool coap_udp_ready = false;
+static uint16_t coap_msg_id = 0;
+
+static vamp_coap_retx_t coap_retx[VAMP_COAP_RETX_SLOTS];
+
+static uint8_t coap_tx[VAMP_COAP_DGRAM_MAX];
+static uint8_t coap_rx[VAMP_COAP_DGRAM_MAX];
+
+static bool vamp_coap_udp(void) {
+	if (!coap_udp_ready) {
+		coap_udp_ready = coap_udp.begin(VAMP_COAP_LOCAL_PORT);
+	}
+	return coap_udp_ready;
+}
+
+static bool vamp_coap_send(IPAddress ip, uint16_t port, const uint8_t * dgram, size_t len) {
+	if (!coap_udp.beginPacket(ip, port)) {
+		return false;
+	}
+	coap_udp.write(dgram, len);
+	return coap_udp.endPacket() == 1;
+}
+
+static uint16_t vamp_coap_next_id(void) {
+	if (coap_msg_id == 0) {
+		coap_msg_id = (uint16_t)random(1, 0xFFFF);
+	}
+	return coap_msg_id++;
+}
+
+/* Timeout inicial con el factor aleatorio de RFC 7252 (entre 1 y 1.5) */
+static uint32_t vamp_coap_initial_timeout(void) {
+	return VAMP_COAP_ACK_TIMEOUT + random(0, VAMP_COAP_ACK_TIMEOUT / 2 + 1);
+}
+
+/* ----------------------------- Retransmisión --------------------------------- */
+
+/* Guardar un CON recién enviado, sin slot libre se pisa el que más reintentos lleva */
+static vamp_coap_retx_t * vamp_coap_retx_add(IPAddress ip, uint16_t port, const uint8_t * dgram, size_t len, uint16_t msg_id) {
+
+	vamp_coap_retx_t * slot = &coap_retx[0];
+	for (uint8_t i = 0; i < VAMP_COAP_RETX_SLOTS; i++) {
+		if (!coap_retx[i].tries) {
+			slot = &coap_retx[i];
+			break;
+		}
+		if (coap_retx[i].tries > slot->tries) {
+			slot = &coap_retx[i];
+		}
+	}
+
+	#ifdef VAMP_DEBUG
+	if (slot->tries) {
+		printf("[COAP] Retransmission table full, giving up MID %u\n", slot->msg_id);
+	}
+	#endif /* VAMP_DEBUG */
+
+	memcpy(slot->dgram, dgram, len);
+	slot->len = (uint16_t)len;
+	slot->ip = ip;
+	slot->port = port;
+	slot->msg_id = msg_id;
+	slot->tries = 1;
+	slot->timeout = vamp_coap_initial_timeout();
+	slot->next_time = millis() + slot->timeout;
+
+	return slot;
+}
+
+static vamp_coap_retx_t * vamp_coap_retx_find(uint16_t msg_id) {
+	for (uint8_t i = 0; i < VAMP_COAP_RETX_SLOTS; i++) {
+		if (coap_retx[i].tries && coap_retx[i].msg_id == msg_id) {
+			return &coap_retx[i];
+		}
+	}
+	return NULL;
+}
+
+/* Reenviar y duplicar el timeout */
+static void vamp_coap_retx_resend(vamp_coap_retx_t * slot) {
+	vamp_coap_send(slot->ip, slot->port, slot->dgram, slot->len);
+	slot->tries++;
+	slot->timeout *= 2;
+	slot->next_time = millis() + slot->timeout;
+}
+
+static void vamp_coap_retx_service(void) {
+
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_COAP_RETX_SLOTS; i++) {
+		vamp_coap_retx_t * slot = &coap_retx[i];
+		if (!slot->tries || (int32_t)(now - slot->next_time) < 0) {
+			continue;
+		}
+		if (slot->tries > VAMP_COAP_MAX_RETRANSMIT) {
+			#ifdef VAMP_DEBUG
+			printf("[COAP] MID %u not acknowledged, dropped\n", slot->msg_id);
+			#endif /* VAMP_DEBUG */
+			slot->tries = 0;
+			continue;
+		}
+		vamp_coap_retx_resend(slot);
+	}
+}
+
+/* ----------------------------- Intercambio --------------------------------- */
+
+/* Leer un datagrama si hay. Los ACK/RST liberan su slot y los CON del servidor
+ * (respuestas separadas) se confirman con un ACK vacío */
+static bool vamp_coap_receive(vamp_coap_msg_t * msg) {
+
+	int size = coap_udp.parsePacket();
+	if (size <= 0) {
+		return false;
+	}
+
+	int len = coap_udp.read(coap_rx, sizeof(coap_rx));
+	if (len <= 0 || !vamp_coap_parse(coap_rx, (size_t)len, msg)) {
+		return false;
+	}
+
+	if (msg->type == VAMP_COAP_ACK || msg->type == VAMP_COAP_RST) {
+		vamp_coap_retx_t * slot = vamp_coap_retx_find(msg->msg_id);
+		if (slot) {
+			slot->tries = 0;
+		}
+	} else if (msg->type == VAMP_COAP_CON) {
+		uint8_t ack[4];
+		vamp_coap_writer_t writer;
+		vamp_coap_begin(&writer, ack, sizeof(ack), VAMP_COAP_ACK, VAMP_COAP_EMPTY, msg->msg_id, NULL, 0);
+		size_t ack_len = vamp_coap_finish(&writer, NULL, 0);
+		if (ack_len) {
+			vamp_coap_send(coap_udp.remoteIP(), coap_udp.remotePort(), ack, ack_len);
+		}
+	}
+
+	return true;
+}
+
+/* Enviar el request que está en coap_tx y esperar la respuesta con ese token.
+ * Un CON que se queda sin respuesta sigue en la tabla de retransmisión */
+static bool vamp_coap_exchange(IPAddress ip, uint16_t port, size_t len, uint8_t type,
+		uint16_t msg_id, const uint8_t * token, vamp_coap_msg_t * response) {
+
+	vamp_coap_retx_t * slot = NULL;
+	if (type == VAMP_COAP_CON) {
+		slot = vamp_coap_retx_add(ip, port, coap_tx, len, msg_id);
+	}
+
+	vamp_coap_send(ip, port, coap_tx, len);
+
+	uint32_t deadline = millis() + (slot ? slot->timeout : VAMP_COAP_ACK_TIMEOUT);
+	uint8_t sync_tries = 1;
+
+	while (true) {
+		vamp_coap_msg_t msg;
+
+		if (vamp_coap_receive(&msg)) {
+			/* Respuesta, en el ACK (piggybacked) o separada */
+			if (msg.code != VAMP_COAP_EMPTY && msg.token_len == VAMP_COAP_TOKEN_LEN &&
+					memcmp(msg.token, token, VAMP_COAP_TOKEN_LEN) == 0) {
+				vamp_coap_retx_t * pending = vamp_coap_retx_find(msg_id);
+				if (pending) {
+					pending->tries = 0;
+				}
+				*response = msg;
+				return true;
+			}
+			if (msg.msg_id == msg_id && msg.type == VAMP_COAP_RST) {
+				return false;
+			}
+			/* ACK vacío: el servidor responderá aparte */
+			if (msg.msg_id == msg_id && msg.type == VAMP_COAP_ACK) {
+				deadline = millis() + VAMP_COAP_ACK_TIMEOUT * 2;
+			}
+			continue;
+		}
+
+		if ((int32_t)(millis() - deadline) >= 0) {
+			vamp_coap_retx_t * pending = slot ? vamp_coap_retx_find(msg_id) : NULL;
+			if (!pending || sync_tries >= VAMP_COAP_SYNC_TRIES) {
+				return false;
+			}
+			vamp_coap_retx_resend(pending);
+			deadline = pending->next_time;
+			sync_tries++;
+		}
+
+		yield();
+	}
+}
+
+/* Armar en coap_tx un request al endpoint del perfil */
+static size_t vamp_coap_build(const vamp_url_t * url, const vamp_profile_t * profile, uint8_t type,
+		uint8_t code, uint16_t msg_id, const uint8_t * token, const uint32_t * block2,
+		const uint32_t * block1, const uint8_t * payload, size_t payload_len) {
+
+	vamp_coap_writer_t writer;
+	vamp_coap_begin(&writer, coap_tx, sizeof(coap_tx), type, code, msg_id, token, VAMP_COAP_TOKEN_LEN);
+
+	/* Opciones en orden: Uri-Path, Content-Format, Uri-Query, Block2, Block1 */
+	vamp_coap_add_split_option(&writer, VAMP_COAP_OPT_URI_PATH, url->path, '/', '?');
+
+	if (payload_len || block1) {
+		vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_CONTENT_FORMAT, VAMP_COAP_FORMAT_JSON);
+	}
+
+	const char * query = strchr(url->path, '?');
+	if (query) {
+		vamp_coap_add_split_option(&writer, VAMP_COAP_OPT_URI_QUERY, query + 1, '&', '\0');
+	}
+	for (uint8_t i = 0; i < profile->query_params.count && profile->query_params.pairs; i++) {
+		char pair[VAMP_KEY_MAX_LEN + VAMP_VALUE_MAX_LEN + 1];
+		int pair_len = snprintf(pair, sizeof(pair), "%s=%s",
+				profile->query_params.pairs[i].key, profile->query_params.pairs[i].value);
+		if (pair_len > 0 && pair_len < (int)sizeof(pair)) {
+			vamp_coap_add_option(&writer, VAMP_COAP_OPT_URI_QUERY, (const uint8_t *)pair, (size_t)pair_len);
+		}
+	}
+
+	if (block2) {
+		vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_BLOCK2, *block2);
+	}
+	if (block1) {
+		vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_BLOCK1, *block1);
+	}
+
+	return vamp_coap_finish(&writer, payload, payload_len);
+}
+
+size_t vamp_coap_request(const vamp_profile_t * profile, char * data, size_t len, size_t data_size) {
+
+	if (!profile || !profile->endpoint_resource || !data || data_size == 0) {
+		return 0;
+	}
+
+	vamp_url_t url;
+	if (!vamp_url_parse(profile->endpoint_resource, &url) || strcmp(url.scheme, "coap") != 0) {
+		#ifdef VAMP_DEBUG
+		printf("[COAP] Unsupported endpoint %s\n", profile->endpoint_resource);
+		#endif /* VAMP_DEBUG */
+		return 0;
+	}
+
+	if (WiFi.status() != WL_CONNECTED || !vamp_coap_udp()) {
+		return 0;
+	}
+
+	IPAddress ip;
+	#ifdef VAMP_DNS_CACHE
+	bool resolved = vamp_dns_resolve(url.host, ip) != VAMP_DNS_FAIL;
+	#else
+	bool resolved = WiFi.hostByName(url.host, ip);
+	#endif /* VAMP_DNS_CACHE */
+	if (!resolved) {
+		#ifdef VAMP_DEBUG
+		printf("[COAP] Cannot resolve %s\n", url.host);
+		#endif /* VAMP_DEBUG */
+		return 0;
+	}
+
+	/* Los mismos métodos que HTTP */
+	uint8_t code;
+	switch (profile->method) {
+		case VAMP_HTTP_METHOD_GET:		code = VAMP_COAP_GET;		break;
+		case VAMP_HTTP_METHOD_POST:		code = VAMP_COAP_POST;		break;
+		case VAMP_HTTP_METHOD_PUT:		code = VAMP_COAP_PUT;		break;
+		case VAMP_HTTP_METHOD_DELETE:	code = VAMP_COAP_DELETE;	break;
+		default:
+			return 0;
+	}
+
+	const char * type_opt = vamp_kv_get(&profile->protocol_options, "type");
+	uint8_t type = (type_opt && strcmp(type_opt, "non") == 0) ? VAMP_COAP_NON : VAMP_COAP_CON;
+
+	size_t payload_len = (code == VAMP_COAP_POST || code == VAMP_COAP_PUT) ? len : 0;
+	const size_t block_size = VAMP_COAP_BLOCK_SIZE(VAMP_COAP_BLOCK_SZX);
+	bool blockwise = payload_len > block_size;
+
+	/* Cada bloque necesita su 2.31 Continue */
+	if (blockwise) {
+		type = VAMP_COAP_CON;
+	}
+
+	uint8_t token[VAMP_COAP_TOKEN_LEN];
+	for (uint8_t i = 0; i < VAMP_COAP_TOKEN_LEN; i++) {
+		token[i] = (uint8_t)random(0, 256);
+	}
+
+	vamp_coap_msg_t response;
+	size_t offset = 0;
+	uint32_t num = 0;
+
+	/* Request, por bloques (Block1) si el payload no cabe en uno */
+	do {
+		size_t chunk = payload_len - offset;
+		bool more = false;
+		if (chunk > block_size) {
+			chunk = block_size;
+			more = true;
+		}
+		uint32_t block1 = VAMP_COAP_BLOCK(num, more, VAMP_COAP_BLOCK_SZX);
+		uint16_t msg_id = vamp_coap_next_id();
+
+		size_t len = vamp_coap_build(&url, profile, type, code, msg_id, token, NULL,
+				blockwise ? &block1 : NULL, (const uint8_t *)data + offset, chunk);
+		if (!len) {
+			#ifdef VAMP_DEBUG
+			printf("[COAP] Request does not fit in %d bytes\n", VAMP_COAP_DGRAM_MAX);
+			#endif /* VAMP_DEBUG */
+			return 0;
+		}
+
+		/* NON sin respuesta que esperar */
+		if (type == VAMP_COAP_NON && code != VAMP_COAP_GET) {
+			vamp_coap_send(ip, url.port, coap_tx, len);
+			return 0;
+		}
+
+		if (!vamp_coap_exchange(ip, url.port, len, type, msg_id, token, &response)) {
+			#ifdef VAMP_DEBUG
+			printf("[COAP] No response for block %lu\n", (unsigned long)num);
+			#endif /* VAMP_DEBUG */
+			return 0;
+		}
+
+		if (VAMP_COAP_CODE_CLASS(response.code) != 2) {
+			#ifdef VAMP_DEBUG
+			printf("[COAP] Error %d.%02d\n", VAMP_COAP_CODE_CLASS(response.code), response.code & 0x1F);
+			#endif /* VAMP_DEBUG */
+			return 0;
+		}
+
+		offset += chunk;
+		num++;
+
+		if (more && response.code != VAMP_COAP_CONTINUE) {
+			/* El servidor respondió sin pedir el resto */
+			break;
+		}
+	} while (offset < payload_len);
+
+	/* Respuesta, los bloques siguientes (Block2) se piden uno a uno */
+	size_t total = 0;
+	while (true) {
+		size_t copy = response.payload_len;
+		if (total + copy > data_size - 1) {
+			copy = data_size - 1 - total;
+		}
+		memcpy(data + total, response.payload, copy);
+		total += copy;
+
+		if (!response.has_block2 || !VAMP_COAP_BLOCK_MORE(response.block2) || total >= data_size - 1) {
+			break;
+		}
+
+		uint32_t block2 = VAMP_COAP_BLOCK(VAMP_COAP_BLOCK_NUM(response.block2) + 1, false, response.block2 & 0x07);
+		uint16_t msg_id = vamp_coap_next_id();
+		size_t len = vamp_coap_build(&url, profile, type, code, msg_id, token, &block2, NULL, NULL, 0);
+
+		if (!len || !vamp_coap_exchange(ip, url.port, len, type, msg_id, token, &response) ||
+				VAMP_COAP_CODE_CLASS(response.code) != 2) {
+			#ifdef VAMP_DEBUG
+			printf("[COAP] Block2 transfer interrupted\n");
+			#endif /* VAMP_DEBUG */
+			break;
+		}
+	}
+
+	data[total] = '\0';
+
+	#ifdef VAMP_DEBUG
+	printf("[COAP] Response %d.%02d, %u bytes\n", VAMP_COAP_CODE_CLASS(response.code),
+			response.code & 0x1F, (unsigned)total);
+	#endif /* VAMP_DEBUG */
+
+	return total;
+}
+
+void vamp_coap_loop(void) {
+
+	if (!coap_udp_ready) {
+		return;
+	}
+
+	/* ACKs que llegaron tarde */
+	vamp_coap_msg_t msg;
+	while (vamp_coap_receive(&msg)) {
+	}
+
+	vamp_coap_retx_service();
+}
+
+/* El request es síncrono: send deja la respuesta en data y receive da su largo */
+static size_t coap_last_len = 0;
+
+static bool vamp_coap_send_request(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
+	coap_last_len = vamp_coap_request(profile, data, len, size);
+	return true;
+}
+
+static size_t vamp_coap_receive_response(const vamp_profile_t * profile, char * data, size_t size) {
+	(void)profile;
+	(void)data;
+	(void)size;
+	size_t len = coap_last_len;
+	coap_last_len = 0;
+	return len;
+}
+
+const vamp_transport_t vamp_coap_transport = {
+	NULL,
+	vamp_coap_send_request,
+	vamp_coap_receive_response,
+	vamp_coap_loop
+};
+
+#endif /* VAMP_COAP */
+
+#endif // ARDUINO_ARCH_ESP8266
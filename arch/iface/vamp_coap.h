@@ -0,0 +1,37 @@
+/**
+ *
+ * Transporte CoAP (coap://) sobre UDP
+ *
+ */
+#ifndef VAMP_COAP_IFACE_H_
+#define VAMP_COAP_IFACE_H_
+
+#include <Arduino.h>
+#include "../../vamp_config.h"
+#include "../../lib/vamp_table.h"
+#include "../../lib/vamp_transport.h"
+
+#ifdef VAMP_COAP
+
+/** @brief Envía un request CoAP con el método y el endpoint del perfil
+ *
+ * Un CON se reintenta VAMP_COAP_SYNC_TRIES veces esperando la respuesta, si no
+ * llega queda en la tabla de retransmisión y vamp_coap_loop() sigue con él.
+ *
+ * @param profile Perfil de comunicación (endpoint coap://)
+ * @param data Datos a enviar, si hay respuesta data la contiene
+ * @param len Largo de los datos a enviar (payload del POST/PUT)
+ * @param data_size Tamaño del buffer data
+ * @return Largo de la respuesta, 0 si no hubo (NON, error o sin ACK todavía)
+ */
+size_t vamp_coap_request(const vamp_profile_t * profile, char * data, size_t len, size_t data_size);
+
+/** @brief Procesa ACKs atrasados y retransmite los CON pendientes, no bloquea */
+void vamp_coap_loop(void);
+
+/** @brief Transporte CoAP para el registro */
+extern const vamp_transport_t vamp_coap_transport;
+
+#endif /* VAMP_COAP */
+
+#endif // VAMP_COAP_IFACE_H_
@@ -0,0 +1,252 @@
+/**
+ *
+ *
+ *
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "vamp_dns.h"
+
+#ifdef VAMP_DNS_CACHE
+
+#include "../../lib/vamp_url.h"
+
+#include <lwip/dns.h>
+
+/* Host en la caché */
+typedef struct {
+	char host[VAMP_URL_HOST_MAX_LEN];		// "" = libre
+	IPAddress ip;
+	bool valid;								// Se resolvió alguna vez
+	bool failed;							// La última resolución falló
+	bool used;								// Consultado desde la última resolución
+	uint8_t pending;						// Generación de la resolución en curso, 0 = ninguna
+	uint32_t resolved_at;					// Última resolución exitosa (millis)
+	uint32_t started_at;					// Inicio de la resolución en curso o de la fallida
+	uint32_t last_used;
+} vamp_dns_entry_t;
+
+static vamp_dns_entry_t dns_cache[VAMP_DNS_SLOTS];
+
+/* El callback puede llegar después de reutilizar la entrada, la generación lo descarta */
+static uint8_t dns_gen = 0;
+
+static bool vamp_dns_fresh(const vamp_dns_entry_t * entry, uint32_t now) {
+	return entry->valid && (now - entry->resolved_at) < VAMP_DNS_TTL;
+}
+
+static bool vamp_dns_in_grace(const vamp_dns_entry_t * entry, uint32_t now) {
+	return entry->valid && (now - entry->resolved_at) < (uint32_t)(VAMP_DNS_TTL + VAMP_DNS_STALE_GRACE);
+}
+
+static void vamp_dns_store(vamp_dns_entry_t * entry, const ip_addr_t * addr) {
+	entry->pending = 0;
+	if (addr) {
+		entry->ip = IPAddress(addr);
+		entry->valid = true;
+		entry->failed = false;
+		entry->resolved_at = millis();
+	} else {
+		entry->failed = true;
+		#ifdef VAMP_DEBUG
+		printf("[DNS] %s not resolved%s\n", entry->host, entry->valid ? ", keeping last address" : "");
+		#endif /* VAMP_DEBUG */
+	}
+}
+
+/* El argumento lleva índice y generación */
+static void vamp_dns_found(const char * name, const ip_addr_t * ipaddr, void * arg) {
+	(void)name;
+	uintptr_t tag = (uintptr_t)arg;
+	uint8_t index = (uint8_t)(tag & 0xFF);
+	uint8_t gen = (uint8_t)(tag >> 8);
+
+	if (index >= VAMP_DNS_SLOTS || dns_cache[index].pending != gen) {
+		return;
+	}
+	vamp_dns_store(&dns_cache[index], ipaddr);
+}
+
+static void vamp_dns_start(vamp_dns_entry_t * entry) {
+
+	if (++dns_gen == 0) {
+		dns_gen = 1;
+	}
+	entry->pending = dns_gen;
+	entry->started_at = millis();
+	entry->used = false;
+
+	uint8_t index = (uint8_t)(entry - dns_cache);
+	ip_addr_t addr;
+	err_t err = dns_gethostbyname(entry->host, &addr, vamp_dns_found,
+			(void *)(uintptr_t)(((uintptr_t)dns_gen << 8) | index));
+
+	if (err == ERR_OK) {
+		vamp_dns_store(entry, &addr);
+	} else if (err != ERR_INPROGRESS) {
+		vamp_dns_store(entry, NULL);
+	}
+}
+
+/* Entrada del host, o una libre / la menos usada que no esté resolviendo */
+static vamp_dns_entry_t * vamp_dns_entry(const char * host) {
+
+	vamp_dns_entry_t * candidate = NULL;
+
+	for (uint8_t i = 0; i < VAMP_DNS_SLOTS; i++) {
+		vamp_dns_entry_t * entry = &dns_cache[i];
+		if (entry->host[0] && strcmp(entry->host, host) == 0) {
+			return entry;
+		}
+		if (entry->pending) {
+			continue;
+		}
+		if (!entry->host[0]) {
+			if (!candidate || candidate->host[0]) {
+				candidate = entry;
+			}
+			continue;
+		}
+		if (!candidate || (candidate->host[0] && (int32_t)(entry->last_used - candidate->last_used) < 0)) {
+			candidate = entry;
+		}
+	}
+
+	if (!candidate) {
+		return NULL;
+	}
+
+	*candidate = vamp_dns_entry_t();
+	strncpy(candidate->host, host, sizeof(candidate->host) - 1);
+	return candidate;
+}
+
+uint8_t vamp_dns_query(const char * host, IPAddress & ip) {
+
+	if (!host || !host[0]) {
+		return VAMP_DNS_FAIL;
+	}
+
+	/* Una IP no pasa por la caché */
+	if (ip.fromString(host)) {
+		return VAMP_DNS_OK;
+	}
+
+	vamp_dns_entry_t * entry = vamp_dns_entry(host);
+	if (!entry) {
+		return VAMP_DNS_FAIL;
+	}
+
+	uint32_t now = millis();
+	entry->used = true;
+	entry->last_used = now;
+
+	if (entry->pending && (now - entry->started_at) >= VAMP_DNS_TIMEOUT) {
+		vamp_dns_store(entry, NULL);
+	}
+
+	if (vamp_dns_fresh(entry, now)) {
+		ip = entry->ip;
+		return VAMP_DNS_OK;
+	}
+
+	/* Vencida o nueva: resolver, tras un fallo se espera VAMP_DNS_TIMEOUT para reintentar */
+	if (!entry->pending && (!entry->failed || (now - entry->started_at) >= VAMP_DNS_TIMEOUT)) {
+		vamp_dns_start(entry);
+		if (vamp_dns_fresh(entry, millis())) {
+			ip = entry->ip;
+			return VAMP_DNS_OK;
+		}
+	}
+
+	if (entry->pending) {
+		return VAMP_DNS_PENDING;
+	}
+
+	if (vamp_dns_in_grace(entry, now)) {
+		ip = entry->ip;
+		return VAMP_DNS_STALE;
+	}
+
+	return VAMP_DNS_FAIL;
+}
+
+uint8_t vamp_dns_resolve(const char * host, IPAddress & ip) {
+
+	uint32_t start = millis();
+	uint8_t result = vamp_dns_query(host, ip);
+
+	while (result == VAMP_DNS_PENDING && (millis() - start) < VAMP_DNS_TIMEOUT) {
+		delay(10);
+		result = vamp_dns_query(host, ip);
+	}
+
+	return result == VAMP_DNS_PENDING ? VAMP_DNS_FAIL : result;
+}
+
+bool vamp_dns_connect(WiFiClient * client, const char * host, uint16_t port, bool secure) {
+
+	if (!client) {
+		return false;
+	}
+
+	IPAddress ip;
+	uint8_t result = vamp_dns_resolve(host, ip);
+	if (result == VAMP_DNS_FAIL) {
+		#ifdef VAMP_DEBUG
+		printf("[DNS] Cannot resolve %s\n", host);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	if (secure && result == VAMP_DNS_OK) {
+		return client->connect(host, port);
+	}
+
+	#ifdef VAMP_DEBUG
+	if (result == VAMP_DNS_STALE) {
+		printf("[DNS] Using last known address for %s\n", host);
+	}
+	#endif /* VAMP_DEBUG */
+
+	return client->connect(ip, port);
+}
+
+void vamp_dns_loop(void) {
+
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_DNS_SLOTS; i++) {
+		vamp_dns_entry_t * entry = &dns_cache[i];
+		if (!entry->host[0]) {
+			continue;
+		}
+
+		if (entry->pending) {
+			if ((now - entry->started_at) >= VAMP_DNS_TIMEOUT) {
+				vamp_dns_store(entry, NULL);
+			}
+			continue;
+		}
+
+		/* Refresh-ahead solo de los hosts que se usaron desde la última resolución */
+		if (entry->valid && entry->used && !entry->failed &&
+				(now - entry->resolved_at) >= (uint32_t)(VAMP_DNS_TTL - VAMP_DNS_PREFETCH)) {
+			#ifdef VAMP_DEBUG
+			printf("[DNS] Refreshing %s\n", entry->host);
+			#endif /* VAMP_DEBUG */
+			vamp_dns_start(entry);
+			continue;
+		}
+
+		/* Sin uso y sin dirección de respaldo: se libera */
+		if (!vamp_dns_in_grace(entry, now) && (now - entry->last_used) >= VAMP_DNS_TTL) {
+			entry->host[0] = '\0';
+		}
+	}
+}
+
+#endif /* VAMP_DNS_CACHE */
+
+#endif // ARDUINO_ARCH_ESP8266
@@ -0,0 +1,56 @@
+/**
+ *
+ * Caché de resolución DNS por host, con refresh-ahead y dirección de respaldo
+ *
+ */
+#ifndef VAMP_DNS_IFACE_H_
+#define VAMP_DNS_IFACE_H_
+
+#include <Arduino.h>
+#include "../../vamp_config.h"
+
+#ifdef VAMP_DNS_CACHE
+
+#include <ESP8266WiFi.h>
+
+/* Resultados de vamp_dns_query() */
+#define VAMP_DNS_OK			0	// Dirección vigente
+#define VAMP_DNS_STALE		1	// Vencida y el DNS no respondió, es la última conocida
+#define VAMP_DNS_PENDING	2	// Resolviendo
+#define VAMP_DNS_FAIL		3	// Sin dirección
+
+/** @brief Dirección del host sin bloquear
+ *
+ * Si no está en la caché o venció arranca la resolución y devuelve PENDING. Si
+ * la resolución falla se sigue usando la última dirección durante
+ * VAMP_DNS_STALE_GRACE. Marca el host como en uso para el refresh-ahead.
+ *
+ * @param host Nombre o IP
+ * @param ip Dirección, válida con OK o STALE
+ * @return VAMP_DNS_OK / STALE / PENDING / FAIL
+ */
+uint8_t vamp_dns_query(const char * host, IPAddress & ip);
+
+/** @brief Igual que vamp_dns_query() pero espera la resolución hasta VAMP_DNS_TIMEOUT,
+ *  para los transportes que conectan de forma bloqueante
+ *
+ * @return VAMP_DNS_OK / STALE / FAIL
+ */
+uint8_t vamp_dns_resolve(const char * host, IPAddress & ip);
+
+/** @brief Conectar el cliente al host usando la caché
+ *
+ * Sin TLS conecta a la dirección. Con TLS conecta por nombre para el SNI (lwIP
+ * lo tiene recién resuelto), salvo que la dirección sea la de respaldo.
+ *
+ * @return true si conectó
+ */
+bool vamp_dns_connect(WiFiClient * client, const char * host, uint16_t port, bool secure);
+
+/** @brief Refresca antes de vencer los hosts en uso, vence la espera de las
+ *  resoluciones y libera los que no se usan. No bloquea */
+void vamp_dns_loop(void);
+
+#endif /* VAMP_DNS_CACHE */
+
+#endif // VAMP_DNS_IFACE_H_
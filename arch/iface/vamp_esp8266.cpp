@@ -26,6 +26,22 @@
 #include <ESP8266HTTPClient.h>
 #include <WiFiClientSecure.h>
 
+#if defined(VAMP_SYNC_LONGPOLL) || defined(VAMP_BREAKER) || defined(VAMP_DNS_CACHE)
+#include "../../lib/vamp_url.h"
+#endif
+
+#ifdef VAMP_BREAKER
+#include "../../lib/vamp_breaker.h"
+#endif /* VAMP_BREAKER */
+
+#ifdef VAMP_DNS_CACHE
+#include "vamp_dns.h"
+#endif /* VAMP_DNS_CACHE */
+
+#ifdef VAMP_SELECT
+#include "../../lib/vamp_jsel.h"
+#endif /* VAMP_SELECT */
+
 
 /* ----------------------------- WiFi --------------------------------- */
 
@@ -41,7 +57,6 @@
 
 // Configuración HTTPS para comunicación con VAMP Registry y endpoints
 #define HTTPS_TIMEOUT 		8000              // Timeout para requests HTTPS (ms)
-#define HTTPS_USER_AGENT 	"VAMP-Gateway/1.0" // User agent para requests
 
 //static char * wifi_ssid_local = NULL;
 //static char * wifi_password_local = NULL;
@@ -308,9 +323,68 @@ bool esp8266_sta_init(const gw_config_t * config){
 }
 
 
+#ifdef VAMP_SELECT
+static vamp_jsel_t http_sel;
+
+/* Preparar la proyección si el perfil pide campos del cuerpo */
+static bool esp8266_http_select_init(const vamp_profile_t * profile) {
+
+	const char * select = vamp_kv_get(&profile->protocol_options, VAMP_SELECT_OPTION);
+	if (select == NULL) {
+		return false;
+	}
+
+	if (!vamp_jsel_init(&http_sel, select, vamp_kv_get(&profile->protocol_options, VAMP_PACK_OPTION))) {
+		#ifdef VAMP_DEBUG
+		printf("[HTTP] Invalid selector '%s', full body used\n", select);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	return true;
+}
+
+/* Pasar len bytes del cuerpo por la proyección, con len < 0 hasta que el
+   servidor cierre o venza el timeout
+   @return Bytes leídos, 0 si ya están todos los campos o el cuerpo no es JSON */
+static int esp8266_http_select(WiFiClient * stream, int len) {
+
+	uint8_t block[64];
+	int total = 0;
+
+	while (len < 0 || total < len) {
+		int want;
+		if (len < 0) {
+			/* Lo disponible, o esperar un byte mientras siga conectado */
+			want = stream->available();
+			if (want <= 0) {
+				if (!stream->connected()) {
+					break;
+				}
+				want = 1;
+			}
+			want = want < (int)sizeof(block) ? want : (int)sizeof(block);
+		} else {
+			want = (len - total) < (int)sizeof(block) ? (len - total) : (int)sizeof(block);
+		}
+		int read = stream->readBytes(block, want);
+		if (read <= 0) {
+			break;
+		}
+		for (int i = 0; i < read; i++) {
+			if (vamp_jsel_feed(&http_sel, block[i]) != 0) {
+				return 0;
+			}
+		}
+		total += read;
+	}
+
+	return total;
+}
+#endif /* VAMP_SELECT */
+
 /* Función unificada para enviar datos por HTTP/HTTPS */
-/* ToDo aqui data_size que medio como a la bartola hay que ver que bola con esto */
-size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t data_size) {
+size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t len, size_t data_size) {
 
 	/* Verificar conexión WiFi */
 	if (!esp8266_check_conn()) {
@@ -345,19 +419,9 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 		return 0;
 	}
 
-	/* Chequeo del protocolo */
-	uint8_t profile_protocol = 0;
-	/* https */
-	if(strncmp(profile->endpoint_resource, "https://", 8) == 0) {
-		profile_protocol = VAMP_PROTOCOL_HTTPS;
-	}
-	/* http */ 
-	else if (strncmp(profile->endpoint_resource, "http://", 7) == 0) {
-		profile_protocol = VAMP_PROTOCOL_HTTP;
-	}
-	/* ... resto de los protocolos no implementados */
-	/* Protocolo no soportado */ 
-	else {
+	/* Chequeo del protocolo, resuelto al configurar el perfil */
+	uint8_t profile_protocol = profile->protocol;
+	if (profile_protocol != VAMP_PROTOCOL_HTTP && profile_protocol != VAMP_PROTOCOL_HTTPS) {
 		#ifdef VAMP_DEBUG
 		printf("[HTTP] Unsupported protocol in endpoint resource\n");
 		#endif /* VAMP_DEBUG */
@@ -412,6 +476,30 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 				profile->protocol_options.count);
 	#endif /* VAMP_DEBUG */
 
+	#ifdef VAMP_DNS_CACHE
+	/* HTTPClient resuelve por nombre, consultar la caché mantiene el host en uso
+	para que el refresh-ahead lo tenga resuelto antes de vencer */
+	{
+		vamp_url_t dns_url;
+		IPAddress dns_ip;
+		if (vamp_url_parse(profile->endpoint_resource, &dns_url)) {
+			vamp_dns_query(dns_url.host, dns_ip);
+		}
+	}
+	#endif /* VAMP_DNS_CACHE */
+
+	#ifdef VAMP_BREAKER
+	/* Con el circuito abierto ni se intenta, el host está caído */
+	vamp_url_t breaker_url;
+	bool breaker_tracked = vamp_url_parse(profile->endpoint_resource, &breaker_url);
+	if (breaker_tracked && !vamp_breaker_allow(breaker_url.host, breaker_url.port, millis())) {
+		#ifdef VAMP_DEBUG
+		printf("[HTTP] Circuit open for %s, request skipped\n", breaker_url.host);
+		#endif /* VAMP_DEBUG */
+		return 0;
+	}
+	#endif /* VAMP_BREAKER */
+
 	/* Hacer siempre una nueva conexion */
 	https_http->setReuse(false);
 
@@ -502,7 +590,8 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 			const char* key = profile->protocol_options.pairs[i].key;
 			const char* value = profile->protocol_options.pairs[i].value;
 			
-			if (key[0] != '\0' && value[0] != '\0') {
+			/* Las directivas (vamp_*) son para el gateway */
+			if (key[0] != '\0' && value[0] != '\0' && !vamp_kv_is_directive(key)) {
 				https_http->addHeader(key, value);
 				
 				#ifdef VAMP_DEBUG
@@ -514,6 +603,12 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 
 	https_http->setTimeout(HTTPS_TIMEOUT);
 
+	#ifdef VAMP_SELECT
+	/* Sin Content-Length el cuerpo puede ser chunked o seguir hasta el cierre */
+	static const char * select_headers[] = { "Transfer-Encoding" };
+	https_http->collectHeaders(select_headers, 1);
+	#endif /* VAMP_SELECT */
+
 	/* Enviar request según método */
 	int httpResponseCode = -1;
 	
@@ -530,11 +625,19 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 			#ifdef VAMP_DEBUG
 			printf("[HTTP] Sending POST request %s...\n", (profile_protocol == VAMP_PROTOCOL_HTTPS) ? "(HTTPS)" : "(HTTP)");
 			#endif /* VAMP_DEBUG */
-			httpResponseCode = https_http->POST((uint8_t*)data, data_size);
+			httpResponseCode = https_http->POST((uint8_t*)data, len);
 			break;
 		default:
 			break;
 	}
+
+	#ifdef VAMP_BREAKER
+	/* Sin respuesta (código negativo de HTTPClient) o 5xx cuenta como fallo del host */
+	if (breaker_tracked) {
+		vamp_breaker_report(breaker_url.host, breaker_url.port,
+				httpResponseCode > 0 && httpResponseCode < 500, millis());
+	}
+	#endif /* VAMP_BREAKER */
 	
 	/* ------------------- Procesar respuesta  ------------------- */
 	
@@ -574,9 +677,19 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 
 		total_read = 0;
 
+		/* Con proyección el cuerpo no se guarda, se lee hasta tener los campos */
+		bool selecting = false;
+		#ifdef VAMP_SELECT
+		selecting = esp8266_http_select_init(profile);
+		if (selecting && is_chunked && !https_http->hasHeader("Transfer-Encoding")) {
+		    /* Sin largo ni chunks: el cuerpo termina cuando el servidor cierra */
+		    is_chunked = false;
+		}
+		#endif /* VAMP_SELECT */
+
 		if (is_chunked) {
 		    /* CHUNKED: Decodificar manualmente SIN string */
-		    while (total_read < (int)(data_size - 1)) {
+		    while (selecting || total_read < (int)(data_size - 1)) {
 		        /* Leer tamaño del chunk (línea HEX) byte a byte */
 		        char hex_buf[16];
 		        int hex_idx = 0;
@@ -597,6 +710,17 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 		        /* Saltar \n si no se leyó con \r */
 		        if (stream->peek() == '\n') stream->read();
 		        
+		        #ifdef VAMP_SELECT
+		        if (selecting) {
+		            int read = esp8266_http_select(stream, chunk_size);
+		            if (read <= 0) break;
+		            while (stream->available() && (stream->peek() == '\r' || stream->peek() == '\n')) {
+		                stream->read();
+		            }
+		            continue;
+		        }
+		        #endif /* VAMP_SELECT */
+
 		        /* Verificar que no exceda buffer */
 		        if (total_read + chunk_size >= (int)(data_size - 1)) {
 		            chunk_size = (data_size - 1) - total_read;
@@ -616,6 +740,10 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 		        /* Si buffer lleno, salir */
 		        if (total_read >= (int)(data_size - 1)) break;
 		    }
+		#ifdef VAMP_SELECT
+		} else if (selecting) {
+		    esp8266_http_select(stream, content_len);
+		#endif /* VAMP_SELECT */
 		} else {
 		    /* CONTENT-LENGTH: Leer directamente */
 		    if (content_len >= (int)data_size) {
@@ -625,6 +753,13 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 		    total_read = stream->readBytes((uint8_t * )data, content_len);
 		}
 
+		#ifdef VAMP_SELECT
+		/* Solo los valores seleccionados, lo que queda del cuerpo lo descarta end() */
+		if (selecting) {
+		    total_read = (int)vamp_jsel_output(&http_sel, (uint8_t *)data, data_size - 1);
+		}
+		#endif /* VAMP_SELECT */
+
 		if (total_read <= 0) {
 			#ifdef VAMP_DEBUG
 			printf("[HTTP] Empty response\n");
@@ -692,5 +827,213 @@ size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t
 	return (size_t)total_read;
 }
 
+/* ----------------------------- Transporte --------------------------------- */
+
+/* El request es síncrono: send deja la respuesta en data y receive da su largo */
+static size_t esp8266_http_last_len = 0;
+
+static bool esp8266_http_send(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
+	esp8266_http_last_len = esp8266_http_request(profile, data, len, size);
+	return esp8266_http_last_len > 0;
+}
+
+static size_t esp8266_http_receive(const vamp_profile_t * profile, char * data, size_t size) {
+	(void)profile;
+	(void)data;
+	(void)size;
+	size_t len = esp8266_http_last_len;
+	esp8266_http_last_len = 0;
+	return len;
+}
+
+const vamp_transport_t esp8266_http_transport = {
+	NULL,
+	esp8266_http_send,
+	esp8266_http_receive,
+	NULL
+};
+
+/* ----------------------------- Long-poll --------------------------------- */
+
+#ifdef VAMP_SYNC_LONGPOLL
+
+/* Conexión propia, no se cruza con tcp_client/https_http de los perfiles */
+static WiFiClient* lp_client = nullptr;
+static char lp_buff[VAMP_SYNC_LONGPOLL_BUFF_SIZE];
+static size_t lp_len = 0;
+static uint32_t lp_deadline = 0;
+static bool lp_parked = false;
+
+static void esp8266_longpoll_stop(void) {
+	if (lp_client) {
+		lp_client->stop();
+	}
+	lp_parked = false;
+	lp_len = 0;
+}
+
+/* El GET se escribe a mano: HTTPClient espera la respuesta dentro de GET() */
+bool esp8266_longpoll_start(const vamp_profile_t * profile, uint32_t timeout_ms) {
+
+	if (profile == NULL || profile->endpoint_resource == NULL) {
+		return false;
+	}
+
+	vamp_url_t url;
+	if (!vamp_url_parse(profile->endpoint_resource, &url) || strcmp(url.scheme, "http") != 0) {
+		#ifdef VAMP_DEBUG
+		printf("[LPOLL] Only plain HTTP endpoints can be parked\n");
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	if (!esp8266_check_conn()) {
+		return false;
+	}
+
+	if (!lp_client) {
+		lp_client = new WiFiClient();
+		if (!lp_client) {
+			return false;
+		}
+	}
+	esp8266_longpoll_stop();
+
+	/* Solo la conexión TCP bloquea, y en la red local son milisegundos */
+	lp_client->setTimeout(HTTPS_TIMEOUT);
+	#ifdef VAMP_DNS_CACHE
+	bool connected = vamp_dns_connect(lp_client, url.host, url.port, false);
+	#else
+	bool connected = lp_client->connect(url.host, url.port);
+	#endif /* VAMP_DNS_CACHE */
+	if (!connected) {
+		#ifdef VAMP_DEBUG
+		printf("[LPOLL] Connection to %s:%u failed\n", url.host, url.port);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+	lp_client->setNoDelay(true);
+
+	/* Request line, la ruta puede traer ya su propio query */
+	char query_buffer[(VAMP_KEY_MAX_LEN + VAMP_VALUE_MAX_LEN) * 4 + 1];
+	query_buffer[0] = '\0';
+	if (profile->query_params.count > 0 && profile->query_params.pairs != NULL) {
+		vamp_kv_to_query_string(&profile->query_params, query_buffer, sizeof(query_buffer));
+	}
+
+	int len = snprintf(lp_buff, sizeof(lp_buff),
+		"GET %s%s%s HTTP/1.0\r\nHost: %s\r\nUser-Agent: %s\r\nAccept: application/json\r\n\r\n",
+		url.path,
+		query_buffer[0] ? (strchr(url.path, '?') ? "&" : "?") : "",
+		query_buffer,
+		url.host,
+		HTTPS_USER_AGENT);
+
+	if (len <= 0 || len >= (int)sizeof(lp_buff) ||
+			lp_client->write((const uint8_t *)lp_buff, len) != (size_t)len) {
+		esp8266_longpoll_stop();
+		return false;
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[LPOLL] Parked: %s%s%s\n", url.path, query_buffer[0] ? "?" : "", query_buffer);
+	#endif /* VAMP_DEBUG */
+
+	lp_len = 0;
+	lp_deadline = millis() + timeout_ms;
+	lp_parked = true;
+	return true;
+}
+
+/* HTTP/1.0: la respuesta termina cuando el VREG cierra la conexión */
+int16_t esp8266_longpoll_poll(char * data, size_t data_size) {
+
+	if (!lp_parked || !lp_client) {
+		return VAMP_LONGPOLL_ERROR;
+	}
+
+	/* Acumular lo que haya llegado, sin esperar */
+	int avail = lp_client->available();
+	while (avail > 0 && lp_len < sizeof(lp_buff) - 1) {
+		size_t chunk = (size_t)avail;
+		if (chunk > sizeof(lp_buff) - 1 - lp_len) {
+			chunk = sizeof(lp_buff) - 1 - lp_len;
+		}
+		int read = lp_client->read((uint8_t *)lp_buff + lp_len, chunk);
+		if (read <= 0) {
+			break;
+		}
+		lp_len += read;
+		avail = lp_client->available();
+	}
+
+	if (lp_client->connected()) {
+		if (lp_len >= sizeof(lp_buff) - 1) {
+			#ifdef VAMP_DEBUG
+			printf("[LPOLL] Response too large\n");
+			#endif /* VAMP_DEBUG */
+			esp8266_longpoll_stop();
+			return VAMP_LONGPOLL_ERROR;
+		}
+		if ((int32_t)(millis() - lp_deadline) >= 0) {
+			#ifdef VAMP_DEBUG
+			printf("[LPOLL] Timeout\n");
+			#endif /* VAMP_DEBUG */
+			esp8266_longpoll_stop();
+			return VAMP_LONGPOLL_ERROR;
+		}
+		return VAMP_LONGPOLL_PENDING;
+	}
+
+	/* Conexión cerrada, respuesta completa */
+	lp_buff[lp_len] = '\0';
+	lp_parked = false;
+	lp_client->stop();
+
+	int status = 0;
+	if (sscanf(lp_buff, "HTTP/%*d.%*d %d", &status) != 1) {
+		#ifdef VAMP_DEBUG
+		printf("[LPOLL] Invalid response\n");
+		#endif /* VAMP_DEBUG */
+		return VAMP_LONGPOLL_ERROR;
+	}
+
+	/* 204/304: se agotó el wait sin cambios */
+	if (status == 204 || status == 304) {
+		return VAMP_LONGPOLL_IDLE;
+	}
+	if (status != 200) {
+		#ifdef VAMP_DEBUG
+		printf("[LPOLL] HTTP error %d\n", status);
+		#endif /* VAMP_DEBUG */
+		return VAMP_LONGPOLL_ERROR;
+	}
+
+	char * body = strstr(lp_buff, "\r\n\r\n");
+	if (!body) {
+		return VAMP_LONGPOLL_ERROR;
+	}
+	body += 4;
+
+	size_t body_len = lp_len - (size_t)(body - lp_buff);
+	if (body_len == 0) {
+		return VAMP_LONGPOLL_IDLE;
+	}
+	if (body_len >= data_size || body_len > INT16_MAX) {
+		return VAMP_LONGPOLL_ERROR;
+	}
+
+	memcpy(data, body, body_len);
+	data[body_len] = '\0';
+
+	#ifdef VAMP_DEBUG
+	printf("[LPOLL] data: %s\n", data);
+	#endif /* VAMP_DEBUG */
+
+	return (int16_t)body_len;
+}
+
+#endif /* VAMP_SYNC_LONGPOLL */
+
 #endif // ARDUINO_ARCH_ESP8266
 
@@ -9,11 +9,14 @@
 #include <Arduino.h>
 #include "../../vamp_config.h"
 #include "../../lib/vamp_table.h"
+#include "../../lib/vamp_transport.h"
 
 
 #define TLS_BUFFER_SIZE_TX 512
 #define TLS_BUFFER_SIZE_RX 1024
 
+#define HTTPS_USER_AGENT 	"VAMP-Gateway/1.0" // User agent para requests
+
 /** Mínimo de heap para TLS
  * El BearSSL la primera vez que intenta una conexion usa 6KB de stack, los reserva
  * en el heap y no los libera más en toda la vida del programa. Asi que cuando se
@@ -40,10 +43,33 @@ bool esp8266_sta_init(const gw_config_t * vamp_conf);
 /** @brief Realiza una solicitud HTTP/HTTPS
  * 
  * @param profile Perfil de comunicación
- * @param data Datos a enviar
+ * @param data Datos a enviar, la respuesta queda aqui
+ * @param len Largo de los datos a enviar (cuerpo del POST)
  * @param data_size Tamaño del buffer data
  * @return Tamaño de los datos recibidos, 0 en caso de error
  */
-size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t data_size);
+size_t esp8266_http_request(const vamp_profile_t * profile, char * data, size_t len, size_t data_size);
+
+/** @brief Transporte HTTP/HTTPS para el registro (vamp_transport_register) */
+extern const vamp_transport_t esp8266_http_transport;
+
+#ifdef VAMP_SYNC_LONGPOLL
+/** @brief Envía un GET HTTP/1.0 long-poll por una conexión dedicada y vuelve sin
+ *  esperar la respuesta. Solo HTTP, con HTTPS devuelve false
+ * 
+ * @param profile Perfil de comunicación
+ * @param timeout_ms Tiempo tras el cual se abandona la consulta
+ * @return true si la consulta quedó estacionada
+ */
+bool esp8266_longpoll_start(const vamp_profile_t * profile, uint32_t timeout_ms);
+
+/** @brief Revisa la consulta long-poll sin bloquear
+ * 
+ * @param data Buffer para el cuerpo de la respuesta
+ * @param data_size Tamaño del buffer data
+ * @return Largo del cuerpo, o VAMP_LONGPOLL_PENDING / IDLE / ERROR
+ */
+int16_t esp8266_longpoll_poll(char * data, size_t data_size);
+#endif /* VAMP_SYNC_LONGPOLL */
 
 #endif // VAMP_ESP8266_IFACE_H_
\ No newline at end of file
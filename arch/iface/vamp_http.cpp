@@ -0,0 +1,572 @@
+/**
+ *
+ *
+ *
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "vamp_http.h"
+#include "vamp_esp8266.h"
+
+#ifdef VAMP_HTTP_ASYNC
+
+#include "../../vamp_gw.h"
+#include "../../vamp_callbacks.h"
+#include "../../lib/vamp_url.h"
+#include "../../lib/vamp_http.h"
+
+#ifdef VAMP_BREAKER
+#include "../../lib/vamp_breaker.h"
+#endif /* VAMP_BREAKER */
+
+#ifdef VAMP_DNS_CACHE
+#include "vamp_dns.h"
+#endif /* VAMP_DNS_CACHE */
+
+#ifdef VAMP_SELECT
+#include "../../lib/vamp_jsel.h"
+#endif /* VAMP_SELECT */
+
+#include "../../../http_server/web_server.h"
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <lwip/dns.h>
+
+/* Fases del request */
+#define HTTP_PHASE_IDLE		0
+#define HTTP_PHASE_DNS		1
+#define HTTP_PHASE_CONNECT	2	// Solo HTTP
+#define HTTP_PHASE_TLS		3	// Conexión + handshake, solo HTTPS
+#define HTTP_PHASE_SEND		4
+#define HTTP_PHASE_RECV		5
+
+/* Resolución DNS en curso */
+#define HTTP_DNS_WAIT		0
+#define HTTP_DNS_OK			1
+#define HTTP_DNS_FAIL		2
+
+/* Bytes que se leen como máximo en cada vuelta, para devolver el lazo enseguida */
+#define HTTP_RECV_STEP		128
+
+static uint8_t http_phase = HTTP_PHASE_IDLE;
+static uint32_t http_phase_start = 0;
+
+static char http_host[VAMP_URL_HOST_MAX_LEN];
+static uint16_t http_port = 0;
+static bool http_secure = false;
+static IPAddress http_ip;
+
+/* El callback del DNS puede llegar tarde, la generación descarta los de requests abandonados */
+static volatile uint8_t http_dns_state = HTTP_DNS_WAIT;
+static uint8_t http_dns_gen = 0;
+
+#ifdef VAMP_DNS_CACHE
+/* La dirección es la de respaldo de la caché, el handshake no puede ir por nombre */
+static bool http_dns_stale = false;
+#endif /* VAMP_DNS_CACHE */
+
+static uint8_t http_tx[VAMP_HTTP_TX_MAX];
+static size_t http_tx_len = 0;
+static size_t http_tx_sent = 0;
+
+static char http_rx[VAMP_HTTP_RX_MAX];
+static vamp_http_reader_t http_reader;
+
+#ifdef VAMP_SELECT
+/* Proyección del cuerpo, el reader le pasa los bytes en lugar de guardarlos */
+static vamp_jsel_t http_sel;
+static bool http_selecting = false;
+static bool http_sel_done = false;				// Ya están todos los campos (o no es JSON)
+#endif /* VAMP_SELECT */
+
+/* Conexiones propias, no se cruzan con las del cliente bloqueante */
+static WiFiClient * http_plain_client = nullptr;
+static WiFiClientSecure * http_secure_client = nullptr;
+static WiFiClient * http_client = nullptr;
+
+static void vamp_http_phase(uint8_t phase) {
+	http_phase = phase;
+	http_phase_start = millis();
+}
+
+static bool vamp_http_timeout(uint32_t timeout) {
+	return (millis() - http_phase_start) >= timeout;
+}
+
+static void vamp_http_stop(void) {
+	if (http_client) {
+		http_client->stop();
+	}
+	http_client = nullptr;
+	http_phase = HTTP_PHASE_IDLE;
+}
+
+static int16_t vamp_http_fail(const char * reason) {
+	#ifdef VAMP_DEBUG
+	printf("[HTTP] Async request to %s failed: %s\n", http_host, reason);
+	#else
+	(void)reason;
+	#endif /* VAMP_DEBUG */
+	vamp_http_stop();
+	return VAMP_REQUEST_ERROR;
+}
+
+/* El host no respondió: falla el request y cuenta para el circuit breaker */
+static int16_t vamp_http_unreachable(const char * reason) {
+	#ifdef VAMP_BREAKER
+	vamp_breaker_report(http_host, http_port, false, millis());
+	#endif /* VAMP_BREAKER */
+	return vamp_http_fail(reason);
+}
+
+#ifndef VAMP_DNS_CACHE
+static void vamp_http_dns_found(const char * name, const ip_addr_t * ipaddr, void * arg) {
+	(void)name;
+	if ((uint8_t)(uintptr_t)arg != http_dns_gen || http_phase != HTTP_PHASE_DNS) {
+		return;
+	}
+	if (ipaddr) {
+		http_ip = IPAddress(ipaddr);
+		http_dns_state = HTTP_DNS_OK;
+	} else {
+		http_dns_state = HTTP_DNS_FAIL;
+	}
+}
+#endif /* VAMP_DNS_CACHE */
+
+#ifdef VAMP_SELECT
+/* El reader pasa el cuerpo a la proyección en lugar de guardarlo */
+static void vamp_http_select_sink(void * ctx, uint8_t byte) {
+	(void)ctx;
+	if (!http_sel_done && vamp_jsel_feed(&http_sel, byte) != 0) {
+		http_sel_done = true;
+	}
+}
+#endif /* VAMP_SELECT */
+
+/* Fase siguiente a la resolución */
+static void vamp_http_resolved(void) {
+	vamp_http_phase(http_secure ? HTTP_PHASE_TLS : HTTP_PHASE_CONNECT);
+}
+
+#ifdef VAMP_DNS_CACHE
+/* Dirección desde la caché DNS, sin bloquear: PENDING sigue en la fase DNS */
+static int16_t vamp_http_lookup(void) {
+	switch (vamp_dns_query(http_host, http_ip)) {
+		case VAMP_DNS_STALE:
+			http_dns_stale = true;
+			/* fall through */
+		case VAMP_DNS_OK:
+			vamp_http_resolved();
+			return VAMP_REQUEST_PENDING;
+		case VAMP_DNS_PENDING:
+			if (vamp_http_timeout(VAMP_HTTP_DNS_TIMEOUT)) {
+				return vamp_http_unreachable("dns timeout");
+			}
+			return VAMP_REQUEST_PENDING;
+		default:
+			return vamp_http_unreachable("dns");
+	}
+}
+#endif /* VAMP_DNS_CACHE */
+
+/* Línea, headers y cuerpo en http_tx */
+static bool vamp_http_build(const vamp_profile_t * profile, const vamp_url_t * url, const char * body, size_t body_len) {
+
+	const char * method = profile->method == VAMP_HTTP_METHOD_POST ? "POST" : "GET";
+	if (profile->method != VAMP_HTTP_METHOD_POST) {
+		body_len = 0;
+	}
+
+	char query_buffer[(VAMP_KEY_MAX_LEN + VAMP_VALUE_MAX_LEN) * 4 + 1];
+	query_buffer[0] = '\0';
+	if (profile->query_params.count > 0 && profile->query_params.pairs != NULL) {
+		vamp_kv_to_query_string(&profile->query_params, query_buffer, sizeof(query_buffer));
+	}
+
+	char * head = (char *)http_tx;
+	size_t size = sizeof(http_tx);
+	int len = snprintf(head, size,
+		"%s %s%s%s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\nConnection: close\r\n",
+		method,
+		url->path,
+		query_buffer[0] ? (strchr(url->path, '?') ? "&" : "?") : "",
+		query_buffer,
+		url->host,
+		HTTPS_USER_AGENT);
+	if (len <= 0 || (size_t)len >= size) {
+		return false;
+	}
+	size_t n = (size_t)len;
+
+	/* Headers personalizados desde protocol_options, igual que el cliente bloqueante */
+	for (uint8_t i = 0; i < profile->protocol_options.count && profile->protocol_options.pairs; i++) {
+		const char * key = profile->protocol_options.pairs[i].key;
+		const char * value = profile->protocol_options.pairs[i].value;
+		if (!key || !value || key[0] == '\0' || value[0] == '\0' || vamp_kv_is_directive(key)) {
+			continue;
+		}
+		len = snprintf(head + n, size - n, "%s: %s\r\n", key, value);
+		if (len <= 0 || (size_t)len >= size - n) {
+			return false;
+		}
+		n += (size_t)len;
+	}
+
+	if (profile->method == VAMP_HTTP_METHOD_POST) {
+		len = snprintf(head + n, size - n, "Content-Length: %u\r\n", (unsigned)body_len);
+		if (len <= 0 || (size_t)len >= size - n) {
+			return false;
+		}
+		n += (size_t)len;
+	}
+
+	if (n + 2 + body_len > size) {
+		return false;
+	}
+	head[n++] = '\r';
+	head[n++] = '\n';
+	if (body_len) {
+		memcpy(http_tx + n, body, body_len);
+		n += body_len;
+	}
+
+	http_tx_len = n;
+	http_tx_sent = 0;
+	return true;
+}
+
+bool vamp_http_async_start(const vamp_profile_t * profile, const char * body, size_t body_len) {
+
+	if (http_phase != HTTP_PHASE_IDLE || !profile || !profile->endpoint_resource ||
+			(body_len && !body)) {
+		return false;
+	}
+
+	if (profile->protocol != VAMP_PROTOCOL_HTTP && profile->protocol != VAMP_PROTOCOL_HTTPS) {
+		return false;
+	}
+	if (profile->method != VAMP_HTTP_METHOD_GET && profile->method != VAMP_HTTP_METHOD_POST) {
+		#ifdef VAMP_DEBUG
+		printf("[HTTP] Unsupported HTTP method: %d\n", profile->method);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	if (WiFi.status() != WL_CONNECTED) {
+		return false;
+	}
+
+	vamp_url_t url;
+	if (!vamp_url_parse(profile->endpoint_resource, &url)) {
+		return false;
+	}
+
+	if (!vamp_http_build(profile, &url, body, body_len)) {
+		#ifdef VAMP_DEBUG
+		printf("[HTTP] Request does not fit in %d bytes\n", VAMP_HTTP_TX_MAX);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	#ifdef VAMP_BREAKER
+	if (!vamp_breaker_allow(url.host, url.port, millis())) {
+		#ifdef VAMP_DEBUG
+		printf("[HTTP] Circuit open for %s, request skipped\n", url.host);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+	#endif /* VAMP_BREAKER */
+
+	strncpy(http_host, url.host, sizeof(http_host) - 1);
+	http_host[sizeof(http_host) - 1] = '\0';
+	http_port = url.port;
+	http_secure = url.secure;
+
+	vamp_http_reader_reset(&http_reader, http_rx, sizeof(http_rx));
+
+	#ifdef VAMP_SELECT
+	http_sel_done = false;
+	http_selecting = false;
+	const char * select = vamp_kv_get(&profile->protocol_options, VAMP_SELECT_OPTION);
+	if (select) {
+		http_selecting = vamp_jsel_init(&http_sel, select, vamp_kv_get(&profile->protocol_options, VAMP_PACK_OPTION));
+		if (http_selecting) {
+			vamp_http_reader_sink(&http_reader, vamp_http_select_sink, NULL);
+		}
+		#ifdef VAMP_DEBUG
+		else {
+			printf("[HTTP] Invalid selector '%s', full body used\n", select);
+		}
+		#endif /* VAMP_DEBUG */
+	}
+	#endif /* VAMP_SELECT */
+
+	#ifdef VAMP_DEBUG
+	printf("[HTTP] Async %s %s:%u%s\n", profile->method == VAMP_HTTP_METHOD_POST ? "POST" : "GET",
+			http_host, http_port, url.path);
+	#endif /* VAMP_DEBUG */
+
+	#ifdef VAMP_DNS_CACHE
+	http_dns_stale = false;
+	vamp_http_phase(HTTP_PHASE_DNS);
+	return vamp_http_lookup() != VAMP_REQUEST_ERROR;
+	#else
+
+	/* Un host que ya es una IP no pasa por el DNS */
+	if (http_ip.fromString(http_host)) {
+		vamp_http_resolved();
+		return true;
+	}
+
+	http_dns_gen++;
+	http_dns_state = HTTP_DNS_WAIT;
+	vamp_http_phase(HTTP_PHASE_DNS);
+
+	ip_addr_t addr;
+	err_t err = dns_gethostbyname(http_host, &addr, vamp_http_dns_found, (void *)(uintptr_t)http_dns_gen);
+	if (err == ERR_OK) {
+		/* Estaba en la caché de lwIP */
+		http_ip = IPAddress(&addr);
+		vamp_http_resolved();
+	} else if (err != ERR_INPROGRESS) {
+		vamp_http_unreachable("dns");
+		return false;
+	}
+
+	return true;
+	#endif /* VAMP_DNS_CACHE */
+}
+
+/* La conexión TCP de lwIP espera el SYN/ACK, en la red local o un backend
+cercano son milisegundos y el timeout lo acota */
+static int16_t vamp_http_connect(void) {
+
+	if (!http_plain_client) {
+		http_plain_client = new WiFiClient();
+		if (!http_plain_client) {
+			return vamp_http_fail("no memory");
+		}
+	}
+
+	http_client = http_plain_client;
+	http_client->setTimeout(VAMP_HTTP_CONNECT_TIMEOUT);
+	if (!http_client->connect(http_ip, http_port)) {
+		return vamp_http_unreachable("connect");
+	}
+	http_client->setNoDelay(true);
+
+	vamp_http_phase(HTTP_PHASE_SEND);
+	return VAMP_REQUEST_PENDING;
+}
+
+/* BearSSL hace la conexión y el handshake en una sola llamada, es el único paso
+que ocupa el lazo varios cientos de ms. El servidor web se pausa solo durante el
+handshake, que es cuando ambos compiten por el heap */
+static int16_t vamp_http_handshake(void) {
+
+	if (!http_secure_client) {
+		http_secure_client = new WiFiClientSecure();
+		if (!http_secure_client) {
+			return vamp_http_fail("no memory");
+		}
+		http_secure_client->setBufferSizes(TLS_BUFFER_SIZE_RX, TLS_BUFFER_SIZE_TX);
+		http_secure_client->setInsecure(); // ToDo: usar certificados en producción
+	}
+
+	if (ESP.getMaxFreeBlockSize() < (MIN_HEAP_FOR_TLS + MIN_HEAP_FOR_TCP_CLIENT)) {
+		return vamp_http_fail("not enough heap for TLS");
+	}
+
+	bool paused = web_server_is_running();
+	if (paused) {
+		web_server_pause();
+	}
+
+	http_client = http_secure_client;
+	http_client->setTimeout(VAMP_HTTP_TLS_TIMEOUT);
+	/* Por nombre para el SNI, el host ya está en la caché del DNS */
+	#ifdef VAMP_DNS_CACHE
+	bool connected = http_dns_stale ? http_client->connect(http_ip, http_port) :
+			http_client->connect(http_host, http_port);
+	#else
+	bool connected = http_client->connect(http_host, http_port);
+	#endif /* VAMP_DNS_CACHE */
+
+	if (paused) {
+		web_server_resume();
+	}
+
+	if (!connected) {
+		return vamp_http_unreachable("TLS handshake");
+	}
+	http_client->setNoDelay(true);
+
+	vamp_http_phase(HTTP_PHASE_SEND);
+	return VAMP_REQUEST_PENDING;
+}
+
+/* Escribir solo lo que entra en el buffer de envío */
+static int16_t vamp_http_send(void) {
+
+	if (!http_client->connected()) {
+		return vamp_http_unreachable("closed while sending");
+	}
+
+	int room = http_client->availableForWrite();
+	if (room > 0) {
+		size_t chunk = http_tx_len - http_tx_sent;
+		if (chunk > (size_t)room) {
+			chunk = (size_t)room;
+		}
+		http_tx_sent += http_client->write(http_tx + http_tx_sent, chunk);
+	}
+
+	if (http_tx_sent >= http_tx_len) {
+		vamp_http_phase(HTTP_PHASE_RECV);
+		return VAMP_REQUEST_PENDING;
+	}
+
+	if (vamp_http_timeout(VAMP_HTTP_SEND_TIMEOUT)) {
+		return vamp_http_unreachable("send timeout");
+	}
+	return VAMP_REQUEST_PENDING;
+}
+
+/* Respuesta completa: solo 200 entrega cuerpo, como el cliente bloqueante */
+static int16_t vamp_http_finish(char * data, size_t data_size) {
+
+	vamp_http_stop();
+
+	#ifdef VAMP_DEBUG
+	printf("[HTTP] Async response %d from %s, %u bytes%s\n", http_reader.status, http_host,
+			(unsigned)http_reader.body_len, http_reader.truncated ? " (truncated)" : "");
+	#endif /* VAMP_DEBUG */
+
+	#ifdef VAMP_BREAKER
+	vamp_breaker_report(http_host, http_port, http_reader.status < 500, millis());
+	#endif /* VAMP_BREAKER */
+
+	if (http_reader.status < 200 || http_reader.status > 299) {
+		return VAMP_REQUEST_ERROR;
+	}
+
+	#ifdef VAMP_SELECT
+	/* Solo los valores seleccionados, puede ser binario */
+	if (http_selecting) {
+		if (http_reader.status != 200) {
+			return VAMP_REQUEST_EMPTY;
+		}
+		size_t selected = vamp_jsel_output(&http_sel, (uint8_t *)data, data_size - 1);
+		data[selected] = '\0';
+		return selected ? (int16_t)selected : VAMP_REQUEST_EMPTY;
+	}
+	#endif /* VAMP_SELECT */
+
+	if (http_reader.status != 200 || http_reader.body_len == 0) {
+		return VAMP_REQUEST_EMPTY;
+	}
+
+	size_t len = http_reader.body_len;
+	if (len >= data_size) {
+		len = data_size - 1;
+	}
+	memcpy(data, http_rx, len);
+	data[len] = '\0';
+	return (int16_t)len;
+}
+
+static int16_t vamp_http_recv(char * data, size_t data_size) {
+
+	uint8_t step[HTTP_RECV_STEP];
+	int avail = http_client->available();
+
+	if (avail > 0) {
+		int read = http_client->read(step, avail < (int)sizeof(step) ? (size_t)avail : sizeof(step));
+		for (int i = 0; i < read; i++) {
+			int8_t result = vamp_http_reader_feed(&http_reader, step[i]);
+			if (result < 0) {
+				return vamp_http_fail("invalid response");
+			}
+			if (result > 0) {
+				return vamp_http_finish(data, data_size);
+			}
+			#ifdef VAMP_SELECT
+			/* Con todos los campos el resto del cuerpo no hace falta */
+			if (http_sel_done) {
+				return vamp_http_finish(data, data_size);
+			}
+			#endif /* VAMP_SELECT */
+		}
+		return VAMP_REQUEST_PENDING;
+	}
+
+	if (!http_client->connected()) {
+		if (vamp_http_reader_close(&http_reader) > 0) {
+			return vamp_http_finish(data, data_size);
+		}
+		return vamp_http_unreachable("closed before the response ended");
+	}
+
+	if (vamp_http_timeout(VAMP_HTTP_RECV_TIMEOUT)) {
+		return vamp_http_unreachable("response timeout");
+	}
+	return VAMP_REQUEST_PENDING;
+}
+
+int16_t vamp_http_async_poll(char * data, size_t data_size) {
+
+	if (!data || data_size == 0) {
+		return VAMP_REQUEST_ERROR;
+	}
+
+	switch (http_phase) {
+
+		case HTTP_PHASE_DNS:
+			#ifdef VAMP_DNS_CACHE
+			return vamp_http_lookup();
+			#else
+			if (http_dns_state == HTTP_DNS_OK) {
+				vamp_http_resolved();
+			} else if (http_dns_state == HTTP_DNS_FAIL) {
+				return vamp_http_unreachable("dns");
+			} else if (vamp_http_timeout(VAMP_HTTP_DNS_TIMEOUT)) {
+				return vamp_http_unreachable("dns timeout");
+			}
+			return VAMP_REQUEST_PENDING;
+			#endif /* VAMP_DNS_CACHE */
+
+		case HTTP_PHASE_CONNECT:
+			return vamp_http_connect();
+
+		case HTTP_PHASE_TLS:
+			return vamp_http_handshake();
+
+		case HTTP_PHASE_SEND:
+			return vamp_http_send();
+
+		case HTTP_PHASE_RECV:
+			return vamp_http_recv(data, data_size);
+
+		default:
+			break;
+	}
+
+	return VAMP_REQUEST_ERROR;
+}
+
+bool vamp_http_async_busy(void) {
+	return http_phase != HTTP_PHASE_IDLE;
+}
+
+void vamp_http_async_abort(void) {
+	if (http_phase != HTTP_PHASE_IDLE) {
+		vamp_http_stop();
+	}
+}
+
+#endif /* VAMP_HTTP_ASYNC */
+
+#endif // ARDUINO_ARCH_ESP8266
@@ -0,0 +1,44 @@
+/**
+ *
+ * Cliente HTTP/HTTPS no bloqueante, avanza por fases desde el lazo del gateway
+ *
+ */
+#ifndef VAMP_HTTP_IFACE_H_
+#define VAMP_HTTP_IFACE_H_
+
+#include <Arduino.h>
+#include "../../vamp_config.h"
+#include "../../lib/vamp_table.h"
+
+#ifdef VAMP_HTTP_ASYNC
+
+/** @brief Arma el request con el perfil y lo deja listo para avanzar
+ *
+ * El request (línea, headers y cuerpo) y el host se copian, asi que el perfil
+ * puede cambiar o liberarse mientras tanto. Solo hay un request a la vez.
+ *
+ * @param profile Perfil de comunicación (endpoint http:// o https://, GET o POST)
+ * @param body Cuerpo del POST
+ * @param body_len Largo del cuerpo
+ * @return true si el request quedó en curso
+ */
+bool vamp_http_async_start(const vamp_profile_t * profile, const char * body, size_t body_len);
+
+/** @brief Avanza el request en curso un paso (DNS, conexión, TLS, envío o
+ *  recepción), cada fase con su timeout
+ *
+ * @param data Buffer para el cuerpo de la respuesta
+ * @param data_size Tamaño del buffer data
+ * @return Largo del cuerpo, o VAMP_REQUEST_PENDING / EMPTY / ERROR
+ */
+int16_t vamp_http_async_poll(char * data, size_t data_size);
+
+/** @brief Hay un request en curso */
+bool vamp_http_async_busy(void);
+
+/** @brief Abandona el request en curso y cierra la conexión */
+void vamp_http_async_abort(void);
+
+#endif /* VAMP_HTTP_ASYNC */
+
+#endif // VAMP_HTTP_IFACE_H_
@@ -0,0 +1,395 @@
+/**
+ *
+ *
+ *
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "vamp_mqtt.h"
+#include "vamp_esp8266.h"
+
+#ifdef VAMP_MQTT
+
+#include "../../vamp_gw.h"
+#include "../../vamp_callbacks.h"
+#include "../../lib/vamp_url.h"
+#include "../../lib/vamp_mqtt.h"
+
+#ifdef VAMP_DNS_CACHE
+#include "vamp_dns.h"
+#endif /* VAMP_DNS_CACHE */
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+
+/* Publicación QoS 1 esperando su PUBACK */
+typedef struct {
+	uint16_t packet_id;						// 0 = slot libre
+	uint16_t len;
+	uint8_t packet[VAMP_MQTT_PACKET_MAX];	// PUBLISH ya codificado, para reenviarlo
+} vamp_mqtt_inflight_t;
+
+/* Sesión con el broker */
+static WiFiClient * mqtt_plain = nullptr;
+static WiFiClientSecure * mqtt_secure = nullptr;
+static WiFiClient * mqtt_conn = nullptr;		// Apunta a mqtt_plain o mqtt_secure
+static char mqtt_host[VAMP_URL_HOST_MAX_LEN];
+static uint16_t mqtt_port = 0;
+static bool mqtt_tls = false;
+static char mqtt_user[VAMP_VALUE_MAX_LEN];
+static char mqtt_pass[VAMP_VALUE_MAX_LEN];
+static bool mqtt_ready = false;					// CONNACK aceptado
+
+static uint32_t mqtt_last_tx = 0;
+static uint32_t mqtt_ping_sent = 0;
+static uint32_t mqtt_last_attempt = 0;
+static uint16_t mqtt_next_id = 1;
+
+static vamp_mqtt_inflight_t mqtt_inflight[VAMP_MQTT_INFLIGHT];
+static vamp_mqtt_reader_t mqtt_reader;
+
+static uint8_t mqtt_packet[VAMP_MQTT_PACKET_MAX];
+
+static bool vamp_mqtt_write(const uint8_t * packet, size_t len) {
+	if (!mqtt_conn || mqtt_conn->write(packet, len) != len) {
+		return false;
+	}
+	mqtt_last_tx = millis();
+	return true;
+}
+
+static void vamp_mqtt_drop(void) {
+	if (mqtt_conn) {
+		mqtt_conn->stop();
+	}
+	mqtt_ready = false;
+	mqtt_ping_sent = 0;
+}
+
+/* Procesar lo que haya llegado del broker, sin esperar */
+static void vamp_mqtt_read(void) {
+
+	while (mqtt_conn && mqtt_conn->available() > 0) {
+		int byte = mqtt_conn->read();
+		if (byte < 0) {
+			break;
+		}
+
+		int8_t result = vamp_mqtt_reader_feed(&mqtt_reader, (uint8_t)byte);
+		if (result < 0) {
+			#ifdef VAMP_DEBUG
+			printf("[MQTT] Malformed packet from broker\n");
+			#endif /* VAMP_DEBUG */
+			vamp_mqtt_drop();
+			return;
+		}
+		if (result == 0) {
+			continue;
+		}
+
+		switch (mqtt_reader.header & VAMP_MQTT_TYPE_MASK) {
+			case VAMP_MQTT_CONNACK:
+				/* body[1] = código de retorno, 0 = aceptado */
+				mqtt_ready = (mqtt_reader.body_len >= 2 && mqtt_reader.body[1] == 0);
+				#ifdef VAMP_DEBUG
+				printf("[MQTT] CONNACK %s\n", mqtt_ready ? "accepted" : "refused");
+				#endif /* VAMP_DEBUG */
+				break;
+
+			case VAMP_MQTT_PUBACK: {
+				uint16_t id = vamp_mqtt_reader_packet_id(&mqtt_reader);
+				for (uint8_t i = 0; i < VAMP_MQTT_INFLIGHT; i++) {
+					if (mqtt_inflight[i].packet_id == id) {
+						mqtt_inflight[i].packet_id = 0;
+					}
+				}
+				break;
+			}
+
+			case VAMP_MQTT_PINGRESP:
+				mqtt_ping_sent = 0;
+				break;
+
+			default:
+				/* No hay suscripciones, el resto se ignora */
+				break;
+		}
+	}
+}
+
+/* Abrir la sesión con el broker y reenviar lo que quedó en vuelo */
+static bool vamp_mqtt_connect(void) {
+
+	if (WiFi.status() != WL_CONNECTED || mqtt_host[0] == '\0') {
+		return false;
+	}
+
+	mqtt_last_attempt = millis();
+
+	if (mqtt_tls) {
+		if (!mqtt_secure) {
+			mqtt_secure = new WiFiClientSecure();
+		}
+		if (!mqtt_secure || ESP.getMaxFreeBlockSize() < (MIN_HEAP_FOR_TLS + MIN_HEAP_FOR_TCP_CLIENT)) {
+			#ifdef VAMP_DEBUG
+			printf("[MQTT] Not enough heap for TLS\n");
+			#endif /* VAMP_DEBUG */
+			return false;
+		}
+		mqtt_secure->setBufferSizes(TLS_BUFFER_SIZE_RX, TLS_BUFFER_SIZE_TX);
+		mqtt_secure->setInsecure(); // ToDo: usar certificados en producción
+		mqtt_conn = mqtt_secure;
+	} else {
+		if (!mqtt_plain) {
+			mqtt_plain = new WiFiClient();
+		}
+		mqtt_conn = mqtt_plain;
+	}
+
+	if (!mqtt_conn) {
+		return false;
+	}
+
+	mqtt_conn->setTimeout(VAMP_MQTT_TIMEOUT);
+	#ifdef VAMP_DNS_CACHE
+	bool connected = vamp_dns_connect(mqtt_conn, mqtt_host, mqtt_port, mqtt_tls);
+	#else
+	bool connected = mqtt_conn->connect(mqtt_host, mqtt_port);
+	#endif /* VAMP_DNS_CACHE */
+	if (!connected) {
+		#ifdef VAMP_DEBUG
+		printf("[MQTT] Connection to %s:%u failed\n", mqtt_host, mqtt_port);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+	mqtt_conn->setNoDelay(true);
+
+	/* Client ID a partir del RF_ID del gateway, estable entre reinicios para que
+	el broker recupere la sesión */
+	char client_id[16];
+	const uint8_t * rf_id = vamp_get_local_wsn_addr();
+	snprintf(client_id, sizeof(client_id), "vamp-%02X%02X%02X%02X%02X",
+			rf_id[0], rf_id[1], rf_id[2], rf_id[3], rf_id[4]);
+
+	vamp_mqtt_reader_reset(&mqtt_reader);
+	size_t len = vamp_mqtt_connect_packet(mqtt_packet, sizeof(mqtt_packet), client_id,
+			mqtt_user, mqtt_pass, VAMP_MQTT_KEEPALIVE, false);
+	if (!len || !vamp_mqtt_write(mqtt_packet, len)) {
+		vamp_mqtt_drop();
+		return false;
+	}
+
+	/* El CONNACK sí se espera, solo pasa al (re)conectar */
+	uint32_t start = millis();
+	while (!mqtt_ready && mqtt_conn->connected() && (millis() - start) < VAMP_MQTT_TIMEOUT) {
+		vamp_mqtt_read();
+		yield();
+	}
+
+	if (!mqtt_ready) {
+		vamp_mqtt_drop();
+		return false;
+	}
+
+	/* Reenviar lo que no fue confirmado, marcado como DUP */
+	for (uint8_t i = 0; i < VAMP_MQTT_INFLIGHT; i++) {
+		if (mqtt_inflight[i].packet_id) {
+			mqtt_inflight[i].packet[0] |= VAMP_MQTT_DUP_FLAG;
+			if (!vamp_mqtt_write(mqtt_inflight[i].packet, mqtt_inflight[i].len)) {
+				vamp_mqtt_drop();
+				return false;
+			}
+		}
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[MQTT] Session open with %s:%u\n", mqtt_host, mqtt_port);
+	#endif /* VAMP_DEBUG */
+
+	return true;
+}
+
+/* Sesión abierta con el broker del perfil */
+static bool vamp_mqtt_session(const vamp_profile_t * profile, const vamp_url_t * url) {
+
+	bool same_broker = mqtt_port == url->port && mqtt_tls == url->secure &&
+			strcmp(mqtt_host, url->host) == 0;
+
+	if (same_broker && mqtt_ready && mqtt_conn && mqtt_conn->connected()) {
+		return true;
+	}
+
+	if (!same_broker) {
+		/* Otro broker: lo que estaba en vuelo no se puede reenviar aqui */
+		vamp_mqtt_drop();
+		memset(mqtt_inflight, 0, sizeof(mqtt_inflight));
+		strncpy(mqtt_host, url->host, sizeof(mqtt_host) - 1);
+		mqtt_host[sizeof(mqtt_host) - 1] = '\0';
+		mqtt_port = url->port;
+		mqtt_tls = url->secure;
+	} else {
+		vamp_mqtt_drop();
+	}
+
+	const char * user = vamp_kv_get(&profile->protocol_options, "username");
+	const char * pass = vamp_kv_get(&profile->protocol_options, "password");
+	strncpy(mqtt_user, user ? user : "", sizeof(mqtt_user) - 1);
+	mqtt_user[sizeof(mqtt_user) - 1] = '\0';
+	strncpy(mqtt_pass, pass ? pass : "", sizeof(mqtt_pass) - 1);
+	mqtt_pass[sizeof(mqtt_pass) - 1] = '\0';
+
+	return vamp_mqtt_connect();
+}
+
+/* Slot libre para una publicación QoS 1, esperando algún PUBACK si están todos ocupados */
+static vamp_mqtt_inflight_t * vamp_mqtt_inflight_slot(void) {
+
+	uint32_t start = millis();
+	do {
+		for (uint8_t i = 0; i < VAMP_MQTT_INFLIGHT; i++) {
+			if (!mqtt_inflight[i].packet_id) {
+				return &mqtt_inflight[i];
+			}
+		}
+		vamp_mqtt_read();
+		yield();
+	} while (mqtt_conn && mqtt_conn->connected() && (millis() - start) < VAMP_MQTT_TIMEOUT);
+
+	return NULL;
+}
+
+bool vamp_mqtt_publish(const vamp_profile_t * profile, const char * data, size_t data_len) {
+
+	if (!profile || !profile->endpoint_resource || !data) {
+		return false;
+	}
+
+	vamp_url_t url;
+	if (!vamp_url_parse(profile->endpoint_resource, &url) ||
+			(strcmp(url.scheme, "mqtt") != 0 && strcmp(url.scheme, "mqtts") != 0)) {
+		return false;
+	}
+
+	/* Topic: protocol_options o la ruta del URL sin la barra inicial */
+	const char * topic = vamp_kv_get(&profile->protocol_options, "topic");
+	if (!topic || !topic[0]) {
+		topic = (url.path[0] == '/') ? url.path + 1 : url.path;
+	}
+	if (!topic[0]) {
+		#ifdef VAMP_DEBUG
+		printf("[MQTT] No topic for %s\n", profile->endpoint_resource);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	const char * qos_opt = vamp_kv_get(&profile->protocol_options, "qos");
+	const char * retain_opt = vamp_kv_get(&profile->protocol_options, "retain");
+	uint8_t qos = (qos_opt && qos_opt[0] == '1') ? 1 : 0;
+	bool retain = retain_opt && (retain_opt[0] == '1' || retain_opt[0] == 't');
+
+	if (!vamp_mqtt_session(profile, &url)) {
+		return false;
+	}
+
+	/* Liberar los slots que ya tengan PUBACK antes de buscar uno */
+	vamp_mqtt_read();
+
+	vamp_mqtt_inflight_t * slot = NULL;
+	uint16_t packet_id = 0;
+	if (qos) {
+		slot = vamp_mqtt_inflight_slot();
+		if (!slot) {
+			#ifdef VAMP_DEBUG
+			printf("[MQTT] In-flight window full\n");
+			#endif /* VAMP_DEBUG */
+			return false;
+		}
+		packet_id = mqtt_next_id++;
+		if (mqtt_next_id == 0) {
+			mqtt_next_id = 1;
+		}
+	}
+
+	uint8_t * packet = slot ? slot->packet : mqtt_packet;
+	size_t len = vamp_mqtt_publish_packet(packet, VAMP_MQTT_PACKET_MAX, topic,
+			(const uint8_t *)data, data_len, qos, retain, packet_id);
+	if (!len) {
+		#ifdef VAMP_DEBUG
+		printf("[MQTT] Message too large (%u bytes)\n", (unsigned)data_len);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	/* Queda en vuelo aunque falle la escritura, se reenvía al reconectar */
+	if (slot) {
+		slot->packet_id = packet_id;
+		slot->len = (uint16_t)len;
+	}
+
+	if (!vamp_mqtt_write(packet, len)) {
+		vamp_mqtt_drop();
+		return slot != NULL;
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[MQTT] Published %u bytes to %s (qos %d)\n", (unsigned)data_len, topic, qos);
+	#endif /* VAMP_DEBUG */
+
+	return true;
+}
+
+void vamp_mqtt_loop(void) {
+
+	/* Nunca se abrió una sesión */
+	if (mqtt_host[0] == '\0') {
+		return;
+	}
+
+	if (!mqtt_ready || !mqtt_conn || !mqtt_conn->connected()) {
+		mqtt_ready = false;
+		if ((millis() - mqtt_last_attempt) >= VAMP_MQTT_RECONNECT_MS) {
+			vamp_mqtt_connect();
+		}
+		return;
+	}
+
+	vamp_mqtt_read();
+
+	uint32_t now = millis();
+
+	/* Sin PINGRESP en un keepalive completo el broker ya nos dio por muertos */
+	if (mqtt_ping_sent && (now - mqtt_ping_sent) >= (uint32_t)VAMP_MQTT_KEEPALIVE * 1000) {
+		#ifdef VAMP_DEBUG
+		printf("[MQTT] Keepalive lost\n");
+		#endif /* VAMP_DEBUG */
+		vamp_mqtt_drop();
+		return;
+	}
+
+	/* PINGREQ a mitad del keepalive si no se envió nada */
+	if (!mqtt_ping_sent && (now - mqtt_last_tx) >= (uint32_t)VAMP_MQTT_KEEPALIVE * 500) {
+		size_t len = vamp_mqtt_empty_packet(mqtt_packet, sizeof(mqtt_packet), VAMP_MQTT_PINGREQ);
+		if (vamp_mqtt_write(mqtt_packet, len)) {
+			mqtt_ping_sent = now;
+		} else {
+			vamp_mqtt_drop();
+		}
+	}
+}
+
+static bool vamp_mqtt_send(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
+	(void)size;
+	return vamp_mqtt_publish(profile, data, len);
+}
+
+const vamp_transport_t vamp_mqtt_transport = {
+	NULL,
+	vamp_mqtt_send,
+	NULL,
+	vamp_mqtt_loop
+};
+
+#endif /* VAMP_MQTT */
+
+#endif // ARDUINO_ARCH_ESP8266
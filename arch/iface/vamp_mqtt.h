@@ -0,0 +1,39 @@
+/**
+ *
+ * Transporte MQTT (mqtt:// y mqtts://) sobre una conexión persistente al broker
+ *
+ */
+#ifndef VAMP_MQTT_IFACE_H_
+#define VAMP_MQTT_IFACE_H_
+
+#include <Arduino.h>
+#include "../../vamp_config.h"
+#include "../../lib/vamp_table.h"
+#include "../../lib/vamp_transport.h"
+
+#ifdef VAMP_MQTT
+
+/** @brief Publica data en el topic del perfil
+ *
+ * Abre (o reutiliza) la sesión con el broker del endpoint. Con QoS 1 no espera
+ * el PUBACK: la publicación queda en vuelo y se confirma en vamp_mqtt_loop().
+ * Solo hay una sesión, un perfil con otro broker cierra la anterior.
+ *
+ * @param profile Perfil de comunicación (endpoint mqtt:// o mqtts://)
+ * @param data Datos a publicar
+ * @param data_len Largo de los datos
+ * @return true si la publicación se envió
+ */
+bool vamp_mqtt_publish(const vamp_profile_t * profile, const char * data, size_t data_len);
+
+/** @brief Atiende la sesión: lee PUBACK/PINGRESP, envía el keepalive y reconecta
+ *  (reenviando lo que quedó en vuelo). Llamar cuando el radio está ocioso */
+void vamp_mqtt_loop(void);
+
+/** @brief Transporte MQTT para el registro. La sesión es compartida por todos los
+ *  perfiles del mismo broker */
+extern const vamp_transport_t vamp_mqtt_transport;
+
+#endif /* VAMP_MQTT */
+
+#endif // VAMP_MQTT_IFACE_H_
@@ -19,12 +19,101 @@ es algo bastante específico de un tipo de gateway */
 #include <SPI.h>
 #include <RF24.h>
 
+#include "../../lib/vamp_spsc.h"
+
 /* CE, CSN pins */
 RF24 wsn_radio;
 
 /* Buffer para datos WSN */
 static uint8_t nrf_buff [VAMP_MAX_PAYLOAD_SIZE];
 
+/** Trama recibida a la espera de ser procesada */
+typedef struct {
+	uint32_t rx_time;						// millis() en el momento de extraerla del chip
+	uint8_t pipe;							// Pipe por el que llegó
+	uint8_t len;							// Longitud de la trama
+	uint8_t data[VAMP_MAX_PAYLOAD_SIZE];	// Contenido
+} nrf_frame_t;
+
+/* Cola de recepción. La FIFO del chip solo tiene 3 niveles, asi que se vacía
+completa en cada consulta (o en cada interrupción) y las tramas esperan aqui a
+ser procesadas. El productor es nrf_drain() y el consumidor nrf_read().
+Hoy ambos corren en el lazo principal: el SPI es compartido con los envíos y no
+se lee el chip desde la interrupción. La cola no necesita bloqueos si el
+productor pasa a otro contexto (test/test_spsc.cpp la prueba con dos hilos) */
+static vamp_spsc_queue<nrf_frame_t, VAMP_WSN_RX_RING_SIZE> rx_queue;
+
+#ifdef VAMP_WSN_SUBADDR
+/* Las alarmas (pipe VAMP_WSN_PIPE_ALARM) esperan aparte y se entregan antes que
+las tramas de rx_queue, aunque hayan llegado después */
+static vamp_spsc_queue<nrf_frame_t, VAMP_WSN_ALARM_RING_SIZE> rx_alarm_queue;
+#endif /* VAMP_WSN_SUBADDR */
+
+#ifdef VAMP_WSN_IRQ_PIN
+/* En el ESP8266/ESP32 el manejador de la interrupción tiene que estar en IRAM */
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32)
+#define NRF_ISR_ATTR IRAM_ATTR
+#else
+#define NRF_ISR_ATTR
+#endif
+
+/* La interrupción solo marca que hay trabajo, la lectura por SPI se difiere
+al lazo principal para no competir con las transmisiones */
+static volatile bool nrf_irq_pending = false;
+/* Solo se usan interrupciones en modo siempre escucha */
+static bool nrf_irq_enabled = false;
+void nrf_irq_handler(void);
+#endif /* VAMP_WSN_IRQ_PIN */
+
+#ifdef VAMP_WSN_TX_BATCH
+/** Respuesta esperando la próxima ráfaga */
+typedef struct {
+	uint8_t dst_addr[VAMP_ADDR_LEN];		// Destino
+	uint8_t len;
+	bool sent;								// Ya salió con las de su destino
+	uint8_t data[VAMP_MAX_PAYLOAD_SIZE];
+} nrf_tx_frame_t;
+
+/* Las respuestas se producen y se envían desde el lazo principal, en orden de
+llegada dentro de cada destino */
+static nrf_tx_frame_t tx_batch[VAMP_WSN_TX_BATCH_LEN];
+static uint8_t tx_count = 0;
+#endif /* VAMP_WSN_TX_BATCH */
+
+#ifdef VAMP_WSN_ACK_PAYLOAD
+/** Respuesta esperando viajar en un ACK del pipe 0 */
+typedef struct {
+	bool used;
+	uint8_t wsn_id;							// Destinatario
+	uint8_t len;							// Con el ID compacto delante
+	uint32_t since;							// millis() al guardarla
+	uint8_t data[VAMP_MAX_PAYLOAD_SIZE];
+} nrf_ack_pending_t;
+
+/* El chip tiene una sola respuesta cargada a la vez: el ACK del pipe 0 se lo
+lleva el primer nodo que transmita, asi que el resto espera aqui su turno */
+static nrf_ack_pending_t ack_pending[VAMP_WSN_ACK_PENDING];
+/* Respuesta cargada en el chip, -1 si no hay */
+static int8_t ack_loaded = -1;
+/* Por dónde sigue la ronda al cargar la próxima */
+static uint8_t ack_turn = 0;
+static void nrf_ack_next(void);
+static void nrf_ack_sent(const uint8_t * data, uint8_t len);
+static void nrf_ack_restore(void);
+#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+/* Último chequeo de conexión con el chip */
+static uint32_t last_chip_check = 0;
+static bool last_chip_state = false;
+
+/* Momento de recepción de la última trama entregada */
+static uint32_t last_rx_time = 0;
+/* Pipe por el que llegó la última trama entregada */
+static uint8_t last_rx_pipe = 0;
+
+/* Estadísticas de recepción */
+static vamp_wsn_stats_t rx_stats;
+
 static uint8_t wsn_ce_pin;
 static uint8_t wsn_csn_pin;
 /* Identificador local del WSN */
@@ -47,7 +136,12 @@ bool nrf_init(void) {
 		/* Configuración mínima necesaria para funcionar */
 		wsn_radio.enableDynamicPayloads();
 		wsn_radio.enableDynamicAck();
+		#ifdef VAMP_WSN_ACK_PAYLOAD
+		/* Las respuestas viajan dentro del ACK de la siguiente trama del nodo */
+		wsn_radio.enableAckPayload();
+		#else
 		wsn_radio.disableAckPayload();
+		#endif /* VAMP_WSN_ACK_PAYLOAD */
 		
 		/* ✅ Pipe 0 direccion local con ACK activos */
 		wsn_radio.setAutoAck(0, true);
@@ -57,9 +151,31 @@ bool nrf_init(void) {
 		wsn_radio.setAutoAck(1, false);
 		uint8_t broadcast_addr[5] = {VAMP_BROADCAST_ADDR};
 		wsn_radio.openReadingPipe(1, broadcast_addr);
+
+		#ifdef VAMP_WSN_SUBADDR
+		/* Pipes 2 y 3 solo en el gateway, el chip filtra por dirección y el
+		pipe clasifica la trama. Comparten el prefijo del broadcast. La alarma
+		lleva ACK: lo da cualquier gateway que la oiga, la confirmación de que
+		la atendió el suyo es el TICKET */
+		if (vamp_get_settings() & VAMP_RMODE_B) {
+			uint8_t alarm_addr[5] = {VAMP_ALARM_ADDR};
+			uint8_t join_addr[5] = {VAMP_JOIN_ADDR};
+			wsn_radio.setAutoAck(VAMP_WSN_PIPE_ALARM, true);
+			wsn_radio.openReadingPipe(VAMP_WSN_PIPE_ALARM, alarm_addr);
+			wsn_radio.setAutoAck(VAMP_WSN_PIPE_JOIN, false);
+			wsn_radio.openReadingPipe(VAMP_WSN_PIPE_JOIN, join_addr);
+		}
+		#endif /* VAMP_WSN_SUBADDR */
 		
 		wsn_radio.flush_rx();
 
+		#ifdef VAMP_WSN_IRQ_PIN
+		/* Solo interesa RX_DR, TX_DS y MAX_RT no bajan el pin IRQ */
+		if (vamp_get_settings() & VAMP_RMODE_B) {
+			wsn_radio.maskIRQ(true, true, false);
+		}
+		#endif /* VAMP_WSN_IRQ_PIN */
+
 		#ifdef VAMP_DEBUG
 		printf("[F24] OK\n");
 		#endif /* VAMP_DEBUG */
@@ -94,32 +210,203 @@ bool nrf_init(uint8_t ce_pin, uint8_t csn_pin, uint8_t * addr) {
 	/* ... y la dirección local */
 	memcpy(local_wsn_addr, addr, VAMP_ADDR_LEN);
 
-	return nrf_init();
+	if (!nrf_init()) {
+		return false;
+	}
+
+	#ifdef VAMP_WSN_IRQ_PIN
+	/* Solo el gateway (siempre escucha) recibe por interrupciones, el mote
+	abre sus propias ventanas de escucha */
+	if ((vamp_get_settings() & VAMP_RMODE_B) && !nrf_irq_enabled) {
+		pinMode(VAMP_WSN_IRQ_PIN, INPUT_PULLUP);
+		attachInterrupt(digitalPinToInterrupt(VAMP_WSN_IRQ_PIN), nrf_irq_handler, FALLING);
+		nrf_irq_enabled = true;
+		/* Pudieron llegar tramas antes de conectar la interrupción */
+		nrf_irq_pending = true;
+
+		#ifdef VAMP_DEBUG
+		printf("[F24] IRQ on pin %d\n", VAMP_WSN_IRQ_PIN);
+		#endif /* VAMP_DEBUG */
+	}
+	#endif /* VAMP_WSN_IRQ_PIN */
+
+	return true;
+}
+
+/* Vaciar la FIFO del chip hacia el anillo de recepción */
+uint8_t nrf_drain(void) {
+
+	uint8_t drained = 0;
+	uint8_t pipe = 0;
+	#ifdef VAMP_WSN_ACK_PAYLOAD
+	bool ack_gone = false;
+	#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+	/* Si la FIFO está llena es probable que el chip haya descartado tramas
+	desde la última vez que se consultó */
+	if (wsn_radio.rxFifoFull()) {
+		rx_stats.hw_overflows++;
+	}
+
+	while (wsn_radio.available(&pipe)) {
+
+		uint8_t bytes_read = wsn_radio.getDynamicPayloadSize();
+
+		/* Una longitud fuera de rango indica una trama corrupta, la FIFO
+		completa deja de ser confiable */
+		if (!bytes_read || bytes_read > 32) {
+			wsn_radio.flush_rx();
+			break;
+		}
+		if (bytes_read > VAMP_MAX_PAYLOAD_SIZE) {
+			bytes_read = VAMP_MAX_PAYLOAD_SIZE;
+		}
+
+		/* Sin espacio en la cola la trama se lee igual (para liberar la FIFO)
+		pero se descarta */
+		#ifdef VAMP_WSN_SUBADDR
+		bool alarm = (pipe == VAMP_WSN_PIPE_ALARM);
+		nrf_frame_t * frame = alarm ? rx_alarm_queue.reserve() : rx_queue.reserve();
+		#else
+		nrf_frame_t * frame = rx_queue.reserve();
+		#endif /* VAMP_WSN_SUBADDR */
+		uint8_t * data = frame ? frame->data : nrf_buff;
+		wsn_radio.read(data, bytes_read);
+
+		#ifdef VAMP_WSN_ACK_PAYLOAD
+		/* La primera trama del pipe 0 se llevó la respuesta cargada en su ACK */
+		if (pipe == VAMP_WSN_PIPE_GW && ack_loaded >= 0) {
+			nrf_ack_sent(data, bytes_read);
+			ack_gone = true;
+		}
+		#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+		if (!frame) {
+			rx_stats.ring_drops++;
+			continue;
+		}
+
+		frame->len = bytes_read;
+		frame->pipe = pipe;
+		frame->rx_time = millis();
+
+		drained++;
+		rx_stats.rx_frames++;
+
+		#ifdef VAMP_WSN_SUBADDR
+		if (alarm) {
+			rx_alarm_queue.commit();
+			rx_stats.rx_alarms++;
+			continue;
+		}
+		#endif /* VAMP_WSN_SUBADDR */
+
+		rx_queue.commit();
+
+		if (rx_queue.size() > rx_stats.ring_high_water) {
+			rx_stats.ring_high_water = rx_queue.size();
+		}
+	}
+
+	#ifdef VAMP_WSN_ACK_PAYLOAD
+	/* Las demás tramas de esta vuelta llegaron antes de cargar la siguiente */
+	if (ack_gone) {
+		nrf_ack_next();
+	}
+	#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+	return drained;
+}
+
+#ifdef VAMP_WSN_IRQ_PIN
+/* Interrupción del pin IRQ del nRF24 (activo en bajo) */
+void NRF_ISR_ATTR nrf_irq_handler(void) {
+	nrf_irq_pending = true;
+}
+#endif /* VAMP_WSN_IRQ_PIN */
+
+/** @brief Atender el radio: con interrupciones solo se accede al chip si la
+ * 	interrupción lo indicó, sin ellas se consulta la FIFO directamente
+ *  @return Cantidad de tramas extraídas del chip
+ */
+uint8_t nrf_service(void) {
+
+	#ifdef VAMP_WSN_IRQ_PIN
+	if (nrf_irq_enabled) {
+		if (!nrf_irq_pending) {
+			return 0;
+		}
+		/* Limpiar las banderas antes de vaciar, asi una trama que llegue
+		después vuelve a bajar el pin y genera otra interrupción */
+		nrf_irq_pending = false;
+		bool tx_ok, tx_fail, rx_ready;
+		wsn_radio.whatHappened(tx_ok, tx_fail, rx_ready);
+	}
+	#endif /* VAMP_WSN_IRQ_PIN */
+
+	return nrf_drain();
+}
+
+/* Descartar todas las tramas pendientes, en el chip y en la cola */
+void nrf_flush(void) {
+	wsn_radio.flush_rx();
+	rx_queue.clear();
+	#ifdef VAMP_WSN_SUBADDR
+	rx_alarm_queue.clear();
+	#endif /* VAMP_WSN_SUBADDR */
 }
 
 /** @brief Lee datos del nRF24
  * 
  * @return 	Número de bytes leídos si hay datos disponibles, 
  * 			0 en caso contrario
+ * @note	La trama más antigua de la cola queda en nrf_buff
  */
 uint8_t nrf_read(void) {
 
 	/* Recibiendo datos desde el nRF24 */
-	if (!wsn_radio.available()) {
-		return 0;
+	nrf_service();
+
+	#ifdef VAMP_WSN_SUBADDR
+	/* Las alarmas se saltan la cola */
+	nrf_frame_t * alarm = rx_alarm_queue.front();
+	if (alarm) {
+		uint8_t bytes_read = alarm->len;
+		memcpy(nrf_buff, alarm->data, bytes_read);
+		last_rx_time = alarm->rx_time;
+		last_rx_pipe = alarm->pipe;
+		rx_alarm_queue.pop();
+		return bytes_read;
 	}
-	
-	/* Leer datos del nRF24 */
-	uint8_t bytes_read = wsn_radio.getDynamicPayloadSize();
-	if (!bytes_read)
+	#endif /* VAMP_WSN_SUBADDR */
+
+	nrf_frame_t * frame = rx_queue.front();
+	if (!frame) {
 		return 0;
-	if (bytes_read > VAMP_MAX_PAYLOAD_SIZE) 
-		bytes_read = VAMP_MAX_PAYLOAD_SIZE;
-	wsn_radio.read(nrf_buff, bytes_read);
+	}
+
+	/* Entregar la trama más antigua */
+	uint8_t bytes_read = frame->len;
+	memcpy(nrf_buff, frame->data, bytes_read);
+	last_rx_time = frame->rx_time;
+	last_rx_pipe = frame->pipe;
+	rx_queue.pop();
 
 	return bytes_read; // Éxito al recibir datos
 }
 
+uint32_t nrf_get_rx_time(void) {
+	return last_rx_time;
+}
+
+uint8_t nrf_get_rx_pipe(void) {
+	return last_rx_pipe;
+}
+
+void nrf_get_stats(vamp_wsn_stats_t * stats) {
+	memcpy(stats, &rx_stats, sizeof(vamp_wsn_stats_t));
+}
+
 /** 
  * Escuchar en una ventana por si hay alguna solicitud TICKET
  * @return 	Número de bytes leídos si hay datos disponibles, 
@@ -128,7 +415,7 @@ uint8_t nrf_read(void) {
  */
 uint8_t nrf_listen_window(void) {
 	
-	wsn_radio.flush_rx();
+	nrf_flush();
 	wsn_radio.startListening();
 
 	uint8_t bytes_read = 0;
@@ -143,13 +430,30 @@ uint8_t nrf_listen_window(void) {
 	return bytes_read; // Timeout - no respuesta
 }
 
+/* Los envíos al broadcast y a sus sub-direcciones no esperan ACK, salvo la alarma */
+static bool nrf_no_ack(const uint8_t * dst_addr) {
+
+	if (!VAMP_IS_MULTICAST_ADDR(dst_addr)) {
+		return false;
+	}
+
+	#ifdef VAMP_WSN_SUBADDR
+	static const uint8_t alarm_addr[VAMP_ADDR_LEN] = {VAMP_ALARM_ADDR};
+	if (memcmp(dst_addr, alarm_addr, VAMP_ADDR_LEN) == 0) {
+		return false;
+	}
+	#endif /* VAMP_WSN_SUBADDR */
+
+	return true;
+}
+
 /* Enviar datos a un dispositivo */
 bool nrf_tell(uint8_t * dst_addr, uint8_t len) {
 
 	wsn_radio.openWritingPipe(dst_addr);
 
 	/* Si es un broadcast no se espera ACK */
-	if(VAMP_IS_BROADCAST_ADDR(dst_addr)){
+	if(nrf_no_ack(dst_addr)){
 
 		#ifdef VAMP_DEBUG
 		printf("[WSN] BCAST\n");
@@ -167,9 +471,272 @@ bool nrf_tell(uint8_t * dst_addr, uint8_t len) {
 	return false; // Éxito al enviar datos		
 }
 
+/* Tiempo que el gateway estuvo sin escuchar para enviar */
+static void nrf_tx_blind(uint32_t start_us) {
+	uint32_t blind = micros() - start_us;
+	rx_stats.tx_bursts++;
+	rx_stats.tx_blind_us += blind;
+	if (blind > rx_stats.tx_blind_max_us) {
+		rx_stats.tx_blind_max_us = blind;
+	}
+}
+
+#ifdef VAMP_WSN_TX_BATCH
+/** @brief Enviar las respuestas juntadas en una sola salida de escucha
+ * 
+ *  Por cada destino se abre el pipe de escritura una vez y sus tramas se
+ *  encadenan en la FIFO de TX con writeFast(). txStandBy() espera que se
+ *  vacíe antes de cambiar de destino, porque la dirección se aplica al
+ *  transmitir. Sin ACK se descarta lo que queda del destino.
+ *  @return false si algún destino se quedó sin ACK
+ */
+static bool nrf_tx_flush(void) {
+
+	if (!tx_count) {
+		return true;
+	}
+
+	/* Rescatar lo que haya en la FIFO antes de dejar de escuchar */
+	nrf_service();
+
+	uint32_t start_us = micros();
+	wsn_radio.stopListening();
+
+	bool all_ok = true;
+	for (uint8_t i = 0; i < tx_count; i++) {
+		if (tx_batch[i].sent) {
+			continue;
+		}
+
+		uint8_t * dst_addr = tx_batch[i].dst_addr;
+		bool multicast = VAMP_IS_MULTICAST_ADDR(dst_addr);
+		wsn_radio.openWritingPipe(dst_addr);
+
+		bool ok = true;
+		for (uint8_t j = i; j < tx_count; j++) {
+			if (tx_batch[j].sent || memcmp(tx_batch[j].dst_addr, dst_addr, VAMP_ADDR_LEN) != 0) {
+				continue;
+			}
+			tx_batch[j].sent = true;
+			if (!ok) {
+				continue;
+			}
+			rx_stats.tx_frames++;
+			/* Con MAX_RT no encola más, txStandBy() lo limpia */
+			ok = wsn_radio.writeFast(tx_batch[j].data, tx_batch[j].len, multicast);
+		}
+
+		if (!wsn_radio.txStandBy() || !ok) {
+			rx_stats.tx_failures++;
+			all_ok = false;
+			#ifdef VAMP_DEBUG
+			printf("[F24] burst to ");
+			vamp_debug_msg(dst_addr, VAMP_ADDR_LEN);
+			#endif /* VAMP_DEBUG */
+		}
+	}
+
+	wsn_radio.startListening();
+	nrf_tx_blind(start_us);
+	#ifdef VAMP_WSN_ACK_PAYLOAD
+	nrf_ack_restore();
+	#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+	tx_count = 0;
+	return all_ok;
+}
+
+/* Sacar la ráfaga antes de que el gateway se bloquee */
+bool nrf_tx_send(void) {
+	if (vamp_get_settings() & VAMP_RMODE_B) {
+		return nrf_tx_flush();
+	}
+	return true;
+}
+
+/* Encolar una respuesta para la próxima ráfaga. Con la ráfaga llena sale antes,
+y si esa salida falla se devuelve false aunque la respuesta quedó encolada */
+static bool nrf_tx_queue(uint8_t * dst_addr, const uint8_t * data, uint8_t len) {
+
+	bool ok = true;
+	if (tx_count >= VAMP_WSN_TX_BATCH_LEN) {
+		ok = nrf_tx_flush();
+	}
+
+	nrf_tx_frame_t * frame = &tx_batch[tx_count++];
+	memcpy(frame->dst_addr, dst_addr, VAMP_ADDR_LEN);
+	memcpy(frame->data, data, len);
+	frame->len = len;
+	frame->sent = false;
+	return ok;
+}
+#endif /* VAMP_WSN_TX_BATCH */
+
+#ifdef VAMP_WSN_ACK_PAYLOAD
+/* Cargar en el chip la próxima respuesta en espera, por turnos entre los nodos.
+Las que ya nadie va a recoger se descartan */
+static void nrf_ack_next(void) {
+
+	if (ack_loaded >= 0) {
+		return;
+	}
+
+	for (uint8_t n = 0; n < VAMP_WSN_ACK_PENDING; n++) {
+		uint8_t i = (uint8_t)((ack_turn + n) % VAMP_WSN_ACK_PENDING);
+		nrf_ack_pending_t * pending = &ack_pending[i];
+		if (!pending->used) {
+			continue;
+		}
+		if (millis() - pending->since > VAMP_WSN_ACK_PENDING_MS) {
+			pending->used = false;
+			rx_stats.ack_drops++;
+			continue;
+		}
+		if (wsn_radio.writeAckPayload(VAMP_WSN_PIPE_GW, pending->data, pending->len)) {
+			ack_loaded = (int8_t)i;
+			ack_turn = (uint8_t)((i + 1) % VAMP_WSN_ACK_PENDING);
+		}
+		return;
+	}
+}
+
+/* Una trama del pipe 0 se llevó la respuesta cargada. Si no era su destinatario
+(el nodo la descarta) vuelve a esperar su turno */
+static void nrf_ack_sent(const uint8_t * data, uint8_t len) {
+
+	nrf_ack_pending_t * pending = &ack_pending[ack_loaded];
+	ack_loaded = -1;
+
+	if (len > 1 && data[1] == pending->wsn_id) {
+		pending->used = false;
+		return;
+	}
+	rx_stats.ack_misses++;
+}
+
+/* Volver a cargar la respuesta que stopListening() borró del chip junto con la FIFO de TX */
+static void nrf_ack_restore(void) {
+	ack_loaded = -1;
+	nrf_ack_next();
+}
+
+/** @brief Dejar una respuesta para el próximo ACK del pipe 0 que reciba el nodo
+ * 
+ *  El gateway no sale de escucha: el chip la entrega sola cuando el nodo
+ *  transmita de nuevo. Cada nodo tiene a lo sumo una respuesta en espera (una
+ *  nueva reemplaza a la que no recogió) y el chip tiene cargada una sola: el
+ *  ACK del pipe 0 se lo lleva el primer nodo que transmita, no necesariamente
+ *  el destinatario. Por eso va [ID compacto][respuesta], el nodo descarta las
+ *  que no son suyas y la respuesta vuelve a cargarse hasta que la recoja su
+ *  nodo o pase VAMP_WSN_ACK_PENDING_MS.
+ *  Las respuestas perdidas (reemplazadas, sin lugar o vencidas) quedan en
+ *  ack_drops de vamp_wsn_get_stats().
+ *  @param dst_addr Nodo destinatario, tiene que estar en la tabla
+ *  @param len Longitud de la respuesta en nrf_buff
+ *  @return true si quedó en espera, false si hay que enviarla aparte
+ */
+bool nrf_ack_load(uint8_t * dst_addr, uint8_t len) {
+
+	uint8_t index = vamp_find_device(dst_addr);
+	vamp_entry_t * entry = vamp_get_table_entry(index);
+	if (!entry || len + VAMP_ACK_TAG_LEN > VAMP_MAX_PAYLOAD_SIZE) {
+		return false;
+	}
+
+	/* Atribuir al ACK correcto las tramas que ya llegaron */
+	nrf_service();
+
+	/* La del mismo nodo, una libre o la más vieja */
+	nrf_ack_pending_t * slot = NULL;
+	for (uint8_t i = 0; i < VAMP_WSN_ACK_PENDING; i++) {
+		nrf_ack_pending_t * pending = &ack_pending[i];
+		if (pending->used && pending->wsn_id == entry->wsn_id) {
+			slot = pending;
+			break;
+		}
+		if (!slot || (slot->used && (!pending->used || (int32_t)(pending->since - slot->since) < 0))) {
+			slot = pending;
+		}
+	}
+
+	if (slot->used) {
+		rx_stats.ack_drops++;
+		/* Si es la que está en el chip, se saca */
+		if (ack_loaded == (int8_t)(slot - ack_pending)) {
+			wsn_radio.flush_tx();
+			ack_loaded = -1;
+		}
+	}
+
+	slot->used = true;
+	slot->wsn_id = entry->wsn_id;
+	slot->since = millis();
+	slot->data[0] = entry->wsn_id;
+	memcpy(&slot->data[VAMP_ACK_TAG_LEN], nrf_buff, len);
+	slot->len = len + VAMP_ACK_TAG_LEN;
+	rx_stats.ack_payloads++;
+
+	nrf_ack_next();
+	return true;
+}
+
+/** @brief Recoger la respuesta que el gateway precargó en sus ACK
+ * 
+ *  El gateway no puede preparar la respuesta en los ~130us que tarda el ACK
+ *  de la trama original, asi que lo que haya llegado con ese ACK es de un
+ *  intercambio anterior y se descarta. Luego se envían PINGs cortos y la 
+ *  respuesta llega en el ACK de alguno de ellos. Una respuesta con otro ID
+ *  compacto era para otro nodo y se descarta.
+ *  @param node_id ID compacto del nodo en el gateway
+ *  @return Número de bytes recibidos en nrf_buff (sin el ID), 0 si no hubo respuesta
+ */
+uint8_t nrf_ack_fetch(uint8_t node_id) {
+
+	/* El gateway no responde al PING por radio, el ID queda para sus registros */
+	uint8_t fetch[2] = { VAMP_PING | VAMP_IS_CMD_MASK, node_id };
+
+	nrf_flush();
+
+	for (uint8_t i = 0; i < VAMP_ACK_FETCH_TRIES; i++) {
+
+		delay(VAMP_ACK_FETCH_DELAY);
+
+		if (!wsn_radio.write(fetch, sizeof(fetch), false)) {
+			continue;
+		}
+
+		uint8_t bytes_read = nrf_read();
+		if (bytes_read <= VAMP_ACK_TAG_LEN) {
+			continue;
+		}
+		if (nrf_buff[0] != node_id) {
+			#ifdef VAMP_DEBUG
+			printf("[F24] ACK for %02X, not us\n", nrf_buff[0]);
+			#endif /* VAMP_DEBUG */
+			continue;
+		}
+
+		bytes_read -= VAMP_ACK_TAG_LEN;
+		memmove(nrf_buff, &nrf_buff[VAMP_ACK_TAG_LEN], bytes_read);
+		return bytes_read;
+	}
+
+	return 0;
+}
+#endif /* VAMP_WSN_ACK_PAYLOAD */
+
 /* Verificar si el chip está en modo activo */
 bool nrf_is_chip_active(void) {
-	if (!wsn_radio.isChipConnected()) {
+
+	/* Consultar el chip por SPI en cada llamada es caro, el resultado se
+	reutiliza durante VAMP_WSN_CHIP_CHECK_MS */
+	if (last_chip_state && (millis() - last_chip_check) < VAMP_WSN_CHIP_CHECK_MS) {
+		return true;
+	}
+	last_chip_check = millis();
+	last_chip_state = wsn_radio.isChipConnected();
+
+	if (!last_chip_state) {
 		
 		/* Chip no conectado */
 		#ifdef VAMP_DEBUG
@@ -248,26 +815,64 @@ int8_t nrf_comm(uint8_t * dst_addr, uint8_t * data, uint8_t len) {
 		memcpy(nrf_buff, data, len);
 
 		if(vamp_get_settings() & VAMP_RMODE_B) {
+
+			#ifdef VAMP_WSN_ACK_PAYLOAD
+			/* Si la solicitud llegó por el pipe con ACK, la respuesta se deja
+			en el chip y viaja en el ACK de la próxima trama del nodo */
+			if (last_rx_pipe == 0 && !VAMP_IS_MULTICAST_ADDR(dst_addr) && nrf_ack_load(dst_addr, len)) {
+				return len;
+			}
+			#endif /* VAMP_WSN_ACK_PAYLOAD */
+
+			#ifdef VAMP_WSN_TX_BATCH
+			/* Sale en la ráfaga al final de la vuelta, el gateway no espera
+			nada de vuelta. Un 0 es que falló la ráfaga que le hizo lugar */
+			return nrf_tx_queue(dst_addr, data, len) ? len : 0;
+			#else
+
+			/* Rescatar lo que haya en la FIFO antes de dejar de escuchar */
+			nrf_service();
 			/* Modo siempre escucha asi que que dejar de escuchar */
+			uint32_t start_us = micros();
 			wsn_radio.stopListening();
 			/* Enviar datos */
+			rx_stats.tx_frames++;
 			if (!nrf_tell(dst_addr, len)) {
 				/* Si falló, se devuelve 0 */
+				rx_stats.tx_failures++;
 				len = 0;
 			}
 			/* Volver a escuchar */
 			wsn_radio.startListening();
+			nrf_tx_blind(start_us);
+			#ifdef VAMP_WSN_ACK_PAYLOAD
+			nrf_ack_restore();
+			#endif /* VAMP_WSN_ACK_PAYLOAD */
 
 			return len;
+			#endif /* VAMP_WSN_TX_BATCH */
 
 		}
 
 		/* Modo bajo consumo, esperamos respuesta */
 		if (vamp_get_settings() & VAMP_RMODE_A) {
 
+			#ifdef VAMP_WSN_ACK_PAYLOAD
+			/* Todas las tramas del nodo al gateway llevan su ID compacto en el
+			byte 1, es el que tiene que venir en la respuesta del ACK */
+			uint8_t node_id = len > 1 ? nrf_buff[1] : 0;
+			#endif /* VAMP_WSN_ACK_PAYLOAD */
+
 			/* Encender el chip */
 			wsn_radio.powerUp();
 			if (nrf_tell(dst_addr, len)) {
+				#ifdef VAMP_WSN_ACK_PAYLOAD
+				/* El ACK de un broadcast o de una alarma no trae la respuesta, llega
+				por la ventana */
+				if (!VAMP_IS_MULTICAST_ADDR(dst_addr)) {
+					len = nrf_ack_fetch(node_id);
+				} else
+				#endif /* VAMP_WSN_ACK_PAYLOAD */
 				/* Si se envió correctamente, abrir ventana de escucha */
 				len = nrf_listen_window();
 				if (len) {
@@ -10,6 +10,8 @@
 
 #include <Arduino.h>
 
+#include "../../vamp_callbacks.h"
+
 #ifdef MOTE_IDOS_BOARD
 	#define RF24_AVAILABLE
 #endif
@@ -37,6 +39,37 @@ bool nrf_init(uint8_t ce_pin, uint8_t csn_pin, uint8_t * addr);
  */
 int8_t nrf_comm(uint8_t * dst_addr, uint8_t * data, uint8_t len);
 
+/** @brief Vacía la FIFO de recepción del chip hacia la cola de tramas
+ * 
+ *  Cada trama se guarda junto al momento en que se extrajo del chip.
+ *  Si la cola está llena la trama se descarta y se contabiliza.
+ *  @return Cantidad de tramas extraídas del chip
+ */
+uint8_t nrf_drain(void);
+
+#ifdef VAMP_WSN_TX_BATCH
+/** @brief Envía ya las respuestas juntadas para la próxima ráfaga
+ * 
+ *  Al final de cada vuelta del gateway y antes de que quede bloqueado
+ *  (request al endpoint, sincronización), mientras el nodo espera la
+ *  respuesta en su ventana de escucha.
+ *  @return false si algún destino se quedó sin ACK
+ */
+bool nrf_tx_send(void);
+#endif /* VAMP_WSN_TX_BATCH */
+
+/** @brief Momento (millis) de recepción de la última trama entregada */
+uint32_t nrf_get_rx_time(void);
+
+/** @brief Pipe por el que llegó la última trama entregada */
+uint8_t nrf_get_rx_pipe(void);
+
+/** @brief Copia las estadísticas de recepción
+ * 
+ *  @param stats Estructura destino
+ */
+void nrf_get_stats(vamp_wsn_stats_t * stats);
+
 /** @brief Is chip active mode
  * 
  *  @return true si el chip está en modo activo, false en caso contrario
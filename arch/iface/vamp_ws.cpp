@@ -0,0 +1,422 @@
+/**
+ *
+ *
+ *
+ */
+
+#if defined(ARDUINO_ARCH_ESP8266)
+
+#include "vamp_ws.h"
+#include "vamp_esp8266.h"
+
+#ifdef VAMP_WS
+
+#include "../../vamp_gw.h"
+#include "../../lib/vamp_url.h"
+#include "../../lib/vamp_ws.h"
+
+#ifdef VAMP_DNS_CACHE
+#include "vamp_dns.h"
+#endif /* VAMP_DNS_CACHE */
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+
+/* Clave de un canal: "esquema://host:puerto" */
+#define VAMP_WS_KEY_LEN (VAMP_URL_SCHEME_MAX_LEN + VAMP_URL_HOST_MAX_LEN + 10)
+
+/* Canal con un backend */
+typedef struct {
+	char key[VAMP_WS_KEY_LEN];				// Servidor del canal, "" = libre
+	char endpoint[VAMP_ENDPOINT_MAX_LEN];	// URL con el que se abrió (ruta del handshake)
+	WiFiClient * client;					// WiFiClient o WiFiClientSecure según el esquema
+	bool open;								// Handshake completado
+	uint32_t last_tx;
+	uint32_t last_attempt;
+	vamp_ws_reader_t reader;
+} vamp_ws_channel_t;
+
+static vamp_ws_channel_t ws_channels[VAMP_WS_CHANNELS];
+
+static uint8_t ws_frame[VAMP_WS_TX_MAX];
+
+static void vamp_ws_random(uint8_t * buf, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = (uint8_t)random(0, 256);
+	}
+}
+
+static bool vamp_ws_write(vamp_ws_channel_t * channel, uint8_t opcode, const uint8_t * payload, size_t len) {
+
+	uint8_t mask_key[4];
+	vamp_ws_random(mask_key, sizeof(mask_key));
+
+	size_t frame_len = vamp_ws_frame(ws_frame, sizeof(ws_frame), opcode, payload, len, mask_key);
+	if (!frame_len || !channel->client || channel->client->write(ws_frame, frame_len) != frame_len) {
+		return false;
+	}
+	channel->last_tx = millis();
+	return true;
+}
+
+static void vamp_ws_drop(vamp_ws_channel_t * channel) {
+	if (channel->client) {
+		channel->client->stop();
+	}
+	channel->open = false;
+}
+
+/* Conectar y hacer el handshake HTTP/1.1 Upgrade. Es lo único que bloquea */
+static bool vamp_ws_connect(vamp_ws_channel_t * channel) {
+
+	channel->last_attempt = millis();
+
+	vamp_url_t url;
+	if (!vamp_url_parse(channel->endpoint, &url) || WiFi.status() != WL_CONNECTED) {
+		return false;
+	}
+
+	if (!channel->client) {
+		if (url.secure) {
+			WiFiClientSecure * secure = new WiFiClientSecure();
+			if (secure) {
+				secure->setBufferSizes(TLS_BUFFER_SIZE_RX, TLS_BUFFER_SIZE_TX);
+				secure->setInsecure(); // ToDo: usar certificados en producción
+			}
+			channel->client = secure;
+		} else {
+			channel->client = new WiFiClient();
+		}
+		if (!channel->client) {
+			return false;
+		}
+	}
+
+	if (url.secure && ESP.getMaxFreeBlockSize() < (MIN_HEAP_FOR_TLS + MIN_HEAP_FOR_TCP_CLIENT)) {
+		#ifdef VAMP_DEBUG
+		printf("[WS] Not enough heap for TLS\n");
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	channel->client->setTimeout(VAMP_WS_TIMEOUT);
+	#ifdef VAMP_DNS_CACHE
+	bool connected = vamp_dns_connect(channel->client, url.host, url.port, url.secure);
+	#else
+	bool connected = channel->client->connect(url.host, url.port);
+	#endif /* VAMP_DNS_CACHE */
+	if (!connected) {
+		#ifdef VAMP_DEBUG
+		printf("[WS] Connection to %s:%u failed\n", url.host, url.port);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+	channel->client->setNoDelay(true);
+
+	uint8_t key_raw[16];
+	char key[25];
+	vamp_ws_random(key_raw, sizeof(key_raw));
+	vamp_ws_base64(key_raw, sizeof(key_raw), key, sizeof(key));
+
+	int len = snprintf((char *)ws_frame, sizeof(ws_frame),
+		"GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+		"Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+		url.path, url.host, key);
+	if (len <= 0 || len >= (int)sizeof(ws_frame) ||
+			channel->client->write(ws_frame, len) != (size_t)len) {
+		vamp_ws_drop(channel);
+		return false;
+	}
+
+	/* Leer la respuesta hasta la línea vacía, solo importa el 101 */
+	char status[16];
+	uint8_t status_len = 0;
+	uint32_t tail = 0;		// Últimos 4 bytes, buscando "\r\n\r\n"
+	bool headers_done = false;
+	uint32_t start = millis();
+
+	while (!headers_done && (millis() - start) < VAMP_WS_TIMEOUT) {
+		if (channel->client->available() <= 0) {
+			if (!channel->client->connected()) {
+				break;
+			}
+			yield();
+			continue;
+		}
+		char c = (char)channel->client->read();
+		if (status_len < sizeof(status) - 1) {
+			status[status_len++] = c;
+		}
+		tail = (tail << 8) | (uint8_t)c;
+		headers_done = (tail == 0x0D0A0D0A);
+	}
+	status[status_len] = '\0';
+
+	if (!headers_done || strncmp(status, "HTTP/1.1 101", 12) != 0) {
+		#ifdef VAMP_DEBUG
+		printf("[WS] Handshake with %s failed\n", channel->endpoint);
+		#endif /* VAMP_DEBUG */
+		vamp_ws_drop(channel);
+		return false;
+	}
+
+	vamp_ws_reader_reset(&channel->reader);
+	channel->open = true;
+	channel->last_tx = millis();
+
+	#ifdef VAMP_DEBUG
+	printf("[WS] Channel open: %s\n", channel->endpoint);
+	#endif /* VAMP_DEBUG */
+
+	return true;
+}
+
+/* Los canales se identifican por servidor: los perfiles que apuntan al mismo
+host y puerto comparten la conexión aunque su ruta o query cambie (el backend
+distingue los mensajes por el rf_id). El handshake usa la ruta del primero */
+static bool vamp_ws_key(const char * endpoint, char * key) {
+	vamp_url_t url;
+	if (!vamp_url_parse(endpoint, &url)) {
+		return false;
+	}
+	snprintf(key, VAMP_WS_KEY_LEN, "%s://%s:%u", url.scheme, url.host, url.port);
+	return true;
+}
+
+/* Canal del servidor del endpoint, o uno libre (o el que está caído) para abrirlo.
+   NULL si el URL no es válido */
+static vamp_ws_channel_t * vamp_ws_channel(const char * endpoint) {
+
+	char key[VAMP_WS_KEY_LEN];
+	if (!vamp_ws_key(endpoint, key)) {
+		return NULL;
+	}
+
+	vamp_ws_channel_t * candidate = NULL;
+
+	for (uint8_t i = 0; i < VAMP_WS_CHANNELS; i++) {
+		if (strcmp(ws_channels[i].key, key) == 0) {
+			return &ws_channels[i];
+		}
+		if (!candidate || (candidate->key[0] && (!ws_channels[i].key[0] || !ws_channels[i].open))) {
+			candidate = &ws_channels[i];
+		}
+	}
+
+	if (candidate->key[0]) {
+		#ifdef VAMP_DEBUG
+		printf("[WS] Closing channel %s to reuse it\n", candidate->key);
+		#endif /* VAMP_DEBUG */
+		vamp_ws_drop(candidate);
+		/* El esquema puede cambiar, el cliente se vuelve a crear */
+		delete candidate->client;
+		candidate->client = NULL;
+	}
+
+	strcpy(candidate->key, key);
+	strncpy(candidate->endpoint, endpoint, sizeof(candidate->endpoint) - 1);
+	candidate->endpoint[sizeof(candidate->endpoint) - 1] = '\0';
+	candidate->open = false;
+	candidate->last_attempt = 0;
+
+	return candidate;
+}
+
+bool vamp_ws_send(const vamp_profile_t * profile, const char * data, size_t data_len) {
+
+	if (!profile || !profile->endpoint_resource || !data) {
+		return false;
+	}
+
+	vamp_ws_channel_t * channel = vamp_ws_channel(profile->endpoint_resource);
+	if (!channel) {
+		return false;
+	}
+
+	if (!channel->open || !channel->client->connected()) {
+		channel->open = false;
+		if (!vamp_ws_connect(channel)) {
+			return false;
+		}
+	}
+
+	if (!vamp_ws_write(channel, VAMP_WS_OP_TEXT, (const uint8_t *)data, data_len)) {
+		#ifdef VAMP_DEBUG
+		printf("[WS] Send failed on %s\n", channel->endpoint);
+		#endif /* VAMP_DEBUG */
+		vamp_ws_drop(channel);
+		return false;
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[WS] Sent %u bytes to %s\n", (unsigned)data_len, channel->endpoint);
+	#endif /* VAMP_DEBUG */
+
+	return true;
+}
+
+/* Leer lo que haya llegado por el canal, sin esperar */
+static void vamp_ws_read(vamp_ws_channel_t * channel) {
+
+	while (channel->open && channel->client->available() > 0) {
+		int byte = channel->client->read();
+		if (byte < 0) {
+			break;
+		}
+
+		int8_t result = vamp_ws_reader_feed(&channel->reader, (uint8_t)byte);
+		if (result < 0) {
+			vamp_ws_drop(channel);
+			return;
+		}
+		if (result == 0) {
+			continue;
+		}
+
+		vamp_ws_reader_t * reader = &channel->reader;
+
+		if (result == VAMP_WS_RX_MESSAGE) {
+			/* Mensaje de datos completo: downlink para un nodo */
+			if (reader->opcode == VAMP_WS_OP_TEXT || reader->opcode == VAMP_WS_OP_BINARY) {
+				if (reader->truncated) {
+					#ifdef VAMP_DEBUG
+					printf("[WS] Downlink larger than %d bytes dropped\n", VAMP_WS_RX_MAX);
+					#endif /* VAMP_DEBUG */
+					continue;
+				}
+				vamp_gw_downlink((char *)reader->data, reader->len);
+			}
+			continue;
+		}
+
+		/* Trama de control, puede haber llegado en medio de un mensaje */
+		switch (reader->control_opcode) {
+			case VAMP_WS_OP_PING:
+				vamp_ws_write(channel, VAMP_WS_OP_PONG, reader->control, reader->control_len);
+				break;
+
+			case VAMP_WS_OP_CLOSE:
+				#ifdef VAMP_DEBUG
+				printf("[WS] Closed by server: %s\n", channel->endpoint);
+				#endif /* VAMP_DEBUG */
+				vamp_ws_write(channel, VAMP_WS_OP_CLOSE, NULL, 0);
+				vamp_ws_drop(channel);
+				return;
+
+			default:
+				break;
+		}
+	}
+}
+
+/* Algún perfil de la tabla sigue apuntando al servidor del canal. Los perfiles
+se liberan y se vuelven a crear en cada sincronización, asi que el canal no se
+cierra al liberar uno sino cuando ya nadie lo usa */
+static bool vamp_ws_referenced(const vamp_ws_channel_t * channel) {
+
+	char key[VAMP_WS_KEY_LEN];
+
+	for (uint8_t i = 0; i < VAMP_MAX_DEVICES; i++) {
+		vamp_entry_t * entry = vamp_get_table_entry(i);
+		if (!entry || entry->status == VAMP_DEV_STATUS_FREE) {
+			continue;
+		}
+		vamp_profile_t * profiles = vamp_get_entry_profiles(i);
+		for (uint8_t p = 0; p < entry->profile_count; p++) {
+			if (profiles[p].protocol == VAMP_PROTOCOL_WEBSOCKET && profiles[p].endpoint_resource &&
+					vamp_ws_key(profiles[p].endpoint_resource, key) && strcmp(key, channel->key) == 0) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/* Cerrar el canal y dejar el slot libre */
+static void vamp_ws_release(vamp_ws_channel_t * channel) {
+
+	#ifdef VAMP_DEBUG
+	printf("[WS] Channel no longer used: %s\n", channel->key);
+	#endif /* VAMP_DEBUG */
+
+	if (channel->open) {
+		vamp_ws_write(channel, VAMP_WS_OP_CLOSE, NULL, 0);
+	}
+	vamp_ws_drop(channel);
+	/* El próximo servidor puede tener otro esquema */
+	delete channel->client;
+	channel->client = NULL;
+	channel->key[0] = '\0';
+}
+
+void vamp_ws_loop(void) {
+
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_WS_CHANNELS; i++) {
+		vamp_ws_channel_t * channel = &ws_channels[i];
+
+		if (!channel->key[0]) {
+			continue;
+		}
+
+		/* Un canal caído se reabre para no perder lo que empuje el backend,
+		salvo que ningún perfil lo use ya */
+		if (!channel->open || !channel->client || !channel->client->connected()) {
+			channel->open = false;
+			if ((now - channel->last_attempt) >= VAMP_WS_RECONNECT_MS) {
+				if (!vamp_ws_referenced(channel)) {
+					vamp_ws_release(channel);
+					continue;
+				}
+				vamp_ws_connect(channel);
+			}
+			continue;
+		}
+
+		vamp_ws_read(channel);
+
+		/* Lo mismo con uno abierto, en cada PING */
+		if (channel->open && (now - channel->last_tx) >= VAMP_WS_PING_MS) {
+			if (!vamp_ws_referenced(channel)) {
+				vamp_ws_release(channel);
+				continue;
+			}
+			if (!vamp_ws_write(channel, VAMP_WS_OP_PING, NULL, 0)) {
+				vamp_ws_drop(channel);
+			}
+		}
+	}
+}
+
+static bool vamp_ws_open(const vamp_profile_t * profile) {
+	if (!profile || !profile->endpoint_resource) {
+		return false;
+	}
+	vamp_ws_channel_t * channel = vamp_ws_channel(profile->endpoint_resource);
+	if (!channel) {
+		return false;
+	}
+	if (channel->open && channel->client->connected()) {
+		return true;
+	}
+	channel->open = false;
+	return vamp_ws_connect(channel);
+}
+
+static bool vamp_ws_send_frame(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
+	(void)size;
+	return vamp_ws_send(profile, data, len);
+}
+
+const vamp_transport_t vamp_ws_transport = {
+	vamp_ws_open,
+	vamp_ws_send_frame,
+	NULL,
+	vamp_ws_loop
+};
+
+#endif /* VAMP_WS */
+
+#endif // ARDUINO_ARCH_ESP8266
@@ -0,0 +1,37 @@
+/**
+ *
+ * Transporte WebSocket (ws:// y wss://), un canal persistente por backend
+ *
+ */
+#ifndef VAMP_WS_IFACE_H_
+#define VAMP_WS_IFACE_H_
+
+#include <Arduino.h>
+#include "../../vamp_config.h"
+#include "../../lib/vamp_table.h"
+#include "../../lib/vamp_transport.h"
+
+#ifdef VAMP_WS
+
+/** @brief Envía data como trama de texto por el canal del endpoint del perfil,
+ *  abriéndolo si hace falta. Las respuestas del backend llegan por
+ *  vamp_ws_loop() como mensajes empujados
+ *
+ * @param profile Perfil de comunicación (endpoint ws:// o wss://)
+ * @param data Datos a enviar
+ * @param data_len Largo de los datos
+ * @return true si la trama se envió
+ */
+bool vamp_ws_send(const vamp_profile_t * profile, const char * data, size_t data_len);
+
+/** @brief Atiende los canales: entrega los mensajes del backend al gateway,
+ *  contesta PING, envía PING si no hubo tráfico, reconecta los caídos y cierra
+ *  los que ningún perfil de la tabla usa ya */
+void vamp_ws_loop(void);
+
+/** @brief Transporte WebSocket para el registro */
+extern const vamp_transport_t vamp_ws_transport;
+
+#endif /* VAMP_WS */
+
+#endif // VAMP_WS_IFACE_H_
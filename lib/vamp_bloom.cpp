@@ -0,0 +1,100 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_bloom.h"
+
+#include <string.h>
+
+#define VAMP_FNV_OFFSET_BASIS	2166136261UL
+#define VAMP_FNV_PRIME			16777619UL
+
+/* FNV-1a de 32 bits a partir de "basis" */
+static uint32_t vamp_fnv1a(const uint8_t * key, size_t len, uint32_t basis) {
+	uint32_t hash = basis;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= key[i];
+		hash *= VAMP_FNV_PRIME;
+	}
+	return hash;
+}
+
+/* Valor de un dígito hex o -1 */
+static int8_t vamp_hex_nibble(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+void vamp_bloom_clear(vamp_bloom_t * bloom) {
+	if (!bloom) return;
+	bloom->bits = 0;
+	bloom->k = 0;
+	memset(bloom->data, 0, sizeof(bloom->data));
+}
+
+bool vamp_bloom_load_hex(vamp_bloom_t * bloom, uint16_t bits, uint8_t k, const char * hex) {
+
+	if (!bloom) return false;
+	vamp_bloom_clear(bloom);
+
+	if (!hex || bits == 0 || (bits % 8) != 0 || bits > (8 * VAMP_BLOOM_MAX_BYTES) ||
+		k == 0 || k > VAMP_BLOOM_MAX_K) {
+		return false;
+	}
+
+	const uint16_t bytes = bits / 8;
+	if (strlen(hex) != (size_t)bytes * 2) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < bytes; i++) {
+		int8_t hi = vamp_hex_nibble(hex[2 * i]);
+		int8_t lo = vamp_hex_nibble(hex[2 * i + 1]);
+		if (hi < 0 || lo < 0) {
+			vamp_bloom_clear(bloom);
+			return false;
+		}
+		bloom->data[i] = (uint8_t)((hi << 4) | lo);
+	}
+
+	bloom->bits = bits;
+	bloom->k = k;
+	return true;
+}
+
+bool vamp_bloom_is_loaded(const vamp_bloom_t * bloom) {
+	return bloom && bloom->bits > 0;
+}
+
+void vamp_bloom_add(vamp_bloom_t * bloom, const uint8_t * key, size_t len) {
+
+	if (!vamp_bloom_is_loaded(bloom) || !key) return;
+
+	uint32_t h1 = vamp_fnv1a(key, len, VAMP_FNV_OFFSET_BASIS);
+	uint32_t h2 = vamp_fnv1a(key, len, h1) | 1;
+
+	for (uint8_t j = 0; j < bloom->k; j++) {
+		uint16_t bit = (uint16_t)((h1 + (uint32_t)j * h2) % bloom->bits);
+		bloom->data[bit >> 3] |= (uint8_t)(1 << (bit & 0x07));
+	}
+}
+
+bool vamp_bloom_maybe_contains(const vamp_bloom_t * bloom, const uint8_t * key, size_t len) {
+
+	/* Sin filtro no se puede descartar nada */
+	if (!vamp_bloom_is_loaded(bloom) || !key) return true;
+
+	uint32_t h1 = vamp_fnv1a(key, len, VAMP_FNV_OFFSET_BASIS);
+	uint32_t h2 = vamp_fnv1a(key, len, h1) | 1;
+
+	for (uint8_t j = 0; j < bloom->k; j++) {
+		uint16_t bit = (uint16_t)((h1 + (uint32_t)j * h2) % bloom->bits);
+		if (!(bloom->data[bit >> 3] & (1 << (bit & 0x07)))) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file vamp_bloom.h
+ * @brief Filtro de Bloom de los RF_ID conocidos por el VREG
+ *
+ * El VREG puede enviar junto con la sincronización un filtro de Bloom con todos
+ * los RF_ID que tiene registrados. Con él, el gateway rechaza sin ir a la red los
+ * JOIN de nodos que el VREG seguro no conoce. Un filtro de Bloom no da falsos
+ * negativos, solo falsos positivos (que terminan en una consulta normal al VREG).
+ * Sí queda viejo: los registrados después de la sincronización no están, por eso
+ * el gateway consulta igual algún rechazo cada VAMP_BLOOM_BYPASS_MS.
+ *
+ * Formato en el JSON de sincronización:
+ *     "bloom": { "m": <bits>, "k": <funciones hash>, "hex": "<m/8 bytes en hex>" }
+ * El bit i del filtro es el bit (i % 8) del byte (i / 8).
+ *
+ * Para cada RF_ID (los 5 bytes) se usa doble hashing con FNV-1a de 32 bits:
+ *     h1 = fnv1a(rf_id, base 2166136261)
+ *     h2 = fnv1a(rf_id, base h1) | 1
+ *     bit_j = (h1 + j * h2) % m,  j = 0..k-1
+ *
+ * Prueba en el host: test/test_bloom.cpp
+ */
+
+#ifndef _VAMP_BLOOM_H_
+#define _VAMP_BLOOM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Tamaño máximo del filtro en bytes (8 bits por byte) */
+#ifndef VAMP_BLOOM_MAX_BYTES
+#define VAMP_BLOOM_MAX_BYTES 128
+#endif // VAMP_BLOOM_MAX_BYTES
+
+/** @brief Máximo de funciones hash aceptadas */
+#define VAMP_BLOOM_MAX_K 16
+
+typedef struct {
+	uint16_t bits;							// Tamaño del filtro en bits (0 = sin filtro)
+	uint8_t k;								// Cantidad de funciones hash
+	uint8_t data[VAMP_BLOOM_MAX_BYTES];		// Bits del filtro
+} vamp_bloom_t;
+
+/** @brief Dejar el filtro vacío (sin filtro, todo "puede estar") */
+void vamp_bloom_clear(vamp_bloom_t * bloom);
+
+/** @brief Cargar el filtro a partir de su representación en hex
+ *  @param bloom Filtro a cargar
+ *  @param bits Tamaño del filtro en bits (múltiplo de 8, hasta 8 * VAMP_BLOOM_MAX_BYTES)
+ *  @param k Cantidad de funciones hash (1 - VAMP_BLOOM_MAX_K)
+ *  @param hex Cadena con exactamente bits / 4 dígitos hex
+ *  @return true si se cargó, false si los parámetros no son válidos (el filtro queda vacío)
+ */
+bool vamp_bloom_load_hex(vamp_bloom_t * bloom, uint16_t bits, uint8_t k, const char * hex);
+
+/** @brief Verificar si hay un filtro cargado */
+bool vamp_bloom_is_loaded(const vamp_bloom_t * bloom);
+
+/** @brief Marcar una clave en el filtro */
+void vamp_bloom_add(vamp_bloom_t * bloom, const uint8_t * key, size_t len);
+
+/** @brief Consultar una clave
+ *  @return false si la clave seguro NO está, true si puede estar (o no hay filtro)
+ */
+bool vamp_bloom_maybe_contains(const vamp_bloom_t * bloom, const uint8_t * key, size_t len);
+
+#endif /* _VAMP_BLOOM_H_ */
@@ -0,0 +1,177 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_breaker.h"
+
+#include <string.h>
+
+typedef struct {
+	char host[VAMP_URL_HOST_MAX_LEN];		// "" = libre
+	uint16_t port;
+	uint8_t state;
+	uint8_t failures;						// Fallos seguidos con el circuito cerrado
+	uint8_t trips;							// Pruebas fallidas seguidas, para el backoff
+	uint32_t until;							// Fin del backoff, o de la prueba si está semiabierto
+	uint32_t last_used;
+} vamp_breaker_slot_t;
+
+static vamp_breaker_slot_t breaker_slots[VAMP_BREAKER_SLOTS];
+static vamp_breaker_stats_t breaker_stats;
+
+/* Slot del host, o uno libre / el menos usado (preferentemente cerrado) para seguirlo */
+static vamp_breaker_slot_t * vamp_breaker_slot(const char * host, uint16_t port, bool create, uint32_t now) {
+
+	vamp_breaker_slot_t * candidate = NULL;
+
+	for (uint8_t i = 0; i < VAMP_BREAKER_SLOTS; i++) {
+		vamp_breaker_slot_t * slot = &breaker_slots[i];
+		if (slot->host[0] && slot->port == port && strcmp(slot->host, host) == 0) {
+			slot->last_used = now;
+			return slot;
+		}
+		if (!create) {
+			continue;
+		}
+		if (!slot->host[0]) {
+			/* Un slot libre gana a cualquier ocupado */
+			if (!candidate || candidate->host[0]) {
+				candidate = slot;
+			}
+			continue;
+		}
+		if (!candidate) {
+			candidate = slot;
+			continue;
+		}
+		if (!candidate->host[0]) {
+			continue;
+		}
+		/* Un cerrado se pierde sin consecuencias, uno abierto volvería a intentar */
+		bool slot_closed = slot->state == VAMP_BREAKER_CLOSED;
+		bool candidate_closed = candidate->state == VAMP_BREAKER_CLOSED;
+		if ((slot_closed && !candidate_closed) ||
+				(slot_closed == candidate_closed && (int32_t)(slot->last_used - candidate->last_used) < 0)) {
+			candidate = slot;
+		}
+	}
+
+	if (!candidate) {
+		return NULL;
+	}
+
+	memset(candidate, 0, sizeof(vamp_breaker_slot_t));
+	strncpy(candidate->host, host, sizeof(candidate->host) - 1);
+	candidate->port = port;
+	candidate->state = VAMP_BREAKER_CLOSED;
+	candidate->last_used = now;
+	return candidate;
+}
+
+/* Abrir con backoff exponencial según las pruebas fallidas */
+static void vamp_breaker_open(vamp_breaker_slot_t * slot, uint32_t now) {
+
+	uint32_t backoff = VAMP_BREAKER_BACKOFF_MIN;
+	for (uint8_t i = 0; i < slot->trips && backoff < VAMP_BREAKER_BACKOFF_MAX; i++) {
+		backoff <<= 1;
+	}
+	if (backoff > VAMP_BREAKER_BACKOFF_MAX) {
+		backoff = VAMP_BREAKER_BACKOFF_MAX;
+	}
+
+	slot->state = VAMP_BREAKER_OPEN;
+	slot->until = now + backoff;
+	breaker_stats.opened++;
+}
+
+bool vamp_breaker_allow(const char * host, uint16_t port, uint32_t now) {
+
+	if (!host || !host[0]) {
+		return true;
+	}
+
+	vamp_breaker_slot_t * slot = vamp_breaker_slot(host, port, false, now);
+	if (!slot || slot->state == VAMP_BREAKER_CLOSED) {
+		return true;
+	}
+
+	/* Abierto o con la prueba todavía en curso */
+	if ((int32_t)(now - slot->until) < 0) {
+		breaker_stats.rejected++;
+		return false;
+	}
+
+	/* Pasó el backoff (o la prueba anterior nunca informó): un request de prueba */
+	if (slot->state == VAMP_BREAKER_OPEN) {
+		breaker_stats.half_opened++;
+	}
+	slot->state = VAMP_BREAKER_HALF_OPEN;
+	slot->until = now + VAMP_BREAKER_BACKOFF_MIN;
+	return true;
+}
+
+void vamp_breaker_report(const char * host, uint16_t port, bool ok, uint32_t now) {
+
+	if (!host || !host[0]) {
+		return;
+	}
+
+	if (ok) {
+		vamp_breaker_slot_t * slot = vamp_breaker_slot(host, port, false, now);
+		if (!slot) {
+			return;
+		}
+		if (slot->state != VAMP_BREAKER_CLOSED) {
+			breaker_stats.closed++;
+		}
+		slot->state = VAMP_BREAKER_CLOSED;
+		slot->failures = 0;
+		slot->trips = 0;
+		return;
+	}
+
+	vamp_breaker_slot_t * slot = vamp_breaker_slot(host, port, true, now);
+	if (!slot) {
+		return;
+	}
+
+	switch (slot->state) {
+		case VAMP_BREAKER_HALF_OPEN:
+			if (slot->trips < 0xFF) {
+				slot->trips++;
+			}
+			vamp_breaker_open(slot, now);
+			break;
+		case VAMP_BREAKER_CLOSED:
+			if (++slot->failures >= VAMP_BREAKER_THRESHOLD) {
+				slot->failures = 0;
+				slot->trips = 0;
+				vamp_breaker_open(slot, now);
+			}
+			break;
+		default:
+			/* Ya abierto, un request que empezó antes de abrirlo */
+			break;
+	}
+}
+
+uint8_t vamp_breaker_state(const char * host, uint16_t port) {
+
+	if (!host) {
+		return VAMP_BREAKER_CLOSED;
+	}
+
+	for (uint8_t i = 0; i < VAMP_BREAKER_SLOTS; i++) {
+		if (breaker_slots[i].host[0] && breaker_slots[i].port == port && strcmp(breaker_slots[i].host, host) == 0) {
+			return breaker_slots[i].state;
+		}
+	}
+	return VAMP_BREAKER_CLOSED;
+}
+
+void vamp_breaker_get_stats(vamp_breaker_stats_t * stats) {
+	if (stats) {
+		*stats = breaker_stats;
+	}
+}
@@ -0,0 +1,75 @@
+/**
+ * @file vamp_breaker.h
+ * @brief Circuit breaker por host para los endpoints de los perfiles
+ *
+ * Cuando un endpoint está caído cada lectura esperaría el timeout completo. El
+ * breaker cuenta los fallos seguidos de cada host y al llegar al umbral abre el
+ * circuito: los requests se rechazan sin conectar hasta que pasa el backoff.
+ * Entonces queda semiabierto y deja pasar un solo request de prueba, si sale
+ * bien se cierra y si falla se vuelve a abrir con el doble de backoff.
+ *
+ * Cuenta como fallo no llegar al servidor (DNS, conexión, TLS, timeout) o un 5xx,
+ * cualquier otra respuesta demuestra que el servidor está vivo.
+ *
+ * Prueba en el host: test/test_breaker.cpp
+ */
+
+#ifndef _VAMP_BREAKER_H_
+#define _VAMP_BREAKER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "vamp_url.h"
+
+/** @brief Hosts seguidos a la vez, sin lugar se reutiliza el menos usado */
+#ifndef VAMP_BREAKER_SLOTS
+#define VAMP_BREAKER_SLOTS 4
+#endif // VAMP_BREAKER_SLOTS
+
+/** @brief Fallos seguidos que abren el circuito */
+#ifndef VAMP_BREAKER_THRESHOLD
+#define VAMP_BREAKER_THRESHOLD 3
+#endif // VAMP_BREAKER_THRESHOLD
+
+/** @brief Backoff (ms) de la primera apertura, se duplica en cada prueba fallida */
+#ifndef VAMP_BREAKER_BACKOFF_MIN
+#define VAMP_BREAKER_BACKOFF_MIN 10000
+#endif // VAMP_BREAKER_BACKOFF_MIN
+
+/** @brief Backoff (ms) máximo */
+#ifndef VAMP_BREAKER_BACKOFF_MAX
+#define VAMP_BREAKER_BACKOFF_MAX 600000
+#endif // VAMP_BREAKER_BACKOFF_MAX
+
+/* Estados del circuito */
+#define VAMP_BREAKER_CLOSED		0	// Normal
+#define VAMP_BREAKER_OPEN		1	// Rechaza hasta que pase el backoff
+#define VAMP_BREAKER_HALF_OPEN	2	// Un request de prueba en curso
+
+/** @brief Contadores de transiciones */
+typedef struct {
+	uint32_t opened;			// Circuitos abiertos (umbral o prueba fallida)
+	uint32_t half_opened;		// Pruebas tras el backoff
+	uint32_t closed;			// Circuitos cerrados tras una prueba exitosa
+	uint32_t rejected;			// Requests rechazados sin conectar
+} vamp_breaker_stats_t;
+
+/** @brief Consultar antes de conectar con el host
+ *  @param now Tiempo actual (ms)
+ *  @return false si el circuito está abierto y el request no debe intentarse
+ */
+bool vamp_breaker_allow(const char * host, uint16_t port, uint32_t now);
+
+/** @brief Informar el resultado del request al host
+ *  @param ok true si el servidor respondió (cualquier código menor que 500)
+ */
+void vamp_breaker_report(const char * host, uint16_t port, bool ok, uint32_t now);
+
+/** @brief Estado actual del circuito del host (CLOSED si no se sigue) */
+uint8_t vamp_breaker_state(const char * host, uint16_t port);
+
+/** @brief Copia de los contadores */
+void vamp_breaker_get_stats(vamp_breaker_stats_t * stats);
+
+#endif /* _VAMP_BREAKER_H_ */
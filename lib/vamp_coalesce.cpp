@@ -0,0 +1,230 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_coalesce.h"
+
+#include <string.h>
+
+typedef struct {
+	vamp_coalesce_key_t key;
+	uint32_t expires;						// millis() en que vence
+	bool valid;
+	uint8_t len;
+	char data[VAMP_COALESCE_DATA_MAX + 1];
+} vamp_coalesce_entry_t;
+
+typedef struct {
+	vamp_coalesce_key_t key;
+	bool in_use;
+	uint8_t count;
+	vamp_coalesce_waiter_t waiters[VAMP_COALESCE_WAITERS];
+} vamp_coalesce_flight_t;
+
+static vamp_coalesce_entry_t coalesce_cache[VAMP_COALESCE_CACHE_SLOTS];
+static vamp_coalesce_flight_t coalesce_flights[VAMP_COALESCE_FLIGHTS];
+static vamp_coalesce_stats_t coalesce_stats;
+
+void vamp_coalesce_key_init(vamp_coalesce_key_t * key) {
+	key->hash = 2166136261UL;
+	key->len = 0;
+}
+
+void vamp_coalesce_key_add(vamp_coalesce_key_t * key, const char * text) {
+
+	if (!text) {
+		text = "";
+	}
+
+	/* El terminador (xor 0) separa los campos, en el hash y en el texto */
+	do {
+		key->hash ^= (uint8_t)*text;
+		key->hash *= 16777619UL;
+		if (key->len < VAMP_COALESCE_KEY_MAX) {
+			key->text[key->len] = *text;
+		}
+		if (key->len <= VAMP_COALESCE_KEY_MAX) {
+			key->len++;
+		}
+	} while (*text++);
+}
+
+bool vamp_coalesce_key_valid(const vamp_coalesce_key_t * key) {
+	return key && key->len <= VAMP_COALESCE_KEY_MAX;
+}
+
+/* El hash descarta rápido, el texto decide */
+static bool vamp_coalesce_key_equal(const vamp_coalesce_key_t * a, const vamp_coalesce_key_t * b) {
+	return a->hash == b->hash && a->len == b->len && memcmp(a->text, b->text, a->len) == 0;
+}
+
+/* Copiar solo la parte usada del texto */
+static void vamp_coalesce_key_copy(vamp_coalesce_key_t * dst, const vamp_coalesce_key_t * src) {
+	dst->hash = src->hash;
+	dst->len = src->len;
+	memcpy(dst->text, src->text, src->len);
+}
+
+static bool vamp_coalesce_alive(const vamp_coalesce_entry_t * entry, uint32_t now) {
+	return entry->valid && (int32_t)(entry->expires - now) > 0;
+}
+
+int16_t vamp_coalesce_lookup(const vamp_coalesce_key_t * key, char * data, size_t data_size, uint32_t now) {
+
+	for (uint8_t i = 0; vamp_coalesce_key_valid(key) && i < VAMP_COALESCE_CACHE_SLOTS; i++) {
+		vamp_coalesce_entry_t * entry = &coalesce_cache[i];
+		if (!entry->valid || !vamp_coalesce_key_equal(&entry->key, key)) {
+			continue;
+		}
+		if (!vamp_coalesce_alive(entry, now)) {
+			entry->valid = false;
+			break;
+		}
+		if (!data || data_size <= entry->len) {
+			break;
+		}
+		memcpy(data, entry->data, entry->len);
+		data[entry->len] = '\0';
+		coalesce_stats.hits++;
+		return entry->len;
+	}
+
+	coalesce_stats.misses++;
+	return -1;
+}
+
+void vamp_coalesce_store(const vamp_coalesce_key_t * key, const char * data, size_t len, uint32_t ttl, uint32_t now) {
+
+	if (ttl == 0 || !data || len > VAMP_COALESCE_DATA_MAX || !vamp_coalesce_key_valid(key)) {
+		return;
+	}
+
+	/* La misma clave, una libre o vencida, o la que vence antes */
+	vamp_coalesce_entry_t * slot = NULL;
+	for (uint8_t i = 0; i < VAMP_COALESCE_CACHE_SLOTS; i++) {
+		vamp_coalesce_entry_t * entry = &coalesce_cache[i];
+		if (entry->valid && vamp_coalesce_key_equal(&entry->key, key)) {
+			slot = entry;
+			break;
+		}
+		if (!vamp_coalesce_alive(entry, now)) {
+			if (!slot || vamp_coalesce_alive(slot, now)) {
+				slot = entry;
+			}
+			continue;
+		}
+		if (!slot || (vamp_coalesce_alive(slot, now) && (int32_t)(entry->expires - slot->expires) < 0)) {
+			slot = entry;
+		}
+	}
+
+	vamp_coalesce_key_copy(&slot->key, key);
+	slot->expires = now + ttl;
+	slot->valid = true;
+	slot->len = (uint8_t)len;
+	memcpy(slot->data, data, len);
+	slot->data[len] = '\0';
+	coalesce_stats.stored++;
+}
+
+uint8_t vamp_coalesce_join(const vamp_coalesce_key_t * key, uint8_t wsn_id, uint16_t ticket) {
+
+	if (!vamp_coalesce_key_valid(key)) {
+		return VAMP_COALESCE_FULL;
+	}
+
+	vamp_coalesce_flight_t * free_flight = NULL;
+
+	for (uint8_t i = 0; i < VAMP_COALESCE_FLIGHTS; i++) {
+		vamp_coalesce_flight_t * flight = &coalesce_flights[i];
+		if (!flight->in_use) {
+			if (!free_flight) {
+				free_flight = flight;
+			}
+			continue;
+		}
+		if (flight->key.hash != key->hash) {
+			continue;
+		}
+		/* Mismo hash y otro request: no se agrupa, y tampoco se abre otro en
+		vuelo con ese hash (vamp_coalesce_finish() lo busca por hash) */
+		if (!vamp_coalesce_key_equal(&flight->key, key)) {
+			return VAMP_COALESCE_FULL;
+		}
+
+		/* El nodo ya espera este request: solo cambia el ticket */
+		for (uint8_t w = 0; w < flight->count; w++) {
+			if (flight->waiters[w].wsn_id == wsn_id) {
+				flight->waiters[w].ticket = ticket;
+				coalesce_stats.joined++;
+				return VAMP_COALESCE_JOINED;
+			}
+		}
+		if (flight->count >= VAMP_COALESCE_WAITERS) {
+			return VAMP_COALESCE_FULL;
+		}
+		flight->waiters[flight->count].wsn_id = wsn_id;
+		flight->waiters[flight->count].ticket = ticket;
+		flight->count++;
+		coalesce_stats.joined++;
+		return VAMP_COALESCE_JOINED;
+	}
+
+	if (!free_flight) {
+		return VAMP_COALESCE_FULL;
+	}
+
+	free_flight->in_use = true;
+	vamp_coalesce_key_copy(&free_flight->key, key);
+	free_flight->count = 0;
+	return VAMP_COALESCE_LEADER;
+}
+
+bool vamp_coalesce_pending(const vamp_coalesce_key_t * key) {
+	for (uint8_t i = 0; vamp_coalesce_key_valid(key) && i < VAMP_COALESCE_FLIGHTS; i++) {
+		if (coalesce_flights[i].in_use && vamp_coalesce_key_equal(&coalesce_flights[i].key, key)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static vamp_coalesce_flight_t * vamp_coalesce_flight(uint32_t hash) {
+	for (uint8_t i = 0; i < VAMP_COALESCE_FLIGHTS; i++) {
+		if (coalesce_flights[i].in_use && coalesce_flights[i].key.hash == hash) {
+			return &coalesce_flights[i];
+		}
+	}
+	return NULL;
+}
+
+void vamp_coalesce_store_flight(uint32_t hash, const char * data, size_t len, uint32_t ttl, uint32_t now) {
+	vamp_coalesce_flight_t * flight = vamp_coalesce_flight(hash);
+	if (flight) {
+		vamp_coalesce_store(&flight->key, data, len, ttl, now);
+	}
+}
+
+uint8_t vamp_coalesce_finish(uint32_t hash, vamp_coalesce_waiter_t * waiters, uint8_t max) {
+
+	vamp_coalesce_flight_t * flight = vamp_coalesce_flight(hash);
+	if (!flight) {
+		return 0;
+	}
+
+	uint8_t count = 0;
+	if (waiters) {
+		count = flight->count < max ? flight->count : max;
+		memcpy(waiters, flight->waiters, count * sizeof(vamp_coalesce_waiter_t));
+	}
+	flight->in_use = false;
+	flight->count = 0;
+	return count;
+}
+
+void vamp_coalesce_get_stats(vamp_coalesce_stats_t * stats) {
+	if (stats) {
+		*stats = coalesce_stats;
+	}
+}
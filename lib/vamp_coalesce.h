@@ -0,0 +1,121 @@
+/**
+ * @file vamp_coalesce.h
+ * @brief Agrupación de requests GET idénticos y caché corta de sus respuestas
+ *
+ * Varios nodos suelen pedir lo mismo por el mismo perfil (por ejemplo el riego
+ * programado de un campo). Cada request se identifica por una clave (el texto
+ * del protocolo, endpoint, parámetros y opciones, con su hash para descartar
+ * rápido; dos requests solo se agrupan si el texto coincide). Mientras uno está en
+ * vuelo los siguientes con la misma clave se suman como espera y reciben la
+ * misma respuesta, sin otro request. Si el perfil lo pide la respuesta además
+ * queda en la caché durante su TTL y sirve a los siguientes sin tocar la red.
+ *
+ * Solo para requests sin efectos (GET), un POST nunca se agrupa.
+ *
+ * Prueba en el host: test/test_coalesce.cpp
+ */
+
+#ifndef _VAMP_COALESCE_H_
+#define _VAMP_COALESCE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Respuestas guardadas a la vez, sin lugar se reemplaza la más próxima a vencer */
+#ifndef VAMP_COALESCE_CACHE_SLOTS
+#define VAMP_COALESCE_CACHE_SLOTS 4
+#endif // VAMP_COALESCE_CACHE_SLOTS
+
+/** @brief Tamaño máximo de una respuesta guardada, las mayores no se guardan.
+ *  Alcanza para VAMP_MAX_PAYLOAD_SIZE, que es lo que recibe el nodo */
+#ifndef VAMP_COALESCE_DATA_MAX
+#define VAMP_COALESCE_DATA_MAX 32
+#endif // VAMP_COALESCE_DATA_MAX
+
+/** @brief Requests distintos que pueden tener esperas a la vez */
+#ifndef VAMP_COALESCE_FLIGHTS
+#define VAMP_COALESCE_FLIGHTS 2
+#endif // VAMP_COALESCE_FLIGHTS
+
+/** @brief Nodos que pueden esperar el mismo request, además del que lo hace */
+#ifndef VAMP_COALESCE_WAITERS
+#define VAMP_COALESCE_WAITERS 6
+#endif // VAMP_COALESCE_WAITERS
+
+/** @brief Largo máximo del texto de una clave. Cada slot de la caché y cada
+ *  request en vuelo guarda uno, un request con una clave más larga no se agrupa */
+#ifndef VAMP_COALESCE_KEY_MAX
+#define VAMP_COALESCE_KEY_MAX 96
+#endif // VAMP_COALESCE_KEY_MAX
+
+/* Resultados de vamp_coalesce_join() */
+#define VAMP_COALESCE_LEADER	0	// Primero con esa clave: el llamador hace el request
+#define VAMP_COALESCE_JOINED	1	// Quedó esperando el request en vuelo
+#define VAMP_COALESCE_FULL		2	// Sin lugar para esperar: request propio
+
+/** @brief Clave de un request: los campos separados por '\0' y su hash (FNV-1a) */
+typedef struct {
+	uint32_t hash;
+	uint8_t len;						// Bytes en text, mayor a VAMP_COALESCE_KEY_MAX si no cupo
+	char text[VAMP_COALESCE_KEY_MAX];
+} vamp_coalesce_key_t;
+
+/** @brief Nodo esperando la respuesta de un request en vuelo */
+typedef struct {
+	uint8_t wsn_id;
+	uint16_t ticket;			// TICKET del mensaje del nodo
+} vamp_coalesce_waiter_t;
+
+/** @brief Contadores */
+typedef struct {
+	uint32_t hits;				// Respuestas servidas desde la caché
+	uint32_t misses;			// Consultas a la caché sin respuesta vigente
+	uint32_t joined;			// Requests que se sumaron a uno en vuelo
+	uint32_t stored;			// Respuestas guardadas
+} vamp_coalesce_stats_t;
+
+/** @brief Empezar una clave vacía */
+void vamp_coalesce_key_init(vamp_coalesce_key_t * key);
+
+/** @brief Agregar un campo a la clave, incluido el terminador para separar campos */
+void vamp_coalesce_key_add(vamp_coalesce_key_t * key, const char * text);
+
+/** @brief Verificar que el texto de la clave cupo entero (si no, no se puede usar) */
+bool vamp_coalesce_key_valid(const vamp_coalesce_key_t * key);
+
+/** @brief Respuesta guardada y vigente de la clave
+ *  @param now Tiempo actual (ms)
+ *  @return Largo copiado en data (terminado en '\0'), o -1 si no hay
+ */
+int16_t vamp_coalesce_lookup(const vamp_coalesce_key_t * key, char * data, size_t data_size, uint32_t now);
+
+/** @brief Guardar la respuesta de la clave durante ttl ms (0 = no guardar) */
+void vamp_coalesce_store(const vamp_coalesce_key_t * key, const char * data, size_t len, uint32_t ttl, uint32_t now);
+
+/** @brief Sumarse al request en vuelo con la clave, o registrarlo como nuevo.
+ *  Nunca hay dos en vuelo con el mismo hash: si el hash coincide y el texto no,
+ *  el llamador hace su request sin agruparlo (FULL)
+ *  @return VAMP_COALESCE_LEADER / JOINED / FULL
+ *  @note Después de LEADER el llamador debe terminar con vamp_coalesce_finish()
+ *  usando key->hash
+ */
+uint8_t vamp_coalesce_join(const vamp_coalesce_key_t * key, uint8_t wsn_id, uint16_t ticket);
+
+/** @brief Verificar si hay un request en vuelo (o encolado) con la clave */
+bool vamp_coalesce_pending(const vamp_coalesce_key_t * key);
+
+/** @brief Guardar la respuesta del request en vuelo con el hash bajo su clave,
+ *  como vamp_coalesce_store(). Para el que solo conservó el hash */
+void vamp_coalesce_store_flight(uint32_t hash, const char * data, size_t len, uint32_t ttl, uint32_t now);
+
+/** @brief Terminar el request en vuelo con el hash y entregar sus esperas
+ *  @param waiters Donde se copian los nodos que esperaban (puede ser NULL si falló)
+ *  @param max Lugar en waiters
+ *  @return Cantidad de nodos copiados
+ */
+uint8_t vamp_coalesce_finish(uint32_t hash, vamp_coalesce_waiter_t * waiters, uint8_t max);
+
+/** @brief Copia de los contadores */
+void vamp_coalesce_get_stats(vamp_coalesce_stats_t * stats);
+
+#endif /* _VAMP_COALESCE_H_ */
@@ -0,0 +1,220 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_coap.h"
+
+#include <string.h>
+
+#define VAMP_COAP_VERSION		1
+#define VAMP_COAP_PAYLOAD_MARK	0xFF
+
+void vamp_coap_begin(vamp_coap_writer_t * writer, uint8_t * buf, size_t size,
+		uint8_t type, uint8_t code, uint16_t msg_id, const uint8_t * token, uint8_t token_len) {
+
+	writer->buf = buf;
+	writer->size = size;
+	writer->len = 0;
+	writer->last_option = 0;
+	writer->error = (!buf || token_len > 8 || size < (size_t)(4 + token_len));
+	if (writer->error) {
+		return;
+	}
+
+	buf[0] = (uint8_t)((VAMP_COAP_VERSION << 6) | ((type & 0x03) << 4) | token_len);
+	buf[1] = code;
+	buf[2] = (uint8_t)(msg_id >> 8);
+	buf[3] = (uint8_t)(msg_id & 0xFF);
+	if (token_len) {
+		memcpy(buf + 4, token, token_len);
+	}
+	writer->len = 4 + token_len;
+}
+
+/* Nibble de delta/largo: <13 directo, 13 = +1 byte, 14 = +2 bytes */
+static uint8_t vamp_coap_nibble(uint32_t value) {
+	return value < 13 ? (uint8_t)value : value < 269 ? 13 : 14;
+}
+
+static size_t vamp_coap_put_ext(uint8_t * buf, uint32_t value) {
+	if (value < 13) {
+		return 0;
+	}
+	if (value < 269) {
+		buf[0] = (uint8_t)(value - 13);
+		return 1;
+	}
+	value -= 269;
+	buf[0] = (uint8_t)(value >> 8);
+	buf[1] = (uint8_t)(value & 0xFF);
+	return 2;
+}
+
+void vamp_coap_add_option(vamp_coap_writer_t * writer, uint16_t number, const uint8_t * value, size_t len) {
+
+	if (writer->error) {
+		return;
+	}
+	if (number < writer->last_option || len > 0xFFFF) {
+		writer->error = true;
+		return;
+	}
+
+	uint32_t delta = number - writer->last_option;
+	size_t need = 1 + (delta < 13 ? 0 : delta < 269 ? 1 : 2) + (len < 13 ? 0 : len < 269 ? 1 : 2) + len;
+	if (writer->len + need > writer->size) {
+		writer->error = true;
+		return;
+	}
+
+	uint8_t * p = writer->buf + writer->len;
+	size_t n = 1;
+	p[0] = (uint8_t)((vamp_coap_nibble(delta) << 4) | vamp_coap_nibble((uint32_t)len));
+	n += vamp_coap_put_ext(p + n, delta);
+	n += vamp_coap_put_ext(p + n, (uint32_t)len);
+	if (len) {
+		memcpy(p + n, value, len);
+		n += len;
+	}
+
+	writer->len += n;
+	writer->last_option = number;
+}
+
+void vamp_coap_add_uint_option(vamp_coap_writer_t * writer, uint16_t number, uint32_t value) {
+	uint8_t bytes[4];
+	size_t len = 0;
+	/* Big endian sin ceros a la izquierda, el 0 va sin bytes */
+	for (int8_t shift = 24; shift >= 0; shift -= 8) {
+		uint8_t byte = (uint8_t)(value >> shift);
+		if (len || byte) {
+			bytes[len++] = byte;
+		}
+	}
+	vamp_coap_add_option(writer, number, bytes, len);
+}
+
+void vamp_coap_add_split_option(vamp_coap_writer_t * writer, uint16_t number, const char * str, char sep, char stop) {
+
+	if (!str) {
+		return;
+	}
+
+	while (*str && *str != stop) {
+		if (*str == sep) {
+			str++;
+			continue;
+		}
+		size_t len = 0;
+		while (str[len] && str[len] != sep && str[len] != stop) {
+			len++;
+		}
+		vamp_coap_add_option(writer, number, (const uint8_t *)str, len);
+		str += len;
+	}
+}
+
+size_t vamp_coap_finish(vamp_coap_writer_t * writer, const uint8_t * payload, size_t len) {
+
+	if (writer->error) {
+		return 0;
+	}
+
+	if (payload && len) {
+		if (writer->len + 1 + len > writer->size) {
+			writer->error = true;
+			return 0;
+		}
+		writer->buf[writer->len++] = VAMP_COAP_PAYLOAD_MARK;
+		memcpy(writer->buf + writer->len, payload, len);
+		writer->len += len;
+	}
+
+	return writer->len;
+}
+
+/* Leer el delta o largo extendido de una opción */
+static bool vamp_coap_get_ext(uint8_t nibble, const uint8_t ** p, const uint8_t * end, uint32_t * value) {
+	if (nibble < 13) {
+		*value = nibble;
+		return true;
+	}
+	if (nibble == 13) {
+		if (*p + 1 > end) {
+			return false;
+		}
+		*value = 13 + (*p)[0];
+		*p += 1;
+		return true;
+	}
+	if (nibble == 14) {
+		if (*p + 2 > end) {
+			return false;
+		}
+		*value = 269 + (((uint32_t)(*p)[0] << 8) | (*p)[1]);
+		*p += 2;
+		return true;
+	}
+	return false;
+}
+
+bool vamp_coap_parse(const uint8_t * buf, size_t len, vamp_coap_msg_t * msg) {
+
+	if (!buf || !msg || len < 4 || (buf[0] >> 6) != VAMP_COAP_VERSION) {
+		return false;
+	}
+
+	memset(msg, 0, sizeof(vamp_coap_msg_t));
+	msg->type = (buf[0] >> 4) & 0x03;
+	msg->token_len = buf[0] & 0x0F;
+	msg->code = buf[1];
+	msg->msg_id = (uint16_t)((buf[2] << 8) | buf[3]);
+
+	if (msg->token_len > 8 || len < (size_t)(4 + msg->token_len)) {
+		return false;
+	}
+	memcpy(msg->token, buf + 4, msg->token_len);
+
+	const uint8_t * p = buf + 4 + msg->token_len;
+	const uint8_t * end = buf + len;
+	uint32_t number = 0;
+
+	while (p < end) {
+		if (*p == VAMP_COAP_PAYLOAD_MARK) {
+			p++;
+			if (p == end) {
+				return false;	// Marca sin payload no es válido
+			}
+			msg->payload = p;
+			msg->payload_len = (size_t)(end - p);
+			return true;
+		}
+
+		uint8_t header = *p++;
+		uint32_t delta, opt_len;
+		if (!vamp_coap_get_ext(header >> 4, &p, end, &delta) ||
+				!vamp_coap_get_ext(header & 0x0F, &p, end, &opt_len) ||
+				p + opt_len > end) {
+			return false;
+		}
+		number += delta;
+
+		if (number == VAMP_COAP_OPT_BLOCK1 || number == VAMP_COAP_OPT_BLOCK2) {
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < opt_len && i < 3; i++) {
+				value = (value << 8) | p[i];
+			}
+			if (number == VAMP_COAP_OPT_BLOCK1) {
+				msg->has_block1 = true;
+				msg->block1 = value;
+			} else {
+				msg->has_block2 = true;
+				msg->block2 = value;
+			}
+		}
+		p += opt_len;
+	}
+
+	return true;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file vamp_coap.h
+ * @brief Codificación de mensajes CoAP (RFC 7252) y transferencia por bloques (RFC 7959)
+ *
+ * Armado de requests con sus opciones en orden creciente (Uri-Path, Content-Format,
+ * Uri-Query, Block2, Block1) y lectura de las respuestas. El transporte UDP lo
+ * pone cada arquitectura (arch/iface/vamp_coap.cpp en el ESP8266).
+ *
+ * Prueba en el host, los mensajes contra los bytes de RFC 7252:
+ * test/test_coap.cpp. El intercambio con el servidor necesita WiFiUDP y no se
+ * prueba ahí.
+ */
+
+#ifndef _VAMP_COAP_H_
+#define _VAMP_COAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Tipos de mensaje */
+#define VAMP_COAP_CON	0
+#define VAMP_COAP_NON	1
+#define VAMP_COAP_ACK	2
+#define VAMP_COAP_RST	3
+
+/* Códigos, clase en los 3 bits altos: 0.xx request, 2.xx éxito, 4.xx/5.xx error */
+#define VAMP_COAP_EMPTY		0x00
+#define VAMP_COAP_GET		0x01
+#define VAMP_COAP_POST		0x02
+#define VAMP_COAP_PUT		0x03
+#define VAMP_COAP_DELETE	0x04
+#define VAMP_COAP_CONTINUE	0x5F	// 2.31, bloque recibido, enviar el siguiente
+#define VAMP_COAP_CODE_CLASS(code) ((code) >> 5)
+
+/* Opciones usadas */
+#define VAMP_COAP_OPT_URI_PATH			11
+#define VAMP_COAP_OPT_CONTENT_FORMAT	12
+#define VAMP_COAP_OPT_URI_QUERY			15
+#define VAMP_COAP_OPT_BLOCK2			23
+#define VAMP_COAP_OPT_BLOCK1			27
+
+#define VAMP_COAP_FORMAT_JSON			50
+
+#define VAMP_COAP_TOKEN_LEN				2
+
+/** @brief Valor de una opción Block: [NUM][M][SZX], tamaño = 2^(SZX + 4) */
+#define VAMP_COAP_BLOCK(num, more, szx)	(((uint32_t)(num) << 4) | ((more) ? 0x08 : 0) | ((szx) & 0x07))
+#define VAMP_COAP_BLOCK_NUM(value)		((value) >> 4)
+#define VAMP_COAP_BLOCK_MORE(value)		(((value) & 0x08) != 0)
+#define VAMP_COAP_BLOCK_SIZE(value)		(16U << ((value) & 0x07))
+
+/** @brief Armado de un mensaje, las opciones deben agregarse en orden creciente */
+typedef struct {
+	uint8_t * buf;
+	size_t size;
+	size_t len;
+	uint16_t last_option;
+	bool error;			// No cupo o se rompió el orden de opciones
+} vamp_coap_writer_t;
+
+/** @brief Mensaje recibido, payload apunta dentro del datagrama */
+typedef struct {
+	uint8_t type;
+	uint8_t code;
+	uint16_t msg_id;
+	uint8_t token_len;
+	uint8_t token[8];
+	bool has_block1;
+	bool has_block2;
+	uint32_t block1;
+	uint32_t block2;
+	const uint8_t * payload;
+	size_t payload_len;
+} vamp_coap_msg_t;
+
+/** @brief Empezar un mensaje: cabecera fija y token */
+void vamp_coap_begin(vamp_coap_writer_t * writer, uint8_t * buf, size_t size,
+		uint8_t type, uint8_t code, uint16_t msg_id, const uint8_t * token, uint8_t token_len);
+
+/** @brief Agregar una opción con valor opaco/texto */
+void vamp_coap_add_option(vamp_coap_writer_t * writer, uint16_t number, const uint8_t * value, size_t len);
+
+/** @brief Agregar una opción entera (se codifica con los bytes mínimos) */
+void vamp_coap_add_uint_option(vamp_coap_writer_t * writer, uint16_t number, uint32_t value);
+
+/** @brief Agregar una opción por cada segmento de str separado por sep
+ *  (Uri-Path con '/', Uri-Query con '&'), termina en '\0' o en stop */
+void vamp_coap_add_split_option(vamp_coap_writer_t * writer, uint16_t number, const char * str, char sep, char stop);
+
+/** @brief Cerrar el mensaje con el payload (puede ser NULL)
+ *  @return Largo del datagrama, 0 si hubo error
+ */
+size_t vamp_coap_finish(vamp_coap_writer_t * writer, const uint8_t * payload, size_t len);
+
+/** @brief Leer un datagrama
+ *  @return false si no es un mensaje CoAP válido
+ */
+bool vamp_coap_parse(const uint8_t * buf, size_t len, vamp_coap_msg_t * msg);
+
+#endif /* _VAMP_COAP_H_ */
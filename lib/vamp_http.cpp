@@ -0,0 +1,304 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_http.h"
+
+#include <string.h>
+
+/* Estados del lector */
+#define VAMP_HTTP_ST_STATUS		0
+#define VAMP_HTTP_ST_HEADER		1
+#define VAMP_HTTP_ST_BODY		2	// Content-Length
+#define VAMP_HTTP_ST_BODY_CLOSE	3	// Hasta que el servidor cierre
+#define VAMP_HTTP_ST_CHUNK_SIZE	4
+#define VAMP_HTTP_ST_CHUNK_DATA	5
+#define VAMP_HTTP_ST_CHUNK_END	6	// CRLF tras los datos del chunk
+#define VAMP_HTTP_ST_TRAILER	7
+#define VAMP_HTTP_ST_DONE		8
+
+void vamp_http_reader_reset(vamp_http_reader_t * reader, char * body, size_t body_size) {
+	if (!reader) {
+		return;
+	}
+	memset(reader, 0, sizeof(vamp_http_reader_t));
+	reader->content_len = -1;
+	reader->body = body;
+	reader->body_size = body_size;
+	if (body && body_size) {
+		body[0] = '\0';
+	}
+}
+
+void vamp_http_reader_sink(vamp_http_reader_t * reader, void (*sink)(void * ctx, uint8_t byte), void * ctx) {
+	if (!reader) {
+		return;
+	}
+	reader->sink = sink;
+	reader->sink_ctx = ctx;
+}
+
+static char vamp_http_lower(char c) {
+	return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+/* Valor del header si la línea es "name: valor" (name en minúsculas), si no NULL */
+static const char * vamp_http_header(const char * line, const char * name) {
+	while (*name) {
+		if (vamp_http_lower(*line) != *name) {
+			return NULL;
+		}
+		line++;
+		name++;
+	}
+	if (*line != ':') {
+		return NULL;
+	}
+	line++;
+	while (*line == ' ' || *line == '\t') {
+		line++;
+	}
+	return line;
+}
+
+static void vamp_http_body_put(vamp_http_reader_t * reader, uint8_t byte) {
+	if (reader->sink) {
+		reader->sink(reader->sink_ctx, byte);
+	} else if (reader->body && reader->body_len + 1 < reader->body_size) {
+		reader->body[reader->body_len++] = (char)byte;
+	} else {
+		reader->truncated = true;
+	}
+}
+
+static int8_t vamp_http_done(vamp_http_reader_t * reader) {
+	reader->state = VAMP_HTTP_ST_DONE;
+	if (reader->body && reader->body_size) {
+		reader->body[reader->body_len] = '\0';
+	}
+	return 1;
+}
+
+/* Línea de estado: "HTTP/1.x NNN texto" */
+static int8_t vamp_http_status_line(vamp_http_reader_t * reader) {
+
+	if (strncmp(reader->line, "HTTP/", 5) != 0) {
+		return -1;
+	}
+	const char * code = strchr(reader->line, ' ');
+	if (!code) {
+		return -1;
+	}
+	code++;
+
+	int16_t status = 0;
+	for (uint8_t i = 0; i < 3; i++) {
+		if (code[i] < '0' || code[i] > '9') {
+			return -1;
+		}
+		status = (int16_t)(status * 10 + (code[i] - '0'));
+	}
+
+	reader->status = status;
+	reader->state = VAMP_HTTP_ST_HEADER;
+	return 0;
+}
+
+/* Fin de los headers: decidir cómo viene el cuerpo */
+static int8_t vamp_http_headers_end(vamp_http_reader_t * reader) {
+
+	/* 100 Continue y demás respuestas provisionales: viene otra detrás */
+	if (reader->status < 200) {
+		reader->status = 0;
+		reader->chunked = false;
+		reader->content_len = -1;
+		reader->state = VAMP_HTTP_ST_STATUS;
+		return 0;
+	}
+
+	if (reader->status == 204 || reader->status == 304) {
+		return vamp_http_done(reader);
+	}
+
+	if (reader->chunked) {
+		reader->state = VAMP_HTTP_ST_CHUNK_SIZE;
+		return 0;
+	}
+
+	if (reader->content_len >= 0) {
+		if (reader->content_len == 0) {
+			return vamp_http_done(reader);
+		}
+		reader->remaining = (uint32_t)reader->content_len;
+		reader->state = VAMP_HTTP_ST_BODY;
+		return 0;
+	}
+
+	reader->state = VAMP_HTTP_ST_BODY_CLOSE;
+	return 0;
+}
+
+static int8_t vamp_http_header_line(vamp_http_reader_t * reader) {
+
+	if (reader->line_len == 0) {
+		return vamp_http_headers_end(reader);
+	}
+
+	const char * value = vamp_http_header(reader->line, "content-length");
+	if (value) {
+		int32_t len = 0;
+		while (*value >= '0' && *value <= '9') {
+			len = len * 10 + (*value - '0');
+			if (len < 0) {
+				return -1;
+			}
+			value++;
+		}
+		reader->content_len = len;
+		return 0;
+	}
+
+	value = vamp_http_header(reader->line, "transfer-encoding");
+	if (value) {
+		/* El último coding es el que importa, basta con encontrar "chunked" */
+		for (const char * p = value; *p; p++) {
+			if (vamp_http_lower(*p) == 'c' && strlen(p) >= 7) {
+				const char * chunked = "chunked";
+				uint8_t i = 0;
+				while (i < 7 && vamp_http_lower(p[i]) == chunked[i]) {
+					i++;
+				}
+				if (i == 7) {
+					reader->chunked = true;
+					break;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Tamaño del chunk en hex, las extensiones tras ';' se ignoran */
+static int8_t vamp_http_chunk_size_line(vamp_http_reader_t * reader) {
+
+	uint32_t size = 0;
+	uint8_t digits = 0;
+
+	for (uint8_t i = 0; i < reader->line_len; i++) {
+		char c = vamp_http_lower(reader->line[i]);
+		uint8_t nibble;
+		if (c >= '0' && c <= '9') {
+			nibble = (uint8_t)(c - '0');
+		} else if (c >= 'a' && c <= 'f') {
+			nibble = (uint8_t)(c - 'a' + 10);
+		} else {
+			break;
+		}
+		if (++digits > 7) {
+			return -1;
+		}
+		size = (size << 4) | nibble;
+	}
+
+	if (!digits) {
+		return -1;
+	}
+
+	if (size == 0) {
+		reader->state = VAMP_HTTP_ST_TRAILER;
+		return 0;
+	}
+
+	reader->remaining = size;
+	reader->state = VAMP_HTTP_ST_CHUNK_DATA;
+	return 0;
+}
+
+/* Línea completa según el estado */
+static int8_t vamp_http_line(vamp_http_reader_t * reader) {
+
+	reader->line[reader->line_len] = '\0';
+	int8_t result = 0;
+
+	switch (reader->state) {
+		case VAMP_HTTP_ST_STATUS:
+			result = vamp_http_status_line(reader);
+			break;
+		case VAMP_HTTP_ST_HEADER:
+			result = vamp_http_header_line(reader);
+			break;
+		case VAMP_HTTP_ST_CHUNK_SIZE:
+			result = vamp_http_chunk_size_line(reader);
+			break;
+		case VAMP_HTTP_ST_CHUNK_END:
+			result = reader->line_len ? -1 : 0;
+			reader->state = VAMP_HTTP_ST_CHUNK_SIZE;
+			break;
+		case VAMP_HTTP_ST_TRAILER:
+			if (reader->line_len == 0) {
+				result = vamp_http_done(reader);
+			}
+			break;
+		default:
+			break;
+	}
+
+	reader->line_len = 0;
+	return result;
+}
+
+int8_t vamp_http_reader_feed(vamp_http_reader_t * reader, uint8_t byte) {
+
+	switch (reader->state) {
+
+		case VAMP_HTTP_ST_BODY:
+			vamp_http_body_put(reader, byte);
+			if (--reader->remaining == 0) {
+				return vamp_http_done(reader);
+			}
+			return 0;
+
+		case VAMP_HTTP_ST_BODY_CLOSE:
+			vamp_http_body_put(reader, byte);
+			return 0;
+
+		case VAMP_HTTP_ST_CHUNK_DATA:
+			vamp_http_body_put(reader, byte);
+			if (--reader->remaining == 0) {
+				reader->state = VAMP_HTTP_ST_CHUNK_END;
+			}
+			return 0;
+
+		case VAMP_HTTP_ST_DONE:
+			/* Lo que llegue después de la respuesta se ignora */
+			return 1;
+
+		default:
+			break;
+	}
+
+	/* Estados por líneas */
+	if (byte == '\r') {
+		return 0;
+	}
+	if (byte == '\n') {
+		return vamp_http_line(reader);
+	}
+	if (reader->line_len < VAMP_HTTP_LINE_MAX - 1) {
+		reader->line[reader->line_len++] = (char)byte;
+	}
+	return 0;
+}
+
+int8_t vamp_http_reader_close(vamp_http_reader_t * reader) {
+
+	if (reader->state == VAMP_HTTP_ST_DONE) {
+		return 1;
+	}
+	if (reader->state == VAMP_HTTP_ST_BODY_CLOSE) {
+		return vamp_http_done(reader);
+	}
+	return -1;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file vamp_http.h
+ * @brief Lector incremental de respuestas HTTP/1.x para el cliente no bloqueante
+ *
+ * Recibe la respuesta byte a byte tal como llega del socket: línea de estado,
+ * headers y cuerpo por Content-Length, chunked o hasta que el servidor cierra.
+ * El cuerpo se copia al buffer del llamador, lo que no cabe se descarta, o se
+ * pasa a una función del llamador que lo procesa a medida que llega.
+ *
+ * Prueba en el host: test/test_http.cpp
+ */
+
+#ifndef _VAMP_HTTP_H_
+#define _VAMP_HTTP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Largo máximo de una línea de header que se interpreta, el resto se ignora */
+#define VAMP_HTTP_LINE_MAX 64
+
+/** @brief Lector de una respuesta */
+typedef struct {
+	uint8_t state;						// Parte de la respuesta que se está leyendo
+	int16_t status;						// Código de estado, 0 hasta leer la línea
+	bool chunked;						// Transfer-Encoding: chunked
+	int32_t content_len;				// Content-Length, -1 si no vino
+	uint32_t remaining;					// Bytes por leer del cuerpo o del chunk actual
+	char line[VAMP_HTTP_LINE_MAX];		// Línea en curso (estado, header o tamaño de chunk)
+	uint8_t line_len;
+	char * body;						// Buffer del cuerpo (del llamador)
+	size_t body_size;
+	size_t body_len;					// Bytes del cuerpo en body
+	bool truncated;						// El cuerpo no cabía en body
+	void (*sink)(void * ctx, uint8_t byte);	// Recibe el cuerpo en lugar de body
+	void * sink_ctx;
+} vamp_http_reader_t;
+
+/** @brief Reiniciar el lector para una respuesta nueva
+ *  @param body Buffer para el cuerpo, queda terminado en '\0'
+ *  @param body_size Tamaño de body (incluye el '\0')
+ */
+void vamp_http_reader_reset(vamp_http_reader_t * reader, char * body, size_t body_size);
+
+/** @brief Pasar el cuerpo byte a byte a sink en lugar de copiarlo en body
+ *  (que queda vacío). Se llama después de vamp_http_reader_reset()
+ */
+void vamp_http_reader_sink(vamp_http_reader_t * reader, void (*sink)(void * ctx, uint8_t byte), void * ctx);
+
+/** @brief Pasar un byte recibido al lector
+ *  @return 1 si la respuesta está completa, 0 si falta, -1 si es inválida
+ */
+int8_t vamp_http_reader_feed(vamp_http_reader_t * reader, uint8_t byte);
+
+/** @brief El servidor cerró la conexión
+ *  @return 1 si la respuesta quedó completa (cuerpo hasta el cierre), -1 si se cortó
+ */
+int8_t vamp_http_reader_close(vamp_http_reader_t * reader);
+
+#endif /* _VAMP_HTTP_H_ */
@@ -0,0 +1,444 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_jsel.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/* Estados del lector */
+#define JSEL_VALUE		0	// Se espera un valor
+#define JSEL_KEY		1	// Se espera una clave o el cierre del objeto
+#define JSEL_COLON		2	// Se espera ':'
+#define JSEL_AFTER		3	// Se espera ',' o el cierre
+#define JSEL_STRING		4	// Dentro de un string
+#define JSEL_LITERAL	5	// Dentro de un número, true, false o null
+#define JSEL_END		6	// Terminó el documento
+
+#define JSEL_OBJECT		0
+#define JSEL_ARRAY		1
+
+/* Tipos de empaquetado */
+#define JSEL_TEXT		0
+#define JSEL_U8			1
+#define JSEL_I8			2
+#define JSEL_U16		3
+#define JSEL_I16		4
+#define JSEL_U32		5
+#define JSEL_I32		6
+#define JSEL_F32		7
+#define JSEL_STR		8
+
+#define JSEL_PATH_LOST	(VAMP_JSEL_PATH_MAX + 1)
+
+static uint8_t vamp_jsel_type(const char * name, size_t len) {
+	static const char * const names[] = { "u8", "i8", "u16", "i16", "u32", "i32", "f32", "s" };
+	for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strlen(names[i]) == len && strncmp(names[i], name, len) == 0) {
+			return i + 1;
+		}
+	}
+	return JSEL_TEXT;
+}
+
+bool vamp_jsel_init(vamp_jsel_t * sel, const char * select, const char * pack) {
+
+	if (!sel || !select || !select[0] || strlen(select) >= sizeof(sel->spec)) {
+		return false;
+	}
+
+	memset(sel, 0, sizeof(vamp_jsel_t));
+	sel->capture = -1;
+	strcpy(sel->spec, select);
+
+	/* Rutas: las comas pasan a ser terminadores */
+	for (uint8_t i = 0; ; i++) {
+		if (i == 0 || sel->spec[i - 1] == '\0') {
+			if (sel->fields >= VAMP_JSEL_FIELDS || sel->spec[i] == '\0' || sel->spec[i] == ',') {
+				return false;
+			}
+			sel->field_at[sel->fields++] = i;
+		}
+		if (sel->spec[i] == ',') {
+			sel->spec[i] = '\0';
+		} else if (sel->spec[i] == '\0') {
+			break;
+		}
+	}
+
+	if (!pack || !pack[0]) {
+		return true;
+	}
+
+	/* Un tipo por ruta */
+	uint8_t count = 0;
+	const char * p = pack;
+	while (true) {
+		const char * end = strchr(p, ',');
+		size_t len = end ? (size_t)(end - p) : strlen(p);
+		if (count >= sel->fields) {
+			return false;
+		}
+		uint8_t type = vamp_jsel_type(p, len);
+		if (type == JSEL_TEXT) {
+			return false;
+		}
+		sel->pack[count++] = type;
+		if (!end) {
+			break;
+		}
+		p = end + 1;
+	}
+	return count == sel->fields;
+}
+
+/* ------------------------------ Ruta actual ------------------------------ */
+
+static void vamp_jsel_path_cut(vamp_jsel_t * sel, uint8_t len) {
+	sel->path_len = len;
+	if (len <= VAMP_JSEL_PATH_MAX) {
+		sel->path[len] = '\0';
+	}
+}
+
+static void vamp_jsel_path_add(vamp_jsel_t * sel, char c) {
+	if (sel->path_len >= VAMP_JSEL_PATH_MAX) {
+		sel->path_len = JSEL_PATH_LOST;
+		return;
+	}
+	sel->path[sel->path_len++] = c;
+	sel->path[sel->path_len] = '\0';
+}
+
+/* Ruta del elemento actual del array del tope */
+static void vamp_jsel_path_index(vamp_jsel_t * sel) {
+	uint8_t top = sel->depth - 1;
+	vamp_jsel_path_cut(sel, sel->mark[top]);
+	if (sel->path_len == JSEL_PATH_LOST) {
+		return;
+	}
+	char num[8];
+	uint8_t n = 0;
+	uint16_t index = sel->index[top];
+	do {
+		num[n++] = '0' + index % 10;
+		index /= 10;
+	} while (index && n < sizeof(num));
+	vamp_jsel_path_add(sel, '[');
+	while (n) {
+		vamp_jsel_path_add(sel, num[--n]);
+	}
+	vamp_jsel_path_add(sel, ']');
+}
+
+/* ------------------------------ Valores ------------------------------ */
+
+static void vamp_jsel_keep(vamp_jsel_t * sel, char c) {
+	uint8_t f = (uint8_t)sel->capture;
+	if (sel->value_len[f] < VAMP_JSEL_VALUE_MAX) {
+		sel->value[f][sel->value_len[f]++] = c;
+		sel->value[f][sel->value_len[f]] = '\0';
+	}
+}
+
+/* Empieza un valor: si la ruta es la de un campo pendiente se copia */
+static void vamp_jsel_value_start(vamp_jsel_t * sel) {
+
+	sel->capture = -1;
+	if (sel->path_len == JSEL_PATH_LOST) {
+		return;
+	}
+	for (uint8_t f = 0; f < sel->fields; f++) {
+		if (!(sel->found & (1 << f)) && strcmp(sel->path, &sel->spec[sel->field_at[f]]) == 0) {
+			sel->capture = (int8_t)f;
+			sel->capture_depth = sel->depth;
+			sel->value_len[f] = 0;
+			sel->value[f][0] = '\0';
+			return;
+		}
+	}
+}
+
+static bool vamp_jsel_all(const vamp_jsel_t * sel) {
+	return sel->found == (uint8_t)((1 << sel->fields) - 1);
+}
+
+/* Dentro de un objeto/array seleccionado, que se copia crudo */
+static bool vamp_jsel_raw(const vamp_jsel_t * sel) {
+	return sel->capture >= 0 && sel->depth > sel->capture_depth;
+}
+
+static void vamp_jsel_value_end(vamp_jsel_t * sel) {
+	if (sel->capture >= 0 && !vamp_jsel_raw(sel)) {
+		sel->found |= (uint8_t)(1 << sel->capture);
+		sel->capture = -1;
+	}
+	sel->state = sel->depth ? JSEL_AFTER : JSEL_END;
+}
+
+static int8_t vamp_jsel_open(vamp_jsel_t * sel, uint8_t kind) {
+	if (sel->depth >= VAMP_JSEL_DEPTH) {
+		return -1;
+	}
+	sel->kind[sel->depth] = kind;
+	sel->mark[sel->depth] = sel->path_len;
+	sel->index[sel->depth] = 0;
+	sel->depth++;
+	if (kind == JSEL_ARRAY) {
+		vamp_jsel_path_index(sel);
+		sel->state = JSEL_VALUE;
+	} else {
+		sel->state = JSEL_KEY;
+	}
+	return 0;
+}
+
+static int8_t vamp_jsel_close(vamp_jsel_t * sel, uint8_t kind) {
+	if (!sel->depth || sel->kind[sel->depth - 1] != kind) {
+		return -1;
+	}
+	sel->depth--;
+	vamp_jsel_path_cut(sel, sel->mark[sel->depth]);
+	vamp_jsel_value_end(sel);
+	return 0;
+}
+
+static bool vamp_jsel_space(uint8_t c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool vamp_jsel_literal(uint8_t c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+/* Avanzar el lector un byte, sin la copia cruda */
+static int8_t vamp_jsel_step(vamp_jsel_t * sel, uint8_t c) {
+
+	/* Copia de un string o un literal seleccionado */
+	bool keep = sel->capture >= 0 && !vamp_jsel_raw(sel);
+
+	switch (sel->state) {
+
+		case JSEL_STRING:
+			if (sel->escape > 1) {
+				/* Dígitos de \uXXXX */
+				sel->escape = sel->escape < 5 ? sel->escape + 1 : 0;
+				return 0;
+			}
+			if (sel->escape) {
+				sel->escape = c == 'u' ? 2 : 0;
+				if (sel->in_key) {
+					vamp_jsel_path_add(sel, (char)c);
+				} else if (keep) {
+					vamp_jsel_keep(sel, c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c == 'u' ? '?' : (char)c);
+				}
+				return 0;
+			}
+			if (c == '\\') {
+				sel->escape = 1;
+				return 0;
+			}
+			if (c == '"') {
+				if (sel->in_key) {
+					sel->in_key = false;
+					sel->state = JSEL_COLON;
+				} else {
+					vamp_jsel_value_end(sel);
+				}
+				return 0;
+			}
+			if (sel->in_key) {
+				vamp_jsel_path_add(sel, (char)c);
+			} else if (keep) {
+				vamp_jsel_keep(sel, (char)c);
+			}
+			return 0;
+
+		case JSEL_LITERAL:
+			if (vamp_jsel_literal(c)) {
+				if (keep) {
+					vamp_jsel_keep(sel, (char)c);
+				}
+				return 0;
+			}
+			/* El delimitador termina el valor y se procesa después */
+			vamp_jsel_value_end(sel);
+			return vamp_jsel_step(sel, c);
+
+		case JSEL_VALUE:
+			if (vamp_jsel_space(c)) {
+				return 0;
+			}
+			if (c == ']' && sel->depth && sel->kind[sel->depth - 1] == JSEL_ARRAY && sel->index[sel->depth - 1] == 0) {
+				/* Array vacío */
+				return vamp_jsel_close(sel, JSEL_ARRAY);
+			}
+			if (!vamp_jsel_raw(sel)) {
+				vamp_jsel_value_start(sel);
+				keep = sel->capture >= 0;
+			}
+			if (c == '{' || c == '[') {
+				if (keep) {
+					vamp_jsel_keep(sel, (char)c);
+				}
+				return vamp_jsel_open(sel, c == '{' ? JSEL_OBJECT : JSEL_ARRAY);
+			}
+			if (c == '"') {
+				sel->in_key = false;
+				sel->state = JSEL_STRING;
+				return 0;
+			}
+			if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+				if (keep) {
+					vamp_jsel_keep(sel, (char)c);
+				}
+				sel->state = JSEL_LITERAL;
+				return 0;
+			}
+			return -1;
+
+		case JSEL_KEY:
+			if (vamp_jsel_space(c)) {
+				return 0;
+			}
+			if (c == '}') {
+				return vamp_jsel_close(sel, JSEL_OBJECT);
+			}
+			if (c != '"') {
+				return -1;
+			}
+			vamp_jsel_path_cut(sel, sel->mark[sel->depth - 1]);
+			if (sel->path_len && sel->path_len != JSEL_PATH_LOST) {
+				vamp_jsel_path_add(sel, '.');
+			}
+			sel->in_key = true;
+			sel->state = JSEL_STRING;
+			return 0;
+
+		case JSEL_COLON:
+			if (vamp_jsel_space(c)) {
+				return 0;
+			}
+			if (c != ':') {
+				return -1;
+			}
+			sel->state = JSEL_VALUE;
+			return 0;
+
+		case JSEL_AFTER:
+			if (vamp_jsel_space(c)) {
+				return 0;
+			}
+			if (c == ',') {
+				if (sel->kind[sel->depth - 1] == JSEL_ARRAY) {
+					sel->index[sel->depth - 1]++;
+					vamp_jsel_path_index(sel);
+					sel->state = JSEL_VALUE;
+				} else {
+					sel->state = JSEL_KEY;
+				}
+				return 0;
+			}
+			if (c == '}' || c == ']') {
+				return vamp_jsel_close(sel, c == '}' ? JSEL_OBJECT : JSEL_ARRAY);
+			}
+			return -1;
+
+		default:
+			/* Después del documento solo espacios */
+			return vamp_jsel_space(c) ? 0 : -1;
+	}
+}
+
+int8_t vamp_jsel_feed(vamp_jsel_t * sel, uint8_t c) {
+
+	if (vamp_jsel_all(sel)) {
+		return 1;
+	}
+
+	/* Dentro de un objeto/array seleccionado se copia todo menos los espacios
+	fuera de los strings, incluido su cierre */
+	if (vamp_jsel_raw(sel) && (sel->state == JSEL_STRING || !vamp_jsel_space(c))) {
+		vamp_jsel_keep(sel, (char)c);
+	}
+
+	if (vamp_jsel_step(sel, c) < 0) {
+		return -1;
+	}
+	return vamp_jsel_all(sel) ? 1 : 0;
+}
+
+/* ------------------------------ Salida ------------------------------ */
+
+static size_t vamp_jsel_put(uint8_t * out, size_t size, size_t n, uint32_t value, uint8_t bytes) {
+	if (n + bytes > size) {
+		return n;
+	}
+	while (bytes--) {
+		out[n++] = (uint8_t)(value >> (bytes * 8));
+	}
+	return n;
+}
+
+size_t vamp_jsel_output(const vamp_jsel_t * sel, uint8_t * out, size_t out_size) {
+
+	if (!sel || !out || out_size == 0) {
+		return 0;
+	}
+
+	size_t n = 0;
+
+	for (uint8_t f = 0; f < sel->fields; f++) {
+
+		const char * value = (sel->found & (1 << f)) ? sel->value[f] : "";
+		uint8_t len = (sel->found & (1 << f)) ? sel->value_len[f] : 0;
+
+		if (sel->pack[f] == JSEL_TEXT) {
+			if (f > 0 && n < out_size) {
+				out[n++] = ',';
+			}
+			if (n + len > out_size) {
+				len = (uint8_t)(out_size - n);
+			}
+			memcpy(out + n, value, len);
+			n += len;
+			continue;
+		}
+
+		if (sel->pack[f] == JSEL_STR) {
+			if (n + 1 + len > out_size) {
+				break;
+			}
+			out[n++] = len;
+			memcpy(out + n, value, len);
+			n += len;
+			continue;
+		}
+
+		uint32_t number;
+		if (value[0] == 't') {
+			number = 1;
+		} else if (sel->pack[f] == JSEL_F32) {
+			float real = (float)strtod(value, NULL);
+			memcpy(&number, &real, sizeof(number));
+		} else {
+			number = (uint32_t)strtol(value, NULL, 10);
+		}
+
+		switch (sel->pack[f]) {
+			case JSEL_U8:
+			case JSEL_I8:	n = vamp_jsel_put(out, out_size, n, number, 1); break;
+			case JSEL_U16:
+			case JSEL_I16:	n = vamp_jsel_put(out, out_size, n, number, 2); break;
+			default:		n = vamp_jsel_put(out, out_size, n, number, 4); break;
+		}
+	}
+
+	/* El texto queda terminado si entra */
+	if (n < out_size) {
+		out[n] = '\0';
+	}
+	return n;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file vamp_jsel.h
+ * @brief Proyección de campos de una respuesta JSON, leída a medida que llega
+ *
+ * El nodo solo recibe VAMP_MAX_PAYLOAD_SIZE bytes y el endpoint suele responder
+ * un documento mucho más grande. El selector recibe el cuerpo byte a byte, sin
+ * guardarlo, y se queda con los valores de los campos pedidos. Cuando los tiene
+ * todos avisa para cortar la lectura.
+ *
+ * Los campos son rutas separadas por coma, con punto entre claves e índices
+ * entre corchetes:
+ *
+ *     "riego.inicio,riego.min,zonas[2]"
+ *
+ * La salida es el texto de los valores separados por coma (los strings sin
+ * comillas, objetos y arrays tal como llegan). Con un empaquetado, un tipo por
+ * campo, la salida es binaria big-endian:
+ *
+ *     "u32,u16,u8"    u8 i8 u16 i16 u32 i32 f32, s = largo (1 byte) + texto
+ *
+ * true/false/null se empaquetan como 1/0/0 y un campo que no llegó como 0.
+ *
+ * Prueba en el host: test/test_jsel.cpp
+ */
+
+#ifndef _VAMP_JSEL_H_
+#define _VAMP_JSEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Campos por selector */
+#ifndef VAMP_JSEL_FIELDS
+#define VAMP_JSEL_FIELDS 4
+#endif // VAMP_JSEL_FIELDS
+
+/** @brief Largo máximo del selector completo */
+#ifndef VAMP_JSEL_SPEC_MAX
+#define VAMP_JSEL_SPEC_MAX 48
+#endif // VAMP_JSEL_SPEC_MAX
+
+/** @brief Largo máximo de la ruta actual, lo que está más abajo no se puede seleccionar */
+#ifndef VAMP_JSEL_PATH_MAX
+#define VAMP_JSEL_PATH_MAX 48
+#endif // VAMP_JSEL_PATH_MAX
+
+/** @brief Anidamiento máximo del documento */
+#ifndef VAMP_JSEL_DEPTH
+#define VAMP_JSEL_DEPTH 8
+#endif // VAMP_JSEL_DEPTH
+
+/** @brief Largo máximo del valor de un campo, el resto se descarta */
+#ifndef VAMP_JSEL_VALUE_MAX
+#define VAMP_JSEL_VALUE_MAX 24
+#endif // VAMP_JSEL_VALUE_MAX
+
+/** @brief Selector en curso */
+typedef struct {
+	/* Campos */
+	char spec[VAMP_JSEL_SPEC_MAX];				// Rutas separadas por '\0'
+	uint8_t field_at[VAMP_JSEL_FIELDS];			// Inicio de cada ruta en spec
+	uint8_t pack[VAMP_JSEL_FIELDS];				// Tipo de cada campo, 0 = texto
+	uint8_t fields;
+	uint8_t found;								// Bits de los campos encontrados
+	char value[VAMP_JSEL_FIELDS][VAMP_JSEL_VALUE_MAX + 1];
+	uint8_t value_len[VAMP_JSEL_FIELDS];
+
+	/* Documento */
+	uint8_t state;
+	uint8_t depth;
+	uint8_t kind[VAMP_JSEL_DEPTH];				// Objeto o array
+	uint8_t mark[VAMP_JSEL_DEPTH];				// Largo de la ruta al abrir
+	uint16_t index[VAMP_JSEL_DEPTH];			// Elemento actual de los arrays
+	char path[VAMP_JSEL_PATH_MAX + 1];
+	uint8_t path_len;							// VAMP_JSEL_PATH_MAX+1 = ruta demasiado larga
+	bool in_key;								// El string es una clave
+	uint8_t escape;								// Escape en curso en el string
+	int8_t capture;								// Campo que se está copiando, -1 ninguno
+	uint8_t capture_depth;						// Profundidad del objeto/array copiado
+} vamp_jsel_t;
+
+/** @brief Preparar el selector
+ *  @param select Rutas separadas por coma
+ *  @param pack Tipos separados por coma, uno por ruta, o NULL para salida de texto
+ *  @return false si el selector o el empaquetado no son válidos
+ */
+bool vamp_jsel_init(vamp_jsel_t * sel, const char * select, const char * pack);
+
+/** @brief Pasar un byte del documento
+ *  @return 1 si ya están todos los campos (se puede dejar de leer), 0 si faltan,
+ *  -1 si el documento no es JSON válido
+ */
+int8_t vamp_jsel_feed(vamp_jsel_t * sel, uint8_t byte);
+
+/** @brief Salida con los valores encontrados, texto terminado en '\0' si entra
+ *  @return Bytes escritos en out
+ */
+size_t vamp_jsel_output(const vamp_jsel_t * sel, uint8_t * out, size_t out_size);
+
+#endif /* _VAMP_JSEL_H_ */
@@ -42,8 +42,171 @@ bool vamp_kv_parse_json(vamp_key_value_store_t* store, JsonObject json_obj) {
     return true;
 }
 
-/* Procesar la respuesta de sincronización de VREG */
-bool vamp_process_sync_json_response(const char* json_data) {
+/** Cambio pendiente de la sincronización, ya validado. Los perfiles no se
+ * guardan aqui: siguen en el documento JSON (el nodo "node" del array "nodes")
+ * y se construyen recién al aplicar el cambio */
+#define VAMP_SYNC_OP_ADD		0x01	// ADD o UPDATE
+#define VAMP_SYNC_OP_REMOVE		0x02
+
+typedef struct {
+	uint8_t action;
+	uint8_t rf_id[VAMP_ADDR_LEN];
+	uint8_t type;
+	uint8_t node;							// Posición en el array "nodes"
+} vamp_sync_op_t;
+
+static vamp_sync_op_t sync_ops[VAMP_SYNC_MAX_OPS];
+
+/* Perfiles del cambio que se está aplicando, pasan a la tabla ya construidos */
+static vamp_profile_t sync_profiles[VAMP_MAX_PROFILES];
+
+/* Resultado de la última respuesta aplicada, para el planificador de sincronización */
+static uint8_t sync_last_changes = 0;
+static uint32_t sync_next_hint = 0;
+
+uint8_t vamp_sync_last_changes(void) {
+	return sync_last_changes;
+}
+
+uint32_t vamp_sync_next_hint(void) {
+	return sync_next_hint;
+}
+
+/* Recorrer los cambios en orden como lo haría la segunda pasada para saber, sin
+tocar la tabla, si vamp_add_device() va a encontrar lugar para cada nodo nuevo.
+Los slots libres e inactivos son los que puede usar, un REMOVE de un nodo que los
+ocupa devuelve uno */
+static bool vamp_sync_ops_fit(uint8_t op_count) {
+
+	uint8_t slots = vamp_get_status_count(VAMP_DEV_STATUS_FREE) +
+		vamp_get_status_count(VAMP_DEV_STATUS_INACTIVE);
+
+	for (uint8_t i = 0; i < op_count; i++) {
+
+		vamp_sync_op_t * op = &sync_ops[i];
+		uint8_t table_index = vamp_find_device(op->rf_id);
+		vamp_entry_t * entry = (table_index < VAMP_MAX_DEVICES) ? vamp_get_table_entry(table_index) : NULL;
+
+		/* Un inactivo ya se contó como slot disponible */
+		bool present = entry != NULL;
+		bool counted = entry && entry->status == VAMP_DEV_STATUS_INACTIVE;
+
+		/* Lo que haya hecho un cambio anterior de la misma respuesta manda */
+		for (uint8_t j = 0; j < i; j++) {
+			if (memcmp(sync_ops[j].rf_id, op->rf_id, VAMP_ADDR_LEN) == 0) {
+				present = (sync_ops[j].action == VAMP_SYNC_OP_ADD);
+				counted = false;
+			}
+		}
+
+		if (op->action == VAMP_SYNC_OP_REMOVE) {
+			if (present && !counted) {
+				slots++;
+			}
+			continue;
+		}
+
+		if (!present) {
+			if (slots == 0) {
+				return false;
+			}
+			slots--;
+		}
+	}
+
+	return true;
+}
+
+/* Liberar lo reservado en los perfiles del cambio en curso */
+static void vamp_sync_profiles_discard(void) {
+	for (uint8_t p = 0; p < VAMP_MAX_PROFILES; p++) {
+		vamp_clear_profile(&sync_profiles[p]);
+	}
+}
+
+/* Construir un perfil a partir de su objeto JSON
+   @return false si faltó memoria */
+static bool vamp_parse_profile(JsonObject profile, vamp_profile_t * out) {
+
+	/* Extraer method */
+	out->method = VAMP_HTTP_METHOD_GET; // Valor por defecto
+	out->protocol = VAMP_PROTOCOL_NONE;
+	if (profile.containsKey("method")) {
+
+		/* Extraer el metodo (GET, POST...) */
+		if (!strcmp(profile["method"], "GET")) {
+			out->method = VAMP_HTTP_METHOD_GET;
+		} else if (!strcmp(profile["method"], "POST")) {
+			out->method = VAMP_HTTP_METHOD_POST;
+		} else if (!strcmp(profile["method"], "PUT")) {
+			out->method = VAMP_HTTP_METHOD_PUT;
+		} else if (!strcmp(profile["method"], "DELETE")) {
+			out->method = VAMP_HTTP_METHOD_DELETE;
+		} else {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Método desconocido: %s\n", profile["method"].as<const char*>());
+			#endif /* VAMP_DEBUG */
+		}
+	}
+
+	/* Extraer endpoint_resource */
+	if (profile.containsKey("endpoint")) {
+		const char * endpoint_str = profile["endpoint"];
+		if (endpoint_str && strlen(endpoint_str) > 0 && strlen(endpoint_str) < VAMP_ENDPOINT_MAX_LEN) {
+			out->endpoint_resource = strdup(endpoint_str);
+			out->protocol = vamp_transport_resolve(endpoint_str);
+			if (!out->endpoint_resource) {
+				#ifdef VAMP_DEBUG
+				printf("[JSON] Error asignando memoria para endpoint_resource\n");
+				#endif /* VAMP_DEBUG */
+				return false;
+			}
+		} else {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Endpoint resource inválido o demasiado largo\n");
+			#endif /* VAMP_DEBUG */
+		}
+	}
+
+	/* Extraer protocol_options */
+	if (profile.containsKey("options") && profile["options"].is<JsonObject>()) {
+		/* Pre-asignar antes de parsear */
+		if (!vamp_kv_preallocate(&out->protocol_options)) {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Error pre-asignando protocol_options\n");
+			#endif
+			return false;
+		}
+		vamp_kv_parse_json(&out->protocol_options, profile["options"]);
+	}
+
+	/* Extraer los protocols query */
+	if (profile.containsKey("params") && profile["params"].is<JsonObject>()) {
+		/* Pre-asignar antes de parsear */
+		if (!vamp_kv_preallocate(&out->query_params)) {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Error pre-asignando query_params\n");
+			#endif
+			return false;
+		}
+		vamp_kv_parse_json(&out->query_params, profile["params"]);
+	}
+
+	return true;
+}
+
+/* Procesar la respuesta de sincronización de VREG. Se hace en dos pasadas:
+primero se valida toda la respuesta sin tocar la tabla, y solo si todo salió bien
+se aplican los cambios. Como la radio solo se atiende desde el lazo principal (la
+interrupción solo encola tramas), ninguna trama ve la tabla a medio aplicar, y
+una respuesta inválida no toca la tabla ni el timestamp.
+La primera pasada guarda de cada cambio lo que necesita para validar (acción,
+RF_ID, tipo) y su posición en "nodes". Los perfiles se construyen en la segunda
+pasada, de a un nodo, desde el mismo documento: si falta memoria ese nodo queda
+como estaba y el timestamp no avanza, asi que la próxima sincronización repite
+el delta. Una consulta puntual ("lookup") aplica los nodos pero no avanza el
+timestamp: el delta de la próxima sincronización sigue desde la última. */
+static bool vamp_process_vreg_json(const char* json_data, bool lookup) {
 
 	if (json_data == NULL) {
 		return false;
@@ -74,262 +237,214 @@ bool vamp_process_sync_json_response(const char* json_data) {
 		return false;
 	}
 
-	/* Extraer el timestamp */
-	const char* timestamp = doc["timestamp"];
-
-	/** @todo !!!!! Aqui hay un problema con el manejo de timestamps y la actualizacion
-	 * exitosa o no, esto no esta bien manejado asi y puede llevar a inconsistencias !!!!!*/
-	if (timestamp) {
-		vamp_set_last_sync_timestamp(timestamp);
+	JsonArray nodes = doc["nodes"];
+	if (nodes.size() > VAMP_SYNC_MAX_OPS) {
+		#ifdef VAMP_DEBUG
+		printf("[JSON] Demasiados nodos en la sincronización: %d\n", (int)nodes.size());
+		#endif /* VAMP_DEBUG */
+		return false;
 	}
 
-	/* Procesar cada entrada en el array de nodos */
-	JsonArray nodes = doc["nodes"];
+	/* ------------------ Primera pasada: validar ------------------ */
+
+	uint8_t op_count = 0;
+	memset(sync_ops, 0, sizeof(sync_ops));
+
 	for (JsonObject node : nodes) {
-		
-		/* Verificar campos obligatorios y que no estén vacíos */
-		if (!node.containsKey("action") || !node["action"] ||
-			!node.containsKey("rf_id") || !node["rf_id"] || 
-			!node.containsKey("type") || !node["type"] ||
-			!node.containsKey("profiles") || !node["profiles"]) {
-			#ifdef VAMP_DEBUG
-			printf("[JSON] Entrada JSON sin mandatory fields o con valores vacíos\n");
-			#endif /* VAMP_DEBUG */
-			continue; // Saltar esta entrada
-		}
 
-		/* Extraer RF_ID */
-		uint8_t rf_id[VAMP_ADDR_LEN];
-		if (!hex_to_rf_id(node["rf_id"], rf_id)) {
+		vamp_sync_op_t * op = &sync_ops[op_count];
+		op->node = op_count;
+
+		if (!node.containsKey("action") || !node["action"] ||
+			!node.containsKey("rf_id") || !node["rf_id"] ||
+			!hex_to_rf_id(node["rf_id"], op->rf_id)) {
 			#ifdef VAMP_DEBUG
-			printf("[JSON] RF_ID inválido en la respuesta VREG\n");
+			printf("[JSON] Entrada sin action o con RF_ID inválido\n");
 			#endif /* VAMP_DEBUG */
-			continue;
+			goto invalid;
 		}
 
 		#ifdef VAMP_DEBUG
 		printf("[JSON] RF_ID recibido: %s\n", node["rf_id"].as<const char*>());
 		#endif /* VAMP_DEBUG */
 
-		/* Buscar si el nodo ya esta en la tabla */
-		uint8_t table_index = vamp_find_device(rf_id);
-		if (table_index < VAMP_MAX_DEVICES) {
-			#ifdef VAMP_DEBUG
-			printf("[JSON] Nodo registrado %s\n", node["rf_id"].as<const char*>());
-			#endif /* VAMP_DEBUG */
+		if (strcmp(node["action"], "REMOVE") == 0) {
+			op->action = VAMP_SYNC_OP_REMOVE;
+			op_count++;
+			continue;
 		}
-		if (table_index > VAMP_MAX_DEVICES) {
+
+		if (strcmp(node["action"], "ADD") != 0 && strcmp(node["action"], "UPDATE") != 0) {
 			#ifdef VAMP_DEBUG
-			printf("[JSON] Error buscando al nodo en la tabla\n");
+			printf("[JSON] Acción desconocida en JSON: %s\n", node["action"].as<const char*>());
 			#endif /* VAMP_DEBUG */
-			continue;
+			goto invalid;
 		}
 
-		/* Procesar según la acción */
-		if (strcmp(node["action"], "ADD") == 0 || strcmp(node["action"], "UPDATE") == 0) {
+		op->action = VAMP_SYNC_OP_ADD;
 
-			/* !!! a partir de aqui el nodo aun cuando estubiera agregado, se actualiza
-			hay que ver lo conveniente o seguro de esta operacion, puede que sea mejor 
-			no hacer nada si el nodo ya existe y esta activo..... */
-
-			/* Si el nodo no está registrado, se agrega */
-			if (table_index == VAMP_MAX_DEVICES) {
-				table_index = vamp_add_device(rf_id);
-			}
-			/* Si el nodo ya está registrado, se actualiza, para eso
-			vamos a limpiar primero la entrada */
-			else {
-				vamp_clear_entry(table_index);
-			}
-
-			if (table_index >= VAMP_MAX_DEVICES) {
-				#ifdef VAMP_DEBUG
-				printf("[JSON] Error agregando nodo a la tabla: %s - Sin slots disponibles o error interno\n", node["rf_id"].as<const char*>());
-				#endif /* VAMP_DEBUG */
-				continue; // Saltar este dispositivo y continuar con el siguiente
-			}
+		/* Verificar campos obligatorios y que no estén vacíos */
+		if (!node.containsKey("type") || !node["type"] ||
+			!node.containsKey("profiles") || !node["profiles"].is<JsonArray>()) {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Entrada JSON sin mandatory fields o con valores vacíos\n");
+			#endif /* VAMP_DEBUG */
+			goto invalid;
+		}
 
+		/* Extraer tipo del dispositivo */		
+		if (!strcmp(node["type"], "fixed")) {
+			op->type = 0;
+		} else if (!strcmp(node["type"], "dynamic")) {
+			op->type = 1;
+		} else if (!strcmp(node["type"], "auto")) {
+			op->type = 2;
+		} else {
+			/* !!!!! valor por defecto ???? */
 			#ifdef VAMP_DEBUG
-			printf("[JSON] Nodo agregado %s\n", node["rf_id"].as<const char*>());
+			printf("[JSON] Tipo de dispositivo desconocido: %s\n", node["type"].as<const char*>());
 			#endif /* VAMP_DEBUG */
+			op->type = 0; // Valor por defecto
+		}
 
-			vamp_entry_t * entry = vamp_get_table_entry(table_index);
-			if (!entry) {
+		/* Debe haber al menos un perfil, y todos tienen que ser objetos */
+		JsonArray profiles = node["profiles"];
+		if (profiles.size() == 0 || profiles.size() > VAMP_MAX_PROFILES) {
+			#ifdef VAMP_DEBUG
+			printf("[JSON] Tiene que haber entre 1 y %d perfiles\n", VAMP_MAX_PROFILES);
+			#endif /* VAMP_DEBUG */
+			goto invalid;
+		}
+		for (JsonVariant profile : profiles) {
+			if (!profile.is<JsonObject>()) {
 				#ifdef VAMP_DEBUG
-				printf("[JSON] Error al obtener la entrada de la tabla\n");
+				printf("[JSON] Perfil que no es un objeto\n");
 				#endif /* VAMP_DEBUG */
-				continue;
+				goto invalid;
 			}
+		}
 
-			/* Asignar el estado de cache */
-			entry->status = VAMP_DEV_STATUS_CACHE;
-
-			/* Extraer tipo del dispositivo */		
-			if (!strcmp(node["type"], "fixed")) {
-				entry->type = 0;
-			} else if (!strcmp(node["type"], "dynamic")) {
-				entry->type = 1;
-			} else if (!strcmp(node["type"], "auto")) {
-				entry->type = 2;
-			} else {
-				/* !!!!! valor por defecto ???? */
-				#ifdef VAMP_DEBUG
-				printf("[JSON] Tipo de dispositivo desconocido: %s\n", node["type"].as<const char*>());
-				#endif /* VAMP_DEBUG */
-				entry->type = 0; // Valor por defecto
-			}
+		op_count++;
+	}
 
-			/* Procesar perfiles, debe haber al menos uno */
-			JsonArray profiles = node["profiles"];
-			if (profiles.size() == 0 || profiles.size() >= VAMP_MAX_PROFILES) {
-				#ifdef VAMP_DEBUG
-				printf("[JSON] Tiene que haber entre 1 y %d perfiles\n", VAMP_MAX_PROFILES);
-				#endif /* VAMP_DEBUG */
-				continue; // Saltar este nodo si no hay perfiles
-			}
+	if (!vamp_sync_ops_fit(op_count)) {
+		#ifdef VAMP_DEBUG
+		printf("[JSON] No hay slots para todos los nodos nuevos\n");
+		#endif /* VAMP_DEBUG */
+		goto invalid;
+	}
 
-			/* Inicializar contador de perfiles */
-			uint8_t profile_index = 0;
-			entry->profile_count = 0;
-
-			/* Procesar cada perfil */
-			for (JsonObject profile : profiles) {
-				if (profile_index >= VAMP_MAX_PROFILES) {
-					#ifdef VAMP_DEBUG
-					printf("[JSON] Límite máximo de perfiles alcanzado\n");
-					#endif /* VAMP_DEBUG */
-					break;
-				}
-
-				/* Extraer method */
-				if (profile.containsKey("method")) {
-
-					/* Extraer el metodo (GET, POST...) */
-					if (!strcmp(profile["method"], "GET")) {
-						entry->profiles[profile_index].method = VAMP_HTTP_METHOD_GET;
-					} else if (!strcmp(profile["method"], "POST")) {
-						entry->profiles[profile_index].method = VAMP_HTTP_METHOD_POST;
-					} else if (!strcmp(profile["method"], "PUT")) {
-						entry->profiles[profile_index].method = VAMP_HTTP_METHOD_PUT;
-					} else if (!strcmp(profile["method"], "DELETE")) {
-						entry->profiles[profile_index].method = VAMP_HTTP_METHOD_DELETE;
-					} else {
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Método desconocido: %s\n", profile["method"].as<const char*>());
-						#endif /* VAMP_DEBUG */
-						/* !!! no me gustan estos valores por defecto !!!  */
-						entry->profiles[profile_index].method = 0; // Valor por defecto
-					}
-				} else {
-					/* !!! no me gustan estos valores por defecto !!!  */
-					entry->profiles[profile_index].method = 0; // Valor por defecto
-				}
-
-				/* Extraer endpoint_resource */
-				if (profile.containsKey("endpoint")) {
-					const char * endpoint_str = profile["endpoint"];
-					if (endpoint_str && strlen(endpoint_str) > 0 && strlen(endpoint_str) < VAMP_ENDPOINT_MAX_LEN) {
-						/* Liberar memoria previa si existe */
-						if (entry->profiles[profile_index].endpoint_resource) {
-							free(entry->profiles[profile_index].endpoint_resource);
-						}
-						/* Asignar nueva memoria */
-						entry->profiles[profile_index].endpoint_resource = strdup(endpoint_str);
-						if (!entry->profiles[profile_index].endpoint_resource) {
-							#ifdef VAMP_DEBUG
-							printf("[JSON] Error asignando memoria para endpoint_resource\n");
-							#endif /* VAMP_DEBUG */
-							break;
-						}
-					} else {
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Endpoint resource inválido o demasiado largo\n");
-						#endif /* VAMP_DEBUG */
-					}
-				}
-
-				/* Extraer protocol_options */
-				if (profile.containsKey("options")) {
-					if (profile["options"].is<JsonObject>()) {
-						JsonObject options_obj = profile["options"];
-						
-						/* Pre-asignar antes de parsear */
-						if (!vamp_kv_preallocate(&entry->profiles[profile_index].protocol_options)) {
-							#ifdef VAMP_DEBUG
-							printf("[JSON] Error pre-asignando protocol_options\n");
-							#endif
-							break;
-						}
-						
-						vamp_kv_parse_json(&entry->profiles[profile_index].protocol_options, options_obj);
-
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Protocol options parseadas: %d pares\n", entry->profiles[profile_index].protocol_options.count);
-						#endif /* VAMP_DEBUG */
-					} else {
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Protocol options no es un objeto JSON válido\n");
-						#endif /* VAMP_DEBUG */
-					}
-				}
-
-				/* Extraer los protocols query */
-				if (profile.containsKey("params")) {
-					if (profile["params"].is<JsonObject>()) {
-						JsonObject params_obj = profile["params"];
-						
-						/* Pre-asignar antes de parsear */
-						if (!vamp_kv_preallocate(&entry->profiles[profile_index].query_params)) {
-							#ifdef VAMP_DEBUG
-							printf("[JSON] Error pre-asignando query_params\n");
-							#endif
-							break;
-						}
-						
-						vamp_kv_parse_json(&entry->profiles[profile_index].query_params, params_obj);
-
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Query params parseados: %d pares\n", entry->profiles[profile_index].query_params.count);
-						#endif /* VAMP_DEBUG */
-					} else {
-						#ifdef VAMP_DEBUG
-						printf("[JSON] Query params no es un objeto JSON válido\n");
-						#endif /* VAMP_DEBUG */
-					}
-				}
-
-				profile_index++;
-				entry->profile_count = profile_index;
-			}
+	/* ------------------ Segunda pasada: aplicar ------------------ */
 
-			#ifdef VAMP_DEBUG
-			printf("[JSON] Dispositivo ADD procesado con %d perfiles\n", profile_index);
-			#endif /* VAMP_DEBUG */
+	bool complete;
+	complete = true;
 
+	for (uint8_t i = 0; i < op_count; i++) {
 
-		} else if (strcmp(node["action"], "REMOVE") == 0) {
+		vamp_sync_op_t * op = &sync_ops[i];
+		uint8_t table_index = vamp_find_device(op->rf_id);
 
-			if (table_index == VAMP_MAX_DEVICES) {
-				/* Remover dispositivo de la tabla */
+		if (op->action == VAMP_SYNC_OP_REMOVE) {
+			if (table_index < VAMP_MAX_DEVICES) {
 				vamp_clear_entry(table_index);
 				#ifdef VAMP_DEBUG
 				printf("[JSON] Dispositivo REMOVE procesado exitosamente\n");
 				#endif /* VAMP_DEBUG */
-			} else {
+			}
+			continue;
+		}
+
+		/* Construir los perfiles antes de tocar la entrada */
+		JsonArray profiles = nodes[op->node]["profiles"];
+		uint8_t profile_count = 0;
+		bool built = true;
+		for (JsonObject profile : profiles) {
+			if (!vamp_parse_profile(profile, &sync_profiles[profile_count++])) {
+				built = false;
+				break;
+			}
+		}
+		if (!built) {
+			/* Sin memoria: el nodo queda como estaba y el delta se repite */
+			vamp_sync_profiles_discard();
+			complete = false;
+			continue;
+		}
+
+		/* Un nodo nuevo queda en caché, uno que ya estaba conserva su estado
+		(un nodo activo sigue activo con sus perfiles nuevos) */
+		vamp_entry_t * entry = (table_index < VAMP_MAX_DEVICES) ? vamp_get_table_entry(table_index) : NULL;
+		if (!entry) {
+			table_index = vamp_add_device(op->rf_id);
+			entry = vamp_get_table_entry(table_index);
+			if (!entry) {
+				/* No debería pasar tras vamp_sync_ops_fit(), pero si un nodo nuevo
+				desalojó a un inactivo que la misma respuesta actualizaba, sus
+				perfiles se liberan y el timestamp no avanza */
 				#ifdef VAMP_DEBUG
-				printf("[JSON] Dispositivo REMOVE no encontrado en tabla\n");
+				printf("[JSON] Sin slots para el nodo, se omite\n");
 				#endif /* VAMP_DEBUG */
+				vamp_sync_profiles_discard();
+				complete = false;
+				continue;
 			}
+			vamp_set_entry_status(entry, VAMP_DEV_STATUS_CACHE);
+		}
 
-		} else {
-			#ifdef VAMP_DEBUG
-			printf("[JSON] Acción desconocida en JSON: %s\n", node["action"].as<const char*>());
-			#endif /* VAMP_DEBUG */
+		/* Reemplazar los perfiles: se liberan los viejos y se traspasan los
+		construidos (punteros incluidos, asi que no se copia ni se reserva nada) */
+		vamp_profile_t * entry_profiles = vamp_get_entry_profiles(table_index);
+		for (uint8_t p = 0; p < VAMP_MAX_PROFILES; p++) {
+			vamp_clear_profile(&entry_profiles[p]);
 		}
+		memcpy(entry_profiles, sync_profiles, sizeof(sync_profiles));
+		memset(sync_profiles, 0, sizeof(sync_profiles));
+
+		entry->type = op->type;
+		entry->profile_count = profile_count;
+
+		#ifdef VAMP_DEBUG
+		printf("[JSON] Dispositivo ADD procesado con %d perfiles\n", profile_count);
+		#endif /* VAMP_DEBUG */
+	}
+
+	/* Filtro de Bloom opcional con todos los RF_ID registrados en el VREG */
+	if (doc.containsKey("bloom") && doc["bloom"].is<JsonObject>()) {
+		JsonObject bloom = doc["bloom"];
+		vamp_gw_set_vreg_bloom(bloom["m"].as<uint16_t>(), bloom["k"].as<uint8_t>(), bloom["hex"].as<const char*>());
 	}
 
+	if (!complete) {
+		/* Sin avanzar el timestamp la próxima sincronización repite el delta */
+		return false;
+	}
+
+	if (lookup) {
+		return true;
+	}
+
+	sync_last_changes = op_count;
+	sync_next_hint = doc["next_sync"].as<uint32_t>();
+
+	/* Solo ahora, con todo aplicado, se avanza el timestamp */
+	vamp_set_last_sync_timestamp(doc["timestamp"].as<const char*>());
+
 	return true; // Procesamiento exitoso
+
+invalid:
+	/* Nada llegó a la tabla */
+	#ifdef VAMP_DEBUG
+	printf("[JSON] Sincronización descartada\n");
+	#endif /* VAMP_DEBUG */
+	return false;
 }
 
+bool vamp_process_sync_json_response(const char* json_data) {
+	return vamp_process_vreg_json(json_data, false);
+}
+
+bool vamp_process_lookup_json_response(const char* json_data) {
+	return vamp_process_vreg_json(json_data, true);
+}
 
 #endif /* ARDUINO_ARCH_ESP8266 */
\ No newline at end of file
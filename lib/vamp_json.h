@@ -18,10 +18,36 @@
  *          primero si el nodo ya estaba en la tabla.
  * - "REMOVE": eliminar un dispositivo, se cambia el estado a libre y se pone a cero el rf_id
  * - "UPDATE": actualizar un dispositivo existente
+ *
+ * Toda la respuesta se valida antes de tocar la tabla:
+ * - Un solo nodo inválido (acción desconocida, RF_ID inválido, sin tipo o sin
+ *   perfiles) descarta la sincronización entera, antes se omitía ese nodo y se
+ *   aplicaban los demás. Tampoco se aplica nada si los nodos nuevos no entran.
+ * - ADD/UPDATE de un nodo que ya está en la tabla reemplaza sus perfiles y
+ *   conserva su estado: un nodo activo sigue activo, antes volvía a caché y
+ *   tenía que unirse de nuevo.
+ * - Si falta memoria para los perfiles de un nodo, ese nodo queda como estaba,
+ *   el resto se aplica y el timestamp no avanza (la próxima repite el delta).
  * @param json_data: puntero a los datos JSON de la respuesta
  * @return true si la respuesta es válida, false en caso contrario
  */
 bool vamp_process_sync_json_response(const char* json_data);
 
+/** @brief Respuesta del VREG a una consulta puntual por dispositivos. Se aplica
+ *  igual que una sincronización pero no avanza el timestamp de la tabla: la
+ *  consulta no trae los cambios de los demás nodos, que tienen que llegar en
+ *  el delta de la próxima sincronización.
+ *  @param json_data: puntero a los datos JSON de la respuesta
+ *  @return true si la respuesta es válida, false en caso contrario
+ */
+bool vamp_process_lookup_json_response(const char* json_data);
+
+/** @brief Cantidad de nodos que traía la última respuesta aplicada */
+uint8_t vamp_sync_last_changes(void);
+
+/** @brief Segundos hasta la próxima sincronización que sugirió el VREG en la
+ *  última respuesta ("next_sync"), 0 si no sugirió nada */
+uint32_t vamp_sync_next_hint(void);
+
 
 #endif /* _VAMP_JSON_H_ */
@@ -105,6 +105,27 @@ bool vamp_kv_set(vamp_key_value_store_t* store, const char* key, const char* val
     return true;
 }
 
+/** @brief Añadir un par al final aunque la clave ya exista */
+bool vamp_kv_add(vamp_key_value_store_t* store, const char* key, const char* value) {
+    if (!store || !key || !value) return false;
+
+    if (strlen(key) >= VAMP_KEY_MAX_LEN || strlen(value) >= VAMP_VALUE_MAX_LEN) {
+        return false; // Key o value demasiado largo
+    }
+
+    if (store->count >= store->capacity) {
+        return false; /* Límite máximo alcanzado */
+    }
+
+    strncpy(store->pairs[store->count].key, key, VAMP_KEY_MAX_LEN - 1);
+    store->pairs[store->count].key[VAMP_KEY_MAX_LEN - 1] = '\0';
+    strncpy(store->pairs[store->count].value, value, VAMP_VALUE_MAX_LEN - 1);
+    store->pairs[store->count].value[VAMP_VALUE_MAX_LEN - 1] = '\0';
+    store->count++;
+
+    return true;
+}
+
 /** @brief Obtener valor por clave */
 const char* vamp_kv_get(const vamp_key_value_store_t* store, const char* key) {
     if (!store || !key) return NULL;
@@ -154,12 +175,20 @@ void vamp_kv_clear(vamp_key_value_store_t* store) {
     }
 }
 
+/** @brief Verificar si la clave es una directiva del gateway */
+bool vamp_kv_is_directive(const char* key) {
+    return key && strncmp(key, VAMP_KV_DIRECTIVE_PREFIX, sizeof(VAMP_KV_DIRECTIVE_PREFIX) - 1) == 0;
+}
+
 /** @brief Convertir store a string para HTTP headers */
 size_t vamp_kv_to_http_headers(const vamp_key_value_store_t* store, char* buffer, size_t buffer_size) {
     if (!store || !buffer || buffer_size == 0) return 0;
     
     size_t pos = 0;
     for (uint8_t i = 0; i < store->count; i++) {
+        if (vamp_kv_is_directive(store->pairs[i].key)) {
+            continue;
+        }
         int written = snprintf(buffer + pos, buffer_size - pos, "%s: %s\r\n", 
                               store->pairs[i].key, store->pairs[i].value);
         if (written < 0 || (size_t)written >= (buffer_size - pos)) {
@@ -53,6 +53,9 @@ void vamp_kv_free(vamp_key_value_store_t* store);
 /** @brief Añadir o actualizar un par key-value */
 bool vamp_kv_set(vamp_key_value_store_t* store, const char* key, const char* value);
 
+/** @brief Añadir un par al final aunque la clave ya exista (listas en query strings: k=a&k=b) */
+bool vamp_kv_add(vamp_key_value_store_t* store, const char* key, const char* value);
+
 /** @brief Obtener valor por clave */
 const char* vamp_kv_get(const vamp_key_value_store_t* store, const char* key);
 
@@ -65,7 +68,14 @@ bool vamp_kv_remove(vamp_key_value_store_t* store, const char* key);
 /** @brief Limpiar todos los pares */
 void vamp_kv_clear(vamp_key_value_store_t* store);
 
-/** @brief Convertir store a string para HTTP headers */
+/** @brief Prefijo de las opciones que son directivas para el gateway (por ejemplo
+ *  "vamp_cache"), no se envían al endpoint como headers */
+#define VAMP_KV_DIRECTIVE_PREFIX "vamp_"
+
+/** @brief Verificar si la clave es una directiva del gateway */
+bool vamp_kv_is_directive(const char* key);
+
+/** @brief Convertir store a string para HTTP headers (sin las directivas) */
 size_t vamp_kv_to_http_headers(const vamp_key_value_store_t* store, char* buffer, size_t buffer_size);
 
 #endif // VAMP_KV_H_
@@ -0,0 +1,139 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_lzss.h"
+
+#include <string.h>
+
+size_t vamp_lzss_encode(const uint8_t * in, size_t in_len, uint8_t * out, size_t out_size) {
+
+	if (!in || !out || in_len == 0) {
+		return 0;
+	}
+
+	size_t pos = 0;
+	size_t out_len = 0;
+	size_t flags_at = 0;
+	uint8_t bit = 8;
+
+	while (pos < in_len) {
+
+		/* Byte de banderas nuevo cada 8 elementos */
+		if (bit == 8) {
+			if (out_len >= out_size) {
+				return 0;
+			}
+			flags_at = out_len;
+			out[out_len++] = 0;
+			bit = 0;
+		}
+
+		/* Búsqueda lineal de la coincidencia más larga, las respuestas son cortas */
+		size_t best_len = 0;
+		size_t best_dist = 0;
+		size_t max_len = in_len - pos;
+		if (max_len > VAMP_LZSS_MAX_MATCH) {
+			max_len = VAMP_LZSS_MAX_MATCH;
+		}
+		size_t start = pos > VAMP_LZSS_WINDOW ? pos - VAMP_LZSS_WINDOW : 0;
+		for (size_t cand = start; cand < pos && max_len >= VAMP_LZSS_MIN_MATCH; cand++) {
+			size_t len = 0;
+			while (len < max_len && in[cand + len] == in[pos + len]) {
+				len++;
+			}
+			if (len > best_len) {
+				best_len = len;
+				best_dist = pos - cand;
+				if (len == max_len) {
+					break;
+				}
+			}
+		}
+
+		if (best_len >= VAMP_LZSS_MIN_MATCH) {
+			if (out_len + 2 > out_size) {
+				return 0;
+			}
+			uint16_t dist = (uint16_t)(best_dist - 1);
+			out[out_len++] = (uint8_t)(dist >> 4);
+			out[out_len++] = (uint8_t)(((dist & 0x0F) << 4) | (best_len - VAMP_LZSS_MIN_MATCH));
+			pos += best_len;
+		} else {
+			if (out_len >= out_size) {
+				return 0;
+			}
+			out[flags_at] |= (uint8_t)(1 << bit);
+			out[out_len++] = in[pos++];
+		}
+		bit++;
+	}
+
+	return out_len;
+}
+
+void vamp_lzss_decode_reset(vamp_lzss_decoder_t * dec) {
+	if (dec) {
+		memset(dec, 0, sizeof(vamp_lzss_decoder_t));
+	}
+}
+
+int8_t vamp_lzss_decode(vamp_lzss_decoder_t * dec, const uint8_t * in, size_t in_len,
+		uint8_t * out, size_t out_size, size_t * out_len) {
+
+	if (!dec || !out || !out_len || (in_len && !in)) {
+		return -1;
+	}
+
+	size_t len = *out_len;
+
+	for (size_t i = 0; i < in_len; i++) {
+		uint8_t byte = in[i];
+
+		if (dec->half) {
+			/* Segundo byte de la referencia */
+			dec->half = false;
+			size_t dist = (((size_t)dec->ref << 4) | (byte >> 4)) + 1;
+			size_t count = (byte & 0x0F) + VAMP_LZSS_MIN_MATCH;
+			if (dist > len) {
+				*out_len = len;
+				return -1;
+			}
+			/* Byte a byte, la referencia puede solaparse con lo que escribe */
+			for (size_t n = 0; n < count; n++) {
+				if (len >= out_size) {
+					*out_len = len;
+					return 1;
+				}
+				out[len] = out[len - dist];
+				len++;
+			}
+			continue;
+		}
+
+		if (dec->bits == 0) {
+			dec->flags = byte;
+			dec->bits = 8;
+			continue;
+		}
+
+		bool literal = dec->flags & 0x01;
+		dec->flags >>= 1;
+		dec->bits--;
+
+		if (literal) {
+			if (len >= out_size) {
+				*out_len = len;
+				return 1;
+			}
+			out[len++] = byte;
+		} else {
+			dec->ref = byte;
+			dec->half = true;
+		}
+	}
+
+	*out_len = len;
+	return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file vamp_lzss.h
+ * @brief Compresión LZSS liviana de las respuestas que el nodo recibe por POLL
+ *
+ * Las respuestas de texto (JSON de configuración) repiten mucho las claves y
+ * las comillas. El gateway las comprime una vez y el nodo las descomprime a
+ * medida que llegan las páginas, sobre su propio buffer de salida, sin ventana
+ * aparte.
+ *
+ * Formato: grupos de un byte de banderas seguido de hasta 8 elementos, la
+ * bandera del primero en el bit 0. Bandera 1 = un byte literal, bandera 0 =
+ * referencia de 2 bytes a lo ya escrito:
+ *
+ *     [DDDDDDDD][DDDDLLLL]    distancia - 1 (12 bits), largo - VAMP_LZSS_MIN_MATCH (4 bits)
+ *
+ * No hay terminador, la salida termina con la entrada.
+ *
+ * Prueba en el host, con la entrada en páginas como la recibe el nodo:
+ * test/test_lzss.cpp
+ */
+
+#ifndef _VAMP_LZSS_H_
+#define _VAMP_LZSS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Largo mínimo de una referencia, las más cortas no ahorran nada */
+#define VAMP_LZSS_MIN_MATCH		3
+
+/** @brief Largo máximo de una referencia (4 bits) */
+#define VAMP_LZSS_MAX_MATCH		(VAMP_LZSS_MIN_MATCH + 15)
+
+/** @brief Distancia máxima de una referencia (12 bits) */
+#define VAMP_LZSS_WINDOW		4096
+
+/** @brief Descompresión en curso */
+typedef struct {
+	uint8_t flags;				// Banderas del grupo actual
+	uint8_t bits;				// Banderas que quedan en flags
+	uint8_t ref;				// Primer byte de una referencia cortada entre páginas
+	bool half;					// ref tiene el primer byte de la referencia
+} vamp_lzss_decoder_t;
+
+/** @brief Comprimir in en out
+ *  @return Largo comprimido, 0 si no cabe en out_size (no conviene comprimir)
+ */
+size_t vamp_lzss_encode(const uint8_t * in, size_t in_len, uint8_t * out, size_t out_size);
+
+/** @brief Preparar la descompresión de una respuesta nueva */
+void vamp_lzss_decode_reset(vamp_lzss_decoder_t * dec);
+
+/** @brief Descomprimir una parte de la entrada, a continuación de lo ya escrito
+ *  @param out Salida completa hasta ahora, las referencias apuntan a ella
+ *  @param out_len Bytes ya escritos en out, se actualiza
+ *  @return 0 si se usó toda la entrada, 1 si out se llenó antes, -1 si la
+ *  entrada no es válida
+ */
+int8_t vamp_lzss_decode(vamp_lzss_decoder_t * dec, const uint8_t * in, size_t in_len,
+		uint8_t * out, size_t out_size, size_t * out_len);
+
+#endif /* _VAMP_LZSS_H_ */
@@ -0,0 +1,183 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_mqtt.h"
+
+#include <string.h>
+
+/* Largo restante de MQTT: 7 bits por byte, el bit alto indica que sigue otro */
+static size_t vamp_mqtt_put_remaining(uint8_t * buf, uint32_t len) {
+	size_t n = 0;
+	do {
+		uint8_t byte = len % 128;
+		len /= 128;
+		if (len > 0) {
+			byte |= 0x80;
+		}
+		buf[n++] = byte;
+	} while (len > 0 && n < 4);
+	return n;
+}
+
+static size_t vamp_mqtt_remaining_bytes(uint32_t len) {
+	return len < 128 ? 1 : len < 16384 ? 2 : len < 2097152 ? 3 : 4;
+}
+
+/* Cadena UTF-8 de MQTT: largo en 2 bytes big endian y el texto */
+static size_t vamp_mqtt_put_string(uint8_t * buf, const char * str, size_t len) {
+	buf[0] = (uint8_t)(len >> 8);
+	buf[1] = (uint8_t)(len & 0xFF);
+	memcpy(buf + 2, str, len);
+	return len + 2;
+}
+
+size_t vamp_mqtt_connect_packet(uint8_t * buf, size_t size, const char * client_id,
+		const char * user, const char * pass, uint16_t keepalive, bool clean_session) {
+
+	if (!buf || !client_id) {
+		return 0;
+	}
+
+	size_t id_len = strlen(client_id);
+	size_t user_len = (user && user[0]) ? strlen(user) : 0;
+	size_t pass_len = (user_len && pass && pass[0]) ? strlen(pass) : 0;
+
+	/* Cabecera variable: "MQTT", nivel 4, flags, keepalive */
+	uint32_t remaining = 10 + 2 + id_len;
+	if (user_len) {
+		remaining += 2 + user_len;
+	}
+	if (pass_len) {
+		remaining += 2 + pass_len;
+	}
+
+	size_t total = 1 + vamp_mqtt_remaining_bytes(remaining) + remaining;
+	if (total > size) {
+		return 0;
+	}
+
+	uint8_t flags = clean_session ? 0x02 : 0x00;
+	if (user_len) {
+		flags |= 0x80;
+	}
+	if (pass_len) {
+		flags |= 0x40;
+	}
+
+	size_t n = 0;
+	buf[n++] = VAMP_MQTT_CONNECT;
+	n += vamp_mqtt_put_remaining(buf + n, remaining);
+	n += vamp_mqtt_put_string(buf + n, "MQTT", 4);
+	buf[n++] = 4;
+	buf[n++] = flags;
+	buf[n++] = (uint8_t)(keepalive >> 8);
+	buf[n++] = (uint8_t)(keepalive & 0xFF);
+	n += vamp_mqtt_put_string(buf + n, client_id, id_len);
+	if (user_len) {
+		n += vamp_mqtt_put_string(buf + n, user, user_len);
+	}
+	if (pass_len) {
+		n += vamp_mqtt_put_string(buf + n, pass, pass_len);
+	}
+
+	return n;
+}
+
+size_t vamp_mqtt_publish_packet(uint8_t * buf, size_t size, const char * topic,
+		const uint8_t * payload, size_t payload_len, uint8_t qos, bool retain, uint16_t packet_id) {
+
+	if (!buf || !topic || !topic[0] || qos > 1 || (payload_len && !payload)) {
+		return 0;
+	}
+
+	size_t topic_len = strlen(topic);
+	uint32_t remaining = 2 + topic_len + (qos ? 2 : 0) + payload_len;
+
+	size_t total = 1 + vamp_mqtt_remaining_bytes(remaining) + remaining;
+	if (total > size) {
+		return 0;
+	}
+
+	size_t n = 0;
+	buf[n++] = VAMP_MQTT_PUBLISH | (qos << 1) | (retain ? 0x01 : 0x00);
+	n += vamp_mqtt_put_remaining(buf + n, remaining);
+	n += vamp_mqtt_put_string(buf + n, topic, topic_len);
+	if (qos) {
+		buf[n++] = (uint8_t)(packet_id >> 8);
+		buf[n++] = (uint8_t)(packet_id & 0xFF);
+	}
+	if (payload_len) {
+		memcpy(buf + n, payload, payload_len);
+		n += payload_len;
+	}
+
+	return n;
+}
+
+size_t vamp_mqtt_empty_packet(uint8_t * buf, size_t size, uint8_t type) {
+	if (!buf || size < 2) {
+		return 0;
+	}
+	buf[0] = type;
+	buf[1] = 0;
+	return 2;
+}
+
+void vamp_mqtt_reader_reset(vamp_mqtt_reader_t * reader) {
+	if (reader) {
+		memset(reader, 0, sizeof(vamp_mqtt_reader_t));
+	}
+}
+
+int8_t vamp_mqtt_reader_feed(vamp_mqtt_reader_t * reader, uint8_t byte) {
+
+	switch (reader->state) {
+		case 0:
+			reader->header = byte;
+			reader->remaining = 0;
+			reader->multiplier = 1;
+			reader->body_len = 0;
+			reader->state = 1;
+			return 0;
+
+		case 1:
+			reader->remaining += (uint32_t)(byte & 0x7F) * reader->multiplier;
+			if (byte & 0x80) {
+				reader->multiplier *= 128;
+				if (reader->multiplier > 128UL * 128 * 128) {
+					vamp_mqtt_reader_reset(reader);
+					return -1;
+				}
+				return 0;
+			}
+			if (reader->remaining == 0) {
+				reader->state = 0;
+				return 1;
+			}
+			reader->state = 2;
+			return 0;
+
+		case 2:
+			if (reader->body_len < VAMP_MQTT_RX_KEEP) {
+				reader->body[reader->body_len++] = byte;
+			}
+			if (--reader->remaining == 0) {
+				reader->state = 0;
+				return 1;
+			}
+			return 0;
+
+		default:
+			vamp_mqtt_reader_reset(reader);
+			return -1;
+	}
+}
+
+uint16_t vamp_mqtt_reader_packet_id(const vamp_mqtt_reader_t * reader) {
+	if (reader->body_len < 2) {
+		return 0;
+	}
+	return (uint16_t)((reader->body[0] << 8) | reader->body[1]);
+}
@@ -0,0 +1,79 @@
+/**
+ * @file vamp_mqtt.h
+ * @brief Codificación de paquetes MQTT 3.1.1 para el transporte mqtt://
+ *
+ * Solo lo que necesita el gateway para publicar: CONNECT, PUBLISH (QoS 0/1),
+ * PINGREQ y DISCONNECT hacia el broker, y un lector byte a byte de lo que llega
+ * (CONNACK, PUBACK, PINGRESP). La conexión la maneja cada arquitectura
+ * (arch/iface/vamp_mqtt.cpp en el ESP8266).
+ *
+ * Prueba en el host, los paquetes contra los bytes del estándar:
+ * test/test_mqtt.cpp. La conexión con el broker necesita WiFiClient y no se
+ * prueba ahí.
+ */
+
+#ifndef _VAMP_MQTT_H_
+#define _VAMP_MQTT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Tipos de paquete (nibble alto del primer byte) */
+#define VAMP_MQTT_CONNECT		0x10
+#define VAMP_MQTT_CONNACK		0x20
+#define VAMP_MQTT_PUBLISH		0x30
+#define VAMP_MQTT_PUBACK		0x40
+#define VAMP_MQTT_SUBACK		0x90
+#define VAMP_MQTT_PINGREQ		0xC0
+#define VAMP_MQTT_PINGRESP		0xD0
+#define VAMP_MQTT_DISCONNECT	0xE0
+
+#define VAMP_MQTT_TYPE_MASK		0xF0
+#define VAMP_MQTT_DUP_FLAG		0x08
+
+/** @brief Bytes del cuerpo que el lector guarda de cada paquete recibido, el
+ *  resto se descarta (al gateway solo le interesan CONNACK y PUBACK) */
+#define VAMP_MQTT_RX_KEEP 4
+
+/** @brief Lector incremental de paquetes entrantes */
+typedef struct {
+	uint8_t state;						// 0 = tipo, 1 = largo restante, 2 = cuerpo
+	uint8_t header;						// Primer byte del paquete
+	uint32_t remaining;					// Bytes del cuerpo por leer
+	uint32_t multiplier;				// Para decodificar el largo variable
+	uint8_t body[VAMP_MQTT_RX_KEEP];	// Primeros bytes del cuerpo
+	uint8_t body_len;					// Bytes guardados en body
+} vamp_mqtt_reader_t;
+
+/** @brief Armar un CONNECT
+ *  @param clean_session false para que el broker conserve la sesión (QoS 1 en vuelo)
+ *  @param user Usuario o NULL, pass solo se envía si hay usuario
+ *  @return Largo del paquete, 0 si no cabe en buf
+ */
+size_t vamp_mqtt_connect_packet(uint8_t * buf, size_t size, const char * client_id,
+		const char * user, const char * pass, uint16_t keepalive, bool clean_session);
+
+/** @brief Armar un PUBLISH
+ *  @param packet_id Identificador (solo con qos > 0)
+ *  @return Largo del paquete, 0 si no cabe en buf
+ */
+size_t vamp_mqtt_publish_packet(uint8_t * buf, size_t size, const char * topic,
+		const uint8_t * payload, size_t payload_len, uint8_t qos, bool retain, uint16_t packet_id);
+
+/** @brief Armar un paquete sin cuerpo (PINGREQ, DISCONNECT)
+ *  @return 2, o 0 si no cabe en buf
+ */
+size_t vamp_mqtt_empty_packet(uint8_t * buf, size_t size, uint8_t type);
+
+/** @brief Reiniciar el lector (tras reconectar) */
+void vamp_mqtt_reader_reset(vamp_mqtt_reader_t * reader);
+
+/** @brief Pasar un byte recibido al lector
+ *  @return 1 si completó un paquete (header/body), 0 si falta, -1 si es inválido
+ */
+int8_t vamp_mqtt_reader_feed(vamp_mqtt_reader_t * reader, uint8_t byte);
+
+/** @brief Identificador de paquete de un PUBACK completo */
+uint16_t vamp_mqtt_reader_packet_id(const vamp_mqtt_reader_t * reader);
+
+#endif /* _VAMP_MQTT_H_ */
@@ -0,0 +1,225 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_prefetch.h"
+
+#include <string.h>
+
+/* Estados del par */
+#define PREFETCH_IDLE		0
+#define PREFETCH_FETCHING	1	// Request en vuelo
+#define PREFETCH_READY		2	// Respuesta esperando el pedido
+
+typedef struct {
+	bool in_use;
+	uint8_t wsn_id;
+	uint8_t profile_index;
+	uint8_t state;
+	uint8_t samples;						// Intervalos parecidos seguidos
+	uint8_t waste;							// Respuestas desperdiciadas seguidas
+	bool cycle_done;						// Ya se hizo el prefetch del próximo pedido
+	bool claimed;							// El pedido llegó con el prefetch en vuelo
+	uint32_t last_ask;
+	uint32_t period;						// Intervalo medio entre pedidos (ms)
+	uint32_t lead;							// Anticipación del prefetch (ms)
+	uint8_t len;
+	char data[VAMP_PREFETCH_DATA_MAX + 1];
+} vamp_prefetch_slot_t;
+
+static vamp_prefetch_slot_t prefetch_slots[VAMP_PREFETCH_SLOTS];
+static vamp_prefetch_stats_t prefetch_stats;
+
+static vamp_prefetch_slot_t * vamp_prefetch_find(uint8_t wsn_id, uint8_t profile_index) {
+	for (uint8_t i = 0; i < VAMP_PREFETCH_SLOTS; i++) {
+		vamp_prefetch_slot_t * slot = &prefetch_slots[i];
+		if (slot->in_use && slot->wsn_id == wsn_id && slot->profile_index == profile_index) {
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+/* Uno libre o el que hace más que no pide, salvo los que están en vuelo */
+static vamp_prefetch_slot_t * vamp_prefetch_new(uint8_t wsn_id, uint8_t profile_index, uint32_t now) {
+
+	vamp_prefetch_slot_t * candidate = NULL;
+	for (uint8_t i = 0; i < VAMP_PREFETCH_SLOTS; i++) {
+		vamp_prefetch_slot_t * slot = &prefetch_slots[i];
+		if (!slot->in_use) {
+			candidate = slot;
+			break;
+		}
+		if (slot->state == PREFETCH_FETCHING) {
+			continue;
+		}
+		if (!candidate || (now - slot->last_ask) > (now - candidate->last_ask)) {
+			candidate = slot;
+		}
+	}
+
+	if (!candidate) {
+		return NULL;
+	}
+
+	memset(candidate, 0, sizeof(vamp_prefetch_slot_t));
+	candidate->in_use = true;
+	candidate->wsn_id = wsn_id;
+	candidate->profile_index = profile_index;
+	candidate->last_ask = now;
+	return candidate;
+}
+
+static uint32_t vamp_prefetch_tolerance(const vamp_prefetch_slot_t * slot) {
+	return slot->period / 100 * VAMP_PREFETCH_JITTER_PCT;
+}
+
+/* El intervalo es un múltiplo del periodo: el nodo se saltó pedidos pero no cambió */
+static bool vamp_prefetch_skipped(const vamp_prefetch_slot_t * slot, uint32_t interval, uint32_t tolerance) {
+	if (slot->samples < VAMP_PREFETCH_MIN_SAMPLES || slot->period == 0 || interval <= slot->period) {
+		return false;
+	}
+	uint32_t rest = interval % slot->period;
+	return rest <= tolerance || slot->period - rest <= tolerance;
+}
+
+/* La respuesta lista no se pidió a tiempo */
+static void vamp_prefetch_waste(vamp_prefetch_slot_t * slot) {
+	slot->state = PREFETCH_IDLE;
+	prefetch_stats.wasted++;
+	if (slot->waste < 0xFF && ++slot->waste == VAMP_PREFETCH_MAX_WASTE) {
+		prefetch_stats.suspended++;
+	}
+}
+
+int16_t vamp_prefetch_ask(uint8_t wsn_id, uint8_t profile_index, uint32_t lead,
+		char * data, size_t data_size, uint32_t now) {
+
+	vamp_prefetch_slot_t * slot = vamp_prefetch_find(wsn_id, profile_index);
+
+	if (lead == 0) {
+		if (slot && slot->state != PREFETCH_FETCHING) {
+			slot->in_use = false;
+		}
+		return -1;
+	}
+
+	if (!slot) {
+		vamp_prefetch_new(wsn_id, profile_index, now);
+		return -1;
+	}
+
+	uint32_t interval = now - slot->last_ask;
+	int16_t result = -1;
+
+	if (slot->state == PREFETCH_READY) {
+		if (interval <= slot->period + vamp_prefetch_tolerance(slot) && data && data_size > slot->len) {
+			memcpy(data, slot->data, slot->len);
+			data[slot->len] = '\0';
+			result = slot->len;
+			slot->state = PREFETCH_IDLE;
+			slot->waste = 0;
+			prefetch_stats.hits++;
+		} else {
+			vamp_prefetch_waste(slot);
+		}
+	} else if (slot->state == PREFETCH_FETCHING) {
+		slot->claimed = true;
+		prefetch_stats.late++;
+	}
+
+	/* Media móvil del intervalo, uno muy distinto reinicia el aprendizaje */
+	uint32_t tolerance = vamp_prefetch_tolerance(slot);
+	uint32_t deviation = interval > slot->period ? interval - slot->period : slot->period - interval;
+	if (slot->samples > 0 && deviation <= tolerance) {
+		slot->period = (slot->period * 3 + interval) / 4;
+		if (slot->samples < 0xFF && ++slot->samples == VAMP_PREFETCH_MIN_SAMPLES) {
+			prefetch_stats.learned++;
+		}
+		/* Pidió a tiempo, lo desperdiciado antes ya no cuenta */
+		slot->waste = 0;
+	} else if (vamp_prefetch_skipped(slot, interval, tolerance)) {
+		/* No se reaprende, y las respuestas que no pidió siguen contando */
+	} else {
+		slot->period = interval;
+		slot->samples = 1;
+		slot->waste = 0;
+	}
+
+	slot->last_ask = now;
+	slot->lead = lead;
+	slot->cycle_done = false;
+	return result;
+}
+
+bool vamp_prefetch_due(uint32_t now, uint8_t * wsn_id, uint8_t * profile_index) {
+
+	for (uint8_t i = 0; i < VAMP_PREFETCH_SLOTS; i++) {
+		vamp_prefetch_slot_t * slot = &prefetch_slots[i];
+		if (!slot->in_use || slot->state == PREFETCH_FETCHING || slot->period == 0) {
+			continue;
+		}
+
+		uint32_t elapsed = now - slot->last_ask;
+
+		if (slot->state == PREFETCH_READY && elapsed > slot->period + vamp_prefetch_tolerance(slot)) {
+			vamp_prefetch_waste(slot);
+		}
+
+		/* El nodo dejó de pedir */
+		if (elapsed / VAMP_PREFETCH_FORGET > slot->period) {
+			slot->in_use = false;
+			continue;
+		}
+
+		if (slot->state != PREFETCH_IDLE || slot->cycle_done ||
+				slot->samples < VAMP_PREFETCH_MIN_SAMPLES || slot->waste >= VAMP_PREFETCH_MAX_WASTE ||
+				slot->lead >= slot->period || elapsed < slot->period - slot->lead) {
+			continue;
+		}
+
+		slot->state = PREFETCH_FETCHING;
+		slot->cycle_done = true;
+		slot->claimed = false;
+		prefetch_stats.issued++;
+
+		*wsn_id = slot->wsn_id;
+		*profile_index = slot->profile_index;
+		return true;
+	}
+
+	return false;
+}
+
+void vamp_prefetch_done(uint8_t wsn_id, uint8_t profile_index, const char * data, int16_t len) {
+
+	vamp_prefetch_slot_t * slot = vamp_prefetch_find(wsn_id, profile_index);
+	if (!slot || slot->state != PREFETCH_FETCHING) {
+		return;
+	}
+
+	/* Si el pedido ya llegó el nodo recibe la respuesta por su propio request */
+	if (slot->claimed || len < 0 || !data || len > VAMP_PREFETCH_DATA_MAX) {
+		slot->state = PREFETCH_IDLE;
+		return;
+	}
+
+	memcpy(slot->data, data, (size_t)len);
+	slot->data[len] = '\0';
+	slot->len = (uint8_t)len;
+	slot->state = PREFETCH_READY;
+}
+
+void vamp_prefetch_drop(uint8_t wsn_id, uint8_t profile_index) {
+	vamp_prefetch_slot_t * slot = vamp_prefetch_find(wsn_id, profile_index);
+	if (slot) {
+		slot->in_use = false;
+	}
+}
+
+void vamp_prefetch_get_stats(vamp_prefetch_stats_t * stats) {
+	if (stats) {
+		*stats = prefetch_stats;
+	}
+}
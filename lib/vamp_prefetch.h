@@ -0,0 +1,93 @@
+/**
+ * @file vamp_prefetch.h
+ * @brief Prefetch de los GET que los nodos piden con un periodo regular
+ *
+ * Muchos nodos piden el mismo perfil GET cada cierto tiempo y después tienen
+ * que volver a hacer POLL porque el request recién empieza cuando llega su
+ * mensaje. Por cada nodo/perfil se aprende el intervalo entre pedidos (media
+ * móvil) y, cuando es estable, el gateway hace el GET un poco antes del próximo
+ * pedido. La respuesta queda lista y el nodo la recibe en el primer POLL.
+ *
+ * Un intervalo que se aleja más de VAMP_PREFETCH_JITTER_PCT del periodo
+ * reinicia el aprendizaje, salvo que sea un múltiplo del periodo (el nodo se
+ * saltó pedidos). Una respuesta que nadie pidió a tiempo cuenta como
+ * desperdiciada y tras VAMP_PREFETCH_MAX_WASTE seguidas el nodo/perfil deja de
+ * prefetchearse hasta que vuelva a pedir a tiempo o su periodo cambie.
+ *
+ * Prueba en el host: test/test_prefetch.cpp
+ */
+
+#ifndef _VAMP_PREFETCH_H_
+#define _VAMP_PREFETCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Pares nodo/perfil seguidos a la vez, sin lugar se reemplaza el más viejo */
+#ifndef VAMP_PREFETCH_SLOTS
+#define VAMP_PREFETCH_SLOTS 8
+#endif // VAMP_PREFETCH_SLOTS
+
+/** @brief Intervalos parecidos seguidos antes de empezar a predecir */
+#ifndef VAMP_PREFETCH_MIN_SAMPLES
+#define VAMP_PREFETCH_MIN_SAMPLES 3
+#endif // VAMP_PREFETCH_MIN_SAMPLES
+
+/** @brief Desvío (% del periodo) tolerado en el intervalo y en la llegada del pedido */
+#ifndef VAMP_PREFETCH_JITTER_PCT
+#define VAMP_PREFETCH_JITTER_PCT 25
+#endif // VAMP_PREFETCH_JITTER_PCT
+
+/** @brief Respuestas desperdiciadas seguidas que suspenden el prefetch del par */
+#ifndef VAMP_PREFETCH_MAX_WASTE
+#define VAMP_PREFETCH_MAX_WASTE 3
+#endif // VAMP_PREFETCH_MAX_WASTE
+
+/** @brief Periodos sin pedidos tras los que se olvida el par */
+#ifndef VAMP_PREFETCH_FORGET
+#define VAMP_PREFETCH_FORGET 4
+#endif // VAMP_PREFETCH_FORGET
+
+/** @brief Tamaño máximo de la respuesta guardada, alcanza para VAMP_MAX_PAYLOAD_SIZE */
+#ifndef VAMP_PREFETCH_DATA_MAX
+#define VAMP_PREFETCH_DATA_MAX 32
+#endif // VAMP_PREFETCH_DATA_MAX
+
+/** @brief Contadores */
+typedef struct {
+	uint32_t learned;			// Pares con periodo estable
+	uint32_t issued;			// Prefetch iniciados
+	uint32_t hits;				// Pedidos servidos con la respuesta ya lista
+	uint32_t late;				// Pedidos que llegaron con el prefetch en vuelo
+	uint32_t wasted;			// Respuestas que nadie pidió a tiempo
+	uint32_t suspended;			// Pares suspendidos por desperdiciar
+} vamp_prefetch_stats_t;
+
+/** @brief El nodo pidió el perfil: aprende el intervalo y entrega la respuesta
+ *  si está lista
+ *  @param lead Anticipación (ms) del prefetch para el perfil, 0 lo deshabilita
+ *  @param data Donde se copia la respuesta (terminada en '\0')
+ *  @param now Tiempo actual (ms)
+ *  @return Largo de la respuesta lista, o -1 si no había
+ */
+int16_t vamp_prefetch_ask(uint8_t wsn_id, uint8_t profile_index, uint32_t lead,
+		char * data, size_t data_size, uint32_t now);
+
+/** @brief Próximo par al que le toca el prefetch, queda en vuelo hasta
+ *  vamp_prefetch_done(). También vence las respuestas no pedidas
+ *  @return true si hay que hacer el request del par
+ */
+bool vamp_prefetch_due(uint32_t now, uint8_t * wsn_id, uint8_t * profile_index);
+
+/** @brief Resultado del prefetch del par
+ *  @param len Largo de la respuesta, < 0 si falló (o se descartó sin request)
+ */
+void vamp_prefetch_done(uint8_t wsn_id, uint8_t profile_index, const char * data, int16_t len);
+
+/** @brief Dejar de seguir el par (el perfil ya no es prefetcheable) */
+void vamp_prefetch_drop(uint8_t wsn_id, uint8_t profile_index);
+
+/** @brief Copia de los contadores */
+void vamp_prefetch_get_stats(vamp_prefetch_stats_t * stats);
+
+#endif /* _VAMP_PREFETCH_H_ */
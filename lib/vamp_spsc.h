@@ -0,0 +1,134 @@
+/**
+ * @file vamp_spsc.h
+ * @brief Cola lock-free de un solo productor y un solo consumidor (SPSC)
+ *
+ * Pensada para pasar tramas desde una interrupción (o un manejador diferido)
+ * hacia el lazo principal sin deshabilitar interrupciones. El productor solo
+ * escribe "head" y el consumidor solo escribe "tail", por lo que no hace falta
+ * ningún bloqueo mientras cada lado se use desde un único contexto.
+ *
+ * Los índices son contadores libres de 8 bits y la capacidad debe ser potencia
+ * de 2, asi (head - tail) es siempre la ocupación, incluso al desbordarse.
+ *
+ * Prueba en el host, con productor y consumidor en hilos distintos:
+ * test/test_spsc.cpp
+ */
+
+#ifndef _VAMP_SPSC_H_
+#define _VAMP_SPSC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Acceso a los índices con semántica acquire/release. En los MCU de un solo
+núcleo basta con impedir que el compilador reordene, en el host hacen falta
+las barreras reales para que dos hilos vean los datos antes que el índice */
+#if defined(__GNUC__)
+#define VAMP_SPSC_LOAD(var)			__atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define VAMP_SPSC_STORE(var, val)	__atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#else
+#define VAMP_SPSC_LOAD(var)			(var)
+#define VAMP_SPSC_STORE(var, val)	((var) = (val))
+#endif
+
+template <typename T, uint8_t N>
+class vamp_spsc_queue {
+
+	static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "vamp_spsc_queue: N debe ser potencia de 2 (<= 128)");
+
+public:
+
+	vamp_spsc_queue() : head(0), tail(0) {}
+
+	/* ------------------------- Productor ------------------------- */
+
+	/** @brief Obtener el siguiente hueco libre para escribir en él
+	 *  @return Puntero al hueco o NULL si la cola está llena
+	 *  @note El elemento no es visible para el consumidor hasta commit()
+	 */
+	T * reserve(void) {
+		uint8_t h = head;
+		if ((uint8_t)(h - VAMP_SPSC_LOAD(tail)) >= N) {
+			return NULL;
+		}
+		return &items[h & (N - 1)];
+	}
+
+	/** @brief Publicar el hueco obtenido con reserve() */
+	void commit(void) {
+		VAMP_SPSC_STORE(head, (uint8_t)(head + 1));
+	}
+
+	/** @brief Copiar un elemento en la cola
+	 *  @return false si la cola está llena
+	 */
+	bool push(const T & item) {
+		T * slot = reserve();
+		if (!slot) {
+			return false;
+		}
+		*slot = item;
+		commit();
+		return true;
+	}
+
+	/* ------------------------- Consumidor ------------------------- */
+
+	/** @brief Elemento más antiguo, sin sacarlo de la cola
+	 *  @return Puntero al elemento o NULL si la cola está vacía
+	 */
+	T * front(void) {
+		uint8_t t = tail;
+		if (VAMP_SPSC_LOAD(head) == t) {
+			return NULL;
+		}
+		return &items[t & (N - 1)];
+	}
+
+	/** @brief Liberar el elemento obtenido con front() */
+	void pop(void) {
+		VAMP_SPSC_STORE(tail, (uint8_t)(tail + 1));
+	}
+
+	/** @brief Sacar una copia del elemento más antiguo
+	 *  @return false si la cola está vacía
+	 */
+	bool pop(T & item) {
+		T * slot = front();
+		if (!slot) {
+			return false;
+		}
+		item = *slot;
+		pop();
+		return true;
+	}
+
+	/** @brief Vaciar la cola
+	 *  @note Solo desde el consumidor, el productor no debe estar activo
+	 */
+	void clear(void) {
+		VAMP_SPSC_STORE(tail, VAMP_SPSC_LOAD(head));
+	}
+
+	/* ------------------------- Ambos ------------------------- */
+
+	/** @brief Cantidad de elementos en la cola (aproximada si el otro lado está activo) */
+	uint8_t size(void) const {
+		return (uint8_t)(VAMP_SPSC_LOAD(head) - VAMP_SPSC_LOAD(tail));
+	}
+
+	bool empty(void) const {
+		return size() == 0;
+	}
+
+	uint8_t capacity(void) const {
+		return N;
+	}
+
+private:
+	uint8_t head;		// Solo lo escribe el productor
+	uint8_t tail;		// Solo lo escribe el consumidor
+	T items[N];
+};
+
+#endif /* _VAMP_SPSC_H_ */
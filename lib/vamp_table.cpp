@@ -13,15 +13,94 @@
 #include "vamp_json.h"
 #endif
 
-/* Tabla global VAMP */
+/* Tabla global VAMP, solo los campos calientes */
 static vamp_entry_t vamp_table[VAMP_MAX_DEVICES];
 
+/* Perfiles de cada entrada, mismo índice que la tabla */
+static vamp_profile_t vamp_profiles[VAMP_MAX_DEVICES][VAMP_MAX_PROFILES];
+
+/* Entradas por status, antes de inicializar la tabla todas tienen status 0 */
+static uint8_t vamp_status_count[VAMP_DEV_STATUS_COUNT] = { VAMP_MAX_DEVICES };
+
 /* Fecha de la última actualización de la tabla en UTC */
 static char last_table_update[] = VAMP_TABLE_INIT_TSMP;
 
 /* Timestamp en millis de la última sincronización (para calcular tiempo transcurrido) */
 static uint32_t last_sync_millis = 0;
 
+/* Planificador de sincronización: intervalo actual y momento de la próxima (millis) */
+static uint32_t sync_interval = VAMP_SYNC_MIN_INTERVAL;
+static uint32_t next_sync_millis = 0;
+
+#ifdef VAMP_SYNC_LONGPOLL
+/* Consulta long-poll estacionada en el VREG, y cuándo reintentar tras un fallo */
+static bool longpoll_parked = false;
+static uint32_t longpoll_retry_millis = 0;
+#endif /* VAMP_SYNC_LONGPOLL */
+
+/* Programar la próxima sincronización a "interval" ms +/- VAMP_SYNC_JITTER_PCT */
+static void vamp_sync_schedule(uint32_t interval) {
+
+	if (interval < VAMP_SYNC_MIN_INTERVAL) {
+		interval = VAMP_SYNC_MIN_INTERVAL;
+	} else if (interval > VAMP_SYNC_MAX_INTERVAL) {
+		interval = VAMP_SYNC_MAX_INTERVAL;
+	}
+	sync_interval = interval;
+
+	int32_t jitter = (int32_t)(interval / 100 * VAMP_SYNC_JITTER_PCT);
+	if (jitter > 0) {
+		interval += random(-jitter, jitter + 1);
+	}
+
+	next_sync_millis = millis() + interval;
+
+	#ifdef VAMP_DEBUG
+	printf("[VAMP] next sync in %lu ms\n", (unsigned long)interval);
+	#endif /* VAMP_DEBUG */
+}
+
+/* Ajustar el intervalo según el resultado de la sincronización */
+static void vamp_sync_reschedule(bool ok) {
+
+	uint8_t changes = 0;
+
+	#ifdef ARDUINOJSON_AVAILABLE
+	/* El VREG sabe mejor cuándo habrá cambios */
+	if (ok && vamp_sync_next_hint() > 0) {
+		vamp_sync_schedule(vamp_sync_next_hint() * 1000);
+		return;
+	}
+	changes = vamp_sync_last_changes();
+	#endif /* ARDUINOJSON_AVAILABLE */
+
+	/* Con cambios se vuelve a mirar pronto, sin cambios o con error se espacia */
+	if (ok && changes > 0) {
+		vamp_sync_schedule(VAMP_SYNC_MIN_INTERVAL);
+	} else {
+		vamp_sync_schedule(sync_interval > VAMP_SYNC_MAX_INTERVAL / 2 ? VAMP_SYNC_MAX_INTERVAL : sync_interval * 2);
+	}
+}
+
+/* Ya toca sincronizar (la primera vez siempre) */
+bool vamp_table_sync_due(void) {
+	return !next_sync_millis || (int32_t)(millis() - next_sync_millis) >= 0;
+}
+
+/* Adelantar la próxima sincronización al mínimo, sin atrasarla si ya estaba más cerca */
+void vamp_table_sync_tighten(void) {
+	#ifdef VAMP_SYNC_LONGPOLL
+	/* Con la consulta estacionada el VREG avisará del alta él mismo */
+	if (longpoll_parked) {
+		return;
+	}
+	#endif /* VAMP_SYNC_LONGPOLL */
+	uint32_t remaining = next_sync_millis - millis();
+	if (next_sync_millis && (int32_t)remaining > (int32_t)VAMP_SYNC_MIN_INTERVAL) {
+		vamp_sync_schedule(VAMP_SYNC_MIN_INTERVAL);
+	}
+}
+
 /* Sincronizar la tabla VAMP con VREG */
 void vamp_table_update(vamp_profile_t * vreg_profile) {
 
@@ -42,7 +121,7 @@ void vamp_table_update(vamp_profile_t * vreg_profile) {
 
 		/* Inicializar la tabla VAMP */
 		for (int i = 0; i < VAMP_MAX_DEVICES; i++) {
-			vamp_table[i].status = VAMP_DEV_STATUS_FREE;
+			vamp_set_entry_status(&vamp_table[i], VAMP_DEV_STATUS_FREE);
 		}
 	}
 
@@ -55,7 +134,10 @@ void vamp_table_update(vamp_profile_t * vreg_profile) {
   printf("[VAMP] sync vreg\n");
   #endif /* VAMP_DEBUG */
 
-  if (vamp_iface_comm(vreg_profile, iface_buff, VAMP_IFACE_BUFF_SIZE)) {
+  bool ok = false;
+
+  iface_buff[0] = '\0';
+  if (vamp_iface_comm(vreg_profile, iface_buff, 0, VAMP_IFACE_BUFF_SIZE) > 0) {
 
 		/* Extraer los datos JSON de la respuesta */
 		#ifdef ARDUINOJSON_AVAILABLE
@@ -66,32 +148,99 @@ void vamp_table_update(vamp_profile_t * vreg_profile) {
 		printf("{MEM} ---- max block: %d B\n", ESP.getMaxFreeBlockSize());
     #endif /* VAMP_DEBUG */
 
-    if (vamp_process_sync_json_response(iface_buff)) {
+    ok = vamp_process_sync_json_response(iface_buff);
 
-      #ifdef VAMP_DEBUG
+    #ifdef VAMP_DEBUG
+    if (ok) {
 			printf("[VAMP] VREG Sync successful\n");
       printf("{MEM} memory status after table update\n");
       printf("{MEM} frag: %d%%\n", ESP.getHeapFragmentation());
       printf("{MEM} ---- max block: %d B\n", ESP.getMaxFreeBlockSize());
-
-      #endif /* VAMP_DEBUG */
-
-		}
-    #ifdef VAMP_DEBUG
-    else {
-      
+		} else {
 			printf("[VAMP] VREG Sync failed\n");
     }
     #endif /* VAMP_DEBUG */
 		#endif /* ARDUINOJSON_AVAILABLE */
-
-		return;
 	}
 
+	/* Programar la próxima según lo que pasó en esta */
+	vamp_sync_reschedule(ok);
+
 	return;
 
 }
 
+#ifdef VAMP_SYNC_LONGPOLL
+/* Atender la consulta long-poll, nunca bloquea esperando al VREG */
+bool vamp_table_longpoll(vamp_profile_t * vreg_profile) {
+
+	/* La carga inicial de la tabla la hace siempre la sincronización completa */
+	if (!vamp_is_table_initialized() || vreg_profile->endpoint_resource[0] == '\0') {
+		return false;
+	}
+
+	if (!longpoll_parked) {
+		if (longpoll_retry_millis && (int32_t)(millis() - longpoll_retry_millis) < 0) {
+			return false;
+		}
+
+		char wait[6];
+		snprintf(wait, sizeof(wait), "%u", (unsigned)VAMP_SYNC_LONGPOLL_WAIT);
+		vamp_kv_clear(&vreg_profile->query_params);
+		vamp_kv_set(&vreg_profile->query_params, "last_update", last_table_update);
+		vamp_kv_set(&vreg_profile->query_params, "wait", wait);
+
+		longpoll_parked = vamp_iface_longpoll_start(vreg_profile,
+				(uint32_t)VAMP_SYNC_LONGPOLL_WAIT * 1000 + VAMP_SYNC_LONGPOLL_GRACE);
+		if (!longpoll_parked) {
+			/* Mientras tanto sigue el planificador adaptativo */
+			longpoll_retry_millis = millis() + VAMP_SYNC_MIN_INTERVAL;
+		}
+		return false;
+	}
+
+	int16_t result = vamp_iface_longpoll_poll(iface_buff, VAMP_IFACE_BUFF_SIZE);
+	if (result == VAMP_LONGPOLL_PENDING) {
+		return false;
+	}
+
+	/* Se vuelve a estacionar en la próxima vuelta */
+	longpoll_parked = false;
+
+	if (result == VAMP_LONGPOLL_IDLE) {
+		return false;
+	}
+
+	if (result == VAMP_LONGPOLL_ERROR) {
+		#ifdef VAMP_DEBUG
+		printf("[VAMP] long-poll failed, back to scheduled sync\n");
+		#endif /* VAMP_DEBUG */
+		longpoll_retry_millis = millis() + VAMP_SYNC_MIN_INTERVAL;
+		return false;
+	}
+
+	bool ok = false;
+
+	#ifdef ARDUINOJSON_AVAILABLE
+	ok = vamp_process_sync_json_response(iface_buff);
+	#endif /* ARDUINOJSON_AVAILABLE */
+
+	#ifdef VAMP_DEBUG
+	printf("[VAMP] long-poll delta %s\n", ok ? "applied" : "rejected");
+	#endif /* VAMP_DEBUG */
+
+	if (ok) {
+		/* Los cambios llegan solos, la sincronización completa queda de respaldo */
+		vamp_sync_schedule(VAMP_SYNC_MAX_INTERVAL);
+	} else {
+		/* Delta inválido: que la próxima sincronización completa lo arregle pronto */
+		vamp_sync_schedule(VAMP_SYNC_MIN_INTERVAL);
+	}
+
+	return ok;
+}
+#endif /* VAMP_SYNC_LONGPOLL */
+
 /* Verificar si la tabla ha sido inicializada */
 bool vamp_is_table_initialized(void) {
     return strcmp(last_table_update, VAMP_TABLE_INIT_TSMP) != 0;
@@ -123,28 +272,44 @@ void vamp_set_last_sync_timestamp(const char * timestamp) {
 
 /* --------------------- Manejo de nodos (entradas) -------------------- */
 
+/* Cambiar el status de una entrada llevando la cuenta por status */
+void vamp_set_entry_status(vamp_entry_t * entry, uint8_t status) {
+    if (!entry || status >= VAMP_DEV_STATUS_COUNT) {
+        return;
+    }
+    if (entry->status < VAMP_DEV_STATUS_COUNT && vamp_status_count[entry->status] > 0) {
+        vamp_status_count[entry->status]--;
+    }
+    entry->status = status;
+    vamp_status_count[status]++;
+}
+
+/* Cantidad de entradas con status "status" */
+uint8_t vamp_get_status_count(uint8_t status) {
+    if (status >= VAMP_DEV_STATUS_COUNT) {
+        return 0;
+    }
+    return vamp_status_count[status];
+}
+
 /* Obtener la cantidad de dispositivos en la tabla */
 uint8_t vamp_get_dev_count(void) {
-    uint8_t count = 0;
-    for (uint8_t i = 0; i < VAMP_MAX_DEVICES; i++) {
-        if (vamp_table[i].status != VAMP_DEV_STATUS_FREE) {
-            count++;
-        }
-    }
-    return count;
+    return VAMP_MAX_DEVICES - vamp_status_count[VAMP_DEV_STATUS_FREE];
 }
 
 /**
  * @brief Devuelve el número de dispositivos activos (status == VAMP_DEV_STATUS_ACTIVE)
  */
 uint8_t vamp_get_active_dev_count(void) {
-    uint8_t count = 0;
-    for (uint8_t i = 0; i < VAMP_MAX_DEVICES; i++) {
-        if (vamp_table[i].status == VAMP_DEV_STATUS_ACTIVE) {
-            count++;
-        }
+    return vamp_status_count[VAMP_DEV_STATUS_ACTIVE];
+}
+
+/* Perfiles de la entrada "index" */
+vamp_profile_t * vamp_get_entry_profiles(uint8_t index) {
+    if (index >= VAMP_MAX_DEVICES) {
+        return NULL;
     }
-    return count;
+    return vamp_profiles[index];
 }
 
 /* Obtener entrada de la tabla apuntada por el índice "index" */
@@ -173,11 +338,13 @@ void vamp_clear_entry(int index) {
 		
 		// Limpiar contenido del buffer (NO liberar memoria pre-asignada)
 		if (vamp_table[index].data_buff) {
-			memset(vamp_table[index].data_buff, 0, VAMP_MAX_PAYLOAD_SIZE + 1);
+			memset(vamp_table[index].data_buff, 0, VAMP_RESPONSE_MAX_SIZE + 1);
 		}
+		vamp_table[index].data_len = 0;
+		vamp_table[index].data_lzss = false;
 		
     // Solo marcar como libre - otros campos se sobrescriben cuando se reasigna
-    vamp_table[index].status = VAMP_DEV_STATUS_FREE;
+    vamp_set_entry_status(&vamp_table[index], VAMP_DEV_STATUS_FREE);
   }
 }
 
@@ -220,19 +387,26 @@ uint8_t vamp_add_device(const uint8_t* rf_id) {
 		vamp_clear_entry(table_index);
 		memcpy(vamp_table[table_index].rf_id, rf_id, VAMP_ADDR_LEN);
 		vamp_table[table_index].wsn_id = vamp_generate_id_byte(table_index);
-		vamp_table[table_index].status = VAMP_DEV_STATUS_ADDED;
+		vamp_set_entry_status(&vamp_table[table_index], VAMP_DEV_STATUS_ADDED);
 		vamp_table[table_index].last_activity = millis();
 		vamp_table[table_index].ticket = 0;
+		vamp_table[table_index].data_len = 0;
+		vamp_table[table_index].data_lzss = false;
+		vamp_table[table_index].seq_top = 0;
+		vamp_table[table_index].seq_window = 0;
+		vamp_table[table_index].seq_rejoin = false;
 
 		/* Reservar memoria para el buffer de datos temporales. Estos datos se guardaran
 		como una cadena asi que se debe tener en cuenta el terminador nulo */
-		vamp_table[table_index].data_buff = (char * )malloc(VAMP_MAX_PAYLOAD_SIZE + 1);
+		if (!vamp_table[table_index].data_buff) {
+			vamp_table[table_index].data_buff = (char * )malloc(VAMP_RESPONSE_MAX_SIZE + 1);
+		}
 		if (!vamp_table[table_index].data_buff) {
 			#ifdef VAMP_DEBUG
 			printf("[TABLE] Error: No se pudo reservar memoria para data_buff\n");
 			#endif /* VAMP_DEBUG */
 			// Si falla la reserva, limpiar la entrada y retornar error
-			vamp_table[table_index].status = VAMP_DEV_STATUS_FREE;
+			vamp_set_entry_status(&vamp_table[table_index], VAMP_DEV_STATUS_FREE);
 			return VAMP_MAX_DEVICES;
 		}
 		
@@ -270,13 +444,18 @@ bool vamp_remove_device(const uint8_t* rf_id) {
 /* Buscar dispositivos expirados para marcarlos como inactivos */
 void vamp_detect_expired() {
   uint32_t current_time = millis();
+
+  /* Sin activos no hay nada que expirar */
+  if (vamp_status_count[VAMP_DEV_STATUS_ACTIVE] == 0) {
+    return;
+  }
   
   // Limpiar tabla unificada VAMP
   for (int i = 0; i < VAMP_MAX_DEVICES; i++) {
     if (vamp_table[i].status == VAMP_DEV_STATUS_ACTIVE) {
       // Verificar timeout de dispositivo (que pasa cuando se desborda el millis()?????)
       if (current_time - vamp_table[i].last_activity > VAMP_DEVICE_TIMEOUT) {
-        vamp_table[i].status = VAMP_DEV_STATUS_INACTIVE;
+        vamp_set_entry_status(&vamp_table[i], VAMP_DEV_STATUS_INACTIVE);
       }
     }
   }
@@ -294,6 +473,10 @@ uint8_t vamp_get_oldest_inactive(void){
 	uint32_t oldest_time = millis();
 	uint8_t oldest_index = VAMP_MAX_DEVICES; // Valor por defecto si no se encuentra
 
+	if (vamp_status_count[VAMP_DEV_STATUS_INACTIVE] == 0) {
+		return oldest_index;
+	}
+
 	for (uint8_t i = 0; i < VAMP_MAX_DEVICES; i++) {
 		if (vamp_table[i].status == VAMP_DEV_STATUS_INACTIVE) {
 			if (vamp_table[i].last_activity < oldest_time) {
@@ -322,7 +505,7 @@ const vamp_profile_t* vamp_get_device_profile(uint8_t device_index, uint8_t prof
         return NULL;
     }
     
-    return &vamp_table[device_index].profiles[profile_index];
+    return &vamp_profiles[device_index][profile_index];
 }
 
 /** @brief Configurar perfil específico de un dispositivo */
@@ -337,33 +520,33 @@ bool vamp_set_device_profile(uint8_t device_index, uint8_t profile_index, const
     }
     
     // Liberar recursos previos si existen
-    if (vamp_table[device_index].profiles[profile_index].endpoint_resource) {
-        free(vamp_table[device_index].profiles[profile_index].endpoint_resource);
-        vamp_table[device_index].profiles[profile_index].endpoint_resource = NULL;
+    if (vamp_profiles[device_index][profile_index].endpoint_resource) {
+        free(vamp_profiles[device_index][profile_index].endpoint_resource);
+        vamp_profiles[device_index][profile_index].endpoint_resource = NULL;
     }
     // Limpiar key-value stores
-    vamp_kv_clear(&vamp_table[device_index].profiles[profile_index].protocol_options);
-    vamp_kv_clear(&vamp_table[device_index].profiles[profile_index].query_params);
+    vamp_kv_clear(&vamp_profiles[device_index][profile_index].protocol_options);
+    vamp_kv_clear(&vamp_profiles[device_index][profile_index].query_params);
     
     // Configurar el nuevo perfil
-    //vamp_table[device_index].profiles[profile_index].protocol = profile->protocol;
-    vamp_table[device_index].profiles[profile_index].method = profile->method;
+    vamp_profiles[device_index][profile_index].protocol = profile->protocol;
+    vamp_profiles[device_index][profile_index].method = profile->method;
     
     // Copiar endpoint_resource si no es NULL
     if (profile->endpoint_resource) {
         size_t len = strlen(profile->endpoint_resource);
-        vamp_table[device_index].profiles[profile_index].endpoint_resource = (char*)malloc(len + 1);
-        if (vamp_table[device_index].profiles[profile_index].endpoint_resource) {
-            strcpy(vamp_table[device_index].profiles[profile_index].endpoint_resource, profile->endpoint_resource);
+        vamp_profiles[device_index][profile_index].endpoint_resource = (char*)malloc(len + 1);
+        if (vamp_profiles[device_index][profile_index].endpoint_resource) {
+            strcpy(vamp_profiles[device_index][profile_index].endpoint_resource, profile->endpoint_resource);
         }
     }
     
     // Copiar protocol_options - usar memcpy para copiar toda la estructura
-    memcpy(&vamp_table[device_index].profiles[profile_index].protocol_options, 
+    memcpy(&vamp_profiles[device_index][profile_index].protocol_options, 
            &profile->protocol_options, sizeof(vamp_key_value_store_t));
     
     // Copiar query_params - usar memcpy para copiar toda la estructura
-    memcpy(&vamp_table[device_index].profiles[profile_index].query_params, 
+    memcpy(&vamp_profiles[device_index][profile_index].query_params, 
            &profile->query_params, sizeof(vamp_key_value_store_t));
     
     // Actualizar profile_count si es necesario
@@ -382,7 +565,7 @@ void vamp_clear_device_profiles(uint8_t device_index) {
     
     // Liberar memoria de todos los perfiles
     for (uint8_t i = 0; i < VAMP_MAX_PROFILES; i++) {
-        vamp_clear_profile(&vamp_table[device_index].profiles[i]);
+        vamp_clear_profile(&vamp_profiles[device_index][i]);
     }
     
     vamp_table[device_index].profile_count = 0;
@@ -392,7 +575,9 @@ void vamp_clear_device_profiles(uint8_t device_index) {
 void vamp_clear_profile(vamp_profile_t* profile) {
     if (!profile) return;
     
-    // Liberar endpoint_resource si existe
+    // Liberar endpoint_resource si existe. Los canales persistentes no se cierran
+    // aqui: la sincronización libera y vuelve a crear los perfiles, y el
+    // transporte cierra en su poll lo que ya no usa ningún perfil
     if (profile->endpoint_resource) {
         free(profile->endpoint_resource);
         profile->endpoint_resource = NULL;
@@ -404,6 +589,7 @@ void vamp_clear_profile(vamp_profile_t* profile) {
     
     // Limpiar otros campos
     profile->method = 0;
+    profile->protocol = VAMP_PROTOCOL_NONE;
 }
 
 
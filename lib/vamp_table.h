@@ -29,6 +29,18 @@
 #define VAMP_NULL_ADDR 0x00, 0x00, 0x00, 0x00, 0x00
 #endif // VAMP_NULL_ADDR
 
+/** @brief Sub-direcciones de los pipes 2-5 del gateway (VAMP_WSN_SUBADDR). El nRF24
+ *  solo deja cambiar el primer byte respecto del pipe 1 (broadcast), asi que las
+ *  escuchan todos los gateways al alcance. El JOIN viaja sin ACK, como el
+ *  broadcast, y la alarma con ACK */
+#ifndef VAMP_ALARM_ADDR
+#define VAMP_ALARM_ADDR 0xFE, 0xFF, 0xFF, 0xFF, 0xFF
+#endif // VAMP_ALARM_ADDR
+
+#ifndef VAMP_JOIN_ADDR
+#define VAMP_JOIN_ADDR 0xFD, 0xFF, 0xFF, 0xFF, 0xFF
+#endif // VAMP_JOIN_ADDR
+
 /** @brief Longitud máxima del endpoint VAMP (en bytes) */
 #ifndef VAMP_ENDPOINT_MAX_LEN
 #define VAMP_ENDPOINT_MAX_LEN 128
@@ -57,6 +69,7 @@ se necesita, por lo tanto cuantos dispositivos utilizar */
 #define VAMP_DEV_STATUS_ADDED		0x04	// Recién agregado, y NO configurado
 #define VAMP_DEV_STATUS_CACHE		0x05	// En caché y configurado
 #define VAMP_DEV_STATUS_REQUEST		0x06	// Dispositivo que solicita unirse y aun no ha confirmado la unión
+#define VAMP_DEV_STATUS_COUNT		0x07	// Cantidad de valores de status (incluye el 0 sin inicializar)
 
 /** Perfil de comunicación VAMP
  * Este perfil se utiliza para definir la estructura de los mensajes que se reencaminan por
@@ -70,7 +83,7 @@ se necesita, por lo tanto cuantos dispositivos utilizar */
  * 						en que deberia estar organizado el mensaje que viene del dispositivo.
  */
 typedef struct vamp_profile_t {
-//	uint8_t protocol;							// Protocolo (HTTP, MQTT, CoAP, etc.)
+	uint8_t protocol;							// VAMP_PROTOCOL_*, resuelto del esquema del endpoint
 	uint8_t method;								// Método específico del protocolo
 	char * endpoint_resource;    				// URL/URI del endpoint sin esquema (dinámica)
 	vamp_key_value_store_t protocol_options;	// Opciones específicas del protocolo (key-value)
@@ -105,17 +118,28 @@ typedef struct vamp_profile_t {
  * nRF24 no exponen su dirección RF al receptor y enviarla en el payload es demasiado costoso.
  * En este caso con el número de verificación (3 bits) + índice (5 bit) se puede identificar 
  * el dispositivo con solo un byte de ID compacto.
+ *
+ * La entrada solo guarda los campos que se consultan en cada trama y en los recorridos
+ * de la tabla (conteos, expiración, búsqueda por RF_ID). Los perfiles, que ocupan
+ * cientos de bytes y solo se usan al reencaminar, van en un almacén aparte con el mismo
+ * índice, accesible con vamp_get_entry_profiles(). Asi los recorridos pasan por un
+ * arreglo denso de unas pocas decenas de bytes por dispositivo.
+ * El status se cambia siempre con vamp_set_entry_status() para mantener los conteos.
  */
 typedef struct {
 	uint8_t wsn_id;                                 // ID en la forma [VVV][IIIII]
-	uint8_t status;                                 // Estado: 
+	uint8_t status;                                 // Estado (solo lectura, ver vamp_set_entry_status())
 	uint8_t type;                                   // Tipo: 0=fijo, 1=dínamico, 2=auto, 3=huérfano
 	uint8_t rf_id[VAMP_ADDR_LEN];                   // RF_ID del dispositivo (5 bytes)
 	uint32_t last_activity;                         // Timestamp de última actividad en millis()
 	uint8_t profile_count;                         	// Número de perfiles configurados (1-4)
-	vamp_profile_t profiles[VAMP_MAX_PROFILES];  	// Array de perfiles de comunicación
 	char * data_buff;     							// Buffer para datos
+	uint16_t data_len;                             	// Bytes de la respuesta en data_buff (puede ser binaria)
+	bool data_lzss;                               	// data_buff está comprimido (VAMP_POLL_PAGING)
 	uint16_t ticket;                              	// Ticket de comunicación
+	uint8_t seq_top;                              	// Secuencia más alta recibida (VAMP_DATA_SEQ)
+	uint32_t seq_window;                          	// Secuencias vistas hacia atrás desde seq_top, bit 0 = seq_top
+	bool seq_rejoin;                              	// Hubo un JOIN_REQ desde la última trama de datos
 	//uint32_t join_time;                          	// Timestamp de cuando se unió
 } vamp_entry_t;
 
@@ -135,6 +159,26 @@ uint32_t vamp_get_last_sync_millis(void);
 /** @brief Establecer el timestamp de la última sincronización */
 void vamp_set_last_sync_timestamp(const char * timestamp);
 
+/** @brief Verificar si ya toca sincronizar con el VREG según el planificador
+ *  @note El intervalo se adapta: se duplica mientras el VREG no reporte cambios
+ *  (o falle), vuelve al mínimo tras cambios y respeta el "next_sync" del VREG,
+ *  siempre entre VAMP_SYNC_MIN_INTERVAL y VAMP_SYNC_MAX_INTERVAL y con jitter
+ */
+bool vamp_table_sync_due(void);
+
+/** @brief Adelantar la próxima sincronización al intervalo mínimo
+ *  (p.ej. cuando un nodo desconocido pide unirse) */
+void vamp_table_sync_tighten(void);
+
+#ifdef VAMP_SYNC_LONGPOLL
+/** @brief Mantener estacionada una consulta long-poll en el VREG y aplicar el
+ *  delta cuando responda. Llamar en cada vuelta del lazo, nunca bloquea salvo al
+ *  abrir la conexión
+ *  @return true si se aplicó un delta
+ */
+bool vamp_table_longpoll(vamp_profile_t * vreg_profile);
+#endif /* VAMP_SYNC_LONGPOLL */
+
 /* --------------------- Manejo de nodos (entradas) -------------------- */
 
 /** @brief Obtener la cantidad de dispositivos en la tabla 
@@ -147,6 +191,24 @@ uint8_t vamp_get_dev_count(void);
  */
 uint8_t vamp_get_active_dev_count(void);
 
+/** @brief Cantidad de dispositivos con un status dado, O(1)
+ *  @param status Uno de los VAMP_DEV_STATUS_*
+ */
+uint8_t vamp_get_status_count(uint8_t status);
+
+/** @brief Cambiar el status de una entrada manteniendo los conteos por status
+ *  @param entry Entrada de la tabla
+ *  @param status Nuevo status (VAMP_DEV_STATUS_*)
+ */
+void vamp_set_entry_status(vamp_entry_t * entry, uint8_t status);
+
+/** @brief Obtener los perfiles (VAMP_MAX_PROFILES) de una entrada
+ *  @param index Índice de la entrada en la tabla
+ *  @return Puntero al primer perfil o NULL si el índice no es válido
+ *  @note Los perfiles válidos son los primeros entry->profile_count
+ */
+vamp_profile_t * vamp_get_entry_profiles(uint8_t index);
+
 /** @brief Obtener entrada de la tabla por índice 
  *  @param index Índice de la entrada en la tabla
  *  @return Puntero a la entrada de la tabla o NULL si no existe
@@ -225,6 +287,10 @@ void vamp_clear_profile(vamp_profile_t* profile);
 /** @brief Macro para verificar si una dirección es broadcast */
 #define VAMP_IS_BROADCAST_ADDR(addr) ((addr)[0] == 0xFF && (addr)[1] == 0xFF && (addr)[2] == 0xFF && (addr)[3] == 0xFF && (addr)[4] == 0xFF)
 
+/** @brief Macro para verificar si una dirección es el broadcast o una de sus
+ *  sub-direcciones (pipes 2-5), compartidas por todos los gateways */
+#define VAMP_IS_MULTICAST_ADDR(addr) ((addr)[1] == 0xFF && (addr)[2] == 0xFF && (addr)[3] == 0xFF && (addr)[4] == 0xFF)
+
 
 /* --------------------- Funciones auxiliares --------------------- */
 
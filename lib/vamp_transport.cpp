@@ -0,0 +1,100 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_transport.h"
+
+#include <string.h>
+
+typedef struct {
+	const char * scheme;
+	uint8_t protocol;
+} vamp_scheme_t;
+
+/* Esquemas conocidos, las variantes con TLS que comparten transporte van juntas */
+static const vamp_scheme_t vamp_schemes[] = {
+	{ "http",	VAMP_PROTOCOL_HTTP },
+	{ "https",	VAMP_PROTOCOL_HTTPS },
+	{ "mqtt",	VAMP_PROTOCOL_MQTT },
+	{ "mqtts",	VAMP_PROTOCOL_MQTT },
+	{ "coap",	VAMP_PROTOCOL_COAP },
+	{ "ws",		VAMP_PROTOCOL_WEBSOCKET },
+	{ "wss",	VAMP_PROTOCOL_WEBSOCKET },
+};
+
+#define VAMP_SCHEME_COUNT (sizeof(vamp_schemes) / sizeof(vamp_schemes[0]))
+
+static const vamp_transport_t * vamp_transports[VAMP_PROTOCOL_COUNT];
+
+uint8_t vamp_transport_resolve(const char * endpoint) {
+
+	if (!endpoint) {
+		return VAMP_PROTOCOL_NONE;
+	}
+
+	const char * sep = strstr(endpoint, "://");
+	if (!sep) {
+		return VAMP_PROTOCOL_NONE;
+	}
+	size_t len = (size_t)(sep - endpoint);
+
+	for (size_t i = 0; i < VAMP_SCHEME_COUNT; i++) {
+		if (strlen(vamp_schemes[i].scheme) != len) {
+			continue;
+		}
+		size_t j = 0;
+		while (j < len) {
+			char c = endpoint[j];
+			if (c >= 'A' && c <= 'Z') {
+				c = (char)(c - 'A' + 'a');
+			}
+			if (c != vamp_schemes[i].scheme[j]) {
+				break;
+			}
+			j++;
+		}
+		if (j == len) {
+			return vamp_schemes[i].protocol;
+		}
+	}
+
+	return VAMP_PROTOCOL_NONE;
+}
+
+bool vamp_transport_register(uint8_t protocol, const vamp_transport_t * transport) {
+	if (protocol >= VAMP_PROTOCOL_COUNT || !transport || !transport->send) {
+		return false;
+	}
+	vamp_transports[protocol] = transport;
+	return true;
+}
+
+const vamp_transport_t * vamp_transport_get(uint8_t protocol) {
+	if (protocol >= VAMP_PROTOCOL_COUNT) {
+		return NULL;
+	}
+	return vamp_transports[protocol];
+}
+
+void vamp_transport_poll_all(void) {
+
+	for (uint8_t i = 0; i < VAMP_PROTOCOL_COUNT; i++) {
+		const vamp_transport_t * transport = vamp_transports[i];
+		if (!transport || !transport->poll) {
+			continue;
+		}
+
+		/* HTTP y HTTPS pueden compartir transporte */
+		bool seen = false;
+		for (uint8_t j = 0; j < i; j++) {
+			if (vamp_transports[j] == transport) {
+				seen = true;
+				break;
+			}
+		}
+		if (!seen) {
+			transport->poll();
+		}
+	}
+}
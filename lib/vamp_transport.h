@@ -0,0 +1,62 @@
+/**
+ * @file vamp_transport.h
+ * @brief Registro de transportes por esquema de URL
+ *
+ * Cada perfil guarda en "protocol" el transporte que le corresponde según el
+ * esquema de su endpoint, resuelto una sola vez al configurar el perfil. Cada
+ * arquitectura registra al iniciar solo los transportes que compila (HTTP/HTTPS,
+ * MQTT, CoAP, WebSocket en el ESP8266; un build de host registraría uno sobre
+ * sockets POSIX), y vamp_iface_comm() despacha por ese índice.
+ *
+ * No depende de Arduino.
+ */
+
+#ifndef _VAMP_TRANSPORT_H_
+#define _VAMP_TRANSPORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Protocolos soportados, índice del registro */
+#define VAMP_PROTOCOL_HTTP    0
+#define VAMP_PROTOCOL_HTTPS   1
+#define VAMP_PROTOCOL_MQTT    2
+#define VAMP_PROTOCOL_COAP    3
+#define VAMP_PROTOCOL_WEBSOCKET 4
+//#define VAMP_PROTOCOL_CUSTOM  15    // Para protocolos definidos por usuario
+#define VAMP_PROTOCOL_COUNT   5
+#define VAMP_PROTOCOL_NONE    0xFF    // Esquema desconocido o sin endpoint
+
+struct vamp_profile_t;
+
+/** @brief Operaciones de un transporte, las que no necesita pueden ser NULL
+ *  (salvo send) */
+typedef struct {
+	/** Preparar la conexión o sesión del perfil (p.ej. el canal persistente) */
+	bool (*open)(const struct vamp_profile_t * profile);
+	/** Enviar los len bytes de data, size es el tamaño del buffer. Un transporte
+	 *  de request/respuesta puede dejar la respuesta en data (hasta size - 1 bytes) */
+	bool (*send)(const struct vamp_profile_t * profile, char * data, size_t len, size_t size);
+	/** Largo de la respuesta al último send que está en data, 0 si no hay */
+	size_t (*receive)(const struct vamp_profile_t * profile, char * data, size_t size);
+	/** Mantenimiento sin bloquear: acks, keepalive, reconexión. También cierra
+	 *  lo que ya no use ningún perfil (los perfiles se liberan y se vuelven a
+	 *  crear en cada sincronización) */
+	void (*poll)(void);
+} vamp_transport_t;
+
+/** @brief Protocolo de un endpoint según su esquema ("http://", "mqtts://"...)
+ *  @return VAMP_PROTOCOL_*, o VAMP_PROTOCOL_NONE si no se conoce
+ */
+uint8_t vamp_transport_resolve(const char * endpoint);
+
+/** @brief Registrar el transporte de un protocolo (reemplaza al anterior) */
+bool vamp_transport_register(uint8_t protocol, const vamp_transport_t * transport);
+
+/** @brief Transporte registrado para el protocolo, NULL si no hay */
+const vamp_transport_t * vamp_transport_get(uint8_t protocol);
+
+/** @brief Llamar el poll de todos los transportes registrados (una vez cada uno) */
+void vamp_transport_poll_all(void);
+
+#endif /* _VAMP_TRANSPORT_H_ */
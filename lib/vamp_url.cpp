@@ -0,0 +1,95 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_url.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+typedef struct {
+	const char * scheme;
+	uint16_t port;
+	bool secure;
+} vamp_url_scheme_t;
+
+static const vamp_url_scheme_t vamp_url_schemes[] = {
+	{ "http",	80,		false },
+	{ "https",	443,	true },
+	{ "mqtt",	1883,	false },
+	{ "mqtts",	8883,	true },
+	{ "coap",	5683,	false },
+	{ "coaps",	5684,	true },
+	{ "ws",		80,		false },
+	{ "wss",	443,	true },
+};
+
+#define VAMP_URL_SCHEME_COUNT (sizeof(vamp_url_schemes) / sizeof(vamp_url_schemes[0]))
+
+static const vamp_url_scheme_t * vamp_url_find_scheme(const char * scheme) {
+	for (size_t i = 0; i < VAMP_URL_SCHEME_COUNT; i++) {
+		if (strcmp(vamp_url_schemes[i].scheme, scheme) == 0) {
+			return &vamp_url_schemes[i];
+		}
+	}
+	return NULL;
+}
+
+uint16_t vamp_url_default_port(const char * scheme) {
+	const vamp_url_scheme_t * known = scheme ? vamp_url_find_scheme(scheme) : NULL;
+	return known ? known->port : 0;
+}
+
+bool vamp_url_parse(const char * url, vamp_url_t * url_out) {
+
+	if (!url || !url_out) {
+		return false;
+	}
+	memset(url_out, 0, sizeof(vamp_url_t));
+
+	/* Esquema */
+	const char * sep = strstr(url, "://");
+	if (!sep || sep == url || (size_t)(sep - url) >= VAMP_URL_SCHEME_MAX_LEN) {
+		return false;
+	}
+	for (size_t i = 0; i < (size_t)(sep - url); i++) {
+		char c = url[i];
+		url_out->scheme[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+	}
+
+	/* Host, termina en ':' (puerto), '/' (ruta), '?' o fin */
+	const char * host = sep + 3;
+	size_t host_len = strcspn(host, ":/?");
+	if (host_len == 0 || host_len >= VAMP_URL_HOST_MAX_LEN) {
+		return false;
+	}
+	memcpy(url_out->host, host, host_len);
+	url_out->host[host_len] = '\0';
+
+	const char * rest = host + host_len;
+
+	/* Puerto */
+	const vamp_url_scheme_t * known = vamp_url_find_scheme(url_out->scheme);
+	url_out->port = known ? known->port : 0;
+	url_out->secure = known ? known->secure : false;
+
+	if (*rest == ':') {
+		char * end = NULL;
+		long port = strtol(rest + 1, &end, 10);
+		if (end == rest + 1 || port <= 0 || port > 65535 || (*end && *end != '/' && *end != '?')) {
+			return false;
+		}
+		url_out->port = (uint16_t)port;
+		rest = end;
+	}
+
+	if (url_out->port == 0) {
+		return false;
+	}
+
+	/* Ruta */
+	url_out->path = (*rest == '\0') ? "/" : rest;
+
+	return true;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file vamp_url.h
+ * @brief Descomponer los URL de los perfiles (esquema://host[:puerto][/ruta])
+ *
+ * Los transportes que no usan HTTPClient (long-poll, MQTT, CoAP, WebSocket)
+ * necesitan el host, el puerto y la ruta por separado. El puerto por defecto
+ * se toma del esquema cuando el URL no lo trae.
+ *
+ * Prueba en el host: test/test_url.cpp
+ */
+
+#ifndef _VAMP_URL_H_
+#define _VAMP_URL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Largo máximo del esquema ("https", "mqtts"...) */
+#define VAMP_URL_SCHEME_MAX_LEN 8
+
+/** @brief Largo máximo del host */
+#ifndef VAMP_URL_HOST_MAX_LEN
+#define VAMP_URL_HOST_MAX_LEN 64
+#endif // VAMP_URL_HOST_MAX_LEN
+
+typedef struct {
+	char scheme[VAMP_URL_SCHEME_MAX_LEN];	// Esquema en minúsculas, sin "://"
+	char host[VAMP_URL_HOST_MAX_LEN];		// Host o IP
+	uint16_t port;							// Puerto explícito o el del esquema
+	const char * path;						// Ruta (con query) dentro del URL original, "/" si no hay
+	bool secure;							// Esquema con TLS (https, mqtts, coaps, wss)
+} vamp_url_t;
+
+/** @brief Descomponer un URL
+ *  @param url URL completo, debe seguir vivo mientras se use url_out->path
+ *  @param url_out Resultado
+ *  @return false si el URL no tiene esquema, host, o el puerto no es válido
+ */
+bool vamp_url_parse(const char * url, vamp_url_t * url_out);
+
+/** @brief Puerto por defecto de un esquema conocido, 0 si no se conoce */
+uint16_t vamp_url_default_port(const char * scheme);
+
+#endif /* _VAMP_URL_H_ */
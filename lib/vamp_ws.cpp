@@ -0,0 +1,192 @@
+/**
+ *
+ *
+ */
+
+#include "vamp_ws.h"
+
+#include <string.h>
+
+/* Estados del lector */
+#define VAMP_WS_ST_HEADER	0
+#define VAMP_WS_ST_LEN		1
+#define VAMP_WS_ST_EXT_LEN	2
+#define VAMP_WS_ST_MASK		3
+#define VAMP_WS_ST_PAYLOAD	4
+
+size_t vamp_ws_frame(uint8_t * buf, size_t size, uint8_t opcode, const uint8_t * payload,
+		size_t len, const uint8_t * mask_key) {
+
+	if (!buf || !mask_key || (len && !payload) || len > 0xFFFF) {
+		return 0;
+	}
+
+	size_t header_len = 2 + (len > 125 ? 2 : 0) + 4;
+	if (header_len + len > size) {
+		return 0;
+	}
+
+	size_t n = 0;
+	buf[n++] = 0x80 | (opcode & 0x0F);
+	if (len > 125) {
+		buf[n++] = 0x80 | 126;
+		buf[n++] = (uint8_t)(len >> 8);
+		buf[n++] = (uint8_t)(len & 0xFF);
+	} else {
+		buf[n++] = 0x80 | (uint8_t)len;
+	}
+	memcpy(buf + n, mask_key, 4);
+	n += 4;
+
+	for (size_t i = 0; i < len; i++) {
+		buf[n++] = payload[i] ^ mask_key[i & 0x03];
+	}
+
+	return n;
+}
+
+void vamp_ws_reader_reset(vamp_ws_reader_t * reader) {
+	if (reader) {
+		memset(reader, 0, sizeof(vamp_ws_reader_t));
+	}
+}
+
+/* Fin de la trama actual: una trama de control, o un mensaje completo si era FIN */
+static int8_t vamp_ws_frame_end(vamp_ws_reader_t * reader) {
+	reader->state = VAMP_WS_ST_HEADER;
+	if (reader->in_control) {
+		reader->control[reader->control_len] = '\0';
+		return VAMP_WS_RX_CONTROL;
+	}
+	if (!(reader->header & 0x80)) {
+		return 0;	// Faltan tramas de continuación
+	}
+	reader->data[reader->len] = '\0';
+	return VAMP_WS_RX_MESSAGE;
+}
+
+/* Después del largo: máscara, payload o fin si la trama va vacía */
+static int8_t vamp_ws_after_len(vamp_ws_reader_t * reader) {
+	if (reader->masked) {
+		reader->state = VAMP_WS_ST_MASK;
+		reader->mask_pos = 0;
+		return 0;
+	}
+	if (reader->remaining == 0) {
+		return vamp_ws_frame_end(reader);
+	}
+	reader->state = VAMP_WS_ST_PAYLOAD;
+	return 0;
+}
+
+int8_t vamp_ws_reader_feed(vamp_ws_reader_t * reader, uint8_t byte) {
+
+	switch (reader->state) {
+
+		case VAMP_WS_ST_HEADER: {
+			uint8_t opcode = byte & 0x0F;
+			reader->header = byte;
+			reader->in_control = (opcode & VAMP_WS_OP_CONTROL) != 0;
+			/* Una de control no toca el mensaje que se esté armando, una de datos
+			nueva lo empieza y la de continuación lo sigue */
+			if (reader->in_control) {
+				if (!(byte & 0x80)) {
+					vamp_ws_reader_reset(reader);
+					return -1;	// Las de control no se fragmentan
+				}
+				reader->control_opcode = opcode;
+				reader->control_len = 0;
+			} else if (opcode != VAMP_WS_OP_CONT) {
+				reader->opcode = opcode;
+				reader->len = 0;
+				reader->truncated = false;
+			}
+			reader->state = VAMP_WS_ST_LEN;
+			return 0;
+		}
+
+		case VAMP_WS_ST_LEN:
+			reader->masked = (byte & 0x80) != 0;
+			reader->remaining = byte & 0x7F;
+			if (reader->remaining == 126 || reader->remaining == 127) {
+				if (reader->in_control) {
+					vamp_ws_reader_reset(reader);
+					return -1;	// Las de control llevan a lo sumo 125 bytes
+				}
+				reader->len_bytes = (reader->remaining == 126) ? 2 : 8;
+				reader->remaining = 0;
+				reader->state = VAMP_WS_ST_EXT_LEN;
+				return 0;
+			}
+			return vamp_ws_after_len(reader);
+
+		case VAMP_WS_ST_EXT_LEN:
+			/* Un mensaje de más de 4 GB no tiene sentido aqui */
+			if (reader->len_bytes > 4 && byte != 0) {
+				vamp_ws_reader_reset(reader);
+				return -1;
+			}
+			reader->remaining = (reader->remaining << 8) | byte;
+			if (--reader->len_bytes > 0) {
+				return 0;
+			}
+			return vamp_ws_after_len(reader);
+
+		case VAMP_WS_ST_MASK:
+			reader->mask[reader->mask_pos++] = byte;
+			if (reader->mask_pos < 4) {
+				return 0;
+			}
+			reader->mask_pos = 0;
+			if (reader->remaining == 0) {
+				return vamp_ws_frame_end(reader);
+			}
+			reader->state = VAMP_WS_ST_PAYLOAD;
+			return 0;
+
+		case VAMP_WS_ST_PAYLOAD:
+			if (reader->masked) {
+				byte ^= reader->mask[reader->mask_pos++ & 0x03];
+			}
+			if (reader->in_control) {
+				reader->control[reader->control_len++] = byte;
+			} else if (reader->len < VAMP_WS_RX_MAX) {
+				reader->data[reader->len++] = byte;
+			} else {
+				reader->truncated = true;
+			}
+			if (--reader->remaining > 0) {
+				return 0;
+			}
+			return vamp_ws_frame_end(reader);
+
+		default:
+			vamp_ws_reader_reset(reader);
+			return -1;
+	}
+}
+
+size_t vamp_ws_base64(const uint8_t * data, size_t len, char * out, size_t out_size) {
+
+	static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	size_t need = ((len + 2) / 3) * 4;
+	if (!data || !out || need + 1 > out_size) {
+		return 0;
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < len; i += 3) {
+		uint32_t chunk = (uint32_t)data[i] << 16;
+		if (i + 1 < len) chunk |= (uint32_t)data[i + 1] << 8;
+		if (i + 2 < len) chunk |= data[i + 2];
+
+		out[n++] = table[(chunk >> 18) & 0x3F];
+		out[n++] = table[(chunk >> 12) & 0x3F];
+		out[n++] = (i + 1 < len) ? table[(chunk >> 6) & 0x3F] : '=';
+		out[n++] = (i + 2 < len) ? table[chunk & 0x3F] : '=';
+	}
+	out[n] = '\0';
+
+	return n;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file vamp_ws.h
+ * @brief Tramas WebSocket (RFC 6455) para el transporte ws://
+ *
+ * El gateway es cliente: sus tramas van siempre enmascaradas y las del servidor
+ * llegan sin máscara. El lector arma los mensajes byte a byte (juntando las
+ * tramas de continuación) para no bloquear esperando el resto. Las tramas de
+ * control (PING, PONG, CLOSE) pueden llegar entre dos tramas de un mensaje
+ * fragmentado y se guardan aparte, sin tocar el mensaje a medio armar.
+ *
+ * Prueba en el host: test/test_ws.cpp
+ */
+
+#ifndef _VAMP_WS_H_
+#define _VAMP_WS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VAMP_WS_OP_CONT		0x0
+#define VAMP_WS_OP_TEXT		0x1
+#define VAMP_WS_OP_BINARY	0x2
+#define VAMP_WS_OP_CLOSE	0x8
+#define VAMP_WS_OP_PING		0x9
+#define VAMP_WS_OP_PONG		0xA
+
+#define VAMP_WS_OP_CONTROL	0x8		// Bit de las tramas de control
+
+/** @brief Payload máximo de una trama de control (RFC 6455 5.5) */
+#define VAMP_WS_CONTROL_MAX	125
+
+/* Resultado de vamp_ws_reader_feed() */
+#define VAMP_WS_RX_MESSAGE	1		// Mensaje de datos completo en opcode/data/len
+#define VAMP_WS_RX_CONTROL	2		// Trama de control completa en control_*
+
+/** @brief Mensaje más largo que se acepta del servidor, el resto se descarta */
+#ifndef VAMP_WS_RX_MAX
+#define VAMP_WS_RX_MAX 256
+#endif // VAMP_WS_RX_MAX
+
+/** @brief Lector incremental de mensajes del servidor */
+typedef struct {
+	uint8_t state;					// Parte de la trama que se está leyendo
+	uint8_t header;					// FIN + opcode de la trama actual
+	bool in_control;				// La trama actual es de control
+	uint8_t opcode;					// Opcode del mensaje (el de la primera trama)
+	uint8_t len_bytes;				// Bytes de largo extendido por leer
+	bool masked;
+	uint8_t mask[4];
+	uint8_t mask_pos;
+	uint32_t remaining;				// Bytes de payload por leer de la trama actual
+	uint16_t len;					// Bytes del mensaje en data
+	bool truncated;					// El mensaje no cabía en data
+	uint8_t data[VAMP_WS_RX_MAX + 1];
+	uint8_t control_opcode;			// Opcode de la última trama de control
+	uint8_t control_len;
+	uint8_t control[VAMP_WS_CONTROL_MAX + 1];
+} vamp_ws_reader_t;
+
+/** @brief Armar una trama de cliente (enmascarada, FIN)
+ *  @param mask_key 4 bytes aleatorios
+ *  @return Largo de la trama, 0 si no cabe en buf
+ */
+size_t vamp_ws_frame(uint8_t * buf, size_t size, uint8_t opcode, const uint8_t * payload,
+		size_t len, const uint8_t * mask_key);
+
+/** @brief Reiniciar el lector (nueva conexión) */
+void vamp_ws_reader_reset(vamp_ws_reader_t * reader);
+
+/** @brief Pasar un byte recibido al lector
+ *  @return VAMP_WS_RX_MESSAGE si completó un mensaje (opcode/data/len),
+ *          VAMP_WS_RX_CONTROL si completó una trama de control
+ *          (control_opcode/control/control_len), 0 si falta, -1 si la trama es inválida
+ */
+int8_t vamp_ws_reader_feed(vamp_ws_reader_t * reader, uint8_t byte);
+
+/** @brief Base64 de len bytes (para Sec-WebSocket-Key)
+ *  @return Largo del texto, 0 si no cabe en out
+ */
+size_t vamp_ws_base64(const uint8_t * data, size_t len, char * out, size_t out_size);
+
+#endif /* _VAMP_WS_H_ */
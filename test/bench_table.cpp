@@ -0,0 +1,117 @@
+/**
+ * @file bench_table.cpp
+ * @brief Recorridos de la tabla de dispositivos con las funciones reales de
+ * lib/vamp_table.cpp: vamp_get_active_dev_count(), vamp_detect_expired() y
+ * vamp_find_device()
+ *
+ * run_host.sh la compila con VAMP_MAX_DEVICES = 32, el máximo que permite el
+ * índice de 5 bits del ID compacto.
+ * La tabla se llena con vamp_add_device() hasta VAMP_MAX_DEVICES, un cuarto de
+ * las entradas activas y ninguna vencida, asi que vamp_detect_expired() recorre
+ * sin cambiar nada. Para comparar con otro diseño de la tabla se compila este
+ * mismo archivo contra esa versión de lib/vamp_table.cpp.
+ *
+ * Uso: sh test/run_host.sh bench_table
+ */
+
+#include "lib/vamp_table.h"
+#include "vamp_gw.h"
+
+#include <chrono>
+
+/* Lo que lib/vamp_table.cpp toma del core y del resto del gateway. La
+sincronización con el VREG no se usa */
+static uint32_t now_ms = 100000;
+
+uint32_t millis(void) {
+	return now_ms;
+}
+
+long random(long howsmall, long howbig) {
+	(void)howbig;
+	return howsmall;
+}
+
+char iface_buff[VAMP_IFACE_BUFF_SIZE];
+
+size_t vamp_iface_comm(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
+	(void)profile; (void)data; (void)len; (void)size;
+	return 0;
+}
+
+bool vamp_is_rf_id_valid(const uint8_t * rf_id) {
+	return rf_id != NULL;
+}
+
+static volatile uint32_t sink;
+
+template <typename F>
+static double ns_per_call(F fn, uint32_t rounds) {
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t r = 0; r < rounds; r++) {
+		sink += fn();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+}
+
+/* Mezcla fija de estados, un cuarto activos */
+static uint8_t status_of(uint8_t i) {
+	static const uint8_t mix[] = {
+		VAMP_DEV_STATUS_ACTIVE, VAMP_DEV_STATUS_INACTIVE, VAMP_DEV_STATUS_CACHE, VAMP_DEV_STATUS_REQUEST
+	};
+	return mix[(i * 7) % 4];
+}
+
+int main(void) {
+
+	uint8_t rf_id[VAMP_ADDR_LEN] = { 0x10, 0x20, 0x30, 0x00, 0x00 };
+	uint8_t last[VAMP_ADDR_LEN];
+	const uint8_t missing[VAMP_ADDR_LEN] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE };
+
+	/* La primera sincronización deja todas las entradas libres, el VREG no responde */
+	vamp_profile_t vreg;
+	memset(&vreg, 0, sizeof(vreg));
+	vreg.endpoint_resource = (char *)"http://vreg.local/sync";
+	vamp_table_update(&vreg);
+
+	for (uint8_t i = 0; i < VAMP_MAX_DEVICES; i++) {
+		rf_id[4] = i;
+		uint8_t index = vamp_add_device(rf_id);
+		vamp_entry_t * entry = vamp_get_table_entry(index);
+		if (!entry) {
+			printf("no se pudo agregar el dispositivo %u\n", i);
+			return 1;
+		}
+		vamp_set_entry_status(entry, status_of(i));
+		memcpy(last, rf_id, VAMP_ADDR_LEN);
+	}
+
+	const uint32_t rounds = 2000000;
+
+	double count = ns_per_call([]() {
+		return (uint32_t)vamp_get_active_dev_count();
+	}, rounds);
+	double expire = ns_per_call([]() {
+		vamp_detect_expired();
+		return (uint32_t)0;
+	}, rounds);
+	double find_last = ns_per_call([&]() {
+		return (uint32_t)vamp_find_device(last);
+	}, rounds);
+	double find_missing = ns_per_call([&]() {
+		return (uint32_t)vamp_find_device(missing);
+	}, rounds);
+
+	if (vamp_get_active_dev_count() != (VAMP_MAX_DEVICES + 3) / 4) {
+		printf("vamp_detect_expired() venció entradas activas\n");
+		return 1;
+	}
+
+	printf("%u entradas de %zu B\n", VAMP_MAX_DEVICES, sizeof(vamp_entry_t));
+	printf("  vamp_get_active_dev_count()      %8.1f ns\n", count);
+	printf("  vamp_detect_expired()            %8.1f ns\n", expire);
+	printf("  vamp_find_device() la última     %8.1f ns\n", find_last);
+	printf("  vamp_find_device() sin estar     %8.1f ns\n", find_missing);
+	return 0;
+}
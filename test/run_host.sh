@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compilar y correr en el host las pruebas de las bibliotecas portables (lib/).
+# Uso, desde la raíz del repositorio:  sh test/run_host.sh [prueba...]
+# Los benchmarks (bench_*.cpp) solo corren si se nombran.
+set -e
+cd "$(dirname "$0")/.."
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--std=gnu++17 -O2 -Wall -Wextra -I.}
+OUT=test/build
+mkdir -p "$OUT"
+
+# Cada prueba con las fuentes de lib/ (y flags) que necesita
+sources() {
+	case "$1" in
+		test_spsc)		echo "" ;;
+		test_mqtt)		echo "lib/vamp_mqtt.cpp" ;;
+		test_coap)		echo "lib/vamp_coap.cpp" ;;
+		test_ws)		echo "lib/vamp_ws.cpp" ;;
+		test_coalesce)	echo "lib/vamp_coalesce.cpp" ;;
+		test_jsel)		echo "lib/vamp_jsel.cpp" ;;
+		test_lzss)		echo "lib/vamp_lzss.cpp" ;;
+		test_bloom)		echo "lib/vamp_bloom.cpp" ;;
+		test_breaker)	echo "lib/vamp_breaker.cpp" ;;
+		test_url)		echo "lib/vamp_url.cpp" ;;
+		test_http)		echo "lib/vamp_http.cpp" ;;
+		test_prefetch)	echo "lib/vamp_prefetch.cpp" ;;
+		bench_table)	echo "-DVAMP_MAX_DEVICES=32 -Itest/stubs lib/vamp_table.cpp lib/vamp_kv.cpp" ;;
+	esac
+}
+
+tests=${*:-$(cd test && ls test_*.cpp | sed 's/\.cpp$//')}
+failed=0
+for t in $tests; do
+	echo "== $t"
+	$CXX $CXXFLAGS -o "$OUT/$t" "test/$t.cpp" $(sources "$t") -lpthread
+	"$OUT/$t" || failed=1
+done
+exit $failed
@@ -0,0 +1,20 @@
+/**
+ * @file Arduino.h
+ * @brief Lo mínimo del core de Arduino para incluir en el host los headers de
+ * lib/ que lo piden por los tipos (vamp_table.h, vamp_kv.h) y compilar
+ * lib/vamp_table.cpp. millis() y random() los define la prueba que los usa
+ */
+
+#ifndef _VAMP_TEST_ARDUINO_H_
+#define _VAMP_TEST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+uint32_t millis(void);
+long random(long howsmall, long howbig);
+
+#endif /* _VAMP_TEST_ARDUINO_H_ */
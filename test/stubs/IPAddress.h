@@ -0,0 +1,20 @@
+/**
+ * @file IPAddress.h
+ * @brief IPAddress del core de Arduino, solo para que vamp_config.h compile en
+ * el host
+ */
+
+#ifndef _VAMP_TEST_IPADDRESS_H_
+#define _VAMP_TEST_IPADDRESS_H_
+
+#include <stdint.h>
+
+class IPAddress {
+public:
+	IPAddress() {}
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{ a, b, c, d } {}
+private:
+	uint8_t bytes[4] = { 0 };
+};
+
+#endif /* _VAMP_TEST_IPADDRESS_H_ */
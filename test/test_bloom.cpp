@@ -0,0 +1,120 @@
+/**
+ * @file test_bloom.cpp
+ * @brief Prueba de vamp_bloom: el filtro que arma el VREG según el formato del
+ * encabezado se lee igual en el gateway, sin falsos negativos
+ */
+
+#include "lib/vamp_bloom.h"
+#include "test/vamp_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Lo que haría el VREG: marcar los bits del encabezado y pasarlos a hex */
+static uint32_t fnv1a(const uint8_t * key, size_t len, uint32_t basis) {
+	for (size_t i = 0; i < len; i++) {
+		basis ^= key[i];
+		basis *= 16777619UL;
+	}
+	return basis;
+}
+
+static void vreg_add(uint8_t * data, uint16_t bits, uint8_t k, const uint8_t * rf_id) {
+	uint32_t h1 = fnv1a(rf_id, 5, 2166136261UL);
+	uint32_t h2 = fnv1a(rf_id, 5, h1) | 1;
+	for (uint8_t j = 0; j < k; j++) {
+		uint32_t bit = (h1 + (uint32_t)j * h2) % bits;
+		data[bit / 8] |= (uint8_t)(1 << (bit % 8));
+	}
+}
+
+static void to_hex(const uint8_t * data, size_t len, char * hex) {
+	for (size_t i = 0; i < len; i++) {
+		sprintf(hex + 2 * i, "%02x", data[i]);
+	}
+}
+
+static void make_rf_id(uint8_t * rf_id, uint16_t n) {
+	rf_id[0] = 0x10;
+	rf_id[1] = 0x20;
+	rf_id[2] = 0x30;
+	rf_id[3] = (uint8_t)(n >> 8);
+	rf_id[4] = (uint8_t)(n & 0xFF);
+}
+
+static void test_vreg_format(void) {
+
+	static vamp_bloom_t bloom;
+	const uint16_t bits = 512;
+	const uint8_t k = 4;
+	uint8_t data[bits / 8];
+	char hex[bits / 4 + 1];
+	uint8_t rf_id[5];
+
+	/* 40 nodos registrados en el VREG */
+	memset(data, 0, sizeof(data));
+	for (uint16_t n = 0; n < 40; n++) {
+		make_rf_id(rf_id, n);
+		vreg_add(data, bits, k, rf_id);
+	}
+	to_hex(data, sizeof(data), hex);
+	VAMP_CHECK(vamp_bloom_load_hex(&bloom, bits, k, hex));
+	VAMP_CHECK(vamp_bloom_is_loaded(&bloom));
+	VAMP_CHECK(memcmp(bloom.data, data, sizeof(data)) == 0);
+
+	/* Ningún registrado se rechaza */
+	for (uint16_t n = 0; n < 40; n++) {
+		make_rf_id(rf_id, n);
+		VAMP_CHECK(vamp_bloom_maybe_contains(&bloom, rf_id, 5));
+	}
+
+	/* Con 40 claves, 512 bits y k = 4 pasan muy pocos desconocidos (~0.5%) */
+	uint16_t passed = 0;
+	for (uint16_t n = 1000; n < 2000; n++) {
+		make_rf_id(rf_id, n);
+		passed += vamp_bloom_maybe_contains(&bloom, rf_id, 5);
+	}
+	VAMP_CHECK(passed < 30);
+
+	/* Lo que marca el gateway cae en los mismos bits */
+	uint8_t extra[5] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE };
+	vreg_add(data, bits, k, extra);
+	vamp_bloom_add(&bloom, extra, 5);
+	VAMP_CHECK(memcmp(bloom.data, data, sizeof(data)) == 0);
+}
+
+static void test_load(void) {
+
+	static vamp_bloom_t bloom;
+	uint8_t rf_id[5] = { 1, 2, 3, 4, 5 };
+
+	/* Sin filtro todo puede estar */
+	vamp_bloom_clear(&bloom);
+	VAMP_CHECK(!vamp_bloom_is_loaded(&bloom));
+	VAMP_CHECK(vamp_bloom_maybe_contains(&bloom, rf_id, 5));
+
+	/* Un filtro vacío lo rechaza todo */
+	VAMP_CHECK(vamp_bloom_load_hex(&bloom, 16, 2, "0000"));
+	VAMP_CHECK(!vamp_bloom_maybe_contains(&bloom, rf_id, 5));
+	VAMP_CHECK(vamp_bloom_load_hex(&bloom, 16, 2, "FfFf"));
+	VAMP_CHECK(vamp_bloom_maybe_contains(&bloom, rf_id, 5));
+
+	/* Parámetros inválidos dejan el filtro vacío */
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 12, 2, "000"));
+	VAMP_CHECK(!vamp_bloom_is_loaded(&bloom));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 16, 0, "0000"));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 16, VAMP_BLOOM_MAX_K + 1, "0000"));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 16, 2, "00000"));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 16, 2, "00g0"));
+	VAMP_CHECK(!vamp_bloom_is_loaded(&bloom));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 8 * (VAMP_BLOOM_MAX_BYTES + 1), 2, "00"));
+	VAMP_CHECK(!vamp_bloom_load_hex(&bloom, 16, 2, NULL));
+}
+
+int main(void) {
+
+	test_vreg_format();
+	test_load();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,111 @@
+/**
+ * @file test_breaker.cpp
+ * @brief Prueba de vamp_breaker: apertura por umbral, una sola prueba tras el
+ * backoff, backoff que se duplica, y reemplazo de hosts cuando no hay lugar
+ */
+
+#include "lib/vamp_breaker.h"
+#include "test/vamp_test.h"
+
+#include <stdio.h>
+
+static void fail(const char * host, uint8_t times, uint32_t now) {
+	for (uint8_t i = 0; i < times; i++) {
+		vamp_breaker_report(host, 80, false, now);
+	}
+}
+
+static void test_cycle(uint32_t t) {
+
+	const char * host = "api.local";
+
+	/* Por debajo del umbral sigue cerrado, un éxito reinicia la cuenta */
+	fail(host, VAMP_BREAKER_THRESHOLD - 1, t);
+	vamp_breaker_report(host, 80, true, t);
+	fail(host, VAMP_BREAKER_THRESHOLD - 1, t);
+	VAMP_CHECK_EQ(vamp_breaker_state(host, 80), VAMP_BREAKER_CLOSED);
+	VAMP_CHECK(vamp_breaker_allow(host, 80, t));
+
+	/* El umbral abre: se rechaza sin conectar hasta el fin del backoff */
+	fail(host, 1, t);
+	VAMP_CHECK_EQ(vamp_breaker_state(host, 80), VAMP_BREAKER_OPEN);
+	VAMP_CHECK(!vamp_breaker_allow(host, 80, t + VAMP_BREAKER_BACKOFF_MIN - 1));
+	/* El mismo host en otro puerto es otro servidor */
+	VAMP_CHECK(vamp_breaker_allow(host, 8080, t));
+
+	/* Pasado el backoff, una sola prueba */
+	t += VAMP_BREAKER_BACKOFF_MIN;
+	VAMP_CHECK(vamp_breaker_allow(host, 80, t));
+	VAMP_CHECK_EQ(vamp_breaker_state(host, 80), VAMP_BREAKER_HALF_OPEN);
+	VAMP_CHECK(!vamp_breaker_allow(host, 80, t + 1));
+
+	/* La prueba falla: abierto con el doble de backoff */
+	fail(host, 1, t);
+	VAMP_CHECK_EQ(vamp_breaker_state(host, 80), VAMP_BREAKER_OPEN);
+	VAMP_CHECK(!vamp_breaker_allow(host, 80, t + 2 * VAMP_BREAKER_BACKOFF_MIN - 1));
+	t += 2 * VAMP_BREAKER_BACKOFF_MIN;
+	VAMP_CHECK(vamp_breaker_allow(host, 80, t));
+
+	/* Una prueba que nunca informa no bloquea el host para siempre */
+	VAMP_CHECK(!vamp_breaker_allow(host, 80, t + 1));
+	t += VAMP_BREAKER_BACKOFF_MIN;
+	VAMP_CHECK(vamp_breaker_allow(host, 80, t));
+
+	/* La prueba sale bien: cerrado y el backoff vuelve al mínimo */
+	vamp_breaker_report(host, 80, true, t);
+	VAMP_CHECK_EQ(vamp_breaker_state(host, 80), VAMP_BREAKER_CLOSED);
+	fail(host, VAMP_BREAKER_THRESHOLD, t);
+	VAMP_CHECK(vamp_breaker_allow(host, 80, t + VAMP_BREAKER_BACKOFF_MIN));
+	vamp_breaker_report(host, 80, true, t + VAMP_BREAKER_BACKOFF_MIN);
+}
+
+static void test_backoff_max(void) {
+
+	const char * host = "down.local";
+	uint32_t t = 1000;
+
+	fail(host, VAMP_BREAKER_THRESHOLD, t);
+	uint32_t backoff = VAMP_BREAKER_BACKOFF_MIN;
+	for (uint8_t i = 0; i < 20; i++) {
+		t += backoff;
+		VAMP_CHECK(vamp_breaker_allow(host, 80, t));
+		fail(host, 1, t);
+		backoff = backoff * 2 > VAMP_BREAKER_BACKOFF_MAX ? VAMP_BREAKER_BACKOFF_MAX : backoff * 2;
+		VAMP_CHECK(!vamp_breaker_allow(host, 80, t + backoff - 1));
+	}
+	vamp_breaker_report(host, 80, true, t + backoff);
+}
+
+/* Sin lugar se pierde antes un host cerrado que uno abierto */
+static void test_slots(void) {
+
+	char host[16];
+	uint32_t t = 5000;
+
+	fail("open.local", VAMP_BREAKER_THRESHOLD, t);
+	for (uint8_t i = 0; i < VAMP_BREAKER_SLOTS + 2; i++) {
+		snprintf(host, sizeof(host), "h%u.local", i);
+		fail(host, 1, t + 1 + i);
+	}
+	VAMP_CHECK_EQ(vamp_breaker_state("open.local", 80), VAMP_BREAKER_OPEN);
+	VAMP_CHECK(!vamp_breaker_allow("open.local", 80, t + 1));
+
+	/* Sin host no hay nada que seguir */
+	VAMP_CHECK(vamp_breaker_allow("", 80, t));
+	VAMP_CHECK(vamp_breaker_allow(NULL, 80, t));
+}
+
+int main(void) {
+
+	test_cycle(1000);
+	/* Con millis() a punto de dar la vuelta */
+	test_cycle(0xFFFFFFFFUL - VAMP_BREAKER_BACKOFF_MIN);
+	test_backoff_max();
+	test_slots();
+
+	vamp_breaker_stats_t stats;
+	vamp_breaker_get_stats(&stats);
+	VAMP_CHECK(stats.opened > 0 && stats.half_opened > 0 && stats.closed > 0 && stats.rejected > 0);
+
+	VAMP_TEST_END();
+}
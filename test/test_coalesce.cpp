@@ -0,0 +1,158 @@
+/**
+ * @file test_coalesce.cpp
+ * @brief Prueba de vamp_coalesce: dos requests con el mismo hash y distinto
+ * texto no comparten respuesta ni vuelo, más la caché y las esperas
+ */
+
+#include "lib/vamp_coalesce.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+/* Dos endpoints cuya clave tiene el mismo hash FNV-1a de 32 bits */
+#define URL_A "http://vreg.local/r/66934"
+#define URL_B "http://vreg.local/r/821940"
+
+static void make_key(vamp_coalesce_key_t * key, const char * url) {
+	vamp_coalesce_key_init(key);
+	vamp_coalesce_key_add(key, "0");
+	vamp_coalesce_key_add(key, url);
+}
+
+static void test_key(void) {
+
+	vamp_coalesce_key_t a, b;
+
+	make_key(&a, URL_A);
+	make_key(&b, URL_B);
+	VAMP_CHECK(vamp_coalesce_key_valid(&a));
+	VAMP_CHECK_EQ(a.hash, b.hash);
+	VAMP_CHECK(a.len != b.len || memcmp(a.text, b.text, a.len) != 0);
+
+	/* Los campos quedan separados */
+	vamp_coalesce_key_init(&a);
+	vamp_coalesce_key_add(&a, "ab");
+	vamp_coalesce_key_add(&a, "c");
+	vamp_coalesce_key_init(&b);
+	vamp_coalesce_key_add(&b, "a");
+	vamp_coalesce_key_add(&b, "bc");
+	VAMP_CHECK(a.hash != b.hash);
+
+	/* Lo que no cabe no sirve de clave */
+	char big[VAMP_COALESCE_KEY_MAX + 1];
+	memset(big, 'x', sizeof(big) - 1);
+	big[sizeof(big) - 1] = '\0';
+	vamp_coalesce_key_init(&a);
+	vamp_coalesce_key_add(&a, big);
+	VAMP_CHECK(!vamp_coalesce_key_valid(&a));
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 1, 1), VAMP_COALESCE_FULL);
+	vamp_coalesce_store(&a, "x", 1, 1000, 0);
+	char data[VAMP_COALESCE_DATA_MAX + 1];
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 0), -1);
+
+	/* Justo al límite entra */
+	big[VAMP_COALESCE_KEY_MAX - 1] = '\0';
+	vamp_coalesce_key_init(&a);
+	vamp_coalesce_key_add(&a, big);
+	VAMP_CHECK(vamp_coalesce_key_valid(&a));
+	VAMP_CHECK_EQ(a.len, VAMP_COALESCE_KEY_MAX);
+}
+
+static void test_cache_collision(void) {
+
+	vamp_coalesce_key_t a, b;
+	char data[VAMP_COALESCE_DATA_MAX + 1];
+	make_key(&a, URL_A);
+	make_key(&b, URL_B);
+
+	vamp_coalesce_store(&a, "riego=on", 8, 1000, 100);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&b, data, sizeof(data), 200), -1);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 200), 8);
+	VAMP_CHECK(strcmp(data, "riego=on") == 0);
+
+	/* Guardar la otra no pisa la primera */
+	vamp_coalesce_store(&b, "riego=off", 9, 1000, 200);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&b, data, sizeof(data), 300), 9);
+	VAMP_CHECK(strcmp(data, "riego=off") == 0);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 300), 8);
+	VAMP_CHECK(strcmp(data, "riego=on") == 0);
+
+	/* Vencida, y lo que no cabe o no se guarda */
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 1100), -1);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&b, data, 5, 300), -1);
+	char big[VAMP_COALESCE_DATA_MAX + 2];
+	memset(big, 'y', sizeof(big));
+	vamp_coalesce_store(&a, big, sizeof(big), 1000, 2000);
+	vamp_coalesce_store(&a, "z", 1, 0, 2000);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 2000), -1);
+}
+
+static void test_flight_collision(void) {
+
+	vamp_coalesce_key_t a, b;
+	vamp_coalesce_waiter_t waiters[VAMP_COALESCE_WAITERS];
+	char data[VAMP_COALESCE_DATA_MAX + 1];
+	make_key(&a, URL_A);
+	make_key(&b, URL_B);
+
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x21, 1), VAMP_COALESCE_LEADER);
+	VAMP_CHECK(vamp_coalesce_pending(&a));
+	VAMP_CHECK(!vamp_coalesce_pending(&b));
+
+	/* Mismo hash, otro request: hace el suyo sin esperar la respuesta de A */
+	VAMP_CHECK_EQ(vamp_coalesce_join(&b, 0x22, 2), VAMP_COALESCE_FULL);
+
+	/* El mismo request sí se suma, y un nodo repetido solo cambia el ticket */
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x23, 3), VAMP_COALESCE_JOINED);
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x24, 4), VAMP_COALESCE_JOINED);
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x23, 5), VAMP_COALESCE_JOINED);
+
+	/* La respuesta queda bajo la clave del vuelo, no bajo el hash */
+	vamp_coalesce_store_flight(a.hash, "ok", 2, 1000, 5000);
+	uint8_t count = vamp_coalesce_finish(a.hash, waiters, VAMP_COALESCE_WAITERS);
+	VAMP_CHECK_EQ(count, 2);
+	VAMP_CHECK(waiters[0].wsn_id == 0x23 && waiters[0].ticket == 5);
+	VAMP_CHECK(waiters[1].wsn_id == 0x24 && waiters[1].ticket == 4);
+	VAMP_CHECK(!vamp_coalesce_pending(&a));
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&a, data, sizeof(data), 5001), 2);
+	VAMP_CHECK_EQ(vamp_coalesce_lookup(&b, data, sizeof(data), 5001), -1);
+
+	/* Terminado A, B ya puede abrir su vuelo */
+	VAMP_CHECK_EQ(vamp_coalesce_join(&b, 0x22, 6), VAMP_COALESCE_LEADER);
+	VAMP_CHECK_EQ(vamp_coalesce_finish(b.hash, NULL, 0), 0);
+	VAMP_CHECK(!vamp_coalesce_pending(&b));
+}
+
+static void test_waiters_full(void) {
+
+	vamp_coalesce_key_t a, c, d;
+	make_key(&a, "http://a/");
+	make_key(&c, "http://c/");
+	make_key(&d, "http://d/");
+
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x10, 0), VAMP_COALESCE_LEADER);
+	for (uint8_t i = 0; i < VAMP_COALESCE_WAITERS; i++) {
+		VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x11 + i, i), VAMP_COALESCE_JOINED);
+	}
+	VAMP_CHECK_EQ(vamp_coalesce_join(&a, 0x30, 0), VAMP_COALESCE_FULL);
+
+	/* Sin vuelos libres */
+	VAMP_CHECK_EQ(vamp_coalesce_join(&c, 0x31, 0), VAMP_COALESCE_LEADER);
+	VAMP_CHECK_EQ(vamp_coalesce_join(&d, 0x32, 0), VAMP_COALESCE_FULL);
+
+	/* Un fallo no entrega nada */
+	VAMP_CHECK_EQ(vamp_coalesce_finish(a.hash, NULL, 0), 0);
+	VAMP_CHECK_EQ(vamp_coalesce_finish(c.hash, NULL, 0), 0);
+	VAMP_CHECK_EQ(vamp_coalesce_join(&d, 0x32, 0), VAMP_COALESCE_LEADER);
+	vamp_coalesce_finish(d.hash, NULL, 0);
+}
+
+int main(void) {
+
+	test_key();
+	test_cache_collision();
+	test_flight_collision();
+	test_waiters_full();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,138 @@
+/**
+ * @file test_coap.cpp
+ * @brief Prueba de vamp_coap: mensajes armados contra los bytes de RFC 7252,
+ * opciones con delta y largo extendidos, y lectura de respuestas con bloques
+ */
+
+#include "lib/vamp_coap.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+static const uint8_t token[VAMP_COAP_TOKEN_LEN] = { 0xAB, 0xCD };
+
+static bool same(const uint8_t * a, size_t a_len, const uint8_t * b, size_t b_len) {
+	return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+/* Un POST como el que arma el transporte para un bloque intermedio */
+static void test_request(void) {
+
+	uint8_t buf[64];
+	vamp_coap_writer_t writer;
+
+	vamp_coap_begin(&writer, buf, sizeof(buf), VAMP_COAP_CON, VAMP_COAP_POST, 0x1234, token, sizeof(token));
+	vamp_coap_add_split_option(&writer, VAMP_COAP_OPT_URI_PATH, "/vamp/data?a=1&b=2", '/', '?');
+	vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_CONTENT_FORMAT, VAMP_COAP_FORMAT_JSON);
+	vamp_coap_add_split_option(&writer, VAMP_COAP_OPT_URI_QUERY, "a=1&b=2", '&', '\0');
+	vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_BLOCK1, VAMP_COAP_BLOCK(2, true, 2));
+	size_t len = vamp_coap_finish(&writer, (const uint8_t *)"hi", 2);
+
+	const uint8_t expected[] = {
+		0x42, 0x02, 0x12, 0x34, 0xAB, 0xCD,
+		0xB4, 'v', 'a', 'm', 'p',			// Uri-Path (11)
+		0x04, 'd', 'a', 't', 'a',
+		0x11, 0x32,							// Content-Format (12) = 50
+		0x33, 'a', '=', '1',				// Uri-Query (15)
+		0x03, 'b', '=', '2',
+		0xC1, 0x2A,							// Block1 (27) = num 2, M, 64 bytes
+		0xFF, 'h', 'i'
+	};
+	VAMP_CHECK(same(buf, len, expected, sizeof(expected)));
+
+	/* Y se lee de vuelta */
+	vamp_coap_msg_t msg;
+	VAMP_CHECK(vamp_coap_parse(buf, len, &msg));
+	VAMP_CHECK_EQ(msg.type, VAMP_COAP_CON);
+	VAMP_CHECK_EQ(msg.code, VAMP_COAP_POST);
+	VAMP_CHECK_EQ(msg.msg_id, 0x1234);
+	VAMP_CHECK_EQ(msg.token_len, 2);
+	VAMP_CHECK(memcmp(msg.token, token, 2) == 0);
+	VAMP_CHECK(msg.has_block1 && !msg.has_block2);
+	VAMP_CHECK_EQ(VAMP_COAP_BLOCK_NUM(msg.block1), 2);
+	VAMP_CHECK(VAMP_COAP_BLOCK_MORE(msg.block1));
+	VAMP_CHECK_EQ(VAMP_COAP_BLOCK_SIZE(msg.block1), 64);
+	VAMP_CHECK(same(msg.payload, msg.payload_len, (const uint8_t *)"hi", 2));
+}
+
+/* Delta y largo de 13 a 268 (+1 byte) y desde 269 (+2 bytes) */
+static void test_extended(void) {
+
+	uint8_t buf[400];
+	uint8_t value[300];
+	memset(value, 'x', sizeof(value));
+	vamp_coap_writer_t writer;
+
+	vamp_coap_begin(&writer, buf, sizeof(buf), VAMP_COAP_NON, VAMP_COAP_GET, 1, NULL, 0);
+	vamp_coap_add_option(&writer, VAMP_COAP_OPT_URI_QUERY, value, 20);
+	vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_BLOCK2, VAMP_COAP_BLOCK(300, false, 6));
+	vamp_coap_add_option(&writer, 2000, value, 300);
+	size_t len = vamp_coap_finish(&writer, NULL, 0);
+	VAMP_CHECK(len > 0);
+
+	/* Uri-Query: delta 15 -> 13 + 2, largo 20 -> 13 + 7 */
+	VAMP_CHECK_EQ(buf[4], 0xDD);
+	VAMP_CHECK_EQ(buf[5], 2);
+	VAMP_CHECK_EQ(buf[6], 7);
+	/* Block2: delta 8, valor 300 << 4 | 6 = 0x12C6 en 2 bytes */
+	const uint8_t block2[] = { 0x82, 0x12, 0xC6 };
+	VAMP_CHECK(memcmp(buf + 7 + 20, block2, sizeof(block2)) == 0);
+	/* Opción 2000: delta 1977 -> 14 + 1708, largo 300 -> 14 + 31 */
+	const uint8_t big[] = { 0xEE, 0x06, 0xAC, 0x00, 0x1F };
+	VAMP_CHECK(memcmp(buf + 30, big, sizeof(big)) == 0);
+	VAMP_CHECK_EQ(len, 30 + sizeof(big) + 300);
+
+	vamp_coap_msg_t msg;
+	VAMP_CHECK(vamp_coap_parse(buf, len, &msg));
+	VAMP_CHECK_EQ(msg.type, VAMP_COAP_NON);
+	VAMP_CHECK(msg.has_block2);
+	VAMP_CHECK_EQ(VAMP_COAP_BLOCK_NUM(msg.block2), 300);
+	VAMP_CHECK(!VAMP_COAP_BLOCK_MORE(msg.block2));
+	VAMP_CHECK_EQ(VAMP_COAP_BLOCK_SIZE(msg.block2), 1024);
+	VAMP_CHECK(msg.payload == NULL && msg.payload_len == 0);
+}
+
+static void test_errors(void) {
+
+	uint8_t buf[16];
+	vamp_coap_writer_t writer;
+
+	/* Opciones fuera de orden */
+	vamp_coap_begin(&writer, buf, sizeof(buf), VAMP_COAP_CON, VAMP_COAP_GET, 1, token, sizeof(token));
+	vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_BLOCK2, 0);
+	vamp_coap_add_uint_option(&writer, VAMP_COAP_OPT_URI_PATH, 0);
+	VAMP_CHECK_EQ(vamp_coap_finish(&writer, NULL, 0), 0);
+
+	/* No cabe el payload */
+	vamp_coap_begin(&writer, buf, sizeof(buf), VAMP_COAP_CON, VAMP_COAP_GET, 1, token, sizeof(token));
+	VAMP_CHECK_EQ(vamp_coap_finish(&writer, (const uint8_t *)"0123456789", 10), 0);
+
+	/* Datagramas inválidos */
+	vamp_coap_msg_t msg;
+	const uint8_t version[] = { 0x80, 0x45, 0x00, 0x01 };
+	const uint8_t token_len[] = { 0x49, 0x45, 0x00, 0x01 };
+	const uint8_t mark_only[] = { 0x60, 0x45, 0x00, 0x01, 0xFF };
+	const uint8_t truncated[] = { 0x60, 0x45, 0x00, 0x01, 0xB4, 'v', 'a' };
+	const uint8_t nibble15[] = { 0x60, 0x45, 0x00, 0x01, 0xF1, 0x00 };
+	VAMP_CHECK(!vamp_coap_parse(version, sizeof(version), &msg));
+	VAMP_CHECK(!vamp_coap_parse(token_len, sizeof(token_len), &msg));
+	VAMP_CHECK(!vamp_coap_parse(mark_only, sizeof(mark_only), &msg));
+	VAMP_CHECK(!vamp_coap_parse(truncated, sizeof(truncated), &msg));
+	VAMP_CHECK(!vamp_coap_parse(nibble15, sizeof(nibble15), &msg));
+
+	/* ACK vacío, lo que manda el servidor antes de una respuesta separada */
+	const uint8_t empty_ack[] = { 0x60, 0x00, 0x12, 0x34 };
+	VAMP_CHECK(vamp_coap_parse(empty_ack, sizeof(empty_ack), &msg));
+	VAMP_CHECK_EQ(msg.type, VAMP_COAP_ACK);
+	VAMP_CHECK_EQ(msg.code, VAMP_COAP_EMPTY);
+	VAMP_CHECK_EQ(VAMP_COAP_CODE_CLASS(msg.code), 0);
+}
+
+int main(void) {
+
+	test_request();
+	test_extended();
+	test_errors();
+
+	VAMP_TEST_END();
+}
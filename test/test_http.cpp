@@ -0,0 +1,138 @@
+/**
+ * @file test_http.cpp
+ * @brief Prueba de vamp_http: respuestas con Content-Length, chunked y hasta el
+ * cierre, respuestas provisionales, cuerpo truncado o pasado a un sink
+ */
+
+#include "lib/vamp_http.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+/* Pasar la respuesta, devuelve lo que dijo el lector al terminar o al primer
+resultado distinto de 0 */
+static int8_t feed(vamp_http_reader_t * reader, const char * response) {
+	int8_t res = 0;
+	for (size_t i = 0; response[i] && res == 0; i++) {
+		res = vamp_http_reader_feed(reader, (uint8_t)response[i]);
+	}
+	return res;
+}
+
+static void test_content_length(void) {
+
+	vamp_http_reader_t reader;
+	char body[64];
+
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+		"CONTENT-LENGTH:  11\r\n\r\n{\"riego\":1}"), 1);
+	VAMP_CHECK_EQ(reader.status, 200);
+	VAMP_CHECK(strcmp(body, "{\"riego\":1}") == 0);
+	/* Lo que sigue a la respuesta se ignora */
+	VAMP_CHECK_EQ(vamp_http_reader_feed(&reader, 'x'), 1);
+	VAMP_CHECK(strcmp(body, "{\"riego\":1}") == 0);
+
+	/* Sin cuerpo */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n"), 1);
+	VAMP_CHECK_EQ(reader.status, 404);
+	VAMP_CHECK(body[0] == '\0');
+
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 204 No Content\r\n\r\n"), 1);
+
+	/* Un 100 Continue antes de la respuesta real, y headers parecidos que no son */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 201 Created\r\n"
+		"X-Content-Length: 99\r\nContent-Length: 2\r\n\r\nok"), 1);
+	VAMP_CHECK_EQ(reader.status, 201);
+	VAMP_CHECK(strcmp(body, "ok") == 0);
+}
+
+static void test_chunked(void) {
+
+	vamp_http_reader_t reader;
+	char body[64];
+
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, Chunked\r\n\r\n"
+		"5\r\nhola \r\nA;ext=1\r\ndel gatewa\r\n1\r\ny\r\n0\r\nX-Trailer: 1\r\n\r\n"), 1);
+	VAMP_CHECK(strcmp(body, "hola del gateway") == 0);
+
+	/* Tamaño inválido, o datos de más en el chunk */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n"), -1);
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n"), -1);
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000\r\n"), -1);
+
+	/* Cortada a mitad de un chunk */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nho"), 0);
+	VAMP_CHECK_EQ(vamp_http_reader_close(&reader), -1);
+}
+
+static void test_until_close(void) {
+
+	vamp_http_reader_t reader;
+	char body[8];
+
+	/* Sin largo el cuerpo termina al cerrar, lo que no cabe se descarta */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.0 200 OK\r\n\r\n0123456789"), 0);
+	VAMP_CHECK_EQ(vamp_http_reader_close(&reader), 1);
+	VAMP_CHECK(reader.truncated);
+	VAMP_CHECK(strcmp(body, "0123456") == 0);
+
+	/* Cerrada antes de los headers */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nContent-Le"), 0);
+	VAMP_CHECK_EQ(vamp_http_reader_close(&reader), -1);
+
+	/* Líneas de estado inválidas */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "SSH-2.0-OpenSSH\r\n"), -1);
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 2x0 OK\r\n"), -1);
+}
+
+typedef struct {
+	char data[64];
+	size_t len;
+} sink_buf_t;
+
+static void sink(void * ctx, uint8_t byte) {
+	sink_buf_t * buf = (sink_buf_t *)ctx;
+	if (buf->len < sizeof(buf->data) - 1) {
+		buf->data[buf->len++] = (char)byte;
+		buf->data[buf->len] = '\0';
+	}
+}
+
+static void test_sink(void) {
+
+	vamp_http_reader_t reader;
+	char body[4];
+	sink_buf_t out = { { 0 }, 0 };
+
+	/* Con sink el buffer queda vacío y el cuerpo no se trunca */
+	vamp_http_reader_reset(&reader, body, sizeof(body));
+	vamp_http_reader_sink(&reader, sink, &out);
+	VAMP_CHECK_EQ(feed(&reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+		"6\r\n{\"a\":1\r\n1\r\n}\r\n0\r\n\r\n"), 1);
+	VAMP_CHECK(strcmp(out.data, "{\"a\":1}") == 0);
+	VAMP_CHECK(body[0] == '\0');
+	VAMP_CHECK(!reader.truncated);
+}
+
+int main(void) {
+
+	test_content_length();
+	test_chunked();
+	test_until_close();
+	test_sink();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,177 @@
+/**
+ * @file test_jsel.cpp
+ * @brief Prueba de vamp_jsel: rutas con claves e índices, objetos copiados
+ * crudos, empaquetado binario y documentos inválidos
+ */
+
+#include "lib/vamp_jsel.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+/* Pasar el documento, devuelve lo último que dijo el selector y en feeds
+cuántos bytes leyó antes de poder cortar */
+static int8_t feed(vamp_jsel_t * sel, const char * doc, size_t * feeds = NULL) {
+	int8_t res = 0;
+	size_t i = 0;
+	for (; doc[i]; i++) {
+		res = vamp_jsel_feed(sel, (uint8_t)doc[i]);
+		if (res != 0) {
+			i++;
+			break;
+		}
+	}
+	if (feeds) {
+		*feeds = i;
+	}
+	return res;
+}
+
+static bool text_is(const vamp_jsel_t * sel, const char * expected) {
+	uint8_t out[64];
+	size_t len = vamp_jsel_output(sel, out, sizeof(out));
+	if (len != strlen(expected) || memcmp(out, expected, len) != 0) {
+		printf("   salida: %.*s\n", (int)len, (const char *)out);
+		return false;
+	}
+	return true;
+}
+
+static const char * const doc =
+	"{ \"id\": 7, \"riego\": { \"inicio\": \"06:00\", \"min\": 15, \"activo\": true },\n"
+	"  \"zonas\": [ 1, 2, 3, 4 ], \"cfg\": { \"a\": \"x y\", \"b\": [ 1, { } ] },\n"
+	"  \"temp\": -2.5, \"resto\": \"no hace falta leerlo\" }";
+
+static void test_text(void) {
+
+	vamp_jsel_t sel;
+	size_t feeds;
+
+	VAMP_CHECK(vamp_jsel_init(&sel, "riego.inicio,riego.min,zonas[2]", NULL));
+	VAMP_CHECK_EQ(feed(&sel, doc, &feeds), 1);
+	VAMP_CHECK(text_is(&sel, "06:00,15,3"));
+	/* Con todo encontrado deja de leer antes del final */
+	VAMP_CHECK(feeds < strlen(doc));
+	VAMP_CHECK(doc[feeds - 1] == ',');
+
+	/* Objetos y arrays se copian sin los espacios de fuera de los strings */
+	VAMP_CHECK(vamp_jsel_init(&sel, "cfg,riego.activo,temp", NULL));
+	VAMP_CHECK_EQ(feed(&sel, doc), 1);
+	VAMP_CHECK(text_is(&sel, "{\"a\":\"x y\",\"b\":[1,{}]},true,-2.5"));
+
+	/* Un campo que no está: el documento termina sin completar */
+	VAMP_CHECK(vamp_jsel_init(&sel, "id,falta", NULL));
+	VAMP_CHECK_EQ(feed(&sel, doc), 0);
+	VAMP_CHECK(text_is(&sel, "7,"));
+
+	/* El orden de la salida es el del selector, no el del documento */
+	VAMP_CHECK(vamp_jsel_init(&sel, "zonas[3],id", NULL));
+	VAMP_CHECK_EQ(feed(&sel, doc), 1);
+	VAMP_CHECK(text_is(&sel, "4,7"));
+}
+
+static void test_strings(void) {
+
+	vamp_jsel_t sel;
+
+	/* Escapes en valores y en claves */
+	VAMP_CHECK(vamp_jsel_init(&sel, "a\"b,c", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{\"a\\\"b\":\"l1\\nl2\",\"c\":\"caf\\u00e9\"}"), 1);
+	VAMP_CHECK(text_is(&sel, "l1\nl2,caf?"));
+
+	/* Un valor largo se corta en VAMP_JSEL_VALUE_MAX */
+	char big[80];
+	char expected[VAMP_JSEL_VALUE_MAX + 1];
+	snprintf(big, sizeof(big), "{\"v\":\"%040d\"}", 0);
+	memset(expected, '0', VAMP_JSEL_VALUE_MAX);
+	expected[VAMP_JSEL_VALUE_MAX] = '\0';
+	VAMP_CHECK(vamp_jsel_init(&sel, "v", NULL));
+	VAMP_CHECK_EQ(feed(&sel, big), 1);
+	VAMP_CHECK(text_is(&sel, expected));
+
+	/* Índices de dos cifras y arrays anidados */
+	VAMP_CHECK(vamp_jsel_init(&sel, "m[1][0],l[10]", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{\"m\":[[1,2],[3,4]],\"l\":[0,1,2,3,4,5,6,7,8,9,10]}"), 1);
+	VAMP_CHECK(text_is(&sel, "3,10"));
+
+	/* Array vacío antes del campo */
+	VAMP_CHECK(vamp_jsel_init(&sel, "b", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{\"a\":[],\"b\":null}"), 1);
+	VAMP_CHECK(text_is(&sel, "null"));
+}
+
+static void test_pack(void) {
+
+	vamp_jsel_t sel;
+	uint8_t out[32];
+
+	VAMP_CHECK(vamp_jsel_init(&sel, "id,riego.min,riego.activo,falta", "u32,u16,u8,u16"));
+	VAMP_CHECK_EQ(feed(&sel, doc), 0);
+	size_t len = vamp_jsel_output(&sel, out, sizeof(out));
+	const uint8_t expected[] = {
+		0x00, 0x00, 0x00, 0x07,		// id
+		0x00, 0x0F,					// riego.min
+		0x01,						// true
+		0x00, 0x00					// falta
+	};
+	VAMP_CHECK(len == sizeof(expected) && memcmp(out, expected, len) == 0);
+
+	/* Texto con su largo */
+	VAMP_CHECK(vamp_jsel_init(&sel, "riego.inicio,zonas[0]", "s,i8"));
+	VAMP_CHECK_EQ(feed(&sel, doc), 1);
+	len = vamp_jsel_output(&sel, out, sizeof(out));
+	const uint8_t text[] = { 5, '0', '6', ':', '0', '0', 0x01 };
+	VAMP_CHECK(len == sizeof(text) && memcmp(out, text, len) == 0);
+
+	/* Negativos y float */
+	VAMP_CHECK(vamp_jsel_init(&sel, "n,f", "i16,f32"));
+	VAMP_CHECK_EQ(feed(&sel, "{\"n\":-2,\"f\":1.5}"), 1);
+	len = vamp_jsel_output(&sel, out, sizeof(out));
+	const uint8_t packed[] = { 0xFF, 0xFE, 0x3F, 0xC0, 0x00, 0x00 };
+	VAMP_CHECK(len == sizeof(packed) && memcmp(out, packed, len) == 0);
+
+	/* Lo que no entra en la salida queda afuera */
+	VAMP_CHECK_EQ(vamp_jsel_output(&sel, out, 3), 2);
+}
+
+static void test_invalid(void) {
+
+	vamp_jsel_t sel;
+
+	/* Selectores */
+	VAMP_CHECK(!vamp_jsel_init(&sel, "", NULL));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a,,b", NULL));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a,", NULL));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a,b,c,d,e", NULL));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a,b", "u8"));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a", "u8,u8"));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "a", "u64"));
+	VAMP_CHECK(!vamp_jsel_init(&sel, "una.ruta.que.no.entra.en.el.selector.de.cuarenta.y.ocho", NULL));
+
+	/* Documentos */
+	VAMP_CHECK(vamp_jsel_init(&sel, "z", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{\"a\" 1}"), -1);
+	VAMP_CHECK(vamp_jsel_init(&sel, "z", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{\"a\":[1}"), -1);
+	VAMP_CHECK(vamp_jsel_init(&sel, "z", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{a:1}"), -1);
+	VAMP_CHECK(vamp_jsel_init(&sel, "z", NULL));
+	VAMP_CHECK_EQ(feed(&sel, "{} x"), -1);
+
+	/* Más anidado que VAMP_JSEL_DEPTH */
+	char deep[VAMP_JSEL_DEPTH + 2];
+	memset(deep, '[', VAMP_JSEL_DEPTH + 1);
+	deep[VAMP_JSEL_DEPTH + 1] = '\0';
+	VAMP_CHECK(vamp_jsel_init(&sel, "z", NULL));
+	VAMP_CHECK_EQ(feed(&sel, deep), -1);
+}
+
+int main(void) {
+
+	test_text();
+	test_strings();
+	test_pack();
+	test_invalid();
+
+	VAMP_TEST_END();
+}
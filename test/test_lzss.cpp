@@ -0,0 +1,122 @@
+/**
+ * @file test_lzss.cpp
+ * @brief Prueba de vamp_lzss: ida y vuelta, y la descompresión por páginas
+ * como la hace el nodo, con referencias y grupos cortados entre páginas
+ */
+
+#include "lib/vamp_lzss.h"
+#include "test/vamp_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t packed[8192];
+static uint8_t out[8192];
+
+/* Descomprimir en páginas de page bytes, como llegan por POLL */
+static bool paged_round_trip(const uint8_t * in, size_t in_len, size_t packed_len, size_t page) {
+
+	vamp_lzss_decoder_t dec;
+	vamp_lzss_decode_reset(&dec);
+	size_t out_len = 0;
+
+	for (size_t at = 0; at < packed_len; at += page) {
+		size_t n = packed_len - at < page ? packed_len - at : page;
+		if (vamp_lzss_decode(&dec, packed + at, n, out, sizeof(out), &out_len) != 0) {
+			return false;
+		}
+	}
+
+	return out_len == in_len && memcmp(out, in, in_len) == 0 && !dec.half;
+}
+
+static void check(const uint8_t * in, size_t in_len, bool compressible) {
+
+	size_t packed_len = vamp_lzss_encode(in, in_len, packed, sizeof(packed));
+	VAMP_CHECK(packed_len > 0);
+	if (compressible) {
+		VAMP_CHECK(packed_len < in_len);
+	}
+
+	/* Toda junta y en páginas de todos los tamaños que usa el nodo (y de 1
+	byte, que corta cada referencia por la mitad) */
+	VAMP_CHECK(paged_round_trip(in, in_len, packed_len, packed_len));
+	for (size_t page = 1; page <= 30; page++) {
+		if (!paged_round_trip(in, in_len, packed_len, page)) {
+			printf("   falló con páginas de %u bytes\n", (unsigned)page);
+			vamp_test_failures++;
+		}
+	}
+}
+
+static void test_round_trip(void) {
+
+	const char * json = "{\"riego\":{\"inicio\":\"06:00\",\"min\":15},\"zonas\":[{\"id\":1,\"on\":true},"
+		"{\"id\":2,\"on\":true},{\"id\":3,\"on\":false},{\"id\":4,\"on\":true}]}";
+	check((const uint8_t *)json, strlen(json), true);
+
+	/* Una sola letra: referencias que se solapan con lo que escriben */
+	uint8_t run[300];
+	memset(run, 'a', sizeof(run));
+	check(run, sizeof(run), true);
+
+	/* Cortos */
+	check((const uint8_t *)"a", 1, false);
+	check((const uint8_t *)"abcabc", 6, false);
+
+	/* Más largo que la ventana: las referencias no pueden pasar de 4096 */
+	static uint8_t text[6000];
+	for (size_t i = 0; i < sizeof(text); i++) {
+		text[i] = (uint8_t)("0123456789abcdef"[(i * 7 + i / 97) % 16]);
+	}
+	check(text, sizeof(text), true);
+
+	/* Lo que no se comprime no entra en un buffer del mismo tamaño */
+	uint8_t noise[200];
+	srand(1);
+	for (size_t i = 0; i < sizeof(noise); i++) {
+		noise[i] = (uint8_t)rand();
+	}
+	VAMP_CHECK_EQ(vamp_lzss_encode(noise, sizeof(noise), packed, sizeof(noise)), 0);
+	check(noise, sizeof(noise), false);
+}
+
+static void test_limits(void) {
+
+	vamp_lzss_decoder_t dec;
+	size_t out_len;
+	uint8_t small[8];
+
+	/* Salida llena: devuelve 1 con lo que entró */
+	uint8_t run[40];
+	memset(run, 'z', sizeof(run));
+	size_t packed_len = vamp_lzss_encode(run, sizeof(run), packed, sizeof(packed));
+	vamp_lzss_decode_reset(&dec);
+	out_len = 0;
+	VAMP_CHECK_EQ(vamp_lzss_decode(&dec, packed, packed_len, small, sizeof(small), &out_len), 1);
+	VAMP_CHECK_EQ(out_len, sizeof(small));
+	VAMP_CHECK(memcmp(small, run, sizeof(small)) == 0);
+
+	/* Referencia a antes del comienzo */
+	const uint8_t bad[] = { 0x01, 'x', 0x00, 0x10 };
+	vamp_lzss_decode_reset(&dec);
+	out_len = 0;
+	VAMP_CHECK_EQ(vamp_lzss_decode(&dec, bad, sizeof(bad), out, sizeof(out), &out_len), -1);
+
+	/* Con dos bytes escritos la distancia 2 es válida */
+	const uint8_t good[] = { 0x03, 'x', 'y', 0x00, 0x11 };
+	vamp_lzss_decode_reset(&dec);
+	out_len = 0;
+	VAMP_CHECK_EQ(vamp_lzss_decode(&dec, good, sizeof(good), out, sizeof(out), &out_len), 0);
+	VAMP_CHECK(out_len == 6 && memcmp(out, "xyxyxy", 6) == 0);
+
+	VAMP_CHECK_EQ(vamp_lzss_encode(run, 0, packed, sizeof(packed)), 0);
+}
+
+int main(void) {
+
+	test_round_trip();
+	test_limits();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,141 @@
+/**
+ * @file test_mqtt.cpp
+ * @brief Prueba de vamp_mqtt: los paquetes armados contra los bytes del estándar
+ * MQTT 3.1.1 y el lector con las respuestas del broker
+ */
+
+#include "lib/vamp_mqtt.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+static bool same(const uint8_t * a, size_t a_len, const uint8_t * b, size_t b_len) {
+	return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+/* Pasar un paquete entero al lector, devuelve lo que dijo el último byte */
+static int8_t feed(vamp_mqtt_reader_t * reader, const uint8_t * buf, size_t len) {
+	int8_t res = 0;
+	for (size_t i = 0; i < len; i++) {
+		res = vamp_mqtt_reader_feed(reader, buf[i]);
+		if (res != 0 && i + 1 < len) {
+			return -2;	// terminó antes de tiempo
+		}
+	}
+	return res;
+}
+
+static void test_connect(void) {
+
+	uint8_t buf[64];
+
+	const uint8_t plain[] = {
+		0x10, 14,
+		0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x3C,
+		0x00, 0x02, 'g', 'w'
+	};
+	size_t len = vamp_mqtt_connect_packet(buf, sizeof(buf), "gw", NULL, NULL, 60, true);
+	VAMP_CHECK(same(buf, len, plain, sizeof(plain)));
+
+	/* Usuario y clave, sesión persistente */
+	const uint8_t auth[] = {
+		0x10, 21,
+		0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xC0, 0x01, 0x2C,
+		0x00, 0x02, 'g', 'w',
+		0x00, 0x01, 'u',
+		0x00, 0x02, 'p', 'w'
+	};
+	len = vamp_mqtt_connect_packet(buf, sizeof(buf), "gw", "u", "pw", 300, false);
+	VAMP_CHECK(same(buf, len, auth, sizeof(auth)));
+
+	/* Sin usuario la clave no se envía */
+	len = vamp_mqtt_connect_packet(buf, sizeof(buf), "gw", NULL, "pw", 60, true);
+	VAMP_CHECK(same(buf, len, plain, sizeof(plain)));
+
+	/* No cabe */
+	VAMP_CHECK_EQ(vamp_mqtt_connect_packet(buf, sizeof(plain) - 1, "gw", NULL, NULL, 60, true), 0);
+}
+
+static void test_publish(void) {
+
+	uint8_t buf[256];
+	const uint8_t payload[] = { 0x01, 0x02, 0x03 };
+
+	const uint8_t qos0[] = { 0x30, 8, 0x00, 0x03, 'a', '/', 'b', 0x01, 0x02, 0x03 };
+	size_t len = vamp_mqtt_publish_packet(buf, sizeof(buf), "a/b", payload, 3, 0, false, 7);
+	VAMP_CHECK(same(buf, len, qos0, sizeof(qos0)));
+
+	const uint8_t qos1[] = { 0x33, 10, 0x00, 0x03, 'a', '/', 'b', 0x12, 0x34, 0x01, 0x02, 0x03 };
+	len = vamp_mqtt_publish_packet(buf, sizeof(buf), "a/b", payload, 3, 1, true, 0x1234);
+	VAMP_CHECK(same(buf, len, qos1, sizeof(qos1)));
+
+	/* Largo restante en dos bytes: 2 + 1 + 197 = 200 = 0xC8 0x01 */
+	uint8_t big[197];
+	memset(big, 0xAA, sizeof(big));
+	len = vamp_mqtt_publish_packet(buf, sizeof(buf), "t", big, sizeof(big), 0, false, 0);
+	VAMP_CHECK_EQ(len, 1 + 2 + 200);
+	VAMP_CHECK_EQ(buf[1], 0xC8);
+	VAMP_CHECK_EQ(buf[2], 0x01);
+	VAMP_CHECK_EQ(buf[len - 1], 0xAA);
+	VAMP_CHECK_EQ(vamp_mqtt_publish_packet(buf, len - 1, "t", big, sizeof(big), 0, false, 0), 0);
+
+	/* Lo que no se puede publicar */
+	VAMP_CHECK_EQ(vamp_mqtt_publish_packet(buf, sizeof(buf), "", payload, 3, 0, false, 0), 0);
+	VAMP_CHECK_EQ(vamp_mqtt_publish_packet(buf, sizeof(buf), "t", payload, 3, 2, false, 1), 0);
+	VAMP_CHECK_EQ(vamp_mqtt_publish_packet(buf, sizeof(buf), "t", NULL, 3, 0, false, 0), 0);
+
+	const uint8_t ping[] = { 0xC0, 0x00 };
+	len = vamp_mqtt_empty_packet(buf, sizeof(buf), VAMP_MQTT_PINGREQ);
+	VAMP_CHECK(same(buf, len, ping, sizeof(ping)));
+	VAMP_CHECK_EQ(vamp_mqtt_empty_packet(buf, 1, VAMP_MQTT_DISCONNECT), 0);
+}
+
+static void test_reader(void) {
+
+	vamp_mqtt_reader_t reader;
+	vamp_mqtt_reader_reset(&reader);
+
+	/* CONNACK aceptado */
+	const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+	VAMP_CHECK_EQ(feed(&reader, connack, sizeof(connack)), 1);
+	VAMP_CHECK_EQ(reader.header & VAMP_MQTT_TYPE_MASK, VAMP_MQTT_CONNACK);
+	VAMP_CHECK_EQ(reader.body_len, 2);
+	VAMP_CHECK_EQ(reader.body[1], 0x00);
+
+	/* PUBACK con su identificador */
+	const uint8_t puback[] = { 0x40, 0x02, 0xBE, 0xEF };
+	VAMP_CHECK_EQ(feed(&reader, puback, sizeof(puback)), 1);
+	VAMP_CHECK_EQ(reader.header & VAMP_MQTT_TYPE_MASK, VAMP_MQTT_PUBACK);
+	VAMP_CHECK_EQ(vamp_mqtt_reader_packet_id(&reader), 0xBEEF);
+
+	/* PINGRESP sin cuerpo */
+	const uint8_t pingresp[] = { 0xD0, 0x00 };
+	VAMP_CHECK_EQ(feed(&reader, pingresp, sizeof(pingresp)), 1);
+	VAMP_CHECK_EQ(reader.header & VAMP_MQTT_TYPE_MASK, VAMP_MQTT_PINGRESP);
+	VAMP_CHECK_EQ(vamp_mqtt_reader_packet_id(&reader), 0);
+
+	/* Un PUBLISH entrante largo: se guardan solo los primeros bytes y el
+	siguiente paquete se lee bien */
+	uint8_t buf[256];
+	uint8_t big[197];
+	memset(big, 0x55, sizeof(big));
+	size_t len = vamp_mqtt_publish_packet(buf, sizeof(buf), "t", big, sizeof(big), 0, false, 0);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), 1);
+	VAMP_CHECK_EQ(reader.body_len, VAMP_MQTT_RX_KEEP);
+	VAMP_CHECK_EQ(feed(&reader, puback, sizeof(puback)), 1);
+	VAMP_CHECK_EQ(vamp_mqtt_reader_packet_id(&reader), 0xBEEF);
+
+	/* Largo restante de más de 4 bytes */
+	const uint8_t bad[] = { 0x30, 0xFF, 0xFF, 0xFF, 0xFF };
+	VAMP_CHECK_EQ(feed(&reader, bad, sizeof(bad)), -1);
+	VAMP_CHECK_EQ(feed(&reader, connack, sizeof(connack)), 1);
+}
+
+int main(void) {
+
+	test_connect();
+	test_publish();
+	test_reader();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_prefetch.cpp
+ * @brief Prueba de vamp_prefetch: aprendizaje del periodo, respuesta lista en
+ * el pedido, pedido con el prefetch en vuelo, suspensión por desperdicio y olvido
+ */
+
+#include "lib/vamp_prefetch.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+#define PERIOD		10000
+#define LEAD		1000
+#define TOLERANCE	(PERIOD / 100 * VAMP_PREFETCH_JITTER_PCT)
+
+static char data[VAMP_PREFETCH_DATA_MAX + 1];
+
+static int16_t ask(uint8_t id, uint32_t now) {
+	return vamp_prefetch_ask(id, 0, LEAD, data, sizeof(data), now);
+}
+
+static bool due(uint8_t id, uint32_t now) {
+	uint8_t wsn_id = 0, profile_index = 0xFF;
+	return vamp_prefetch_due(now, &wsn_id, &profile_index) && wsn_id == id && profile_index == 0;
+}
+
+/* Pedidos cada PERIOD hasta tener el periodo, devuelve el momento del último */
+static uint32_t learn(uint8_t id, uint32_t t) {
+	for (uint8_t i = 0; i < VAMP_PREFETCH_MIN_SAMPLES; i++, t += PERIOD) {
+		VAMP_CHECK_EQ(ask(id, t), -1);
+		/* Todavía no predice */
+		VAMP_CHECK(!due(id, t + PERIOD - LEAD));
+	}
+	VAMP_CHECK_EQ(ask(id, t), -1);
+	return t;
+}
+
+static void test_hit_and_late(uint32_t t) {
+
+	t = learn(0x21, t);
+
+	/* El prefetch sale LEAD antes del próximo pedido, una sola vez */
+	VAMP_CHECK(!due(0x21, t + PERIOD - LEAD - 1));
+	VAMP_CHECK(due(0x21, t + PERIOD - LEAD));
+	VAMP_CHECK(!due(0x21, t + PERIOD - LEAD + 1));
+	vamp_prefetch_done(0x21, 0, "on", 2);
+
+	t += PERIOD;
+	VAMP_CHECK_EQ(ask(0x21, t), 2);
+	VAMP_CHECK(strcmp(data, "on") == 0);
+
+	/* El pedido llega con el prefetch en vuelo: la respuesta no se guarda */
+	VAMP_CHECK(due(0x21, t + PERIOD - LEAD));
+	t += PERIOD;
+	VAMP_CHECK_EQ(ask(0x21, t), -1);
+	vamp_prefetch_done(0x21, 0, "off", 3);
+	VAMP_CHECK(!due(0x21, t + 1));
+
+	/* Lo que no entra en la respuesta guardada no se guarda */
+	char big[VAMP_PREFETCH_DATA_MAX + 2];
+	memset(big, 'x', sizeof(big));
+	VAMP_CHECK(due(0x21, t + PERIOD - LEAD));
+	vamp_prefetch_done(0x21, 0, big, sizeof(big));
+	t += PERIOD;
+	VAMP_CHECK_EQ(ask(0x21, t), -1);
+
+	vamp_prefetch_drop(0x21, 0);
+	VAMP_CHECK(!due(0x21, t + PERIOD - LEAD));
+}
+
+/* Un nodo que se salta pedidos sin cambiar su periodo */
+static void test_waste(uint32_t t) {
+
+	vamp_prefetch_stats_t before, after;
+	vamp_prefetch_get_stats(&before);
+	t = learn(0x22, t);
+
+	for (uint8_t i = 0; i < VAMP_PREFETCH_MAX_WASTE; i++) {
+		VAMP_CHECK(due(0x22, t + PERIOD - LEAD));
+		vamp_prefetch_done(0x22, 0, "z", 1);
+		/* Vence sin pedido, y en el mismo ciclo no se repite */
+		VAMP_CHECK(!due(0x22, t + PERIOD + TOLERANCE + 1));
+		VAMP_CHECK(!due(0x22, t + 2 * PERIOD - LEAD));
+		t += 2 * PERIOD;
+		VAMP_CHECK_EQ(ask(0x22, t), -1);
+	}
+
+	vamp_prefetch_get_stats(&after);
+	VAMP_CHECK_EQ(after.wasted - before.wasted, VAMP_PREFETCH_MAX_WASTE);
+	VAMP_CHECK_EQ(after.suspended - before.suspended, 1);
+
+	/* Suspendido, aunque siga con el mismo periodo */
+	VAMP_CHECK(!due(0x22, t + PERIOD - LEAD));
+	t += 2 * PERIOD;
+	VAMP_CHECK_EQ(ask(0x22, t), -1);
+	VAMP_CHECK(!due(0x22, t + PERIOD - LEAD));
+
+	/* Vuelve a pedir a tiempo */
+	t += PERIOD;
+	VAMP_CHECK_EQ(ask(0x22, t), -1);
+	VAMP_CHECK(due(0x22, t + PERIOD - LEAD));
+	vamp_prefetch_done(0x22, 0, NULL, -1);
+
+	vamp_prefetch_drop(0x22, 0);
+}
+
+static void test_relearn_and_forget(uint32_t t) {
+
+	t = learn(0x23, t);
+
+	/* Otro periodo: aprende de nuevo */
+	for (uint8_t i = 0; i < VAMP_PREFETCH_MIN_SAMPLES - 1; i++) {
+		t += PERIOD / 2;
+		VAMP_CHECK_EQ(ask(0x23, t), -1);
+		VAMP_CHECK(!due(0x23, t + PERIOD / 2 - LEAD));
+	}
+	t += PERIOD / 2;
+	VAMP_CHECK_EQ(ask(0x23, t), -1);
+	VAMP_CHECK(due(0x23, t + PERIOD / 2 - LEAD));
+	vamp_prefetch_done(0x23, 0, "a", 1);
+
+	/* Deja de pedir: se olvida tras VAMP_PREFETCH_FORGET periodos */
+	VAMP_CHECK(!due(0x23, t + VAMP_PREFETCH_FORGET * PERIOD / 2 + VAMP_PREFETCH_FORGET));
+	t += (VAMP_PREFETCH_FORGET + 1) * PERIOD / 2;
+	VAMP_CHECK_EQ(ask(0x23, t), -1);
+	t += PERIOD / 2;
+	VAMP_CHECK_EQ(ask(0x23, t), -1);
+	VAMP_CHECK(!due(0x23, t + PERIOD / 2 - LEAD));
+	vamp_prefetch_drop(0x23, 0);
+
+	/* Sin anticipación (perfil no prefetcheable) se deja de seguir */
+	t = learn(0x24, t + PERIOD);
+	VAMP_CHECK_EQ(vamp_prefetch_ask(0x24, 0, 0, data, sizeof(data), t + PERIOD), -1);
+	VAMP_CHECK(!due(0x24, t + 2 * PERIOD - LEAD));
+
+	/* Una anticipación mayor que el periodo no predice nada */
+	t += 10 * PERIOD;
+	for (uint8_t i = 0; i <= VAMP_PREFETCH_MIN_SAMPLES + 1; i++, t += PERIOD) {
+		vamp_prefetch_ask(0x25, 0, PERIOD, data, sizeof(data), t);
+	}
+	VAMP_CHECK(!due(0x25, t));
+	vamp_prefetch_drop(0x25, 0);
+}
+
+int main(void) {
+
+	test_hit_and_late(1000);
+	/* Con millis() a punto de dar la vuelta */
+	test_hit_and_late(0xFFFFFFFFUL - 3 * PERIOD);
+	test_waste(500000);
+	test_relearn_and_forget(1000000);
+
+	VAMP_TEST_END();
+}
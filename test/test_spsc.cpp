@@ -0,0 +1,140 @@
+/**
+ * @file test_spsc.cpp
+ * @brief Prueba de vamp_spsc_queue: casos límite en un hilo y un productor y
+ * un consumidor en hilos distintos, que es el uso para el que está pensada
+ */
+
+#include "lib/vamp_spsc.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+#include <thread>
+
+/* Trama de prueba, el contenido se deriva de la secuencia para detectar
+elementos leídos antes de que el productor terminara de escribirlos */
+typedef struct {
+	uint32_t seq;
+	uint8_t data[28];
+} test_frame_t;
+
+static void fill(test_frame_t * frame, uint32_t seq) {
+	frame->seq = seq;
+	for (uint8_t i = 0; i < sizeof(frame->data); i++) {
+		frame->data[i] = (uint8_t)(seq * 31 + i);
+	}
+}
+
+static bool valid(const test_frame_t * frame, uint32_t seq) {
+	if (frame->seq != seq) {
+		return false;
+	}
+	for (uint8_t i = 0; i < sizeof(frame->data); i++) {
+		if (frame->data[i] != (uint8_t)(seq * 31 + i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_single_thread(void) {
+
+	vamp_spsc_queue<int, 4> queue;
+	int item = 0;
+
+	VAMP_CHECK(queue.empty());
+	VAMP_CHECK(queue.front() == NULL);
+	VAMP_CHECK(!queue.pop(item));
+
+	/* Llenar hasta la capacidad */
+	for (int i = 0; i < 4; i++) {
+		VAMP_CHECK(queue.push(i));
+	}
+	VAMP_CHECK_EQ(queue.size(), 4);
+	VAMP_CHECK(!queue.push(99));
+	VAMP_CHECK(queue.reserve() == NULL);
+
+	/* Orden FIFO */
+	for (int i = 0; i < 4; i++) {
+		VAMP_CHECK(queue.pop(item));
+		VAMP_CHECK_EQ(item, i);
+	}
+	VAMP_CHECK(queue.empty());
+
+	/* Los índices de 8 bits dan la vuelta muchas veces */
+	for (int i = 0; i < 1000; i++) {
+		int * slot = queue.reserve();
+		VAMP_CHECK(slot != NULL);
+		if (slot) {
+			*slot = i;
+			queue.commit();
+		}
+		int * head = queue.front();
+		VAMP_CHECK(head != NULL && *head == i);
+		queue.pop();
+	}
+	VAMP_CHECK(queue.empty());
+
+	/* clear() desde el consumidor */
+	queue.push(1);
+	queue.push(2);
+	queue.clear();
+	VAMP_CHECK(queue.empty());
+	VAMP_CHECK(queue.push(3));
+	VAMP_CHECK(queue.pop(item) && item == 3);
+}
+
+/* Un hilo produce con reserve()/commit(), como nrf_drain(), y otro consume con
+front()/pop(), como nrf_read(). Una cola chica fuerza que esté llena y vacía
+muchas veces */
+template <uint8_t N>
+static void test_two_threads(uint32_t count) {
+
+	static vamp_spsc_queue<test_frame_t, N> queue;
+	uint32_t produced_full = 0;
+	uint32_t bad = 0;
+
+	std::thread producer([&]() {
+		for (uint32_t seq = 0; seq < count; ) {
+			test_frame_t * frame = queue.reserve();
+			if (!frame) {
+				produced_full++;
+				std::this_thread::yield();
+				continue;
+			}
+			fill(frame, seq++);
+			queue.commit();
+		}
+	});
+
+	std::thread consumer([&]() {
+		for (uint32_t seq = 0; seq < count; ) {
+			test_frame_t * frame = queue.front();
+			if (!frame) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (!valid(frame, seq)) {
+				bad++;
+			}
+			queue.pop();
+			seq++;
+		}
+	});
+
+	producer.join();
+	consumer.join();
+
+	VAMP_CHECK_EQ(bad, 0);
+	VAMP_CHECK(queue.empty());
+	printf("   N=%d: %u tramas, cola llena %u veces\n", N, count, produced_full);
+}
+
+int main(void) {
+
+	test_single_thread();
+	test_two_threads<2>(200000);
+	test_two_threads<16>(1000000);
+	test_two_threads<128>(1000000);
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,83 @@
+/**
+ * @file test_url.cpp
+ * @brief Prueba de vamp_url: URL de los perfiles con y sin puerto y ruta, y los
+ * que se rechazan
+ */
+
+#include "lib/vamp_url.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+static bool parsed(const char * url, const char * scheme, const char * host, uint16_t port, const char * path, bool secure) {
+	vamp_url_t out;
+	if (!vamp_url_parse(url, &out)) {
+		printf("   no se leyó %s\n", url);
+		return false;
+	}
+	if (strcmp(out.scheme, scheme) != 0 || strcmp(out.host, host) != 0 || out.port != port ||
+			strcmp(out.path, path) != 0 || out.secure != secure) {
+		printf("   %s -> %s %s %u %s %d\n", url, out.scheme, out.host, out.port, out.path, out.secure);
+		return false;
+	}
+	return true;
+}
+
+static void test_valid(void) {
+
+	VAMP_CHECK(parsed("http://vreg.local/api/gw?id=1", "http", "vreg.local", 80, "/api/gw?id=1", false));
+	VAMP_CHECK(parsed("HTTPS://Api.Example.com", "https", "Api.Example.com", 443, "/", true));
+	VAMP_CHECK(parsed("mqtt://192.168.1.10:1884/vamp/up", "mqtt", "192.168.1.10", 1884, "/vamp/up", false));
+	VAMP_CHECK(parsed("mqtts://broker", "mqtts", "broker", 8883, "/", true));
+	VAMP_CHECK(parsed("coap://10.0.0.2/sensores", "coap", "10.0.0.2", 5683, "/sensores", false));
+	VAMP_CHECK(parsed("coaps://10.0.0.2:6000", "coaps", "10.0.0.2", 6000, "/", true));
+	VAMP_CHECK(parsed("ws://gw.local:8080?canal=1", "ws", "gw.local", 8080, "?canal=1", false));
+	VAMP_CHECK(parsed("wss://gw.local/ws", "wss", "gw.local", 443, "/ws", true));
+
+	/* Un esquema desconocido sirve si trae el puerto */
+	VAMP_CHECK(parsed("tcp://gw.local:9000", "tcp", "gw.local", 9000, "/", false));
+
+	/* La ruta apunta dentro del URL original */
+	const char * url = "http://h/x";
+	vamp_url_t out;
+	VAMP_CHECK(vamp_url_parse(url, &out) && out.path == url + 8);
+
+	VAMP_CHECK_EQ(vamp_url_default_port("wss"), 443);
+	VAMP_CHECK_EQ(vamp_url_default_port("gopher"), 0);
+	VAMP_CHECK_EQ(vamp_url_default_port(NULL), 0);
+}
+
+static void test_invalid(void) {
+
+	vamp_url_t out;
+	char long_host[VAMP_URL_HOST_MAX_LEN + 16];
+
+	VAMP_CHECK(!vamp_url_parse("vreg.local/api", &out));
+	VAMP_CHECK(!vamp_url_parse("://vreg.local", &out));
+	VAMP_CHECK(!vamp_url_parse("http:///api", &out));
+	VAMP_CHECK(!vamp_url_parse("http://:80/api", &out));
+	VAMP_CHECK(!vamp_url_parse("toolongscheme://h", &out));
+	VAMP_CHECK(!vamp_url_parse("tcp://gw.local", &out));
+	VAMP_CHECK(!vamp_url_parse("http://h:/x", &out));
+	VAMP_CHECK(!vamp_url_parse("http://h:0", &out));
+	VAMP_CHECK(!vamp_url_parse("http://h:65536", &out));
+	VAMP_CHECK(!vamp_url_parse("http://h:80x/api", &out));
+	VAMP_CHECK(!vamp_url_parse(NULL, &out));
+
+	/* El host tiene que entrar en VAMP_URL_HOST_MAX_LEN con su terminador */
+	strcpy(long_host, "http://");
+	memset(long_host + 7, 'a', VAMP_URL_HOST_MAX_LEN);
+	long_host[7 + VAMP_URL_HOST_MAX_LEN] = '\0';
+	VAMP_CHECK(!vamp_url_parse(long_host, &out));
+	long_host[7 + VAMP_URL_HOST_MAX_LEN - 1] = '\0';
+	VAMP_CHECK(vamp_url_parse(long_host, &out));
+	VAMP_CHECK_EQ(strlen(out.host), VAMP_URL_HOST_MAX_LEN - 1);
+}
+
+int main(void) {
+
+	test_valid();
+	test_invalid();
+
+	VAMP_TEST_END();
+}
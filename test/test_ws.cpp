@@ -0,0 +1,177 @@
+/**
+ * @file test_ws.cpp
+ * @brief Prueba de vamp_ws: tramas del cliente, mensajes fragmentados con tramas
+ * de control en el medio y los límites del lector
+ */
+
+#include "lib/vamp_ws.h"
+#include "test/vamp_test.h"
+
+#include <string.h>
+
+/* Trama de servidor (sin máscara) */
+static size_t server_frame(uint8_t * buf, bool fin, uint8_t opcode, const char * payload, size_t len) {
+	size_t n = 0;
+	buf[n++] = (fin ? 0x80 : 0x00) | opcode;
+	if (len > 125) {
+		buf[n++] = 126;
+		buf[n++] = (uint8_t)(len >> 8);
+		buf[n++] = (uint8_t)(len & 0xFF);
+	} else {
+		buf[n++] = (uint8_t)len;
+	}
+	memcpy(buf + n, payload, len);
+	return n + len;
+}
+
+/* Pasar una trama entera al lector, devuelve lo que dijo el último byte */
+static int8_t feed(vamp_ws_reader_t * reader, const uint8_t * buf, size_t len) {
+	int8_t res = 0;
+	for (size_t i = 0; i < len; i++) {
+		res = vamp_ws_reader_feed(reader, buf[i]);
+		if (res != 0 && i + 1 < len) {
+			return -2;	// terminó antes de tiempo
+		}
+	}
+	return res;
+}
+
+static void test_message(void) {
+
+	static vamp_ws_reader_t reader;
+	uint8_t buf[512];
+	vamp_ws_reader_reset(&reader);
+
+	size_t len = server_frame(buf, true, VAMP_WS_OP_TEXT, "hola", 4);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK_EQ(reader.opcode, VAMP_WS_OP_TEXT);
+	VAMP_CHECK_EQ(reader.len, 4);
+	VAMP_CHECK(strcmp((char *)reader.data, "hola") == 0);
+
+	/* Largo extendido de 2 bytes, más de lo que se guarda */
+	char big[300];
+	memset(big, 'x', sizeof(big));
+	len = server_frame(buf, true, VAMP_WS_OP_BINARY, big, sizeof(big));
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK_EQ(reader.opcode, VAMP_WS_OP_BINARY);
+	VAMP_CHECK_EQ(reader.len, VAMP_WS_RX_MAX);
+	VAMP_CHECK(reader.truncated);
+
+	/* El siguiente mensaje empieza limpio */
+	len = server_frame(buf, true, VAMP_WS_OP_TEXT, "ok", 2);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK(!reader.truncated);
+	VAMP_CHECK(strcmp((char *)reader.data, "ok") == 0);
+}
+
+/* Un PING entre dos fragmentos no pisa el mensaje a medio armar */
+static void test_interleaved_control(void) {
+
+	static vamp_ws_reader_t reader;
+	uint8_t buf[64];
+	size_t len;
+	vamp_ws_reader_reset(&reader);
+
+	len = server_frame(buf, false, VAMP_WS_OP_TEXT, "{\"rf_id\":", 9);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), 0);
+
+	len = server_frame(buf, true, VAMP_WS_OP_PING, "ab", 2);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_CONTROL);
+	VAMP_CHECK_EQ(reader.control_opcode, VAMP_WS_OP_PING);
+	VAMP_CHECK_EQ(reader.control_len, 2);
+	VAMP_CHECK(strcmp((char *)reader.control, "ab") == 0);
+
+	/* Un PONG vacío también */
+	len = server_frame(buf, true, VAMP_WS_OP_PONG, "", 0);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_CONTROL);
+	VAMP_CHECK_EQ(reader.control_opcode, VAMP_WS_OP_PONG);
+	VAMP_CHECK_EQ(reader.control_len, 0);
+
+	len = server_frame(buf, false, VAMP_WS_OP_CONT, "\"01\",", 5);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), 0);
+	len = server_frame(buf, true, VAMP_WS_OP_CONT, "\"data\":\"x\"}", 11);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK_EQ(reader.opcode, VAMP_WS_OP_TEXT);
+	VAMP_CHECK(!reader.truncated);
+	VAMP_CHECK(strcmp((char *)reader.data, "{\"rf_id\":\"01\",\"data\":\"x\"}") == 0);
+}
+
+static void test_invalid(void) {
+
+	static vamp_ws_reader_t reader;
+	uint8_t buf[256];
+	char big[126];
+	memset(big, 'x', sizeof(big));
+	size_t len;
+
+	/* Control fragmentado */
+	vamp_ws_reader_reset(&reader);
+	len = server_frame(buf, false, VAMP_WS_OP_PING, "a", 1);
+	VAMP_CHECK_EQ(vamp_ws_reader_feed(&reader, buf[0]), -1);
+
+	/* Control de más de 125 bytes */
+	vamp_ws_reader_reset(&reader);
+	len = server_frame(buf, true, VAMP_WS_OP_PING, big, sizeof(big));
+	VAMP_CHECK_EQ(feed(&reader, buf, 2), -1);
+
+	/* Largo de 8 bytes de más de 4 GB */
+	vamp_ws_reader_reset(&reader);
+	const uint8_t huge[] = { 0x82, 127, 0x00, 0x00, 0x00, 0x01 };
+	VAMP_CHECK_EQ(feed(&reader, huge, sizeof(huge)), -1);
+
+	/* Tras un error el lector sigue sirviendo */
+	len = server_frame(buf, true, VAMP_WS_OP_CLOSE, "", 0);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_CONTROL);
+	VAMP_CHECK_EQ(reader.control_opcode, VAMP_WS_OP_CLOSE);
+}
+
+/* Las tramas del cliente van enmascaradas, el lector las desenmascara */
+static void test_client_frame(void) {
+
+	static vamp_ws_reader_t reader;
+	const uint8_t mask[4] = { 0x37, 0xFA, 0x21, 0x3D };
+	uint8_t buf[512];
+	vamp_ws_reader_reset(&reader);
+
+	/* Ejemplo de RFC 6455 5.7 */
+	const uint8_t hello[] = { 0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 };
+	size_t len = vamp_ws_frame(buf, sizeof(buf), VAMP_WS_OP_TEXT, (const uint8_t *)"Hello", 5, mask);
+	VAMP_CHECK(len == sizeof(hello) && memcmp(buf, hello, len) == 0);
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK(strcmp((char *)reader.data, "Hello") == 0);
+
+	uint8_t payload[200];
+	for (size_t i = 0; i < sizeof(payload); i++) {
+		payload[i] = (uint8_t)i;
+	}
+	len = vamp_ws_frame(buf, sizeof(buf), VAMP_WS_OP_BINARY, payload, sizeof(payload), mask);
+	VAMP_CHECK_EQ(len, 2 + 2 + 4 + sizeof(payload));
+	VAMP_CHECK_EQ(feed(&reader, buf, len), VAMP_WS_RX_MESSAGE);
+	VAMP_CHECK(reader.len == sizeof(payload) && memcmp(reader.data, payload, sizeof(payload)) == 0);
+
+	VAMP_CHECK_EQ(vamp_ws_frame(buf, len - 1, VAMP_WS_OP_BINARY, payload, sizeof(payload), mask), 0);
+}
+
+static void test_base64(void) {
+
+	char out[32];
+
+	/* Sec-WebSocket-Key del ejemplo de RFC 6455 1.3 */
+	VAMP_CHECK_EQ(vamp_ws_base64((const uint8_t *)"the sample nonce", 16, out, sizeof(out)), 24);
+	VAMP_CHECK(strcmp(out, "dGhlIHNhbXBsZSBub25jZQ==") == 0);
+
+	VAMP_CHECK_EQ(vamp_ws_base64((const uint8_t *)"ab", 2, out, sizeof(out)), 4);
+	VAMP_CHECK(strcmp(out, "YWI=") == 0);
+	VAMP_CHECK_EQ(vamp_ws_base64((const uint8_t *)"the sample nonce", 16, out, 24), 0);
+}
+
+int main(void) {
+
+	test_message();
+	test_interleaved_control();
+	test_invalid();
+	test_client_frame();
+	test_base64();
+
+	VAMP_TEST_END();
+}
@@ -0,0 +1,42 @@
+/**
+ * @file vamp_test.h
+ * @brief Macros mínimas para las pruebas en el host de las bibliotecas de lib/
+ *
+ * Cada prueba es un programa aparte que devuelve 0 si todo pasó. Se compilan
+ * y corren con test/run_host.sh.
+ */
+
+#ifndef _VAMP_TEST_H_
+#define _VAMP_TEST_H_
+
+#include <stdio.h>
+
+static int vamp_test_failures = 0;
+
+/* Reportar y seguir, para ver todas las fallas de una corrida */
+#define VAMP_CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: falló %s\n", __FILE__, __LINE__, #cond); \
+		vamp_test_failures++; \
+	} \
+} while (0)
+
+#define VAMP_CHECK_EQ(a, b) do { \
+	long long _a = (long long)(a), _b = (long long)(b); \
+	if (_a != _b) { \
+		printf("%s:%d: falló %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		vamp_test_failures++; \
+	} \
+} while (0)
+
+/* Al final de main() */
+#define VAMP_TEST_END() do { \
+	if (vamp_test_failures) { \
+		printf("%d fallas\n", vamp_test_failures); \
+		return 1; \
+	} \
+	printf("ok\n"); \
+	return 0; \
+} while (0)
+
+#endif /* _VAMP_TEST_H_ */
@@ -69,9 +69,49 @@ void vamp_gw_init(const gw_config_t * gw_config) {
 
 void vamp_gw_sync(void) {
 
+	/* La sincronización bloquea mientras dura */
+	vamp_wsn_send_pending();
 	vamp_table_sync();
 }
 
+/* Sincronizar solo cuando el planificador lo indique */
+bool vamp_gw_sync_poll(void) {
+
+	#ifdef VAMP_SYNC_LONGPOLL
+	/* El delta del long-poll cuenta como sincronización */
+	bool delta = vamp_table_sync_longpoll();
+	#else
+	bool delta = false;
+	#endif /* VAMP_SYNC_LONGPOLL */
+
+	if (!vamp_table_sync_due()) {
+		return delta;
+	}
+
+	vamp_table_sync();
+	return true;
+}
+
+/* Una vuelta del lazo del gateway, nada espera a la red salvo la sincronización */
+int8_t vamp_gw_poll(void) {
+
+	int8_t wsn = vamp_gw_wsn();
+
+	#ifdef VAMP_HTTP_ASYNC
+	/* Abrir el request puede bloquear en la conexión TLS */
+	vamp_wsn_send_pending();
+	/* El VREG va por el cliente bloqueante, no se abre junto a un request en vuelo */
+	if (vamp_gw_uplink_poll()) {
+		return wsn;
+	}
+	#endif /* VAMP_HTTP_ASYNC */
+
+	/* La sincronización bloquea mientras dura */
+	vamp_wsn_send_pending();
+	vamp_gw_sync_poll();
+	return wsn;
+}
+
 /* -------------------------------------- WSN -------------------------------------- */
 
 
@@ -89,9 +129,10 @@ bool vamp_is_rf_id_valid(const uint8_t * rf_id) {
 		return false; // RF_ID nulo
 	}
 
-	if (rf_id[0] == 0xFF && rf_id[1] == 0xFF && rf_id[2] == 0xFF &&
+	/* El broadcast y sus sub-direcciones solo difieren en el primer byte */
+	if (rf_id[1] == 0xFF && rf_id[2] == 0xFF &&
 	    rf_id[3] == 0xFF && rf_id[4] == 0xFF) {
-		return false; // RF_ID de broadcast
+		return false; // RF_ID de broadcast o de una sub-dirección
 	}
 
 	return true;
@@ -34,6 +34,22 @@
 /* Valores especiales para longitud */
 #define VAMP_WSN_LENGTH_ESCAPE        31            // Longitud = 31 indica escape (datos adicionales siguen)
 
+/** Número de secuencia de las tramas de datos (VAMP_DATA_SEQ)
+ * [0|PP|LLLLL][ID][len si escape][SEQ][datos...]
+ * La secuencia 0 indica inicio de flujo (el nodo arrancó) y reinicia la ventana
+ * del gateway, al dar la vuelta el nodo salta de 255 a 1. El JOIN_REQ con
+ * VAMP_JOIN_FLAG_BOOT también la reinicia. La secuencia avanza con
+ * cada envío exitoso, una trama que falló conserva la suya si se reenvía igual.
+ */
+#ifdef VAMP_DATA_SEQ
+#define VAMP_DATA_SEQ_LEN             1
+#else
+#define VAMP_DATA_SEQ_LEN             0
+#endif /* VAMP_DATA_SEQ */
+
+/** Ventana de duplicados del gateway, en tramas hacia atrás desde la última */
+#define VAMP_DATA_SEQ_WINDOW          32
+
 
 /** Client Message types (datos/comandos)
  * Se utiliza un solo byte para tanto identificar el tipo de mensaje como 
@@ -57,10 +73,96 @@
 #define VAMP_PONG           0x04
 #define VAMP_POLL           0x05
 #define VAMP_TICKET         0x06
+#define VAMP_FRAG           0x07
+#define VAMP_JOIN_PENDING   0x08
+#define VAMP_ALARM          0x09
 
 /*  Largo que deberian tener cada uno de los mensajes de comando para poder 
     verificarlos */
-#define VAMP_JOIN_REQ_LEN   0x06 // 1 byte comando + 5 bytes RF_ID
+#define VAMP_JOIN_REQ_LEN   (0x06 + VAMP_DATA_SEQ_LEN) // 1 byte comando + 5 bytes RF_ID (+ flags)
+
+/** Con VAMP_DATA_SEQ el JOIN_REQ lleva un byte de flags tras el RF_ID.
+ * VAMP_JOIN_FLAG_BOOT: primer JOIN desde que el nodo arrancó, su secuencia
+ * empieza de nuevo. Sin él el nodo está reintentando (re-join por fallos) y
+ * puede reenviar la última trama que el gateway ya recibió.
+ */
+#define VAMP_JOIN_FLAG_BOOT 0x01
+
+/** JOIN_PENDING: el gateway no tiene al nodo en caché y lo está buscando en el
+ * VREG, el nodo debe repetir el JOIN_REQ pasados "retry_ms" milisegundos
+ * [0x88][retry_ms MSB][retry_ms LSB]
+ */
+#define VAMP_JOIN_PENDING_LEN   0x03
+
+/** Fragmentos: mensajes del nodo mayores que una trama
+ * [0x87][ID compacto][L|PP|MMMMM][offset][datos...]
+ *  - L: último fragmento del mensaje
+ *  - PP: perfil por el que se reencamina el mensaje completo
+ *  - MMMMM: identificador del mensaje (0-31), distingue un mensaje del siguiente
+ *  - offset: posición del fragmento dentro del mensaje (bytes)
+ * El gateway responde cada fragmento intermedio con [0x87][ID][hdr][siguiente offset]
+ * y el último con el TICKET del mensaje completo.
+ */
+#define VAMP_FRAG_HDR_LEN               4
+#define VAMP_FRAG_LAST_MASK             0x80
+#define VAMP_FRAG_MAKE_HDR(last, profile, msg_id)   (((last) ? VAMP_FRAG_LAST_MASK : 0) | (((profile) & 0x03) << 5) | ((msg_id) & 0x1F))
+#define VAMP_FRAG_GET_PROFILE(hdr)      (((hdr) >> 5) & 0x03)
+#define VAMP_FRAG_GET_MSG_ID(hdr)       ((hdr) & 0x1F)
+#define VAMP_FRAG_IS_LAST(hdr)          ((hdr) & VAMP_FRAG_LAST_MASK)
+/* Datos que caben en cada fragmento */
+#define VAMP_FRAG_CHUNK_SIZE            (VAMP_MAX_PAYLOAD_SIZE - VAMP_FRAG_HDR_LEN)
+
+/** POLL: el nodo pide la respuesta de su ticket
+ * [0x85][ID compacto][ticket MSB][ticket LSB]
+ * [0x85][ID compacto][ticket MSB][ticket LSB][offset MSB][offset LSB][opciones]  (VAMP_POLL_PAGING)
+ * El gateway responde [largo][estado][datos...] con hasta VAMP_POLL_PAGE_SIZE bytes
+ * de la respuesta a partir de offset (0 en el POLL corto). El estado indica si es
+ * la última página y si la respuesta completa está comprimida (lib/vamp_lzss.h),
+ * el POLL corto siempre recibe VAMP_POLL_END.
+ */
+#define VAMP_POLL_REQ_LEN               4
+#define VAMP_POLL_PAGED_REQ_LEN         7
+#define VAMP_POLL_ACCEPT_LZSS           0x01    // Opción: el nodo descomprime
+#define VAMP_POLL_HDR_LEN               2
+#define VAMP_POLL_END                   0xFF    // Última página
+#define VAMP_POLL_MORE                  0xFE    // Faltan páginas
+#define VAMP_POLL_END_LZSS              0xFD
+#define VAMP_POLL_MORE_LZSS             0xFC
+#define VAMP_POLL_IS_LAST(status)       ((status) & 0x01)
+#define VAMP_POLL_IS_LZSS(status)       (!((status) & 0x02))
+/* Con VAMP_WSN_ACK_PAYLOAD la respuesta en el ACK lleva delante el ID compacto
+del destinatario, el ACK del pipe 0 lo recibe el primer nodo que transmita */
+#ifdef VAMP_WSN_ACK_PAYLOAD
+#define VAMP_ACK_TAG_LEN                1
+#else
+#define VAMP_ACK_TAG_LEN                0
+#endif /* VAMP_WSN_ACK_PAYLOAD */
+/* Datos que caben en cada página */
+#define VAMP_POLL_PAGE_SIZE             (VAMP_MAX_PAYLOAD_SIZE - VAMP_POLL_HDR_LEN - VAMP_ACK_TAG_LEN)
+
+/** Pipes del nRF24 en el gateway. Con VAMP_WSN_SUBADDR el pipe por el que llega
+ * la trama ya la clasifica sin mirar el contenido:
+ *  - 0: dirección del gateway, con ACK
+ *  - 1: broadcast, sin ACK
+ *  - 2: alarmas (VAMP_ALARM_ADDR), se atienden antes que las demás tramas
+ *  - 3: JOIN_REQ (VAMP_JOIN_ADDR)
+ * Los pipes 4 y 5 quedan libres: sus direcciones también serían compartidas por
+ * todos los gateways y un ID compacto solo vale en el gateway que lo asignó.
+ */
+#define VAMP_WSN_PIPE_GW                0
+#define VAMP_WSN_PIPE_BCAST             1
+#define VAMP_WSN_PIPE_ALARM             2
+#define VAMP_WSN_PIPE_JOIN              3
+
+/** ALARM: mensaje urgente del nodo, enviado a VAMP_ALARM_ADDR
+ * [0x89][ID compacto][perfil][dirección del gateway (5)][datos...]
+ * Como la dirección la escuchan todos los gateways, la dirección completa del
+ * gateway al que se unió el nodo descarta las alarmas de nodos de otro gateway
+ * con el mismo ID compacto. El gateway la reencamina sin pasar por la caché ni
+ * la cola del cliente no bloqueante y responde con un TICKET.
+ */
+#define VAMP_ALARM_GW_OFFSET            3
+#define VAMP_ALARM_HDR_LEN              (VAMP_ALARM_GW_OFFSET + VAMP_ADDR_LEN)
 
 
 /** Métodos VAMP
@@ -91,6 +193,28 @@ void vamp_gw_init(const gw_config_t * gw_config);
  */
 void vamp_gw_sync(void);
 
+/**
+ * @brief Synchronize with VREG only when the adaptive scheduler says so
+ * 
+ * Meant to be called on every loop iteration instead of a fixed sync_interval.
+ * The interval backs off while VREG reports no changes, tightens after changes
+ * or unknown JOINs, honours the VREG "next_sync" hint and carries random jitter.
+ * With VAMP_SYNC_LONGPOLL it also services the parked long-poll request, so the
+ * VREG can push deltas as soon as they exist; it never waits on that request.
+ * @return true if a sync was performed
+ */
+bool vamp_gw_sync_poll(void);
+
+/**
+ * @brief One cooperative iteration of the gateway loop
+ * 
+ * Processes a radio frame (vamp_gw_wsn), advances the in-flight HTTP uplink one
+ * phase with VAMP_HTTP_ASYNC, and runs the scheduled VREG sync while no uplink
+ * is in flight. Meant to be called on every loop iteration, next to the web server.
+ * @return Result of vamp_gw_wsn()
+ */
+int8_t vamp_gw_poll(void);
+
 
 /** @brief Check if the RF_ID is valid
  * 
@@ -211,6 +211,54 @@ int8_t vamp_wsn_recv(uint8_t * data, uint8_t len) {
 
 }
 
+/* Momento de recepción de la última trama entregada */
+uint32_t vamp_wsn_get_rx_time(void) {
+
+	#ifdef RF24_AVAILABLE
+	return nrf_get_rx_time();
+	#else
+	return millis();
+	#endif // RF24_AVAILABLE
+
+}
+
+/* Enviar las respuestas que esperan la próxima ráfaga */
+bool vamp_wsn_send_pending(void) {
+
+	#if defined(RF24_AVAILABLE) && defined(VAMP_WSN_TX_BATCH)
+	return nrf_tx_send();
+	#else
+	return true;
+	#endif // RF24_AVAILABLE && VAMP_WSN_TX_BATCH
+
+}
+
+/* Pipe de la última trama entregada */
+uint8_t vamp_wsn_get_rx_pipe(void) {
+
+	#ifdef RF24_AVAILABLE
+	return nrf_get_rx_pipe();
+	#else
+	return 0;
+	#endif // RF24_AVAILABLE
+
+}
+
+/* Estadísticas de recepción */
+void vamp_wsn_get_stats(vamp_wsn_stats_t * stats) {
+
+	if (!stats) {
+		return;
+	}
+
+	#ifdef RF24_AVAILABLE
+	nrf_get_stats(stats);
+	#else
+	memset(stats, 0, sizeof(vamp_wsn_stats_t));
+	#endif // RF24_AVAILABLE
+
+}
+
 /* ----------------------------- /wsn --------------------------------- */
 
 
@@ -220,6 +268,11 @@ int8_t vamp_wsn_recv(uint8_t * data, uint8_t len) {
 
 #if defined(ARDUINO_ARCH_ESP8266)
 #include "arch/iface/vamp_esp8266.h"
+#include "arch/iface/vamp_mqtt.h"
+#include "arch/iface/vamp_coap.h"
+#include "arch/iface/vamp_ws.h"
+#include "arch/iface/vamp_http.h"
+#include "arch/iface/vamp_dns.h"
 #endif
 
 bool vamp_iface_init(const gw_config_t * vamp_conf) {
@@ -229,6 +282,19 @@ bool vamp_iface_init(const gw_config_t * vamp_conf) {
 	}
 
 	#if defined(ARDUINO_ARCH_ESP8266)
+	/* Registrar solo los transportes que se compilaron */
+	vamp_transport_register(VAMP_PROTOCOL_HTTP, &esp8266_http_transport);
+	vamp_transport_register(VAMP_PROTOCOL_HTTPS, &esp8266_http_transport);
+	#ifdef VAMP_MQTT
+	vamp_transport_register(VAMP_PROTOCOL_MQTT, &vamp_mqtt_transport);
+	#endif /* VAMP_MQTT */
+	#ifdef VAMP_COAP
+	vamp_transport_register(VAMP_PROTOCOL_COAP, &vamp_coap_transport);
+	#endif /* VAMP_COAP */
+	#ifdef VAMP_WS
+	vamp_transport_register(VAMP_PROTOCOL_WEBSOCKET, &vamp_ws_transport);
+	#endif /* VAMP_WS */
+
 	/* Inicializar la interfaz WiFi - esto conecta y configura */
 	if(esp8266_sta_init(vamp_conf)){
 		return true;
@@ -295,15 +361,98 @@ bool vamp_iface_init(const gw_config_t * vamp_conf) {
 } */
 
 /* Internal helper that uses explicit method and params */
-uint8_t vamp_iface_comm(const vamp_profile_t * profile, char * data, size_t len) {
+size_t vamp_iface_comm(const vamp_profile_t * profile, char * data, size_t len, size_t size) {
 	if (!profile || !data) {
 		return 0;
 	}
 
+	/* El esquema ya se resolvió al cargar el perfil */
+	const vamp_transport_t * transport = vamp_transport_get(profile->protocol);
+	if (!transport) {
+		#ifdef VAMP_DEBUG
+		printf("[CALLBACK] No transport for protocol %u\n", profile->protocol);
+		#endif /* VAMP_DEBUG */
+		return 0;
+	}
+
+	if (transport->open && !transport->open(profile)) {
+		return 0;
+	}
+
+	if (!transport->send(profile, data, len, size)) {
+		return 0;
+	}
+
+	/* MQTT y WebSocket no tienen respuesta síncrona (ver vamp_gw_downlink()) */
+	if (!transport->receive) {
+		return 0;
+	}
+
+	return transport->receive(profile, data, size);
+}
+
+/* Mantenimiento de las conexiones persistentes, con el radio ocioso */
+void vamp_iface_loop(void) {
+
 	#if defined(ARDUINO_ARCH_ESP8266)
-	/* Usar función unificada para HTTP/HTTPS */
-	return esp8266_http_request(profile, data, len);
+	#ifdef VAMP_DNS_CACHE
+	vamp_dns_loop();
+	#endif /* VAMP_DNS_CACHE */
 	#endif
 
-	return 0;
-}
\ No newline at end of file
+	vamp_transport_poll_all();
+}
+
+#ifdef VAMP_HTTP_ASYNC
+/* Request no bloqueante, avanza con vamp_iface_request_poll() */
+bool vamp_iface_request_start(const vamp_profile_t * profile, const char * data, size_t len) {
+	if (!profile) {
+		return false;
+	}
+
+	#if defined(ARDUINO_ARCH_ESP8266)
+	return vamp_http_async_start(profile, data, len);
+	#endif
+
+	return false;
+}
+
+int16_t vamp_iface_request_poll(char * data, size_t len) {
+	if (!data || len == 0) {
+		return VAMP_REQUEST_ERROR;
+	}
+
+	#if defined(ARDUINO_ARCH_ESP8266)
+	return vamp_http_async_poll(data, len);
+	#endif
+
+	return VAMP_REQUEST_ERROR;
+}
+#endif /* VAMP_HTTP_ASYNC */
+
+#ifdef VAMP_SYNC_LONGPOLL
+/* Consulta long-poll al VREG, en su propia conexión */
+bool vamp_iface_longpoll_start(const vamp_profile_t * profile, uint32_t timeout_ms) {
+	if (!profile) {
+		return false;
+	}
+
+	#if defined(ARDUINO_ARCH_ESP8266)
+	return esp8266_longpoll_start(profile, timeout_ms);
+	#endif
+
+	return false;
+}
+
+int16_t vamp_iface_longpoll_poll(char * data, size_t len) {
+	if (!data || len == 0) {
+		return VAMP_LONGPOLL_ERROR;
+	}
+
+	#if defined(ARDUINO_ARCH_ESP8266)
+	return esp8266_longpoll_poll(data, len);
+	#endif
+
+	return VAMP_LONGPOLL_ERROR;
+}
+#endif /* VAMP_SYNC_LONGPOLL */
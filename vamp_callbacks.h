@@ -96,6 +96,52 @@ bool vamp_wsn_send_ticket(uint8_t * dst_addr, uint16_t ticket);
  */
 int8_t vamp_wsn_recv(uint8_t * data, uint8_t len);
 
+/**
+ * @brief Momento (millis) en que el radio recibió la última trama entregada
+ * 		  por vamp_wsn_recv(). Como las tramas pueden esperar en el anillo de
+ * 		  recepción, este valor es más fiel que millis() al procesarlas.
+ * @return Timestamp en millis() de la recepción
+ */
+uint32_t vamp_wsn_get_rx_time(void);
+
+/**
+ * @brief Enviar ya las respuestas que esperan la próxima ráfaga de TX
+ * 		  (VAMP_WSN_TX_BATCH), al final de vamp_gw_wsn() y antes de una
+ * 		  operación que bloquea al gateway
+ * @return false si alguna respuesta no recibió ACK, true si no había nada
+ */
+bool vamp_wsn_send_pending(void);
+
+/**
+ * @brief Pipe del radio por el que llegó la última trama entregada por
+ * 		  vamp_wsn_recv() (VAMP_WSN_PIPE_*)
+ * @return Número de pipe, 0 si el radio no lo informa
+ */
+uint8_t vamp_wsn_get_rx_pipe(void);
+
+/** Estadísticas de recepción y envío del WSN */
+typedef struct {
+	uint32_t rx_frames;			// Tramas extraídas de la FIFO del chip
+	uint32_t hw_overflows;		// Veces que la FIFO del chip se encontró llena (posibles pérdidas)
+	uint32_t ring_drops;		// Tramas descartadas por tener el anillo lleno
+	uint8_t ring_high_water;	// Máxima ocupación alcanzada por el anillo
+	uint32_t ack_payloads;		// Respuestas precargadas como payload de ACK
+	uint32_t ack_misses;		// ACK con respuesta que se llevó otro nodo (se vuelve a cargar)
+	uint32_t ack_drops;			// Respuestas precargadas que no llegaron (reemplazadas, sin lugar o vencidas)
+	uint32_t rx_alarms;			// Tramas llegadas por el pipe de alarmas (VAMP_WSN_SUBADDR)
+	uint32_t tx_frames;			// Tramas enviadas en modo siempre escucha
+	uint32_t tx_bursts;			// Veces que se dejó de escuchar para enviar
+	uint32_t tx_failures;		// Envíos sin ACK (por ráfaga y destino con VAMP_WSN_TX_BATCH)
+	uint32_t tx_blind_us;		// Tiempo total sin escuchar por enviar (us)
+	uint32_t tx_blind_max_us;	// Máximo tiempo sin escuchar en un envío (us)
+} vamp_wsn_stats_t;
+
+/**
+ * @brief Obtener las estadísticas de recepción del WSN
+ * @param stats Estructura donde se copian las estadísticas
+ */
+void vamp_wsn_get_stats(vamp_wsn_stats_t * stats);
+
 
 
 /* ---------------------------------- gateway ---------------------------------- */
@@ -124,10 +170,66 @@ struct vamp_profile_t;
  * @brief Function for sending data to the VREG server
  * @param profile entire profile of the VREG resource
  * @param data  Data to send, if answer, data will contain the response
- * @param len Length of data buffer
+ * @param len Length of the data to send
+ * @param size Size of the data buffer, the response may use up to size - 1 bytes
  * @return len of data received from the server, 0 on failure
  */
-uint8_t vamp_iface_comm(const vamp_profile_t * profile, char * data, size_t len);
+size_t vamp_iface_comm(const vamp_profile_t * profile, char * data, size_t len, size_t size);
+
+/**
+ * @brief Service persistent transports (keepalive, acks, reconnect)
+ * Called from the gateway loop while the radio is idle, never blocks except
+ * while reconnecting
+ */
+void vamp_iface_loop(void);
+
+#ifdef VAMP_HTTP_ASYNC
+/** @brief Resultados de vamp_iface_request_poll() además del largo de la respuesta */
+#define VAMP_REQUEST_PENDING	0	// Request en curso
+#define VAMP_REQUEST_EMPTY		-1	// Respuesta 2xx sin cuerpo
+#define VAMP_REQUEST_ERROR		-2	// Falló o se agotó el timeout de una fase
+
+/**
+ * @brief Start a non-blocking request with the profile, it advances in vamp_iface_request_poll()
+ * Only one request at a time, the profile and data are copied so they can change meanwhile
+ * @param profile Communication profile (http:// or https://)
+ * @param data Body to send (POST)
+ * @param len Length of data
+ * @return true if the request was started
+ */
+bool vamp_iface_request_start(const vamp_profile_t * profile, const char * data, size_t len);
+
+/**
+ * @brief Advance the request in small steps, never waits for the network
+ * @param data Buffer for the response body
+ * @param len Size of data
+ * @return Length of the body, or VAMP_REQUEST_PENDING / EMPTY / ERROR
+ */
+int16_t vamp_iface_request_poll(char * data, size_t len);
+#endif /* VAMP_HTTP_ASYNC */
+
+#ifdef VAMP_SYNC_LONGPOLL
+/** @brief Resultados de vamp_iface_longpoll_poll() además del largo de la respuesta */
+#define VAMP_LONGPOLL_PENDING	0	// Sigue estacionada, no hay respuesta todavía
+#define VAMP_LONGPOLL_IDLE		-1	// El VREG respondió sin cambios (se agotó el wait)
+#define VAMP_LONGPOLL_ERROR		-2	// Error de conexión, timeout o respuesta inválida
+
+/**
+ * @brief Start a long-poll GET on its own connection and return without waiting
+ * @param profile VREG profile (endpoint + query params, HTTP only)
+ * @param timeout_ms Time after which the parked request is given up
+ * @return true if the request was sent
+ */
+bool vamp_iface_longpoll_start(const vamp_profile_t * profile, uint32_t timeout_ms);
+
+/**
+ * @brief Check the parked long-poll request, never blocks
+ * @param data Buffer for the response body
+ * @param len Length of data buffer
+ * @return body length (>0) when done, or VAMP_LONGPOLL_PENDING / IDLE / ERROR
+ */
+int16_t vamp_iface_longpoll_poll(char * data, size_t len);
+#endif /* VAMP_SYNC_LONGPOLL */
 
 
 #endif // VAMP_CALLBACKS_H
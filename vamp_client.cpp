@@ -17,6 +17,10 @@
 
 #include "lib/vamp_table.h"
 
+#ifdef VAMP_POLL_PAGING
+#include "lib/vamp_lzss.h"
+#endif /* VAMP_POLL_PAGING */
+
 /* Dirección MAC del gateway por defecto, direccion de broadcast */
 static uint8_t vamp_gw_addr[VAMP_ADDR_LEN] = {VAMP_BROADCAST_ADDR};
 
@@ -29,6 +33,11 @@ static uint8_t send_failure_count = 0;
 /** @brief Buffer para almacenar datos de envío y recepción */
 static uint8_t req_resp_wsn_buff[VAMP_MAX_PAYLOAD_SIZE];
 
+#ifdef VAMP_DATA_SEQ
+/* Todavía no hubo un JOIN exitoso desde que arrancó el nodo */
+static bool seq_boot = true;
+#endif /* VAMP_DATA_SEQ */
+
 
 void vamp_client_init(uint8_t * vamp_client_id) {
 
@@ -77,22 +86,54 @@ bool vamp_join_network(void) {
 	//#endif /* VAMP_DEBUG */
 
 	uint8_t payload_len = 0;
+	uint8_t pending_tries = 0;
 
-	/*  Pseudoencabezado: T=1 (comando), Comando ID=0x01 (JOIN_REQ) = 0x81 */
-	req_resp_wsn_buff[payload_len++] = (VAMP_JOIN_REQ | VAMP_IS_CMD_MASK);
+	do {
+		payload_len = 0;
 
-	/* Copiar dirección local */
-	uint8_t * local_wsn_addr = vamp_get_local_wsn_addr();
-	for (int i = 0; i < VAMP_ADDR_LEN; i++) {
-		req_resp_wsn_buff[payload_len++] = local_wsn_addr[i];
-	}
+		/*  Pseudoencabezado: T=1 (comando), Comando ID=0x01 (JOIN_REQ) = 0x81 */
+		req_resp_wsn_buff[payload_len++] = (VAMP_JOIN_REQ | VAMP_IS_CMD_MASK);
 
-	#ifdef VAMP_DEBUG
-	printf("[CLIENT] Joining\n");
-	#endif /* VAMP_DEBUG */
+		/* Copiar dirección local */
+		uint8_t * local_wsn_addr = vamp_get_local_wsn_addr();
+		for (int i = 0; i < VAMP_ADDR_LEN; i++) {
+			req_resp_wsn_buff[payload_len++] = local_wsn_addr[i];
+		}
 
-	/* Enviar mensaje de unión al gateway */
-	payload_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
+		#ifdef VAMP_DATA_SEQ
+		/* Avisar si es el primer JOIN desde que arrancamos */
+		req_resp_wsn_buff[payload_len++] = seq_boot ? VAMP_JOIN_FLAG_BOOT : 0;
+		#endif /* VAMP_DATA_SEQ */
+
+		#ifdef VAMP_DEBUG
+		printf("[CLIENT] Joining\n");
+		#endif /* VAMP_DEBUG */
+
+		/* Enviar mensaje de unión al gateway */
+		#ifdef VAMP_WSN_SUBADDR
+		/* Directo al pipe de JOIN de los gateways */
+		static uint8_t join_addr[VAMP_ADDR_LEN] = {VAMP_JOIN_ADDR};
+		payload_len = vamp_wsn_send(join_addr, req_resp_wsn_buff, payload_len);
+		#else
+		payload_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
+		#endif /* VAMP_WSN_SUBADDR */
+
+		/* El gateway no nos tenía en caché y nos está buscando en el VREG,
+		hay que esperar lo que pide y volver a intentar */
+		if (payload_len != VAMP_JOIN_PENDING_LEN
+			|| req_resp_wsn_buff[0] != (VAMP_JOIN_PENDING | VAMP_IS_CMD_MASK)) {
+			break;
+		}
+
+		uint16_t retry_ms = ((uint16_t)req_resp_wsn_buff[1] << 8) | req_resp_wsn_buff[2];
+
+		#ifdef VAMP_DEBUG
+		printf("[CLIENT] join pending, retry in %d ms\n", retry_ms);
+		#endif /* VAMP_DEBUG */
+
+		delay(retry_ms);
+
+	} while (++pending_tries <= VAMP_JOIN_PENDING_TRIES);
 	/* El mensaje recibido debe ser un JOIN_OK (0x82) + ID_IN_GW (1 byte) + dirección del gateway (5 bytes) */
 	if ((payload_len == 0) 
 		|| (req_resp_wsn_buff[0] != (VAMP_JOIN_OK | VAMP_IS_CMD_MASK)) 
@@ -134,6 +175,11 @@ bool vamp_join_network(void) {
 	/* Resetear contador de fallos ya que tenemos nueva conexión */
 	send_failure_count = 0;
 
+	#ifdef VAMP_DATA_SEQ
+	/* Los próximos JOIN son re-join, el gateway ya conoce nuestra secuencia */
+	seq_boot = false;
+	#endif /* VAMP_DATA_SEQ */
+
 	return true; // Unión exitosa
 }
 
@@ -196,24 +242,43 @@ bool vamp_fail_handle(void){
 }
 
 
-/*  ------------------------ Funciones externas del cliente VAMP ------------------------- */
+#ifdef VAMP_DATA_SEQ
+/* Secuencia de la próxima trama de datos, empieza en 0 al arrancar y salta el
+0 al dar la vuelta */
+static uint8_t data_seq = 0;
 
-/* Dile al gateway que envíe un mensaje que le diga (POST/PUBLISH) "data" al endpoint del "profile" */
-uint8_t vamp_client_tell(const uint8_t profile, const uint8_t * data, uint8_t len) {
+/* Última trama sin respuesta: pudo llegar al gateway igual (se perdió el
+TICKET), asi que si la aplicación la reenvía lleva la misma secuencia */
+static uint8_t unsent_data[VAMP_MAX_PAYLOAD_SIZE];
+static uint8_t unsent_len = 0;
+static uint8_t unsent_profile = 0;
 
-	/* Verificar que los datos no sean nulos y esten dentro del rango permitido, -2 min para el encabezado*/
-	if (profile >= VAMP_MAX_PROFILES || data == NULL || len == 0 || len >= VAMP_MAX_PAYLOAD_SIZE - 2) {
-		return 0;
+/* Secuencia para enviar data, otros datos que los que fallaron toman la siguiente */
+static uint8_t vamp_seq_take(uint8_t profile, const uint8_t * data, uint8_t len) {
+	bool resend = (unsent_len == len && unsent_profile == profile && memcmp(unsent_data, data, len) == 0);
+	if (unsent_len && !resend) {
+		data_seq = (data_seq == 0xFF) ? 1 : data_seq + 1;
 	}
-	
-	/* Si el dispositivo no está activo, no se puede enviar el mensaje */
-	if(!vamp_is_active()) {
-		
-		return 0;
+	unsent_len = 0;
+	return data_seq;
+}
+
+/* La secuencia solo avanza con un envío exitoso */
+static void vamp_seq_done(bool sent, uint8_t profile, const uint8_t * data, uint8_t len) {
+	if (sent) {
+		data_seq = (data_seq == 0xFF) ? 1 : data_seq + 1;
+		return;
 	}
+	memcpy(unsent_data, data, len);
+	unsent_len = len;
+	unsent_profile = profile;
+}
+#endif /* VAMP_DATA_SEQ */
+
+/*  ------------------------ Funciones externas del cliente VAMP ------------------------- */
 
-	/*  Crear mensaje de datos según el protocolo VAMP */
-	//uint8_t payload_len = 0;
+/* Armar en req_resp_wsn_buff la trama de datos, devuelve su largo */
+static uint8_t vamp_make_data_frame(const uint8_t profile, const uint8_t * data, uint8_t len, uint8_t seq) {
 
 	/*  Pseudoencabezado: T=0 (datos), PP=(profile), LLLLL=(length) 
 	 	En caso que len > VAMP_WSN_LENGTH_ESCAPE, se escribira 
@@ -232,33 +297,181 @@ uint8_t vamp_client_tell(const uint8_t profile, const uint8_t * data, uint8_t le
 	/* Copiar el identificador en el GW al segundo byte */
 	req_resp_wsn_buff[1] = id_in_gateway;
 
+	#ifdef VAMP_DATA_SEQ
+	/* Secuencia justo antes de los datos */
+	req_resp_wsn_buff[payload_len++] = seq;
+	#else
+	(void)seq;
+	#endif /* VAMP_DATA_SEQ */
+
 	/*  Copiar los datos del payload */
 	for (int i = 0; i < len; i++) {
 		req_resp_wsn_buff[payload_len++] = data[i];
 	}
 
-	/*  Enviar el mensaje */    
-	len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
+	return payload_len;
+}
 
-	if (len == 0) {
-		/* Si el envío falla, manejar el fallo */
-		if(!vamp_fail_handle()) {
-			/* Si el manejo del fallo también falla, retornar 0 */
+/* Dile al gateway que envíe un mensaje que le diga (POST/PUBLISH) "data" al endpoint del "profile" */
+uint8_t vamp_client_tell(const uint8_t profile, const uint8_t * data, uint8_t len) {
+
+	/* Verificar que los datos no sean nulos y esten dentro del rango permitido, -2 min para el encabezado*/
+	if (profile >= VAMP_MAX_PROFILES || data == NULL || len == 0 || len >= VAMP_MAX_PAYLOAD_SIZE - 2 - VAMP_DATA_SEQ_LEN) {
+		return 0;
+	}
+	
+	/* Si el dispositivo no está activo, no se puede enviar el mensaje */
+	if(!vamp_is_active()) {
+		
+		return 0;
+	}
+
+	/* Los reintentos llevan la misma secuencia para que el gateway los descarte */
+	uint8_t seq = 0;
+	#ifdef VAMP_DATA_SEQ
+	seq = vamp_seq_take(profile, data, len);
+	#endif /* VAMP_DATA_SEQ */
+
+	/*  Crear mensaje de datos según el protocolo VAMP y enviarlo */
+	uint8_t payload_len = vamp_make_data_frame(profile, data, len, seq);
+	uint8_t resp_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
+
+	/* Si el envío falla, manejar el fallo. Si el re-join fue exitoso, intentar
+	enviar de nuevo. El join usó el buffer y pudo cambiar el ID en el gateway,
+	asi que se arma otra vez */
+	if (resp_len == 0 && vamp_fail_handle()) {
+		payload_len = vamp_make_data_frame(profile, data, len, seq);
+		resp_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
+		if(!resp_len) {
+			/* Si vuelve a fallar, incrementar contador de fallos */
+			send_failure_count ++;
+		}
+	}
+
+	#ifdef VAMP_DATA_SEQ
+	vamp_seq_done(resp_len != 0, profile, data, len);
+	#endif /* VAMP_DATA_SEQ */
+
+	if (!resp_len) {
+		return 0;
+	}
+
+	/* Envío exitoso, resetear contador de fallos */
+	send_failure_count = 0;
+	return resp_len;
+}
+
+#ifdef VAMP_WSN_SUBADDR
+/* Alarma [0x89][ID][perfil][gateway][datos...] a la dirección de alarmas, el
+gateway la atiende antes que las demás tramas y responde con un TICKET */
+uint8_t vamp_client_alarm(uint8_t profile, const uint8_t * data, uint8_t len) {
+
+	if (profile >= VAMP_MAX_PROFILES || data == NULL || len == 0 || len > VAMP_MAX_PAYLOAD_SIZE - VAMP_ALARM_HDR_LEN) {
+		return 0;
+	}
+
+	if (!vamp_is_active()) {
+		return 0;
+	}
+
+	static uint8_t alarm_addr[VAMP_ADDR_LEN] = {VAMP_ALARM_ADDR};
+	uint8_t resp_len = 0;
+
+	/* Un reintento después del re-join, que puede cambiar el ID y el gateway */
+	for (uint8_t tries = 0; tries < 2; tries++) {
+		req_resp_wsn_buff[0] = VAMP_ALARM | VAMP_IS_CMD_MASK;
+		req_resp_wsn_buff[1] = id_in_gateway;
+		req_resp_wsn_buff[2] = profile;
+		memcpy(&req_resp_wsn_buff[VAMP_ALARM_GW_OFFSET], vamp_gw_addr, VAMP_ADDR_LEN);
+		memcpy(&req_resp_wsn_buff[VAMP_ALARM_HDR_LEN], data, len);
+
+		resp_len = vamp_wsn_send(alarm_addr, req_resp_wsn_buff, VAMP_ALARM_HDR_LEN + len);
+		if (resp_len || tries || !vamp_fail_handle()) {
+			break;
+		}
+	}
+
+	if (!resp_len) {
+		send_failure_count++;
+		return 0;
+	}
+
+	send_failure_count = 0;
+	return resp_len;
+}
+#endif /* VAMP_WSN_SUBADDR */
+
+/* Enviar un mensaje mayor que una trama en fragmentos [0x87][ID][L|PP|MMMMM][offset][datos...]. 
+Cada fragmento intermedio es confirmado por el gateway con el offset que espera a continuación,
+el último se responde como un tell normal (TICKET) */
+uint8_t vamp_client_tell_frag(const uint8_t profile, const uint8_t * data, uint16_t len) {
+
+	if (profile >= VAMP_MAX_PROFILES || data == NULL || len == 0 || len > VAMP_FRAG_MAX_MSG_SIZE) {
+		return 0;
+	}
+
+	/* Si cabe en una trama no hace falta fragmentar */
+	if (len < VAMP_MAX_PAYLOAD_SIZE - 2 - VAMP_DATA_SEQ_LEN) {
+		return vamp_client_tell(profile, data, (uint8_t)len);
+	}
+
+	if (!vamp_is_active()) {
+		return 0;
+	}
+
+	/* ID del mensaje (5 bits), permite al gateway distinguir un mensaje nuevo 
+	de la repetición de uno anterior */
+	static uint8_t frag_msg_id = 0;
+	frag_msg_id = (frag_msg_id + 1) & 0x1F;
+
+	uint16_t offset = 0;
+	uint8_t resp_len = 0;
+
+	while (offset < len) {
+
+		uint8_t chunk_len = VAMP_FRAG_CHUNK_SIZE;
+		if ((len - offset) <= chunk_len) {
+			chunk_len = (uint8_t)(len - offset);
+		}
+		bool last = (offset + chunk_len) >= len;
+
+		req_resp_wsn_buff[0] = (VAMP_FRAG | VAMP_IS_CMD_MASK);
+		req_resp_wsn_buff[1] = id_in_gateway;
+		req_resp_wsn_buff[2] = VAMP_FRAG_MAKE_HDR(last, profile, frag_msg_id);
+		req_resp_wsn_buff[3] = (uint8_t)offset;
+		memcpy(&req_resp_wsn_buff[VAMP_FRAG_HDR_LEN], &data[offset], chunk_len);
+
+		resp_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, VAMP_FRAG_HDR_LEN + chunk_len);
+
+		if (resp_len == 0) {
+			/* Un re-join cambia el ID en el gateway y pierde el reensamblado,
+			asi que no tiene sentido seguir con este mensaje */
+			vamp_fail_handle();
 			return 0;
 		}
-		/* Si el re-join fue exitoso, intentar enviar de nuevo */
-		len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, payload_len);
-		if(!len) {
-			/* Si vuelve a fallar, incrementar contador de fallos y salir */
-			send_failure_count ++;
+
+		if (last) {
+			break;
+		}
+
+		/* La confirmación trae el offset que espera el gateway, normalmente el
+		siguiente fragmento, o uno anterior si se perdió algo por el camino */
+		if (resp_len != VAMP_FRAG_HDR_LEN
+			|| req_resp_wsn_buff[0] != (VAMP_FRAG | VAMP_IS_CMD_MASK)
+			|| req_resp_wsn_buff[3] > offset + chunk_len
+			|| req_resp_wsn_buff[3] == 0) {
+			#ifdef VAMP_DEBUG
+			printf("[CLIENT] frag %d not acked\n", offset);
+			#endif /* VAMP_DEBUG */
+			vamp_fail_handle();
 			return 0;
 		}
 
+		offset = req_resp_wsn_buff[3];
 	}
 
-	/* Envío exitoso, resetear contador de fallos */
 	send_failure_count = 0;
-	return len;
+	return resp_len;
 }
 
 /* Dile al gateway que envíe un mensaje que le diga (POST/PUBLISH) "data" al endpoint del profile por defecto */
@@ -367,4 +580,90 @@ uint8_t vamp_client_poll(uint16_t ticket, uint8_t * data, uint8_t len) {
 
 	return response_len;
 
-}
\ No newline at end of file
+}
+
+#ifdef VAMP_POLL_PAGING
+/* Pedir la respuesta del ticket página a página, cada POLL con el offset siguiente
+hasta la última. Si viene comprimida se descomprime sobre data a medida que llega */
+uint16_t vamp_client_poll_all(uint16_t ticket, uint8_t * data, uint16_t size) {
+
+	if (data == NULL || size == 0) {
+		return 0;
+	}
+
+	if (!vamp_is_active()) {
+		return 0;
+	}
+
+	vamp_lzss_decoder_t decoder;
+	vamp_lzss_decode_reset(&decoder);
+
+	uint16_t offset = 0;
+	size_t data_len = 0;
+	/* Se reserva el lugar del terminador */
+	size_t capacity = size - 1;
+
+	while (true) {
+
+		req_resp_wsn_buff[0] = (VAMP_POLL | VAMP_IS_CMD_MASK);
+		req_resp_wsn_buff[1] = id_in_gateway;
+		req_resp_wsn_buff[2] = (ticket >> 8) & 0xFF;
+		req_resp_wsn_buff[3] = ticket & 0xFF;
+		req_resp_wsn_buff[4] = (offset >> 8) & 0xFF;
+		req_resp_wsn_buff[5] = offset & 0xFF;
+		req_resp_wsn_buff[6] = VAMP_POLL_ACCEPT_LZSS;
+
+		uint8_t response_len = vamp_wsn_send(vamp_gw_addr, req_resp_wsn_buff, VAMP_POLL_PAGED_REQ_LEN);
+
+		if (response_len == 0) {
+			/* Un re-join cambia el ID en el gateway y el ticket deja de valer,
+			asi que no tiene sentido seguir con esta respuesta */
+			vamp_fail_handle();
+			return 0;
+		}
+
+		uint8_t page = req_resp_wsn_buff[0];
+		uint8_t status = req_resp_wsn_buff[1];
+		if (response_len < VAMP_POLL_HDR_LEN || response_len > VAMP_MAX_PAYLOAD_SIZE ||
+				page != response_len - VAMP_POLL_HDR_LEN || status < VAMP_POLL_MORE_LZSS) {
+			#ifdef VAMP_DEBUG
+			printf("[CLIENT] invalid page %d\n", offset);
+			#endif /* VAMP_DEBUG */
+			return 0;
+		}
+
+		send_failure_count = 0;
+		bool full = false;
+
+		if (VAMP_POLL_IS_LZSS(status)) {
+			int8_t result = vamp_lzss_decode(&decoder, &req_resp_wsn_buff[VAMP_POLL_HDR_LEN], page,
+					data, capacity, &data_len);
+			if (result < 0) {
+				return 0;
+			}
+			full = result > 0;
+		} else {
+			size_t copy = page;
+			if (copy > capacity - data_len) {
+				copy = capacity - data_len;
+				full = true;
+			}
+			memcpy(&data[data_len], &req_resp_wsn_buff[VAMP_POLL_HDR_LEN], copy);
+			data_len += copy;
+		}
+
+		/* Lo que no entra en data se pierde, como en vamp_client_poll() */
+		if (full || VAMP_POLL_IS_LAST(status)) {
+			break;
+		}
+
+		if (page == 0) {
+			return 0;
+		}
+		offset += page;
+	}
+
+	data[data_len] = '\0';
+	return (uint16_t)data_len;
+}
+#endif /* VAMP_POLL_PAGING */
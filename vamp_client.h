@@ -10,6 +10,8 @@
 
 #include <Arduino.h>
 
+#include "vamp_config.h"
+
 /**
  * @brief Initialize VAMP client with VREG URL and gateway ID
  * 
@@ -58,6 +60,29 @@ uint8_t vamp_client_tell(const uint8_t * data, uint8_t len);
  */
 uint8_t vamp_client_tell(const uint8_t profile, const uint8_t * data, uint8_t len);
 
+/** @brief Send a message larger than one radio frame, split in fragments
+ *  @param profile The profile to be used for sending the data
+ *  @param data Pointer to the data to be sent
+ *  @param len Length of the data, up to VAMP_FRAG_MAX_MSG_SIZE
+ *  @return Same as vamp_client_tell(), the last fragment is answered with a TICKET
+ *  @note Each fragment is acknowledged by the gateway with the next expected
+ * *      offset, so a lost fragment is retried alone instead of the whole message.
+ * *      Messages that fit in one frame are sent with vamp_client_tell().
+ */
+uint8_t vamp_client_tell_frag(const uint8_t profile, const uint8_t * data, uint16_t len);
+
+#ifdef VAMP_WSN_SUBADDR
+/** @brief Send an urgent message to the gateway's alarm sub-address
+ *  @param profile The profile to be used for forwarding the data
+ *  @param data Pointer to the data to be sent
+ *  @param len Length of the data, up to VAMP_MAX_PAYLOAD_SIZE - VAMP_ALARM_HDR_LEN
+ *  @return Same as vamp_client_tell(), the gateway answers with a TICKET
+ *  @note The gateway hands alarms to the application before any queued frame
+ * *      and forwards them to the endpoint without cache or request queue.
+ */
+uint8_t vamp_client_alarm(uint8_t profile, const uint8_t * data, uint8_t len);
+#endif /* VAMP_WSN_SUBADDR */
+
 /** @brief Ask for data with VAMP using a specific profile
  *  @param profile The profile to be used for asking the data
  *  @return The ticket number, or 0 on failure
@@ -85,4 +110,19 @@ uint16_t vamp_client_ask(void);
  */
 uint8_t vamp_client_poll(uint16_t ticket, uint8_t * data, uint8_t len);
 
+#ifdef VAMP_POLL_PAGING
+/** @brief Poll the whole response of a ticket, page by page (VAMP_POLL_PAGING)
+ *
+ * @param ticket Ticket returned by vamp_client_ask()
+ * @param data Buffer to store the response, null terminated
+ * @param size Size of the buffer
+ * @return  0 on failure or if the response is not ready yet,
+ *          otherwise the length of the response stored in data
+ * @note Each POLL carries the offset of the page it asks for, so the gateway
+ * *      keeps no paging state. Compressed responses are expanded into data as
+ * *      the pages arrive. A response larger than the buffer is truncated.
+ */
+uint16_t vamp_client_poll_all(uint16_t ticket, uint8_t * data, uint16_t size);
+#endif /* VAMP_POLL_PAGING */
+
 #endif // _VAMP_CLIENT_H_
@@ -46,9 +46,500 @@
 #define VAMP_PASSWORD_MAX_LEN 64
 #endif // VAMP_PASSWORD_MAX_LEN
 
+/** @brief Cantidad de tramas que puede retener la cola de recepción del WSN.
+ *  Cada vez que se consulta el radio se vacía la FIFO del chip (3 tramas en el 
+ *  nRF24) hacia esta cola, de donde luego se procesan una a una. En los motes
+ *  AVR la memoria es escasa y basta con un par de tramas.
+ *  @note Debe ser potencia de 2 */
+#ifndef VAMP_WSN_RX_RING_SIZE
+#if defined(ARDUINO_ARCH_AVR)
+#define VAMP_WSN_RX_RING_SIZE 2
+#else
+#define VAMP_WSN_RX_RING_SIZE 8
+#endif
+#endif // VAMP_WSN_RX_RING_SIZE
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el envío en ráfagas
+ *  del gateway (modo siempre escucha). Las respuestas (JOIN_OK, TICKET, POLL)
+ *  de una vuelta de vamp_gw_wsn() se juntan y salen al terminarla con un solo
+ *  stopListening()/startListening(), agrupadas por destino y encadenadas en la
+ *  FIFO de TX del chip. El tiempo sin escuchar y las ráfagas quedan en
+ *  vamp_wsn_get_stats() con y sin esta opción, para comparar */
+//#define VAMP_WSN_TX_BATCH
+
+/** @brief Respuestas que se juntan como máximo antes de enviar la ráfaga */
+#ifndef VAMP_WSN_TX_BATCH_LEN
+#define VAMP_WSN_TX_BATCH_LEN 6
+#endif // VAMP_WSN_TX_BATCH_LEN
+
+/** @brief Tramas del anillo de recepción que procesa como máximo una vuelta de
+ *  vamp_gw_wsn() antes de enviar sus respuestas. Cada trama retrasa la
+ *  respuesta a las anteriores, que tiene que llegar dentro de la ventana de
+ *  escucha del nodo (VAMP_ANSW_TIMEOUT) */
+#ifndef VAMP_WSN_RX_DRAIN
+#define VAMP_WSN_RX_DRAIN 4
+#endif // VAMP_WSN_RX_DRAIN
+
+/** @brief Pin conectado al IRQ del nRF24. Si se define, el gateway solo accede
+ *  al chip cuando la interrupción indica que llegaron tramas en lugar de
+ *  consultarlo en cada vuelta del lazo */
+//#define VAMP_WSN_IRQ_PIN 4
+
+/** @brief Tiempo (ms) durante el que se confía en el último chequeo de conexión
+ *  con el chip antes de volver a consultarlo por SPI */
+#ifndef VAMP_WSN_CHIP_CHECK_MS
+#define VAMP_WSN_CHIP_CHECK_MS 1000
+#endif // VAMP_WSN_CHIP_CHECK_MS
+
 /** @brief Tiempo de espera por una respuesta */
 #define VAMP_ANSW_TIMEOUT 500
 
+/** @brief Comentar/descomentar para deshabilitar/habilitar las respuestas en el
+ *  payload de los ACK. Debe coincidir en el gateway y en los nodos.
+ *  El gateway precarga TICKET y respuestas de POLL en el ACK del pipe 0 sin
+ *  salir de escucha, y el nodo las recoge con un PING corto en lugar de abrir
+ *  una ventana de escucha de hasta VAMP_ANSW_TIMEOUT. El JOIN viaja por
+ *  broadcast (sin ACK) y sigue usando la ventana.
+ *  @note El ACK del pipe 0 es compartido: si otro nodo transmite antes de que
+ *  el destinatario recoja su respuesta, se la lleva él. Cada respuesta lleva
+ *  el ID compacto del destinatario (una página de POLL tiene un byte menos),
+ *  los demás nodos la descartan y el gateway la vuelve a cargar. */
+//#define VAMP_WSN_ACK_PAYLOAD
+
+/** @brief Espera (ms) antes de cada PING que recoge la respuesta precargada */
+#ifndef VAMP_ACK_FETCH_DELAY
+#define VAMP_ACK_FETCH_DELAY 3
+#endif // VAMP_ACK_FETCH_DELAY
+
+/** @brief Cantidad de PINGs para recoger una respuesta precargada */
+#ifndef VAMP_ACK_FETCH_TRIES
+#define VAMP_ACK_FETCH_TRIES 3
+#endif // VAMP_ACK_FETCH_TRIES
+
+/** @brief Respuestas para el ACK que el gateway guarda a la vez, una por nodo */
+#ifndef VAMP_WSN_ACK_PENDING
+#define VAMP_WSN_ACK_PENDING 4
+#endif // VAMP_WSN_ACK_PENDING
+
+/** @brief Tiempo (ms) que una respuesta espera su ACK. Con holgura sobre
+ *  VAMP_ACK_FETCH_DELAY * VAMP_ACK_FETCH_TRIES, después el nodo ya desistió */
+#ifndef VAMP_WSN_ACK_PENDING_MS
+#define VAMP_WSN_ACK_PENDING_MS 50
+#endif // VAMP_WSN_ACK_PENDING_MS
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar los pipes 2 y 3 del
+ *  gateway. Debe coincidir en el gateway y en los nodos.
+ *  Los nodos envían el JOIN_REQ a VAMP_JOIN_ADDR y las alarmas
+ *  (vamp_client_alarm()) a VAMP_ALARM_ADDR. El gateway clasifica las tramas por
+ *  el pipe por el que llegan y atiende las alarmas antes que el resto (ver
+ *  VAMP_WSN_PIPE_* en vamp.h) */
+//#define VAMP_WSN_SUBADDR
+
+/** @brief Alarmas que pueden esperar a ser procesadas, aparte de las demás tramas.
+ *  @note Debe ser potencia de 2 */
+#ifndef VAMP_WSN_ALARM_RING_SIZE
+#define VAMP_WSN_ALARM_RING_SIZE 2
+#endif // VAMP_WSN_ALARM_RING_SIZE
+
+/** @brief Tamaño máximo (bytes) de un mensaje fragmentado. El offset de cada
+ *  fragmento viaja en un byte, asi que no puede pasar de 255 */
+#ifndef VAMP_FRAG_MAX_MSG_SIZE
+#define VAMP_FRAG_MAX_MSG_SIZE 128
+#endif // VAMP_FRAG_MAX_MSG_SIZE
+
+/** @brief Mensajes fragmentados que el gateway puede reensamblar a la vez */
+#ifndef VAMP_FRAG_SLOTS
+#define VAMP_FRAG_SLOTS 2
+#endif // VAMP_FRAG_SLOTS
+
+/** @brief Tiempo (ms) sin fragmentos nuevos tras el cual se descarta un
+ *  reensamblado incompleto */
+#ifndef VAMP_FRAG_TIMEOUT
+#define VAMP_FRAG_TIMEOUT 5000
+#endif // VAMP_FRAG_TIMEOUT
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar las respuestas de más
+ *  de una trama. Debe coincidir en el gateway y en los nodos.
+ *  El gateway guarda hasta VAMP_RESPONSE_MAX_SIZE bytes de la respuesta y el nodo
+ *  la pide por páginas con vamp_client_poll_all(), cada POLL con su offset. Las
+ *  respuestas de más de una página van comprimidas (ver lib/vamp_lzss.h) si eso
+ *  las achica. Sin paginado la respuesta se corta a lo que entra en una trama */
+//#define VAMP_POLL_PAGING
+
+/** @brief Tamaño máximo de la respuesta guardada para cada nodo. Se reserva por
+ *  nodo activo, el offset de las páginas viaja en 2 bytes */
+#ifdef VAMP_POLL_PAGING
+#ifndef VAMP_RESPONSE_MAX_SIZE
+#define VAMP_RESPONSE_MAX_SIZE 256
+#endif // VAMP_RESPONSE_MAX_SIZE
+#else
+#define VAMP_RESPONSE_MAX_SIZE VAMP_MAX_PAYLOAD_SIZE
+#endif /* VAMP_POLL_PAGING */
+
+/** @brief Intervalo (ms) mínimo entre sincronizaciones con el VREG, se usa
+ *  justo después de una sincronización con cambios o de un JOIN desconocido */
+#ifndef VAMP_SYNC_MIN_INTERVAL
+#define VAMP_SYNC_MIN_INTERVAL 30000
+#endif // VAMP_SYNC_MIN_INTERVAL
+
+/** @brief Intervalo (ms) máximo entre sincronizaciones. Mientras el VREG no
+ *  reporte cambios el intervalo se duplica hasta llegar aqui (30 minutos) */
+#ifndef VAMP_SYNC_MAX_INTERVAL
+#define VAMP_SYNC_MAX_INTERVAL 1800000
+#endif // VAMP_SYNC_MAX_INTERVAL
+
+/** @brief Variación aleatoria (%) del intervalo, evita que los gateways que
+ *  comparten VREG sincronicen todos a la vez */
+#ifndef VAMP_SYNC_JITTER_PCT
+#define VAMP_SYNC_JITTER_PCT 20
+#endif // VAMP_SYNC_JITTER_PCT
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar la sincronización por
+ *  long-poll. El gateway deja una consulta estacionada en el VREG (parámetro "wait")
+ *  y el VREG la responde en cuanto hay un cambio para este gateway, con solo el
+ *  delta. La consulta se atiende sin bloquear el lazo del radio y la sincronización
+ *  periódica queda como red de seguridad. Solo para VREG por HTTP: una conexión TLS
+ *  estacionada no cabe en el heap junto a las de los perfiles, con HTTPS se sigue
+ *  usando el planificador adaptativo. */
+//#define VAMP_SYNC_LONGPOLL
+
+/** @brief Segundos que el VREG puede retener la consulta long-poll antes de
+ *  responder sin cambios. Debe quedar por debajo del timeout de proxies intermedios */
+#ifndef VAMP_SYNC_LONGPOLL_WAIT
+#define VAMP_SYNC_LONGPOLL_WAIT 55
+#endif // VAMP_SYNC_LONGPOLL_WAIT
+
+/** @brief Margen (ms) sobre VAMP_SYNC_LONGPOLL_WAIT antes de dar la consulta por perdida */
+#ifndef VAMP_SYNC_LONGPOLL_GRACE
+#define VAMP_SYNC_LONGPOLL_GRACE 10000
+#endif // VAMP_SYNC_LONGPOLL_GRACE
+
+/** @brief Buffer propio de la consulta long-poll (cabeceras + delta), la respuesta
+ *  llega mientras iface_buff puede estar en uso por otro perfil */
+#ifndef VAMP_SYNC_LONGPOLL_BUFF_SIZE
+#define VAMP_SYNC_LONGPOLL_BUFF_SIZE 1024
+#endif // VAMP_SYNC_LONGPOLL_BUFF_SIZE
+
+/** @brief Máximo de nodos en una respuesta de sincronización del VREG. Los cambios
+ *  se validan todos antes de aplicarse, una respuesta con más nodos se descarta
+ *  entera. Cada cambio ocupa 8 bytes de RAM estática (los perfiles se construyen
+ *  al aplicarlo, de a un nodo) */
+#ifndef VAMP_SYNC_MAX_OPS
+#define VAMP_SYNC_MAX_OPS VAMP_MAX_DEVICES
+#endif // VAMP_SYNC_MAX_OPS
+
+/** @brief Tiempo (ms) que el gateway le pide esperar a un nodo antes de repetir
+ *  el JOIN_REQ mientras busca el dispositivo en el VREG */
+#ifndef VAMP_JOIN_RETRY_MS
+#define VAMP_JOIN_RETRY_MS 2000
+#endif // VAMP_JOIN_RETRY_MS
+
+/** @brief Búsquedas en el VREG pendientes que el gateway puede encolar */
+#ifndef VAMP_JOIN_PENDING_SLOTS
+#define VAMP_JOIN_PENDING_SLOTS 4
+#endif // VAMP_JOIN_PENDING_SLOTS
+
+/** @brief Tiempo (ms) que el gateway junta JOIN desconocidos antes de consultarlos
+ *  al VREG en una sola solicitud (?device=A&device=B...). Si se llena el lote
+ *  (VAMP_JOIN_PENDING_SLOTS o VAMP_MAX_KEY_VALUE_PAIRS) se consulta enseguida */
+#ifndef VAMP_JOIN_BATCH_WINDOW
+#define VAMP_JOIN_BATCH_WINDOW 200
+#endif // VAMP_JOIN_BATCH_WINDOW
+
+/** @brief Veces que un nodo acepta un JOIN_PENDING antes de dar el join por fallido */
+#ifndef VAMP_JOIN_PENDING_TRIES
+#define VAMP_JOIN_PENDING_TRIES 3
+#endif // VAMP_JOIN_PENDING_TRIES
+
+/** @brief RF_ID desconocidos por el VREG que el gateway recuerda para no
+ *  volver a consultarlos en cada JOIN_REQ */
+#ifndef VAMP_NEG_CACHE_SIZE
+#define VAMP_NEG_CACHE_SIZE 4
+#endif // VAMP_NEG_CACHE_SIZE
+
+/** @brief Tiempo (ms) que se recuerda un RF_ID desconocido (10 minutos) */
+#ifndef VAMP_NEG_CACHE_TTL
+#define VAMP_NEG_CACHE_TTL 600000
+#endif // VAMP_NEG_CACHE_TTL
+
+/** @brief Cada cuánto (ms) un JOIN que el filtro de Bloom del VREG rechaza se
+ *  consulta igual. El filtro es una foto de la última sincronización que lo
+ *  trajo y no conoce a los registrados después, que de otro modo esperarían
+ *  hasta VAMP_SYNC_MAX_INTERVAL. Los que el VREG tampoco conoce quedan en la
+ *  caché negativa, asi que no gastan otra consulta */
+#ifndef VAMP_BLOOM_BYPASS_MS
+#define VAMP_BLOOM_BYPASS_MS 30000
+#endif // VAMP_BLOOM_BYPASS_MS
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el transporte MQTT.
+ *  Los perfiles con endpoint mqtt://broker[:puerto]/topic (o mqtts://) publican
+ *  por una única conexión persistente al broker en lugar de un request HTTP.
+ *  protocol_options: "topic" (si no, la ruta del URL), "qos" (0 o 1), "retain",
+ *  "username" y "password" */
+//#define VAMP_MQTT
+
+/** @brief Keepalive (s) de la sesión MQTT, se envía PINGREQ si no hubo tráfico */
+#ifndef VAMP_MQTT_KEEPALIVE
+#define VAMP_MQTT_KEEPALIVE 60
+#endif // VAMP_MQTT_KEEPALIVE
+
+/** @brief Publicaciones QoS 1 sin PUBACK que se mantienen en vuelo. Se envían sin
+ *  esperar el PUBACK y se reenvían (DUP) al reconectar */
+#ifndef VAMP_MQTT_INFLIGHT
+#define VAMP_MQTT_INFLIGHT 2
+#endif // VAMP_MQTT_INFLIGHT
+
+/** @brief Tamaño máximo de un paquete PUBLISH (topic + payload) */
+#ifndef VAMP_MQTT_PACKET_MAX
+#define VAMP_MQTT_PACKET_MAX 384
+#endif // VAMP_MQTT_PACKET_MAX
+
+/** @brief Tiempo (ms) de espera del CONNACK y de un slot en vuelo libre */
+#ifndef VAMP_MQTT_TIMEOUT
+#define VAMP_MQTT_TIMEOUT 3000
+#endif // VAMP_MQTT_TIMEOUT
+
+/** @brief Tiempo (ms) mínimo entre intentos de reconexión al broker */
+#ifndef VAMP_MQTT_RECONNECT_MS
+#define VAMP_MQTT_RECONNECT_MS 5000
+#endif // VAMP_MQTT_RECONNECT_MS
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el transporte CoAP sobre
+ *  UDP (coap://host[:puerto]/ruta). El método sale de VAMP_HTTP_METHOD_*, y
+ *  protocol_options "type" = "non" envía sin confirmación (por defecto CON).
+ *  Los payloads más grandes que un bloque se envían por bloques (Block1) y las
+ *  respuestas largas se piden por bloques (Block2). Sin DTLS, coaps:// no se soporta */
+//#define VAMP_COAP
+
+/** @brief Timeout (ms) inicial del ACK de un mensaje CON, se duplica en cada reintento */
+#ifndef VAMP_COAP_ACK_TIMEOUT
+#define VAMP_COAP_ACK_TIMEOUT 2000
+#endif // VAMP_COAP_ACK_TIMEOUT
+
+/** @brief Retransmisiones de un mensaje CON antes de abandonarlo */
+#ifndef VAMP_COAP_MAX_RETRANSMIT
+#define VAMP_COAP_MAX_RETRANSMIT 4
+#endif // VAMP_COAP_MAX_RETRANSMIT
+
+/** @brief Envíos de un CON mientras se espera la respuesta, el resto de las
+ *  retransmisiones las hace vamp_iface_loop() sin bloquear el radio */
+#ifndef VAMP_COAP_SYNC_TRIES
+#define VAMP_COAP_SYNC_TRIES 2
+#endif // VAMP_COAP_SYNC_TRIES
+
+/** @brief Mensajes CON sin ACK que se pueden seguir retransmitiendo */
+#ifndef VAMP_COAP_RETX_SLOTS
+#define VAMP_COAP_RETX_SLOTS 4
+#endif // VAMP_COAP_RETX_SLOTS
+
+/** @brief Tamaño máximo de un datagrama CoAP (cabecera + opciones + bloque) */
+#ifndef VAMP_COAP_DGRAM_MAX
+#define VAMP_COAP_DGRAM_MAX 256
+#endif // VAMP_COAP_DGRAM_MAX
+
+/** @brief Tamaño de bloque, 2^(SZX + 4) bytes: 2 = 64 bytes */
+#ifndef VAMP_COAP_BLOCK_SZX
+#define VAMP_COAP_BLOCK_SZX 2
+#endif // VAMP_COAP_BLOCK_SZX
+
+/** @brief Puerto UDP local del gateway para CoAP */
+#ifndef VAMP_COAP_LOCAL_PORT
+#define VAMP_COAP_LOCAL_PORT 56830
+#endif // VAMP_COAP_LOCAL_PORT
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el transporte WebSocket
+ *  (ws:// y wss://). Se mantiene un canal abierto por backend, los envíos viajan
+ *  como tramas de texto y el backend puede empujar mensajes
+ *  {"rf_id":"<hex>","data":"..."} que quedan como respuesta pendiente del nodo
+ *  (la que recibe en el próximo POLL) */
+//#define VAMP_WS
+
+/** @brief Canales WebSocket abiertos a la vez (uno por servidor, host:puerto) */
+#ifndef VAMP_WS_CHANNELS
+#define VAMP_WS_CHANNELS 2
+#endif // VAMP_WS_CHANNELS
+
+/** @brief Tiempo (ms) sin tráfico tras el cual se envía un PING */
+#ifndef VAMP_WS_PING_MS
+#define VAMP_WS_PING_MS 30000
+#endif // VAMP_WS_PING_MS
+
+/** @brief Tiempo (ms) de espera del handshake */
+#ifndef VAMP_WS_TIMEOUT
+#define VAMP_WS_TIMEOUT 5000
+#endif // VAMP_WS_TIMEOUT
+
+/** @brief Tiempo (ms) mínimo entre intentos de reconexión de un canal */
+#ifndef VAMP_WS_RECONNECT_MS
+#define VAMP_WS_RECONNECT_MS 5000
+#endif // VAMP_WS_RECONNECT_MS
+
+/** @brief Tamaño máximo de una trama enviada (cabecera + payload) */
+#ifndef VAMP_WS_TX_MAX
+#define VAMP_WS_TX_MAX 512
+#endif // VAMP_WS_TX_MAX
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar la caché DNS. Los
+ *  transportes que conectan por dirección (HTTP no bloqueante, long-poll, MQTT,
+ *  WebSocket, CoAP) resuelven a través de ella: los hosts en uso se refrescan
+ *  antes de vencer y, si el DNS no responde, se sigue usando la última dirección
+ *  durante VAMP_DNS_STALE_GRACE. El cliente HTTP bloqueante necesita el nombre
+ *  (Host y SNI) y sigue resolviendo dentro de HTTPClient */
+//#define VAMP_DNS_CACHE
+
+/** @brief Hosts en la caché */
+#ifndef VAMP_DNS_SLOTS
+#define VAMP_DNS_SLOTS 4
+#endif // VAMP_DNS_SLOTS
+
+/** @brief Vigencia (ms) de una dirección. lwIP no entrega el TTL del registro con
+ *  la respuesta, asi que se usa este valor */
+#ifndef VAMP_DNS_TTL
+#define VAMP_DNS_TTL 300000
+#endif // VAMP_DNS_TTL
+
+/** @brief Antelación (ms) con la que se refresca un host en uso antes de que venza */
+#ifndef VAMP_DNS_PREFETCH
+#define VAMP_DNS_PREFETCH 30000
+#endif // VAMP_DNS_PREFETCH
+
+/** @brief Tiempo (ms) tras vencer durante el que se usa la última dirección si el
+ *  DNS no responde */
+#ifndef VAMP_DNS_STALE_GRACE
+#define VAMP_DNS_STALE_GRACE 3600000
+#endif // VAMP_DNS_STALE_GRACE
+
+/** @brief Espera (ms) máxima de una resolución, y entre reintentos tras un fallo */
+#ifndef VAMP_DNS_TIMEOUT
+#define VAMP_DNS_TIMEOUT 5000
+#endif // VAMP_DNS_TIMEOUT
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el circuit breaker por
+ *  host de los endpoints HTTP/HTTPS. Tras VAMP_BREAKER_THRESHOLD fallos seguidos
+ *  (sin conexión, timeout o 5xx) los requests a ese host se descartan sin
+ *  conectar durante un backoff exponencial, entre VAMP_BREAKER_BACKOFF_MIN y
+ *  VAMP_BREAKER_BACKOFF_MAX (ver lib/vamp_breaker.h). Las lecturas descartadas
+ *  quedan en la SD si VAMP_SD está habilitado y se cuentan en vamp_breaker_get_stats() */
+//#define VAMP_BREAKER
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el cliente HTTP no
+ *  bloqueante. Los mensajes de los nodos hacia endpoints http:// y https:// se
+ *  encolan y vamp_gw_poll() avanza el request por fases (DNS, conexión, TLS,
+ *  envío y recepción), cada una con su timeout, mientras el radio y el servidor
+ *  web siguen atendidos. La respuesta queda para el POLL con el ticket de ese
+ *  mensaje. Las consultas al VREG por JOIN desconocidos también van por la cola
+ *  (una respuesta que no entra en VAMP_HTTP_RX_MAX se repite con el cliente
+ *  bloqueante). La sincronización con el VREG sigue usando el cliente bloqueante */
+//#define VAMP_HTTP_ASYNC
+
+/** @brief Timeout (ms) de la resolución DNS del host */
+#ifndef VAMP_HTTP_DNS_TIMEOUT
+#define VAMP_HTTP_DNS_TIMEOUT 5000
+#endif // VAMP_HTTP_DNS_TIMEOUT
+
+/** @brief Timeout (ms) de la conexión TCP */
+#ifndef VAMP_HTTP_CONNECT_TIMEOUT
+#define VAMP_HTTP_CONNECT_TIMEOUT 5000
+#endif // VAMP_HTTP_CONNECT_TIMEOUT
+
+/** @brief Timeout (ms) de la conexión TCP más el handshake TLS */
+#ifndef VAMP_HTTP_TLS_TIMEOUT
+#define VAMP_HTTP_TLS_TIMEOUT 8000
+#endif // VAMP_HTTP_TLS_TIMEOUT
+
+/** @brief Timeout (ms) del envío del request */
+#ifndef VAMP_HTTP_SEND_TIMEOUT
+#define VAMP_HTTP_SEND_TIMEOUT 5000
+#endif // VAMP_HTTP_SEND_TIMEOUT
+
+/** @brief Timeout (ms) de la respuesta completa */
+#ifndef VAMP_HTTP_RECV_TIMEOUT
+#define VAMP_HTTP_RECV_TIMEOUT 8000
+#endif // VAMP_HTTP_RECV_TIMEOUT
+
+/** @brief Tamaño máximo del request (línea, headers y cuerpo) */
+#ifndef VAMP_HTTP_TX_MAX
+#define VAMP_HTTP_TX_MAX 768
+#endif // VAMP_HTTP_TX_MAX
+
+/** @brief Tamaño máximo del cuerpo de la respuesta, el resto se descarta */
+#ifndef VAMP_HTTP_RX_MAX
+#define VAMP_HTTP_RX_MAX 512
+#endif // VAMP_HTTP_RX_MAX
+
+/** @brief Mensajes de los nodos esperando el cliente HTTP. Con la cola llena los
+ *  nuevos se descartan (el nodo ya tiene su TICKET)
+ *  @note Debe ser potencia de 2 */
+#ifndef VAMP_UPLINK_QUEUE_LEN
+#define VAMP_UPLINK_QUEUE_LEN 4
+#endif // VAMP_UPLINK_QUEUE_LEN
+
+/** @brief Tamaño máximo del cuerpo de un mensaje encolado (JSON ya armado) */
+#ifndef VAMP_UPLINK_BODY_MAX
+#define VAMP_UPLINK_BODY_MAX 256
+#endif // VAMP_UPLINK_BODY_MAX
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar la agrupación de los GET
+ *  idénticos de varios nodos (HTTP/HTTPS y CoAP). Con VAMP_HTTP_ASYNC, mientras un
+ *  request está encolado o en vuelo los mismos requests de otros nodos esperan su
+ *  respuesta en lugar de hacer el suyo. Un perfil con la opción VAMP_CACHE_OPTION
+ *  (ms) además guarda la respuesta y la sirve sin tocar la red hasta que vence
+ *  (ver lib/vamp_coalesce.h). Las opciones "vamp_*" no se envían como headers */
+//#define VAMP_COALESCE
+
+/** @brief Opción del perfil con el TTL (ms) de la respuesta en la caché, ej.
+ *  "options": {"vamp_cache": "60000"} */
+#ifndef VAMP_CACHE_OPTION
+#define VAMP_CACHE_OPTION "vamp_cache"
+#endif // VAMP_CACHE_OPTION
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el prefetch de los GET
+ *  HTTP/HTTPS que cada nodo pide con un periodo regular. El gateway aprende el
+ *  intervalo de cada nodo/perfil y hace el request VAMP_PREFETCH_LEAD ms antes
+ *  del próximo pedido, asi la respuesta ya está al enviar el TICKET y el nodo la
+ *  recibe en el primer POLL (ver lib/vamp_prefetch.h). Usa la cola del cliente
+ *  no bloqueante, sin VAMP_HTTP_ASYNC no tiene efecto. La opción
+ *  VAMP_PREFETCH_OPTION del perfil cambia la anticipación, "0" lo deshabilita.
+ *  Aciertos y desperdicios en vamp_prefetch_get_stats() */
+//#define VAMP_PREFETCH
+
+/** @brief Anticipación (ms) del prefetch respecto del pedido esperado */
+#ifndef VAMP_PREFETCH_LEAD
+#define VAMP_PREFETCH_LEAD 3000
+#endif // VAMP_PREFETCH_LEAD
+
+/** @brief Opción del perfil con la anticipación (ms) del prefetch, ej.
+ *  "options": {"vamp_prefetch": "0"} lo deshabilita para ese perfil */
+#ifndef VAMP_PREFETCH_OPTION
+#define VAMP_PREFETCH_OPTION "vamp_prefetch"
+#endif // VAMP_PREFETCH_OPTION
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar la proyección de las
+ *  respuestas JSON HTTP/HTTPS. Un perfil con la opción VAMP_SELECT_OPTION recibe
+ *  solo los campos pedidos en lugar del comienzo del cuerpo, que se lee a medida
+ *  que llega sin guardarlo y se corta al tener todos. Con VAMP_PACK_OPTION los
+ *  valores van empaquetados en binario (ver lib/vamp_jsel.h) */
+//#define VAMP_SELECT
+
+/** @brief Opción del perfil con los campos a proyectar, ej.
+ *  "options": {"vamp_select": "riego.inicio,riego.min"} */
+#ifndef VAMP_SELECT_OPTION
+#define VAMP_SELECT_OPTION "vamp_select"
+#endif // VAMP_SELECT_OPTION
+
+/** @brief Opción del perfil con el tipo de cada campo proyectado, ej.
+ *  "options": {"vamp_pack": "u32,u8"} */
+#ifndef VAMP_PACK_OPTION
+#define VAMP_PACK_OPTION "vamp_pack"
+#endif // VAMP_PACK_OPTION
+
+/** @brief Comentar/descomentar para deshabilitar/habilitar el número de secuencia
+ *  en las tramas de datos. Debe coincidir en el gateway y en los nodos.
+ *  El nodo agrega un byte de secuencia tras el ID compacto y el gateway descarta
+ *  las tramas repetidas (ACK perdido, reintento tras re-join) respondiendo con el
+ *  TICKET anterior, sin reenviarlas al endpoint. Cuesta un byte de payload. */
+//#define VAMP_DATA_SEQ
+
 /** @brief   Máximo de fallos consecutivos antes de re-join */
 #define MAX_SEND_FAILURES 3
 
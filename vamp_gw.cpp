@@ -11,6 +11,29 @@
 
 //#include "lib/vamp_kv.h"
 #include "lib/vamp_table.h"
+#include "lib/vamp_bloom.h"
+
+#ifdef VAMP_HTTP_ASYNC
+#include "lib/vamp_spsc.h"
+#endif /* VAMP_HTTP_ASYNC */
+
+#ifdef VAMP_COALESCE
+#include "lib/vamp_coalesce.h"
+#include "lib/vamp_transport.h"
+#endif /* VAMP_COALESCE */
+
+/* El prefetch usa la cola del cliente HTTP no bloqueante */
+#if defined(VAMP_PREFETCH) && !defined(VAMP_HTTP_ASYNC)
+#undef VAMP_PREFETCH
+#endif
+
+#ifdef VAMP_PREFETCH
+#include "lib/vamp_prefetch.h"
+#endif /* VAMP_PREFETCH */
+
+#ifdef VAMP_POLL_PAGING
+#include "lib/vamp_lzss.h"
+#endif /* VAMP_POLL_PAGING */
 
 #include "arch/rtc/rtc.h"
 
@@ -43,6 +66,156 @@ char iface_buff[VAMP_IFACE_BUFF_SIZE];
 static StaticJsonDocument<256> json_payload_doc;
 #endif
 
+/** Reensamblado de un mensaje fragmentado */
+typedef struct {
+	bool in_use;							// Slot ocupado
+	bool done;								// Mensaje completo y ya reencaminado
+	uint8_t wsn_id;							// ID compacto del nodo
+	uint8_t msg_id;							// ID del mensaje (5 bits)
+	uint16_t len;							// Bytes contiguos recibidos
+	uint32_t last_time;						// Último fragmento recibido (millis)
+	uint8_t buff[VAMP_FRAG_MAX_MSG_SIZE];	// Mensaje en construcción
+} vamp_frag_slot_t;
+
+static vamp_frag_slot_t frag_slots[VAMP_FRAG_SLOTS];
+
+/* Contadores del gateway */
+static vamp_gw_stats_t gw_stats;
+
+/** Nodos que pidieron unirse y no estaban en caché, su búsqueda en el VREG se
+ * hace fuera del JOIN para que la respuesta llegue dentro de la ventana de
+ * escucha del nodo */
+typedef struct {
+	bool in_use;
+	bool in_flight;							// Va en la consulta al VREG en curso
+	uint8_t rf_id[VAMP_ADDR_LEN];
+	uint32_t since;							// Cuándo se encoló (millis)
+} vamp_join_pending_t;
+
+/* Dispositivos por consulta al VREG, uno por parámetro "device" */
+#if VAMP_JOIN_PENDING_SLOTS < VAMP_MAX_KEY_VALUE_PAIRS
+#define VAMP_VREG_BATCH_MAX VAMP_JOIN_PENDING_SLOTS
+#else
+#define VAMP_VREG_BATCH_MAX VAMP_MAX_KEY_VALUE_PAIRS
+#endif
+
+static vamp_join_pending_t join_pending[VAMP_JOIN_PENDING_SLOTS];
+
+/** Caché negativa: RF_ID por los que el VREG respondió que no los conoce */
+typedef struct {
+	uint8_t rf_id[VAMP_ADDR_LEN];
+	uint32_t expires;						// millis() a partir del cual se olvida (0 = libre)
+} vamp_neg_entry_t;
+
+static vamp_neg_entry_t neg_cache[VAMP_NEG_CACHE_SIZE];
+
+/* Filtro de Bloom de los RF_ID registrados en el VREG, llega con la sincronización */
+static vamp_bloom_t vreg_bloom;
+/* Última vez que se consultó al VREG un JOIN que el filtro rechazaba */
+static uint32_t bloom_bypass_at = 0;
+static bool bloom_bypassed = false;
+
+#ifdef VAMP_HTTP_ASYNC
+/** Mensaje de un nodo esperando el cliente HTTP no bloqueante. El perfil se toma
+ * de la tabla al arrancar el request, el JSON ya va armado */
+typedef struct {
+	uint8_t wsn_id;							// ID compacto del nodo
+	uint8_t profile_index;
+	uint16_t ticket;						// TICKET que recibió el nodo por este mensaje
+	uint16_t len;
+	bool vreg;								// Consulta al VREG de los JOIN pendientes, no es de un nodo
+	#ifdef VAMP_PREFETCH
+	bool prefetch;							// Sin mensaje del nodo, la respuesta va al prefetch
+	#endif /* VAMP_PREFETCH */
+	#ifdef VAMP_COALESCE
+	bool coalesced;							// Otros nodos pueden esperar esta respuesta
+	uint32_t request_key;					// Hash de la clave, el request en vuelo guarda la clave
+	uint32_t cache_ttl;
+	#endif /* VAMP_COALESCE */
+	char body[VAMP_UPLINK_BODY_MAX];
+} vamp_uplink_t;
+
+static vamp_spsc_queue<vamp_uplink_t, VAMP_UPLINK_QUEUE_LEN> uplink_queue;
+static bool uplink_in_flight = false;
+/* La consulta de los JOIN pendientes espera en la cola o está en vuelo */
+static bool join_queued = false;
+#endif /* VAMP_HTTP_ASYNC */
+
+#ifdef VAMP_POLL_PAGING
+/* Respuesta comprimida antes de reemplazar la original en data_buff */
+static uint8_t poll_lzss_buff[VAMP_RESPONSE_MAX_SIZE];
+#endif /* VAMP_POLL_PAGING */
+
+/* La trama en curso es una alarma: se reencamina sin caché ni cola */
+static bool forward_urgent = false;
+
+static bool vamp_gw_forward(vamp_entry_t * entry, uint8_t profile_index, const uint8_t * payload, uint16_t rec_len);
+static void vamp_gw_process_frag(uint8_t * frag, uint8_t len);
+
+
+/* Guardar la respuesta que el nodo recibe en el próximo POLL, lo que no entra se corta */
+static void vamp_gw_set_response(vamp_entry_t * entry, const char * data, size_t len) {
+	if (len > VAMP_RESPONSE_MAX_SIZE) {
+		len = VAMP_RESPONSE_MAX_SIZE;
+	}
+	memcpy(entry->data_buff, data, len);
+	entry->data_buff[len] = '\0';
+	entry->data_len = (uint16_t)len;
+	entry->data_lzss = false;
+}
+
+/* Copia de los contadores del gateway */
+void vamp_gw_get_stats(vamp_gw_stats_t * stats) {
+	if (stats) {
+		*stats = gw_stats;
+	}
+}
+
+/* Mensaje empujado por un backend: queda como respuesta pendiente del nodo */
+bool vamp_gw_downlink(char * msg, size_t len) {
+
+	#ifdef ARDUINOJSON_AVAILABLE
+	/* El documento del payload está libre fuera de vamp_gw_forward() */
+	json_payload_doc.clear();
+	if (!msg || deserializeJson(json_payload_doc, msg, len)) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] Invalid downlink\n");
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	const char * hex_rf_id = json_payload_doc["rf_id"].as<const char *>();
+	const char * data = json_payload_doc["data"].as<const char *>();
+
+	uint8_t rf_id[VAMP_ADDR_LEN];
+	if (!hex_rf_id || !data || !hex_to_rf_id(hex_rf_id, rf_id)) {
+		return false;
+	}
+
+	uint8_t index = vamp_find_device(rf_id);
+	vamp_entry_t * entry = vamp_get_table_entry(index);
+	if (!entry || entry->status != VAMP_DEV_STATUS_ACTIVE || !entry->data_buff) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] Downlink for %s, node not active\n", hex_rf_id);
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	/* Sin tocar el ticket: el nodo lo recibe en el próximo POLL */
+	vamp_gw_set_response(entry, data, strnlen(data, VAMP_RESPONSE_MAX_SIZE));
+	gw_stats.downlinks++;
+
+	#ifdef VAMP_DEBUG
+	printf("[GW] Downlink for %02X: %s\n", entry->wsn_id, entry->data_buff);
+	#endif /* VAMP_DEBUG */
+
+	return true;
+	#else
+	(void)msg;
+	(void)len;
+	return false;
+	#endif /* ARDUINOJSON_AVAILABLE */
+}
 
 /* Inicializar la tabla VAMP con el perfil de VREG */
 void vamp_table_init(void) {
@@ -59,6 +232,13 @@ void vamp_table_sync(void) {
     vamp_detect_expired();
 }
 
+#ifdef VAMP_SYNC_LONGPOLL
+/* Atender el long-poll con el perfil de VREG */
+bool vamp_table_sync_longpoll(void) {
+    return vamp_table_longpoll(&vamp_vreg_profile);
+}
+#endif /* VAMP_SYNC_LONGPOLL */
+
 /* Inicializar el perfil de VREG */
 bool vamp_gw_vreg_init(const gw_config_t * gw_config){
 
@@ -108,6 +288,7 @@ bool vamp_gw_vreg_init(const gw_config_t * gw_config){
 		return false;
 	}
 	sprintf(vamp_vreg_profile.endpoint_resource, "%s%s", gw_config->vamp.vreg_resource, gw_config->vamp.gw_id);
+	vamp_vreg_profile.protocol = vamp_transport_resolve(vamp_vreg_profile.endpoint_resource);
 
 	#ifdef VAMP_DEBUG
 	printf("[GW] RF ID: %s\n", gateway_conf->vamp.gw_id);
@@ -146,6 +327,120 @@ bool vamp_gw_vreg_init(const gw_config_t * gw_config){
 
 }
 
+/* Cargar (o quitar con bits = 0) el filtro de Bloom del VREG */
+void vamp_gw_set_vreg_bloom(uint16_t bits, uint8_t k, const char * hex) {
+
+	if (bits == 0) {
+		vamp_bloom_clear(&vreg_bloom);
+	} else if (!vamp_bloom_load_hex(&vreg_bloom, bits, k, hex)) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] invalid VREG bloom filter, ignored\n");
+		#endif /* VAMP_DEBUG */
+	}
+
+	/* Con una nueva foto del VREG lo que se sabía de los desconocidos ya no vale */
+	memset(neg_cache, 0, sizeof(neg_cache));
+}
+
+/* El filtro no conoce a los registrados después de la sincronización que lo
+trajo: de vez en cuando un rechazo se consulta igual en el VREG */
+static bool vamp_gw_bloom_bypass(void) {
+
+	uint32_t now = millis();
+	if (bloom_bypassed && (now - bloom_bypass_at) < VAMP_BLOOM_BYPASS_MS) {
+		return false;
+	}
+
+	bloom_bypassed = true;
+	bloom_bypass_at = now;
+	gw_stats.bloom_bypasses++;
+	#ifdef VAMP_DEBUG
+	printf("[GW] not in VREG bloom, asking anyway\n");
+	#endif /* VAMP_DEBUG */
+	return true;
+}
+
+/* Buscar "rf_id" en la caché negativa, las entradas vencidas se liberan */
+static bool vamp_gw_neg_lookup(const uint8_t * rf_id) {
+
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_NEG_CACHE_SIZE; i++) {
+		if (!neg_cache[i].expires) {
+			continue;
+		}
+		if ((int32_t)(now - neg_cache[i].expires) >= 0) {
+			neg_cache[i].expires = 0;
+			continue;
+		}
+		if (memcmp(neg_cache[i].rf_id, rf_id, VAMP_ADDR_LEN) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Recordar que el VREG no conoce "rf_id", si no hay lugar se reemplaza la que vence antes */
+static void vamp_gw_neg_insert(const uint8_t * rf_id) {
+
+	uint8_t victim = 0;
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_NEG_CACHE_SIZE; i++) {
+		if (!neg_cache[i].expires) {
+			victim = i;
+			break;
+		}
+		if ((int32_t)(neg_cache[i].expires - neg_cache[victim].expires) < 0) {
+			victim = i;
+		}
+	}
+
+	memcpy(neg_cache[victim].rf_id, rf_id, VAMP_ADDR_LEN);
+	/* 0 indica libre, asi que se evita */
+	neg_cache[victim].expires = (now + VAMP_NEG_CACHE_TTL) | 1;
+}
+
+/* Aplicar la respuesta del VREG a una consulta con el parser de la
+sincronización, sin avanzar el timestamp */
+static bool vamp_gw_vreg_answer(const char * data) {
+
+	/* Extraer los datos JSON de la respuesta */
+	#ifdef ARDUINOJSON_AVAILABLE
+	if (vamp_process_lookup_json_response(data)) {
+		return true;
+	}
+	#endif /* ARDUINOJSON_AVAILABLE */
+	(void)data;
+
+	#ifdef VAMP_DEBUG
+	printf("[GW] Error procesando respuesta VREG\n");
+	#endif /* VAMP_DEBUG */
+	return false;
+}
+
+/* Enviar al VREG la consulta armada en query_params y aplicar la respuesta.
+Devuelve true si el VREG respondió, aunque no conozca a los dispositivos
+consultados */
+static bool vamp_gw_vreg_query(void) {
+
+	gw_stats.vreg_lookups++;
+
+	/* Las respuestas que esperan la ráfaga no pueden esperar al VREG */
+	vamp_wsn_send_pending();
+
+	// Enviar request usando TELL y recibir respuesta, la consulta va sin cuerpo
+	iface_buff[0] = '\0';
+	if (vamp_iface_comm(&vamp_vreg_profile, iface_buff, 0, VAMP_IFACE_BUFF_SIZE) > 0) {
+		return vamp_gw_vreg_answer(iface_buff);
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[GW] Error procesando respuesta VREG\n");
+	#endif /* VAMP_DEBUG */
+	return false;
+}
+
 /* preguntarle al VREG por el dispositivo "rf_id" !!!! por revisar */
 uint8_t vamp_get_vreg_device(const uint8_t * rf_id) {
 
@@ -161,28 +456,178 @@ uint8_t vamp_get_vreg_device(const uint8_t * rf_id) {
 	rf_id_to_hex(rf_id, char_rf_id);
 
 	/* Configurar query_params con device */
-	//vamp_clear_profile.query_params.pairs[0].key = NULL;
-	//vamp_clear_profile.query_params.pairs[0].value = NULL;
 	vamp_kv_clear(&vamp_vreg_profile.query_params);
 	vamp_kv_set(&vamp_vreg_profile.query_params, "device", char_rf_id);
 
-	// Enviar request usando TELL y recibir respuesta
-	if (vamp_iface_comm(&vamp_vreg_profile, iface_buff, VAMP_IFACE_BUFF_SIZE)) {
+	if (vamp_gw_vreg_query()) {
+		gw_stats.vreg_batched++;
+		/* Buscar el dispositivo en la tabla */
+		return vamp_find_device(rf_id);
+	}
+
+	return VAMP_MAX_DEVICES; // No se espera respuesta de datos
+
+}
+
+/* Encolar la búsqueda en el VREG de "rf_id", si ya estaba encolada no se repite */
+static bool vamp_gw_join_defer(const uint8_t * rf_id) {
+
+	vamp_join_pending_t * free_slot = NULL;
+
+	for (uint8_t i = 0; i < VAMP_JOIN_PENDING_SLOTS; i++) {
+		if (!join_pending[i].in_use) {
+			if (!free_slot) {
+				free_slot = &join_pending[i];
+			}
+			continue;
+		}
+		if (memcmp(join_pending[i].rf_id, rf_id, VAMP_ADDR_LEN) == 0) {
+			return true;
+		}
+	}
+
+	if (!free_slot) {
+		return false;
+	}
+
+	memcpy(free_slot->rf_id, rf_id, VAMP_ADDR_LEN);
+	free_slot->since = millis();
+	free_slot->in_use = true;
+	return true;
+}
+
+/* Armar en query_params la consulta de los pendientes que van en el lote:
+?device=A&device=B... el VREG responde con todos en el array "nodes" */
+static void vamp_gw_join_query(void) {
+
+	char char_rf_id[VAMP_GW_ID_MAX_LEN];
+	vamp_kv_clear(&vamp_vreg_profile.query_params);
+	for (uint8_t i = 0; i < VAMP_JOIN_PENDING_SLOTS; i++) {
+		if (join_pending[i].in_flight) {
+			rf_id_to_hex(join_pending[i].rf_id, char_rf_id);
+			vamp_kv_add(&vamp_vreg_profile.query_params, "device", char_rf_id);
+		}
+	}
+}
+
+/* Cerrar la consulta del lote, "answered" si el VREG respondió */
+static void vamp_gw_join_resolved(bool answered) {
+
+	uint8_t batch_len = 0;
+
+	for (uint8_t i = 0; i < VAMP_JOIN_PENDING_SLOTS; i++) {
+
+		vamp_join_pending_t * pending = &join_pending[i];
+		if (!pending->in_flight) {
+			continue;
+		}
+		batch_len++;
+
+		/* Si el VREG respondió y no lo conoce se recuerda, un error de red no */
+		if (answered && vamp_find_device(pending->rf_id) == VAMP_MAX_DEVICES) {
+			#ifdef VAMP_DEBUG
+			printf("[GW] VREG: no device found\n");
+			#endif /* VAMP_DEBUG */
+			vamp_gw_neg_insert(pending->rf_id);
+		} else if (answered) {
+			/* Registrado después del filtro: que no lo vuelva a rechazar */
+			vamp_bloom_add(&vreg_bloom, pending->rf_id, VAMP_ADDR_LEN);
+		}
+
+		/* Encontrado o no, se libera: si el nodo insiste se vuelve a encolar */
+		pending->in_flight = false;
+		pending->in_use = false;
+	}
+
+	if (answered && batch_len > 0) {
+		gw_stats.vreg_batched += batch_len;
+		gw_stats.upstream_saved += batch_len - 1;
+	}
+
+	#ifdef VAMP_HTTP_ASYNC
+	join_queued = false;
+	#endif /* VAMP_HTTP_ASYNC */
+}
+
+#ifdef VAMP_HTTP_ASYNC
+/* Encolar la consulta del lote en el cliente no bloqueante, con la cola llena
+queda para la próxima vuelta */
+static void vamp_gw_join_push(void) {
+
+	vamp_uplink_t * uplink = uplink_queue.reserve();
+	if (!uplink) {
+		for (uint8_t i = 0; i < VAMP_JOIN_PENDING_SLOTS; i++) {
+			join_pending[i].in_flight = false;
+		}
+		return;
+	}
+
+	uplink->wsn_id = 0;
+	uplink->profile_index = 0;
+	uplink->ticket = 0;
+	uplink->len = 0;
+	uplink->body[0] = '\0';
+	uplink->vreg = true;
+	#ifdef VAMP_PREFETCH
+	uplink->prefetch = false;
+	#endif /* VAMP_PREFETCH */
+	#ifdef VAMP_COALESCE
+	uplink->coalesced = false;
+	#endif /* VAMP_COALESCE */
+	uplink_queue.commit();
+	join_queued = true;
+}
+#endif /* VAMP_HTTP_ASYNC */
+
+/* Resolver en el VREG las búsquedas pendientes. Tras un corte de energía todos los
+nodos piden unirse casi a la vez, asi que se espera VAMP_JOIN_BATCH_WINDOW para 
+juntarlos y se consultan en lote con una sola solicitud. Las respuestas quedan en 
+la tabla y el JOIN_REQ que repite cada nodo se atiende desde la caché.
+Con VAMP_HTTP_ASYNC la consulta va por la cola del cliente no bloqueante y se
+resuelve en vamp_gw_uplink_poll() */
+static void vamp_gw_join_background(void) {
+
+	uint8_t batch[VAMP_VREG_BATCH_MAX];
+	uint8_t batch_len = 0;
+	bool window_closed = false;
+	uint32_t now = millis();
+
+	#ifdef VAMP_HTTP_ASYNC
+	/* Un lote por vez, los que llegan mientras tanto van en el siguiente */
+	if (join_queued) {
+		return;
+	}
+	#endif /* VAMP_HTTP_ASYNC */
 
-		/* Extraer los datos JSON de la respuesta */
-		#ifdef ARDUINOJSON_AVAILABLE
-		if (vamp_process_sync_json_response(iface_buff)) {
-			/* Buscar el dispositivo en la tabla */
-			return vamp_find_device(rf_id);
+	for (uint8_t i = 0; i < VAMP_JOIN_PENDING_SLOTS && batch_len < VAMP_VREG_BATCH_MAX; i++) {
+		if (!join_pending[i].in_use) {
+			continue;
+		}
+		if ((now - join_pending[i].since) >= VAMP_JOIN_BATCH_WINDOW) {
+			window_closed = true;
 		}
-		#endif /* ARDUINOJSON_AVAILABLE */
+		batch[batch_len++] = i;
+	}
+
+	/* Nada pendiente, o el lote aún no está lleno ni le llegó su hora */
+	if (batch_len == 0 || (batch_len < VAMP_VREG_BATCH_MAX && !window_closed)) {
+		return;
+	}
+
+	for (uint8_t i = 0; i < batch_len; i++) {
+		join_pending[batch[i]].in_flight = true;
 	}
 
 	#ifdef VAMP_DEBUG
-	printf("[GW] Error procesando respuesta VREG\n");
+	printf("[GW] VREG batch lookup: %d devices\n", batch_len);
 	#endif /* VAMP_DEBUG */
-	return VAMP_MAX_DEVICES; // No se espera respuesta de datos
 
+	#ifdef VAMP_HTTP_ASYNC
+	vamp_gw_join_push();
+	#else
+	vamp_gw_join_query();
+	vamp_gw_join_resolved(vamp_gw_vreg_query());
+	#endif /* VAMP_HTTP_ASYNC */
 }
 
 /* Procesar comando "cmd" */
@@ -216,26 +661,52 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 		encontrado en el cache */
 		if (node_index >= VAMP_MAX_DEVICES) {
 
-			/* Dispositivo no encontrado en caché, hay que solicitarlo al VREG */
+			/* Dispositivo no encontrado en caché, hay que solicitarlo al VREG. 
+			Esto es un round trip HTTPS que no cabe en la ventana de escucha del 
+			nodo, asi que se encola y se le pide que lo intente más tarde */
+			/* Antes de ir a la red, descartar los que el VREG seguro no conoce */
+			if (vamp_gw_neg_lookup(&cmd[1])) {
+				#ifdef VAMP_DEBUG
+				printf("[GW] unknown device (negative cache)\n");
+				#endif /* VAMP_DEBUG */
+				gw_stats.neg_hits++;
+				gw_stats.upstream_saved++;
+				return;
+			}
+			gw_stats.neg_misses++;
+
+			if (!vamp_bloom_maybe_contains(&vreg_bloom, &cmd[1], VAMP_ADDR_LEN) && !vamp_gw_bloom_bypass()) {
+				#ifdef VAMP_DEBUG
+				printf("[GW] unknown device (VREG bloom)\n");
+				#endif /* VAMP_DEBUG */
+				gw_stats.bloom_rejects++;
+				gw_stats.upstream_saved++;
+				return;
+			}
+
 			#ifdef VAMP_DEBUG
 			printf("[GW] no in cache, asking VREG\n");
 			#endif /* VAMP_DEBUG */
 
-					/* Si no esta en el cache hay que preguntarle al VREG */
-			node_index = vamp_get_vreg_device(&cmd[1]);
-
-			if (node_index == VAMP_MAX_DEVICES) {
+			if (!vamp_gw_join_defer(&cmd[1])) {
 				#ifdef VAMP_DEBUG
-				printf("[GW] VREG: no device found\n");
+				printf("[GW] VREG: pending queue full\n");
 				#endif /* VAMP_DEBUG */
-				return; // Error al obtener el dispositivo
+				return; // El nodo reintentará por timeout
 			}
 
-			#ifdef VAMP_DEBUG
-			printf("[GW] Dev found in VREG: ");
-			#endif /* VAMP_DEBUG */
+			/* Puede haber más nodos nuevos en camino, conviene sincronizar pronto */
+			vamp_table_sync_tighten();
+
+			uint8_t rf_id[VAMP_ADDR_LEN];
+			memcpy(rf_id, &cmd[1], VAMP_ADDR_LEN);
 
+			cmd[0] = VAMP_JOIN_PENDING | VAMP_IS_CMD_MASK;
+			cmd[1] = (VAMP_JOIN_RETRY_MS >> 8) & 0xFF;
+			cmd[2] = VAMP_JOIN_RETRY_MS & 0xFF;
+			vamp_wsn_send(rf_id, cmd, VAMP_JOIN_PENDING_LEN);
 
+			return;
 		} 
 		#ifdef VAMP_DEBUG
 		else {
@@ -249,8 +720,18 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 		printf("%d\n", entry->wsn_id);
 		#endif /* VAMP_DEBUG */
 
-		entry->status = VAMP_DEV_STATUS_REQUEST; // Marcar como en solicitud
-		entry->last_activity = millis(); // Actualizar última actividad
+		vamp_set_entry_status(entry, VAMP_DEV_STATUS_REQUEST); // Marcar como en solicitud
+		entry->last_activity = vamp_wsn_get_rx_time(); // Actualizar última actividad
+		#ifdef VAMP_DATA_SEQ
+		/* Si el nodo arrancó su secuencia empieza de nuevo. Si no, está
+		reintentando y la primera trama puede ser la última que ya llegó */
+		if (cmd[1 + VAMP_ADDR_LEN] & VAMP_JOIN_FLAG_BOOT) {
+			entry->seq_window = 0;
+			entry->seq_rejoin = false;
+		} else {
+			entry->seq_rejoin = true;
+		}
+		#endif /* VAMP_DATA_SEQ */
 
 		/* Formamos la respuesta para el nodo solicitante */
 
@@ -301,7 +782,7 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 		}
 
 		/* Marcar como activo */
-		entry->status = VAMP_DEV_STATUS_ACTIVE; 
+		vamp_set_entry_status(entry, VAMP_DEV_STATUS_ACTIVE);
 
 		return;
 	}
@@ -313,7 +794,9 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 		printf("[GW] PING\n");
 		#endif /* VAMP_DEBUG */
 
-		/* ... */
+		/* Con VAMP_WSN_ACK_PAYLOAD los nodos envían PINGs (con su ID compacto)
+		para recoger la respuesta precargada en el ACK, que ya entregó el
+		chip, asi que no hay nada que responder */
 
 		return;
 
@@ -363,11 +846,54 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 			#endif /* VAMP_DEBUG */
 
 			uint8_t response[VAMP_MAX_PAYLOAD_SIZE];
-			response[0] = strlen(entry->data_buff);
-			response[1] = 0xFF;
-			memcpy(&response[2], entry->data_buff, response[0]);
+			uint16_t offset = 0;
+			bool paged = false;
+
+			#ifdef VAMP_POLL_PAGING
+			/* POLL con offset: el nodo recorre la respuesta por páginas */
+			if (len >= VAMP_POLL_PAGED_REQ_LEN) {
+				paged = true;
+				offset = ((uint16_t)cmd[4] << 8) | cmd[5];
+
+				/* Al pedir la primera página se comprime, una vez por respuesta. Si
+				no se achica queda como está */
+				if (offset == 0 && (cmd[6] & VAMP_POLL_ACCEPT_LZSS) && !entry->data_lzss &&
+						entry->data_len > VAMP_POLL_PAGE_SIZE) {
+					size_t packed = vamp_lzss_encode((const uint8_t *)entry->data_buff, entry->data_len,
+							poll_lzss_buff, entry->data_len - 1);
+					if (packed > 0) {
+						#ifdef VAMP_DEBUG
+						printf("[GW] Response for %02X compressed %u -> %u\n", entry->wsn_id,
+								entry->data_len, (unsigned)packed);
+						#endif /* VAMP_DEBUG */
+						memcpy(entry->data_buff, poll_lzss_buff, packed);
+						entry->data_len = (uint16_t)packed;
+						entry->data_lzss = true;
+					}
+				}
+			}
+			#endif /* VAMP_POLL_PAGING */
+
+			/* La página desde offset, el POLL corto solo recibe la primera. El largo
+			es el guardado, la respuesta puede ser binaria (vamp_pack) */
+			uint16_t page = offset < entry->data_len ? entry->data_len - offset : 0;
+			bool last = true;
+			if (page > VAMP_POLL_PAGE_SIZE) {
+				page = VAMP_POLL_PAGE_SIZE;
+				last = !paged;
+			}
+
+			response[0] = (uint8_t)page;
+			if (entry->data_lzss) {
+				response[1] = last ? VAMP_POLL_END_LZSS : VAMP_POLL_MORE_LZSS;
+			} else {
+				response[1] = last ? VAMP_POLL_END : VAMP_POLL_MORE;
+			}
+			if (page) {
+				memcpy(&response[VAMP_POLL_HDR_LEN], entry->data_buff + offset, page);
+			}
 
-			vamp_wsn_send(entry->rf_id, response, 2 + response[0]);
+			vamp_wsn_send(entry->rf_id, response, VAMP_POLL_HDR_LEN + page);
 
 		} else {
 			/* Si el ticket no coincide, se ignora la solicitud */
@@ -380,6 +906,52 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 
 	}
 
+	/* Fragmento de un mensaje mayor que una trama */
+	if (cmd[0] == VAMP_FRAG) {
+		vamp_gw_process_frag(cmd, len);
+		return;
+	}
+
+	#ifdef VAMP_WSN_SUBADDR
+	/* Alarma: se reencamina ya, sin esperar en la caché ni en la cola */
+	if (cmd[0] == VAMP_ALARM) {
+
+		if (len < VAMP_ALARM_HDR_LEN || cmd[2] >= VAMP_MAX_PROFILES) {
+			#ifdef VAMP_DEBUG
+			printf("[GW] ALARM inválida\n");
+			#endif /* VAMP_DEBUG */
+			return;
+		}
+
+		/* Las alarmas de nodos de otro gateway llegan igual, la dirección las descarta */
+		if (memcmp(&cmd[VAMP_ALARM_GW_OFFSET], vamp_get_local_wsn_addr(), VAMP_ADDR_LEN) != 0) {
+			#ifdef VAMP_DEBUG
+			printf("[GW] ALARM para otro gateway: ");
+			vamp_debug_msg(&cmd[VAMP_ALARM_GW_OFFSET], VAMP_ADDR_LEN);
+			#endif /* VAMP_DEBUG */
+			return;
+		}
+
+		vamp_entry_t * entry = vamp_get_table_entry(VAMP_GET_INDEX(cmd[1]));
+		if (!entry || entry->wsn_id != cmd[1] || entry->status != VAMP_DEV_STATUS_ACTIVE) {
+			#ifdef VAMP_DEBUG
+			printf("[GW] ALARM de nodo desconocido o inactivo: %02X\n", cmd[1]);
+			#endif /* VAMP_DEBUG */
+			return;
+		}
+
+		#ifdef VAMP_DEBUG
+		printf("[GW] ALARM de %02X, perfil %d\n", entry->wsn_id, cmd[2]);
+		#endif /* VAMP_DEBUG */
+
+		gw_stats.alarms++;
+		forward_urgent = true;
+		vamp_gw_forward(entry, cmd[2], &cmd[VAMP_ALARM_HDR_LEN], len - VAMP_ALARM_HDR_LEN);
+		forward_urgent = false;
+		return;
+	}
+	#endif /* VAMP_WSN_SUBADDR */
+
 	/* Comando no reconocido */
 
 	#ifdef VAMP_DEBUG
@@ -390,211 +962,796 @@ void vamp_gw_process_command(uint8_t * cmd, uint8_t len) {
 
 }
 
-bool vamp_gw_process_data(uint8_t * data, uint8_t len) {
+#ifdef VAMP_COALESCE
+/** Clave del request que hace el perfil. Solo se agrupan los GET de HTTP/HTTPS y
+ * CoAP, que no tienen efectos y no envían el cuerpo: dos nodos con el mismo
+ * endpoint, parámetros y opciones reciben la misma respuesta
+ * @return false si el request no se puede agrupar (o la clave es muy larga)
+ */
+static bool vamp_gw_request_key(const vamp_profile_t * profile, vamp_coalesce_key_t * key) {
 
-	/* El primer byte contiene el protocolo: [C=0][PP][LLLLL] */
-	uint8_t profile_index = VAMP_WSN_GET_PROFILE(data[0]);
-	uint8_t rec_len = VAMP_WSN_GET_LENGTH(data[0]);
+	vamp_coalesce_key_init(key);
 
-	/* Manejar escape de longitud (si length == 31, el siguiente byte tiene la longitud real) */
-	uint8_t data_offset = 2; // Por defecto: [protocol][wsn_id][data...]
-	if (rec_len == VAMP_WSN_LENGTH_ESCAPE) {
-		rec_len = data[2];
-			data_offset = 3; // [protocol][wsn_id][length][data...]
-		}
+	if (profile->method != VAMP_HTTP_METHOD_GET || !profile->endpoint_resource) {
+		return false;
+	}
+	if (profile->protocol != VAMP_PROTOCOL_HTTP && profile->protocol != VAMP_PROTOCOL_HTTPS &&
+			profile->protocol != VAMP_PROTOCOL_COAP) {
+		return false;
+	}
 
-	/* Verificar que la longitud es válida */
-	if ((rec_len > (VAMP_MAX_PAYLOAD_SIZE - data_offset)) || ((rec_len + data_offset) != len)) {
-			#ifdef VAMP_DEBUG
-			printf("[WSN] invalid data length: rec_len=%d, data_offset=%d, len=%d\n", rec_len, data_offset, len);
-			#endif /* VAMP_DEBUG */
-			return false; // Longitud inválida
-		}
+	char protocol[4];
+	snprintf(protocol, sizeof(protocol), "%u", profile->protocol);
 
-		/* Verificar que el perfil es válido */
-		if (profile_index >= VAMP_MAX_PROFILES) {
-			#ifdef VAMP_DEBUG
-			printf("[WSN] invalid profile index: %d\n", profile_index);
-			#endif /* VAMP_DEBUG */
-			return false; // Perfil inválido
+	vamp_coalesce_key_add(key, protocol);
+	vamp_coalesce_key_add(key, profile->endpoint_resource);
+	for (uint8_t i = 0; i < profile->query_params.count && profile->query_params.pairs; i++) {
+		vamp_coalesce_key_add(key, profile->query_params.pairs[i].key);
+		vamp_coalesce_key_add(key, profile->query_params.pairs[i].value);
+	}
+	/* Las directivas no cambian el request */
+	for (uint8_t i = 0; i < profile->protocol_options.count && profile->protocol_options.pairs; i++) {
+		if (vamp_kv_is_directive(profile->protocol_options.pairs[i].key)) {
+			continue;
 		}
+		vamp_coalesce_key_add(key, profile->protocol_options.pairs[i].key);
+		vamp_coalesce_key_add(key, profile->protocol_options.pairs[i].value);
+	}
 
-		const uint8_t node_index = VAMP_GET_INDEX(data[1]);
-		vamp_entry_t * entry = vamp_get_table_entry(node_index);
+	/* Una clave que no cupo no se puede comparar */
+	return vamp_coalesce_key_valid(key);
+}
 
-		if (!entry) {
-			#ifdef VAMP_DEBUG
-			printf("[WSN] entry not found for index: %d\n", node_index);
-			#endif /* VAMP_DEBUG */
-			return false; // Entrada no encontrada
-		}
+/* TTL (ms) de la respuesta en la caché, directiva "vamp_cache" del perfil (0 = sin caché) */
+static uint32_t vamp_gw_cache_ttl(const vamp_profile_t * profile) {
+	const char * ttl = vamp_kv_get(&profile->protocol_options, VAMP_CACHE_OPTION);
+	return ttl ? (uint32_t)strtoul(ttl, NULL, 10) : 0;
+}
+#endif /* VAMP_COALESCE */
+
+#ifdef VAMP_HTTP_ASYNC
+/* Encolar el mensaje para el cliente HTTP no bloqueante, o sumarlo al mismo
+request si ya hay uno encolado o en vuelo */
+static bool vamp_gw_uplink_push(vamp_entry_t * entry, uint8_t profile_index, const char * body, size_t len) {
 
-		if (entry->status != VAMP_DEV_STATUS_ACTIVE) {
+	/* La respuesta anterior no corresponde al ticket nuevo */
+	if (entry->data_buff) {
+		entry->data_buff[0] = '\0';
+	}
+	entry->data_len = 0;
+	entry->data_lzss = false;
+
+	#ifdef VAMP_COALESCE
+	const vamp_profile_t * profile = &vamp_get_entry_profiles(VAMP_GET_INDEX(entry->wsn_id))[profile_index];
+	vamp_coalesce_key_t request_key;
+	uint8_t flight = VAMP_COALESCE_FULL;
+	if (vamp_gw_request_key(profile, &request_key)) {
+		flight = vamp_coalesce_join(&request_key, entry->wsn_id, entry->ticket);
+		if (flight == VAMP_COALESCE_JOINED) {
 			#ifdef VAMP_DEBUG
-			printf("[WSN] entry not active for device: %02X\n", entry->wsn_id);
+			printf("[GW] Uplink from %02X joined a request in flight\n", entry->wsn_id);
 			#endif /* VAMP_DEBUG */
-			return false; // Entrada no activa
+			gw_stats.coalesced++;
+			return true;
 		}
+	}
+	#endif /* VAMP_COALESCE */
 
-		/* Verificar que el dispositivo tiene el perfil solicitado */
-		const vamp_profile_t * profile = &entry->profiles[profile_index];
-		if (!profile) {
-			#ifdef VAMP_DEBUG
-			printf("[WSN] profile %d not configured for device: %02X\n", profile_index, entry->wsn_id);
-			#endif /* VAMP_DEBUG */
-			return false; // Perfil no configurado
+	vamp_uplink_t * uplink = uplink_queue.reserve();
+	if (!uplink || len >= sizeof(uplink->body)) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] Uplink from %02X dropped (%s)\n", entry->wsn_id, uplink ? "too large" : "queue full");
+		#endif /* VAMP_DEBUG */
+		#ifdef VAMP_COALESCE
+		if (flight == VAMP_COALESCE_LEADER) {
+			vamp_coalesce_finish(request_key.hash, NULL, 0);
 		}
+		#endif /* VAMP_COALESCE */
+		gw_stats.uplink_dropped++;
+		return false;
+	}
+
+	uplink->wsn_id = entry->wsn_id;
+	uplink->profile_index = profile_index;
+	uplink->ticket = entry->ticket;
+	uplink->len = (uint16_t)len;
+	uplink->vreg = false;
+	#ifdef VAMP_PREFETCH
+	uplink->prefetch = false;
+	#endif /* VAMP_PREFETCH */
+	#ifdef VAMP_COALESCE
+	uplink->coalesced = flight == VAMP_COALESCE_LEADER;
+	uplink->request_key = request_key.hash;
+	uplink->cache_ttl = vamp_gw_cache_ttl(profile);
+	#endif /* VAMP_COALESCE */
+	memcpy(uplink->body, body, len);
+	uplink->body[len] = '\0';
+	uplink_queue.commit();
+
+	gw_stats.forwarded++;
+	return true;
+}
 
-		/* Actualizar la última actividad del dispositivo */
-		entry->last_activity = millis();
+/* Respuesta del endpoint: solo sirve si el nodo sigue esperando ese ticket */
+static void vamp_gw_uplink_deliver(uint8_t wsn_id, uint16_t ticket, const char * data, size_t len) {
 
+	vamp_entry_t * entry = vamp_get_table_entry(VAMP_GET_INDEX(wsn_id));
+	if (!entry || entry->wsn_id != wsn_id || entry->ticket != ticket || !entry->data_buff) {
 		#ifdef VAMP_DEBUG
-		printf("[WSN] received from device %02X, profile %d, resource: %s\n", 
-				(entry->wsn_id & 0x7F), 
-				profile_index, 
-					profile->endpoint_resource ? profile->endpoint_resource : "N/A");
-		printf("[WSN] data: %s\n", &data[data_offset]);
-		//vamp_debug_msg(&data[data_offset], rec_len);
+		printf("[GW] Response for %02X ticket %u is stale\n", wsn_id, ticket);
 		#endif /* VAMP_DEBUG */
+		return;
+	}
 
-		/** Como la respuesta del servidor puede demorar y 
-		probablemente el mote no resuelva nada con ella
-		le respondemos con un TICKET para que el mote sepa que
-		al menos su tarea fue recibida
-		@note que por cada TICKET que se envie se incrementa el ticket
-		y como en este caso hay un solo buffer, pues se recuerda un
-		solo ticket por cada comunicación, si no se hace polling el 
-		ticket se pierde.
-		*/		
-		entry->ticket++;
-		vamp_wsn_send_ticket(entry->rf_id, entry->ticket);
+	vamp_gw_set_response(entry, data, len);
 
+	#ifdef VAMP_DEBUG
+	printf("Datos recibidos del endpoint: %s\n", entry->data_buff);
+	#endif /* VAMP_DEBUG */
+}
 
-		/** ---------------------- Preparar envío al endpoint ---------------------- * 
-		* ToDo!!!
-		* Esta parte queda como muy especifica de la aplicacion farm, pues se construye un json
-		* con datetime, gw_id y data que es lo que este endpoint en particular espera
-		* por lo tanto en una aplicacion generica esto habria que modificarlo
-		*/
-		/* ToDo HAY QUE RESISAR ESTO!!! */
-		#ifdef ARDUINOJSON_AVAILABLE
-		/* Reutilizar documento JSON estático (NO crear en stack cada vez) */
-		json_payload_doc.clear();
-		
-		/* Obtener fecha/hora actual del RTC */
-		char datetime_buf[DATE_TIME_BUFF];
-		datetime_buf[0] = '\0';
-		rtc_get_utc_time(datetime_buf);
-		json_payload_doc["datetime"] = datetime_buf;
-
-		/* Agregar gateway_id */
-		json_payload_doc["gw"] = gateway_conf->vamp.gw_id ? gateway_conf->vamp.gw_id : "";
-				
-		/* Agregar datos */
-		char to_send_data[VAMP_MAX_PAYLOAD_SIZE];
-		to_send_data[0] = '\0';
-		if (rec_len > 0 && rec_len < VAMP_MAX_PAYLOAD_SIZE) {
-			memcpy(to_send_data, &data[data_offset], rec_len);
-			to_send_data[rec_len] = '\0';
-			json_payload_doc["data"] = to_send_data;
+/* Sacar el mensaje terminado de la cola. Con una respuesta (> 0) también la reciben
+los nodos que se sumaron al mismo request, con un error se pierde para todos */
+static void vamp_gw_uplink_pop(const vamp_uplink_t * uplink, const char * data, int16_t result) {
+
+	#ifdef VAMP_COALESCE
+	if (uplink->coalesced) {
+		if (result > 0) {
+			size_t len = (size_t)result > VAMP_RESPONSE_MAX_SIZE ? VAMP_RESPONSE_MAX_SIZE : (size_t)result;
+			vamp_coalesce_store_flight(uplink->request_key, data, len, uplink->cache_ttl, millis());
+		}
+
+		vamp_coalesce_waiter_t waiters[VAMP_COALESCE_WAITERS];
+		uint8_t count = vamp_coalesce_finish(uplink->request_key, waiters, VAMP_COALESCE_WAITERS);
+
+		if (result > 0) {
+			for (uint8_t i = 0; i < count; i++) {
+				vamp_gw_uplink_deliver(waiters[i].wsn_id, waiters[i].ticket, data, (size_t)result);
+			}
+		} else if (result == VAMP_REQUEST_ERROR) {
+			gw_stats.uplink_dropped += count;
+		}
+	}
+	#endif /* VAMP_COALESCE */
+
+	#ifdef VAMP_PREFETCH
+	if (uplink->prefetch) {
+		int16_t len = result > VAMP_RESPONSE_MAX_SIZE ? VAMP_RESPONSE_MAX_SIZE : result;
+		vamp_prefetch_done(uplink->wsn_id, uplink->profile_index, data, len > 0 ? len : -1);
+	}
+	#endif /* VAMP_PREFETCH */
+
+	(void)uplink;
+	(void)data;
+	(void)result;
+	uplink_queue.pop();
+}
+
+#ifdef VAMP_PREFETCH
+/* Anticipación (ms) del prefetch del perfil, 0 si no se hace. Solo los GET de
+HTTP/HTTPS, la opción VAMP_PREFETCH_OPTION cambia VAMP_PREFETCH_LEAD */
+static uint32_t vamp_gw_prefetch_lead(const vamp_profile_t * profile) {
+
+	if (profile->method != VAMP_HTTP_METHOD_GET || !profile->endpoint_resource ||
+			(profile->protocol != VAMP_PROTOCOL_HTTP && profile->protocol != VAMP_PROTOCOL_HTTPS)) {
+		return 0;
+	}
+
+	const char * lead = vamp_kv_get(&profile->protocol_options, VAMP_PREFETCH_OPTION);
+	return lead ? (uint32_t)strtoul(lead, NULL, 10) : VAMP_PREFETCH_LEAD;
+}
+
+/* Encolar el prefetch que toca, con la cola libre */
+static void vamp_gw_prefetch_push(void) {
+
+	uint8_t wsn_id;
+	uint8_t profile_index;
+	if (!vamp_prefetch_due(millis(), &wsn_id, &profile_index)) {
+		return;
+	}
+
+	vamp_entry_t * entry = vamp_get_table_entry(VAMP_GET_INDEX(wsn_id));
+	const vamp_profile_t * profile = &vamp_get_entry_profiles(VAMP_GET_INDEX(wsn_id))[profile_index];
+	if (!entry || entry->wsn_id != wsn_id || vamp_gw_prefetch_lead(profile) == 0) {
+		vamp_prefetch_drop(wsn_id, profile_index);
+		return;
+	}
+
+	#ifdef VAMP_COALESCE
+	/* Un request igual ya está en vuelo, su respuesta no sirve para el próximo pedido */
+	vamp_coalesce_key_t request_key;
+	bool keyed = vamp_gw_request_key(profile, &request_key);
+	if (keyed && vamp_coalesce_pending(&request_key)) {
+		vamp_prefetch_done(wsn_id, profile_index, NULL, -1);
+		return;
+	}
+	#endif /* VAMP_COALESCE */
+
+	vamp_uplink_t * uplink = uplink_queue.reserve();
+	if (!uplink) {
+		vamp_prefetch_done(wsn_id, profile_index, NULL, -1);
+		return;
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[GW] Prefetch for %02X, profile %u\n", wsn_id, profile_index);
+	#endif /* VAMP_DEBUG */
+
+	uplink->wsn_id = wsn_id;
+	uplink->profile_index = profile_index;
+	uplink->ticket = 0;
+	uplink->len = 0;
+	uplink->body[0] = '\0';
+	uplink->vreg = false;
+	uplink->prefetch = true;
+	#ifdef VAMP_COALESCE
+	/* Los nodos que pidan mientras tanto esperan esta respuesta */
+	uplink->coalesced = keyed && vamp_coalesce_join(&request_key, wsn_id, 0) == VAMP_COALESCE_LEADER;
+	uplink->request_key = request_key.hash;
+	uplink->cache_ttl = vamp_gw_cache_ttl(profile);
+	#endif /* VAMP_COALESCE */
+	uplink_queue.commit();
+}
+#endif /* VAMP_PREFETCH */
+
+/* Avanzar el request en vuelo o arrancar el siguiente de la cola */
+bool vamp_gw_uplink_poll(void) {
+
+	vamp_uplink_t * uplink = uplink_queue.front();
+	if (!uplink) {
+		#ifdef VAMP_PREFETCH
+		vamp_gw_prefetch_push();
+		#endif /* VAMP_PREFETCH */
+		return false;
+	}
+
+	/* Un prefetch o una consulta al VREG no son mensajes de un nodo: no se
+	entregan ni cuentan como perdidos */
+	bool from_node = !uplink->vreg;
+	#ifdef VAMP_PREFETCH
+	from_node = from_node && !uplink->prefetch;
+	#endif /* VAMP_PREFETCH */
+
+	if (!uplink_in_flight) {
+		const vamp_profile_t * profile = &vamp_vreg_profile;
+		if (uplink->vreg) {
+			/* La consulta se arma recién ahora, la sincronización también usa query_params */
+			vamp_gw_join_query();
 		} else {
-			json_payload_doc["data"] = "";
+			vamp_entry_t * entry = vamp_get_table_entry(VAMP_GET_INDEX(uplink->wsn_id));
+			if (!entry || entry->wsn_id != uplink->wsn_id) {
+				/* El nodo dejó la tabla mientras esperaba */
+				vamp_gw_uplink_pop(uplink, NULL, VAMP_REQUEST_ERROR);
+				return false;
+			}
+			profile = &vamp_get_entry_profiles(VAMP_GET_INDEX(uplink->wsn_id))[uplink->profile_index];
+		}
+
+		if (!vamp_iface_request_start(profile, uplink->body, uplink->len)) {
+			if (uplink->vreg) {
+				/* VREG sin cliente no bloqueante (no es http/https): como antes */
+				vamp_gw_join_resolved(vamp_gw_vreg_query());
+			} else if (from_node) {
+				gw_stats.uplink_dropped++;
+			}
+			vamp_gw_uplink_pop(uplink, NULL, VAMP_REQUEST_ERROR);
+			return false;
 		}
 
-		/* Serializar JSON al buffer */
-		size_t json_len = serializeJson(json_payload_doc, iface_buff, VAMP_IFACE_BUFF_SIZE - 1);
-		iface_buff[json_len] = '\0';
-		rec_len = json_len;
+		if (uplink->vreg) {
+			gw_stats.vreg_lookups++;
+		}
+		uplink_in_flight = true;
+		return true;
+	}
 
-		/* HAY QUE RESISAR ESTO!!! */
-		#endif /* ARDUINOJSON_AVAILABLE */
+	int16_t result = vamp_iface_request_poll(iface_buff, VAMP_IFACE_BUFF_SIZE);
+	if (result == VAMP_REQUEST_PENDING) {
+		return true;
+	}
 
-		/** ---------------------- /Preparar envío al endpoint ---------------------- */
+	if (uplink->vreg) {
+		/* Una respuesta que no se pudo leer (por ejemplo, más larga que
+		VAMP_HTTP_RX_MAX) se repite con el cliente bloqueante */
+		bool answered = result > 0 && vamp_gw_vreg_answer(iface_buff);
+		if (!answered && result != VAMP_REQUEST_ERROR) {
+			vamp_gw_join_query();
+			answered = vamp_gw_vreg_query();
+		}
+		vamp_gw_join_resolved(answered);
+	} else if (!from_node) {
+		/* La respuesta queda en el prefetch */
+	} else if (result > 0) {
+		vamp_gw_uplink_deliver(uplink->wsn_id, uplink->ticket, iface_buff, (size_t)result);
+	} else if (result == VAMP_REQUEST_ERROR) {
+		gw_stats.uplink_dropped++;
+	}
 
-		/** ---------------------- Guarda en la SD ---------------------- */
+	uplink_in_flight = false;
+	vamp_gw_uplink_pop(uplink, iface_buff, result);
+	return false;
+}
+#endif /* VAMP_HTTP_ASYNC */
+
+/** Reencaminar hacia el endpoint del perfil un mensaje completo del nodo, ya
+ * sea de una sola trama o reensamblado a partir de fragmentos. Responde al
+ * nodo con un TICKET y guarda la respuesta del endpoint en data_buff.
+ * @param entry Entrada activa del nodo
+ * @param profile_index Perfil (0-3) por el que se envía
+ * @param payload Datos del nodo (sin encabezado)
+ * @param rec_len Longitud de los datos
+ * @return true si el mensaje se procesó
+ */
+static bool vamp_gw_forward(vamp_entry_t * entry, uint8_t profile_index, const uint8_t * payload, uint16_t rec_len) {
 
-		#ifdef VAMP_SD
-		/* Construir nombre del archivo: /data_mote/{node_id}.json */
-		char filepath[32];
-		snprintf(filepath, sizeof(filepath), "/data_mote/%02X%02X%02X%02X%02X.json",
-				entry->rf_id[0], entry->rf_id[1], entry->rf_id[2], 
-				entry->rf_id[3], entry->rf_id[4]);
-		
-		/* Abrir archivo en modo append (crea si no existe) */
-		File dataFile = SD.open(filepath, FILE_WRITE);
-		if (dataFile) {
-			/* Escribir línea JSON al final del archivo */
-			dataFile.println(iface_buff);
-			dataFile.close();
+	const vamp_profile_t * profile = &vamp_get_entry_profiles(VAMP_GET_INDEX(entry->wsn_id))[profile_index];
+
+	/* Actualizar la última actividad del dispositivo con el momento en que
+	el radio recibió la trama, no cuando se procesa */
+	entry->last_activity = vamp_wsn_get_rx_time();
+
+	#ifdef VAMP_DEBUG
+	printf("[WSN] received from device %02X, profile %d, resource: %s\n", 
+			(entry->wsn_id & 0x7F), 
+			profile_index, 
+				profile->endpoint_resource ? profile->endpoint_resource : "N/A");
+	printf("[WSN] data: %.*s\n", (int)rec_len, (const char *)payload);
+	#endif /* VAMP_DEBUG */
+
+	/** Como la respuesta del servidor puede demorar y 
+	probablemente el mote no resuelva nada con ella
+	le respondemos con un TICKET para que el mote sepa que
+	al menos su tarea fue recibida
+	@note que por cada TICKET que se envie se incrementa el ticket
+	y como en este caso hay un solo buffer, pues se recuerda un
+	solo ticket por cada comunicación, si no se hace polling el 
+	ticket se pierde.
+	*/		
+	entry->ticket++;
+	vamp_wsn_send_ticket(entry->rf_id, entry->ticket);
+
+
+	/** ---------------------- Preparar envío al endpoint ---------------------- * 
+	* ToDo!!!
+	* Esta parte queda como muy especifica de la aplicacion farm, pues se construye un json
+	* con datetime, gw_id y data que es lo que este endpoint en particular espera
+	* por lo tanto en una aplicacion generica esto habria que modificarlo
+	*/
+	/* ToDo HAY QUE RESISAR ESTO!!! */
+	#ifdef ARDUINOJSON_AVAILABLE
+	/* Reutilizar documento JSON estático (NO crear en stack cada vez) */
+	json_payload_doc.clear();
+	
+	/* Obtener fecha/hora actual del RTC */
+	char datetime_buf[DATE_TIME_BUFF];
+	datetime_buf[0] = '\0';
+	rtc_get_utc_time(datetime_buf);
+	json_payload_doc["datetime"] = datetime_buf;
+
+	/* Agregar gateway_id */
+	json_payload_doc["gw"] = gateway_conf->vamp.gw_id ? gateway_conf->vamp.gw_id : "";
 			
+	/* Agregar datos */
+	char to_send_data[VAMP_FRAG_MAX_MSG_SIZE + 1];
+	to_send_data[0] = '\0';
+	if (rec_len > 0 && rec_len <= VAMP_FRAG_MAX_MSG_SIZE) {
+		memcpy(to_send_data, payload, rec_len);
+		to_send_data[rec_len] = '\0';
+		/* Como const char * el documento guarda solo el puntero, el buffer
+		sigue vivo hasta serializar */
+		json_payload_doc["data"] = (const char *)to_send_data;
+	} else {
+		json_payload_doc["data"] = "";
+	}
+
+	/* Serializar JSON al buffer */
+	size_t json_len = serializeJson(json_payload_doc, iface_buff, VAMP_IFACE_BUFF_SIZE - 1);
+	iface_buff[json_len] = '\0';
+
+	/* HAY QUE RESISAR ESTO!!! */
+	#endif /* ARDUINOJSON_AVAILABLE */
+
+	/** ---------------------- /Preparar envío al endpoint ---------------------- */
+
+	/** ---------------------- Guarda en la SD ---------------------- */
+
+	#ifdef VAMP_SD
+	/* Construir nombre del archivo: /data_mote/{node_id}.json */
+	char filepath[32];
+	snprintf(filepath, sizeof(filepath), "/data_mote/%02X%02X%02X%02X%02X.json",
+			entry->rf_id[0], entry->rf_id[1], entry->rf_id[2], 
+			entry->rf_id[3], entry->rf_id[4]);
+	
+	/* Abrir archivo en modo append (crea si no existe) */
+	File dataFile = SD.open(filepath, FILE_WRITE);
+	if (dataFile) {
+		/* Escribir línea JSON al final del archivo */
+		dataFile.println(iface_buff);
+		dataFile.close();
+		
+		#ifdef VAMP_DEBUG
+		printf("[SD] Guardado en %s\n", filepath);
+		#endif
+	} else {
+		#ifdef VAMP_DEBUG
+		printf("[SD] Error: No se pudo abrir %s\n", filepath);
+		#endif
+	}
+	#endif /* VAMP_SD */
+
+	/** ---------------------- /Guarda en la SD ---------------------- */
+
+	/** ---------------------- Enviar al endpoint ---------------------- */
+
+	/* Enviar con el perfil completo (método/endpoint/params) */
+	if (!profile->endpoint_resource || profile->endpoint_resource[0] == '\0') {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] empty endpoint resource, not sending to internet\n");
+		#endif /* VAMP_DEBUG */
+		return false;
+	}
+
+	#ifdef VAMP_PREFETCH
+	/* Respuesta pedida por adelantado, también aprende el periodo del nodo */
+	if (entry->data_buff && !forward_urgent) {
+		int16_t prefetched = vamp_prefetch_ask(entry->wsn_id, profile_index, vamp_gw_prefetch_lead(profile),
+				entry->data_buff, VAMP_RESPONSE_MAX_SIZE + 1, entry->last_activity);
+		if (prefetched >= 0) {
+			entry->data_len = (uint16_t)prefetched;
+			entry->data_lzss = false;
+			gw_stats.upstream_saved++;
 			#ifdef VAMP_DEBUG
-			printf("[SD] Guardado en %s\n", filepath);
-			#endif
-		} else {
+			printf("[GW] Prefetched response for %02X: %s\n", entry->wsn_id, entry->data_buff);
+			#endif /* VAMP_DEBUG */
+			return true;
+		}
+	}
+	#endif /* VAMP_PREFETCH */
+
+	#ifdef VAMP_COALESCE
+	/* Respuesta reciente del mismo request, sin tocar la red */
+	vamp_coalesce_key_t request_key;
+	bool coalesce = !forward_urgent && vamp_gw_request_key(profile, &request_key);
+	if (coalesce && entry->data_buff && vamp_gw_cache_ttl(profile) > 0) {
+		char cached[VAMP_COALESCE_DATA_MAX + 1];
+		int16_t cached_len = vamp_coalesce_lookup(&request_key, cached, sizeof(cached), millis());
+		if (cached_len >= 0) {
+			vamp_gw_set_response(entry, cached, (size_t)cached_len);
+			gw_stats.coalesced++;
 			#ifdef VAMP_DEBUG
-			printf("[SD] Error: No se pudo abrir %s\n", filepath);
-			#endif
+			printf("[GW] Response for %02X from cache: %s\n", entry->wsn_id, entry->data_buff);
+			#endif /* VAMP_DEBUG */
+			return true;
 		}
-		#endif /* VAMP_SD */
+	}
+	#endif /* VAMP_COALESCE */
+
+	#ifdef VAMP_HTTP_ASYNC
+	/* HTTP sin bloquear: la respuesta llega en vamp_gw_uplink_poll() */
+	if (!forward_urgent && (profile->protocol == VAMP_PROTOCOL_HTTP || profile->protocol == VAMP_PROTOCOL_HTTPS)) {
+		return vamp_gw_uplink_push(entry, profile_index, iface_buff, json_len);
+	}
+	#endif /* VAMP_HTTP_ASYNC */
 
-		/** ---------------------- /Guarda en la SD ---------------------- */
+	/* El TICKET no puede esperar la próxima ráfaga mientras el request bloquea */
+	vamp_wsn_send_pending();
 
-		/** ---------------------- Enviar al endpoint ---------------------- */
+	gw_stats.forwarded++;
+	size_t rec_iface_len = vamp_iface_comm(profile, iface_buff, json_len, VAMP_IFACE_BUFF_SIZE);
 
-		/* Enviar con el perfil completo (método/endpoint/params) */
-		if (!profile->endpoint_resource || profile->endpoint_resource[0] == '\0') {
+	if(rec_iface_len > 0) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] respuesta desde el endpoint\n");
+		#endif /* VAMP_DEBUG */
+
+		/* Verificar que el buffer fue asignado en vamp_add_device() */
+		if (!entry->data_buff) {
 			#ifdef VAMP_DEBUG
-			printf("[WSN] empty endpoint resource, not sending to internet\n");
+			printf("[GW] Error: data_buff no inicializado\n");
 			#endif /* VAMP_DEBUG */
 			return false;
 		}
 
-		size_t rec_iface_len = vamp_iface_comm(profile, iface_buff, json_len);
+		/* Copiar datos al buffer pre-asignado */
+		vamp_gw_set_response(entry, iface_buff, rec_iface_len);
 
-		if(rec_iface_len > 0) {
-			#ifdef VAMP_DEBUG
-		printf("[GW] respuesta desde el endpoint\n");
+		#ifdef VAMP_COALESCE
+		if (coalesce) {
+			vamp_coalesce_store(&request_key, entry->data_buff, entry->data_len, vamp_gw_cache_ttl(profile), millis());
+		}
+		#endif /* VAMP_COALESCE */
+
+		#ifdef VAMP_DEBUG
+		printf("Datos recibidos del endpoint: %s\n", entry->data_buff);
 		#endif /* VAMP_DEBUG */
+		return true;
 
-			/* Verificar que el buffer fue asignado en vamp_add_device() */
-			if (!entry->data_buff) {
-				#ifdef VAMP_DEBUG
-				printf("[GW] Error: data_buff no inicializado\n");
-				#endif /* VAMP_DEBUG */
-				return false;
-			}
+	}
 
-			/* Limitar al tamaño del buffer pre-asignado */
-			if (rec_iface_len > VAMP_MAX_PAYLOAD_SIZE) {
-				rec_iface_len = VAMP_MAX_PAYLOAD_SIZE;
-			}
+	/* Procesamiento exitoso */
+	return true;
+}
 
-			/* Copiar datos al buffer pre-asignado */
-			memcpy(entry->data_buff, iface_buff, rec_iface_len);
-			entry->data_buff[rec_iface_len] = '\0'; // Asegurar terminación
+/** Buscar el slot de reensamblado para un nodo. Un nodo solo envía un mensaje
+ * fragmentado a la vez, asi que un ID de mensaje distinto reemplaza al anterior.
+ * Si el nodo no tiene slot se toma uno libre, uno ya terminado o el más antiguo.
+ */
+static vamp_frag_slot_t * vamp_gw_frag_slot(uint8_t wsn_id, bool create) {
 
+	vamp_frag_slot_t * candidate = NULL;
+	uint32_t now = millis();
+
+	for (uint8_t i = 0; i < VAMP_FRAG_SLOTS; i++) {
+
+		/* Liberar los reensamblados vencidos */
+		if (frag_slots[i].in_use && (now - frag_slots[i].last_time) > VAMP_FRAG_TIMEOUT) {
 			#ifdef VAMP_DEBUG
-			printf("Datos recibidos del endpoint: %s\n", entry->data_buff);
+			if (!frag_slots[i].done) {
+				printf("[FRAG] timeout for %02X, %d bytes dropped\n", frag_slots[i].wsn_id, frag_slots[i].len);
+			}
 			#endif /* VAMP_DEBUG */
-			return true;
+			frag_slots[i].in_use = false;
+		}
 
+		if (frag_slots[i].in_use && frag_slots[i].wsn_id == wsn_id) {
+			return &frag_slots[i];
 		}
 
-	/* Procesamiento exitoso */
+		/* Preferencia: libre > terminado > el más antiguo */
+		if (!candidate ||
+			(candidate->in_use && !frag_slots[i].in_use) ||
+			(candidate->in_use && !candidate->done && frag_slots[i].done) ||
+			(candidate->in_use && frag_slots[i].in_use && candidate->done == frag_slots[i].done &&
+			 frag_slots[i].last_time < candidate->last_time)) {
+			candidate = &frag_slots[i];
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	candidate->in_use = true;
+	candidate->done = false;
+	candidate->wsn_id = wsn_id;
+	candidate->len = 0;
+	return candidate;
+}
+
+/* Procesar un fragmento [0x87][ID][L|PP|MMMMM][offset][datos...] */
+static void vamp_gw_process_frag(uint8_t * frag, uint8_t len) {
+
+	if (len <= VAMP_FRAG_HDR_LEN) {
+		#ifdef VAMP_DEBUG
+		printf("[FRAG] too short: %d\n", len);
+		#endif /* VAMP_DEBUG */
+		return;
+	}
+
+	vamp_entry_t * entry = vamp_get_table_entry(VAMP_GET_INDEX(frag[1]));
+	if (!entry || entry->wsn_id != frag[1] || entry->status != VAMP_DEV_STATUS_ACTIVE) {
+		#ifdef VAMP_DEBUG
+		printf("[FRAG] unknown or inactive node: %02X\n", frag[1]);
+		#endif /* VAMP_DEBUG */
+		return;
+	}
+
+	const uint8_t hdr = frag[2];
+	const uint8_t offset = frag[3];
+	const uint8_t chunk_len = len - VAMP_FRAG_HDR_LEN;
+	const uint8_t msg_id = VAMP_FRAG_GET_MSG_ID(hdr);
+
+	/* El primer fragmento abre (o reinicia) el reensamblado, los demás
+	tienen que encontrar uno en curso para el mismo mensaje */
+	vamp_frag_slot_t * slot = vamp_gw_frag_slot(frag[1], offset == 0);
+	if (!slot) {
+		#ifdef VAMP_DEBUG
+		printf("[FRAG] no reassembly for %02X, offset %d\n", frag[1], offset);
+		#endif /* VAMP_DEBUG */
+		return;
+	}
+
+	if (slot->len == 0 || slot->msg_id != msg_id) {
+		if (offset != 0) {
+			/* Se perdió el inicio de este mensaje */
+			slot->in_use = false;
+			return;
+		}
+		slot->msg_id = msg_id;
+		slot->done = false;
+		slot->len = 0;
+	}
+
+	slot->last_time = millis();
+	entry->last_activity = vamp_wsn_get_rx_time();
+
+	/* Fragmento repetido (se perdió nuestra respuesta), se responde de nuevo */
+	if (offset < slot->len) {
+		if (slot->done && VAMP_FRAG_IS_LAST(hdr)) {
+			gw_stats.dup_frames++;
+			gw_stats.upstream_saved++;
+			vamp_wsn_send_ticket(entry->rf_id, entry->ticket);
+			return;
+		}
+		frag[0] = VAMP_FRAG | VAMP_IS_CMD_MASK;
+		frag[3] = (uint8_t)slot->len;
+		vamp_wsn_send(entry->rf_id, frag, VAMP_FRAG_HDR_LEN);
+		return;
+	}
+
+	/* Hueco o desborde: el mensaje ya no se puede completar */
+	if (offset > slot->len || (slot->len + chunk_len) > VAMP_FRAG_MAX_MSG_SIZE) {
+		#ifdef VAMP_DEBUG
+		printf("[FRAG] bad fragment for %02X: offset %d, have %d\n", frag[1], offset, slot->len);
+		#endif /* VAMP_DEBUG */
+		slot->in_use = false;
+		return;
+	}
+
+	memcpy(&slot->buff[slot->len], &frag[VAMP_FRAG_HDR_LEN], chunk_len);
+	slot->len += chunk_len;
+
+	if (!VAMP_FRAG_IS_LAST(hdr)) {
+		/* Confirmar con el offset que se espera a continuación */
+		frag[0] = VAMP_FRAG | VAMP_IS_CMD_MASK;
+		frag[3] = (uint8_t)slot->len;
+		vamp_wsn_send(entry->rf_id, frag, VAMP_FRAG_HDR_LEN);
+		return;
+	}
+
+	#ifdef VAMP_DEBUG
+	printf("[FRAG] message %d from %02X complete: %d bytes\n", msg_id, frag[1], slot->len);
+	#endif /* VAMP_DEBUG */
+
+	/* El slot queda como terminado para responder repeticiones del último
+	fragmento sin reencaminar el mensaje otra vez */
+	slot->done = true;
+	vamp_gw_forward(entry, VAMP_FRAG_GET_PROFILE(hdr), slot->buff, slot->len);
+}
+
+#ifdef VAMP_DATA_SEQ
+/** Ventana deslizante de secuencias por nodo (como la anti-replay de IPsec).
+ * seq_top es la secuencia más alta vista y el bit n de seq_window indica si se
+ * vio seq_top - n. La ventana vuelve a empezar cuando el nodo reinicia: con el
+ * JOIN_REQ de arranque (VAMP_JOIN_FLAG_BOOT), con la secuencia 0, con la primera
+ * trama después de un re-join o con una secuencia más vieja que la ventana (el 0
+ * se perdió). Solo se descartan las repetidas dentro de la ventana.
+ * @return true si la secuencia es nueva (y queda marcada), false si es repetida
+ */
+static bool vamp_gw_seq_check(vamp_entry_t * entry, uint8_t seq) {
+
+	/* Tras un re-join (JOIN_REQ sin VAMP_JOIN_FLAG_BOOT) solo es repetida la
+	última trama, que es la que reenvía vamp_fail_handle() */
+	bool rejoin = entry->seq_rejoin;
+	entry->seq_rejoin = false;
+	if (rejoin && entry->seq_window != 0 && seq == entry->seq_top) {
+		return false;
+	}
+
+	/* Primera trama o inicio de flujo, salvo que sea la repetición del propio 0 */
+	if (rejoin || entry->seq_window == 0 || (seq == 0 && !(entry->seq_top == 0 && (entry->seq_window & 1)))) {
+		entry->seq_top = seq;
+		entry->seq_window = 1;
+		return true;
+	}
+
+	uint8_t ahead = (uint8_t)(seq - entry->seq_top);
+
+	if (ahead == 0) {
+		return false;
+	}
+
+	/* Más nueva que la última: correr la ventana */
+	if (ahead < 128) {
+		entry->seq_window = (ahead >= VAMP_DATA_SEQ_WINDOW) ? 0 : (entry->seq_window << ahead);
+		entry->seq_window |= 1;
+		entry->seq_top = seq;
+		return true;
+	}
+
+	/* Más vieja que la ventana: el nodo reinició y se perdió su secuencia 0 */
+	uint8_t back = (uint8_t)(entry->seq_top - seq);
+	if (back >= VAMP_DATA_SEQ_WINDOW) {
+		entry->seq_top = seq;
+		entry->seq_window = 1;
+		return true;
+	}
+
+	/* Más vieja: buscarla en la ventana */
+	if (entry->seq_window & ((uint32_t)1 << back)) {
+		return false;
+	}
+
+	entry->seq_window |= ((uint32_t)1 << back);
 	return true;
 }
+#endif /* VAMP_DATA_SEQ */
 
-/* --------------- WSN --------------- */
+bool vamp_gw_process_data(uint8_t * data, uint8_t len) {
 
-int8_t vamp_gw_wsn(void) {
+	/* El primer byte contiene el protocolo: [C=0][PP][LLLLL] */
+	uint8_t profile_index = VAMP_WSN_GET_PROFILE(data[0]);
+	uint8_t rec_len = VAMP_WSN_GET_LENGTH(data[0]);
+
+	/* Manejar escape de longitud (si length == 31, el siguiente byte tiene la longitud real) */
+	uint8_t data_offset = 2; // Por defecto: [protocol][wsn_id][data...]
+	if (rec_len == VAMP_WSN_LENGTH_ESCAPE) {
+		rec_len = data[2];
+		data_offset = 3; // [protocol][wsn_id][length][data...]
+	}
+
+	/* El byte de secuencia va justo antes de los datos */
+	data_offset += VAMP_DATA_SEQ_LEN;
+
+	/* Verificar que la longitud es válida */
+	if ((rec_len > (VAMP_MAX_PAYLOAD_SIZE - data_offset)) || ((rec_len + data_offset) != len)) {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] invalid data length: rec_len=%d, data_offset=%d, len=%d\n", rec_len, data_offset, len);
+		#endif /* VAMP_DEBUG */
+		return false; // Longitud inválida
+	}
+
+	/* Verificar que el perfil es válido */
+	if (profile_index >= VAMP_MAX_PROFILES) {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] invalid profile index: %d\n", profile_index);
+		#endif /* VAMP_DEBUG */
+		return false; // Perfil inválido
+	}
 
-    /* Extraer el mensaje de la interface via callback */
-	int8_t recv_len = vamp_wsn_recv(wsn_buffer, VAMP_MAX_PAYLOAD_SIZE);
+	const uint8_t node_index = VAMP_GET_INDEX(data[1]);
+	vamp_entry_t * entry = vamp_get_table_entry(node_index);
 
-	if (recv_len <= 0) {
-		return recv_len; // No hay datos disponibles
+	if (!entry) {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] entry not found for index: %d\n", node_index);
+		#endif /* VAMP_DEBUG */
+		return false; // Entrada no encontrada
 	}
 
+	if (entry->status != VAMP_DEV_STATUS_ACTIVE) {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] entry not active for device: %02X\n", entry->wsn_id);
+		#endif /* VAMP_DEBUG */
+		return false; // Entrada no activa
+	}
+
+	#ifdef VAMP_DATA_SEQ
+	/* Trama repetida: el nodo no recibió nuestro TICKET y reintentó, se le
+	responde con el mismo ticket pero no se vuelve a enviar al endpoint */
+	if (!vamp_gw_seq_check(entry, data[data_offset - 1])) {
+		#ifdef VAMP_DEBUG
+		printf("[WSN] duplicate seq %d from %02X\n", data[data_offset - 1], entry->wsn_id);
+		#endif /* VAMP_DEBUG */
+		gw_stats.dup_frames++;
+		gw_stats.upstream_saved++;
+		entry->last_activity = vamp_wsn_get_rx_time();
+		vamp_wsn_send_ticket(entry->rf_id, entry->ticket);
+		return true;
+	}
+	#endif /* VAMP_DATA_SEQ */
+
+	return vamp_gw_forward(entry, profile_index, &data[data_offset], rec_len);
+}
+
+/* --------------- WSN --------------- */
+
+/* Atender una trama recibida, mismos códigos que vamp_gw_wsn() */
+static int8_t vamp_gw_wsn_frame(int8_t recv_len) {
+
+	#ifdef VAMP_WSN_SUBADDR
+	/* El pipe ya dice qué puede llegar: por el de alarmas y el de JOIN no se
+	acepta otra cosa */
+	uint8_t pipe = vamp_wsn_get_rx_pipe();
+	if ((pipe == VAMP_WSN_PIPE_ALARM && wsn_buffer[0] != (VAMP_IS_CMD_MASK | VAMP_ALARM)) ||
+			(pipe == VAMP_WSN_PIPE_JOIN && wsn_buffer[0] != (VAMP_IS_CMD_MASK | VAMP_JOIN_REQ))) {
+		#ifdef VAMP_DEBUG
+		printf("[GW] trama %02X no esperada en el pipe %d\n", wsn_buffer[0], pipe);
+		#endif /* VAMP_DEBUG */
+		return -1;
+	}
+	#endif /* VAMP_WSN_SUBADDR */
+
 	/* --------------------- Si es un comando --------------------- */
 	if (wsn_buffer[0] & VAMP_IS_CMD_MASK) {
 
@@ -619,3 +1776,48 @@ int8_t vamp_gw_wsn(void) {
 	return -3;
 }
 
+int8_t vamp_gw_wsn(void) {
+
+	int8_t result = 0;
+	int8_t recv_len = 0;
+	uint8_t frames = 0;
+
+	/* Procesar las tramas que esperan en el anillo antes de enviar las
+	respuestas, todas en la misma ráfaga. Queda el primer error, si no el
+	resultado de la última trama */
+	while (frames < VAMP_WSN_RX_DRAIN) {
+		/* Extraer el mensaje de la interface via callback */
+		recv_len = vamp_wsn_recv(wsn_buffer, VAMP_MAX_PAYLOAD_SIZE);
+		if (recv_len <= 0) {
+			break;
+		}
+		frames++;
+
+		int8_t frame_result = vamp_gw_wsn_frame(recv_len);
+		if (result >= 0 && frame_result != 0) {
+			result = frame_result;
+		}
+	}
+
+	if (recv_len < 0 && result >= 0) {
+		result = recv_len; // Error del radio
+	}
+
+	bool idle = frames == 0 && recv_len == 0;
+	if (idle) {
+		/* Sin tráfico de radio, momento de resolver los JOIN pendientes */
+		vamp_gw_join_background();
+	}
+
+	/* Las respuestas de esta vuelta salen ya: quien llama puede bloquearse y
+	el nodo solo escucha durante su ventana */
+	if (!vamp_wsn_send_pending() && result >= 0) {
+		result = -4;
+	}
+
+	if (idle) {
+		vamp_iface_loop();
+	}
+	return result;
+}
+
@@ -44,13 +44,8 @@
 #define VAMP_HTTP_METHOD_PUT 	2
 #define VAMP_HTTP_METHOD_DELETE 3
 
-/* Protocolos soportados  ??*/
-#define VAMP_PROTOCOL_HTTP    0
-#define VAMP_PROTOCOL_HTTPS   1
-#define VAMP_PROTOCOL_MQTT    2
-#define VAMP_PROTOCOL_COAP    3
-#define VAMP_PROTOCOL_WEBSOCKET 4
-//#define VAMP_PROTOCOL_CUSTOM  15    // Para protocolos definidos por usuario
+/* Protocolos soportados (VAMP_PROTOCOL_*) y su registro de transportes */
+#include "lib/vamp_transport.h"
 
 
 
@@ -76,13 +71,58 @@ void vamp_table_init(void);
 
 void vamp_table_sync(void);
 
+#ifdef VAMP_SYNC_LONGPOLL
+bool vamp_table_sync_longpoll(void);
+#endif /* VAMP_SYNC_LONGPOLL */
+
+/** @brief Contadores del gateway */
+typedef struct {
+	uint32_t forwarded;			// Mensajes reencaminados al endpoint
+	uint32_t dup_frames;		// Tramas repetidas descartadas
+	uint32_t upstream_saved;	// Solicitudes al endpoint o al VREG que se evitaron
+	uint32_t coalesced;			// GET resueltos por otro request en vuelo o por la caché (VAMP_COALESCE)
+	uint32_t vreg_lookups;		// Consultas de dispositivo hechas al VREG
+	uint32_t vreg_batched;		// Dispositivos resueltos en esas consultas
+	uint32_t neg_hits;			// JOIN rechazados por la caché negativa
+	uint32_t neg_misses;		// JOIN desconocidos que no estaban en la caché negativa
+	uint32_t bloom_rejects;		// JOIN rechazados por el filtro de Bloom del VREG
+	uint32_t bloom_bypasses;	// JOIN que el filtro rechazaba y se consultaron igual
+	uint32_t downlinks;			// Mensajes empujados por un backend a un nodo
+	uint32_t uplink_dropped;	// Mensajes HTTP no entregados: cola llena o request fallido
+	uint32_t alarms;			// Alarmas reencaminadas (VAMP_WSN_SUBADDR)
+} vamp_gw_stats_t;
+
+/** @brief Obtener una copia de los contadores del gateway */
+void vamp_gw_get_stats(vamp_gw_stats_t * stats);
+
+/** @brief Mensaje empujado por un backend (WebSocket) para un nodo
+ *  Formato {"rf_id":"<10 hex>","data":"..."}, data queda como respuesta pendiente
+ *  del nodo y la recibe en el próximo POLL con su último ticket
+ *  @param msg Mensaje, se parsea en el mismo buffer
+ *  @return true si se entregó al nodo
+ */
+bool vamp_gw_downlink(char * msg, size_t len);
+
+#ifdef VAMP_HTTP_ASYNC
+/** @brief Avanzar el request HTTP de un nodo que está en vuelo, o arrancar el
+ *  siguiente de la cola. La respuesta queda para el POLL con el ticket del mensaje
+ *  @return true si quedó un request en vuelo
+ */
+bool vamp_gw_uplink_poll(void);
+#endif /* VAMP_HTTP_ASYNC */
+
 /* ------------------- Gestion de mensajes WSN ------------------- */
 
 /** 
  * @brief Verificar si algun dispositivo VAMP nos contactó
  *  Esta función se encarga de verificar si algún dispositivo VAMP nos ha contactado
  *  y, en caso afirmativo, procesa la solicitud.
- * 	@return Codigo de estado:
+ *  En cada llamada se vacía la FIFO del radio hacia el anillo de recepción y se
+ *  procesan hasta VAMP_WSN_RX_DRAIN tramas del anillo, las más antiguas primero. Con VAMP_WSN_SUBADDR las alarmas se
+ *  procesan antes y el pipe por el que llegó la trama limita qué comando puede ser.
+ *  Con VAMP_WSN_TX_BATCH las respuestas de la vuelta se envían antes de volver.
+ * 	@return Codigo de estado (con varias tramas, el primer error o el de la última):
+ * 				-4 si alguna respuesta por radio no recibió ACK
  * 				-3 si hubo error en el procesamiento de datos
  * 				-2 en caso  error de conexión con el chip (o de timeout????)
  *           	-1 datos de entrada inválidos o error en el procesamiento,
@@ -111,6 +151,14 @@ bool vamp_gw_vreg_init(const gw_config_t * gw_config);
  */
 uint8_t vamp_get_vreg_device(const uint8_t * rf_id);
 
+/** @brief Cargar el filtro de Bloom con los RF_ID que conoce el VREG
+ *  @param bits Tamaño del filtro en bits, 0 para quitar el filtro
+ *  @param k Cantidad de funciones hash
+ *  @param hex Contenido del filtro en hex
+ *  @note Al cambiar el filtro se vacía la caché negativa
+ */
+void vamp_gw_set_vreg_bloom(uint16_t bits, uint8_t k, const char * hex);
+
 
 
 #endif // _VAMP_GW_H_
\ No newline at end of file